@@ -0,0 +1,303 @@
+// Copyright 2007 John Robinson
+
+// fillBench.cpp
+//
+// Fills and strokes large paths into a 1920x1080 buffer: the paths in
+// complex.data scaled up to fill the screen, a rounded rectangle background
+// and a line chart.  Runs every case with pxCanvas::setThreadCount set to 1,
+// 2, 4 ... up to the number of cpus.  Prints the best time per frame over a
+// few runs, the speedup over one thread and checks that the output is the
+// same as with one thread.
+//
+//  ./fillBench [-n frames] [-t threads] [complex.data]
+
+#include "pxCore.h"
+#include "pxOffscreen.h"
+#include "pxTimer.h"
+#include "pxCanvas.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <thread>
+
+#define WIDTH 1920
+#define HEIGHT 1080
+
+typedef std::vector<pxVertex> path;
+
+static bool loadPaths(const char* file, std::vector<path>& paths)
+{
+  FILE* f = fopen(file, "r");
+  if (!f)
+    return false;
+
+  std::vector<char> line(1 << 16);
+  std::string s;
+  while (fgets(&line[0], line.size(), f))
+  {
+    s += &line[0];
+    if (s.empty() || s[s.size()-1] != '\n')
+      continue;
+
+    path p;
+    const char* c = s.c_str();
+    char* e;
+    for (;;)
+    {
+      pxVertex v;
+      v.x = strtod(c, &e);
+      if (e == c || *e != ',')
+        break;
+      c = e+1;
+      v.y = strtod(c, &e);
+      if (e == c)
+        break;
+      p.push_back(v);
+      c = (*e == ',')?e+1:e;
+    }
+    if (p.size() > 1)
+      paths.push_back(p);
+    s.clear();
+  }
+  fclose(f);
+  return true;
+}
+
+// scale the paths to fill the screen
+static void fitPaths(std::vector<path>& paths)
+{
+  double right = 1, bottom = 1;
+  for (size_t i = 0; i < paths.size(); i++)
+  {
+    for (size_t j = 0; j < paths[i].size(); j++)
+    {
+      right = pxMax<double>(right, paths[i][j].x);
+      bottom = pxMax<double>(bottom, paths[i][j].y);
+    }
+  }
+
+  double scale = pxMin<double>(WIDTH/right, HEIGHT/bottom);
+  for (size_t i = 0; i < paths.size(); i++)
+  {
+    for (size_t j = 0; j < paths[i].size(); j++)
+    {
+      paths[i][j].x *= scale;
+      paths[i][j].y *= scale;
+    }
+  }
+}
+
+// a gradient to composite onto
+static void drawBackground(pxBuffer& b)
+{
+  for (int y = 0; y < b.height(); y++)
+  {
+    pxPixel* p = b.scanline(y);
+    for (int x = 0; x < b.width(); x++, p++)
+    {
+      p->r = (x + y) & 0xff;
+      p->g = y & 0xff;
+      p->b = x & 0xff;
+      p->a = 255;
+    }
+  }
+}
+
+static void drawTexture(pxBuffer& b)
+{
+  for (int y = 0; y < b.height(); y++)
+  {
+    pxPixel* p = b.scanline(y);
+    for (int x = 0; x < b.width(); x++, p++)
+    {
+      p->r = x*2;
+      p->g = y*2;
+      p->b = ((x >> 4) + (y >> 4)) & 1?255:64;
+      p->a = 255;
+    }
+  }
+}
+
+static void drawPaths(pxCanvas& canvas, const std::vector<path>& paths)
+{
+  for (size_t i = 0; i < paths.size(); i++)
+  {
+    const path& p = paths[i];
+    canvas.newPath();
+    canvas.moveTo(p[0].x, p[0].y);
+    for (size_t j = 1; j < p.size(); j++)
+      canvas.lineTo(p[j].x, p[j].y);
+    canvas.fill();
+  }
+}
+
+static void drawComplex(pxCanvas& canvas, const std::vector<path>& paths)
+{
+  canvas.setFillColor(0, 168, 255);
+  drawPaths(canvas, paths);
+}
+
+static void drawComplexAlpha(pxCanvas& canvas, const std::vector<path>& paths)
+{
+  canvas.setFillColor(0, 168, 255, 160);
+  drawPaths(canvas, paths);
+  canvas.setFillColor(0, 0, 0);
+}
+
+static void drawComplexTexture(pxCanvas& canvas, const std::vector<path>& paths)
+{
+  pxMatrix m;
+  m.identity();
+  m.rotate(0.3);
+  m.scale(3.3);
+  canvas.setTextureMatrix(m);
+  canvas.setBiLerp(true);
+  drawPaths(canvas, paths);
+}
+
+static void drawRoundRect(pxCanvas& canvas, const std::vector<path>&)
+{
+  canvas.setFillColor(40, 40, 40, 200);
+  canvas.roundRect(20.5, 20.5, WIDTH-41, HEIGHT-41, 64);
+  canvas.fill();
+  canvas.setFillColor(0, 0, 0);
+}
+
+static void drawChart(pxCanvas& canvas, const std::vector<path>&)
+{
+  canvas.newPath();
+  canvas.moveTo(0, HEIGHT);
+  for (int x = 0; x <= WIDTH; x += 8)
+    canvas.lineTo(x, HEIGHT/2 + sin(x/60.0)*HEIGHT/3 + sin(x/7.0)*20);
+  canvas.lineTo(WIDTH, HEIGHT);
+  canvas.lineTo(0, HEIGHT);
+  canvas.setFillColor(255, 128, 0, 128);
+  canvas.fill();
+
+  canvas.newPath();
+  for (int x = 0; x <= WIDTH; x += 8)
+  {
+    double y = HEIGHT/2 + cos(x/80.0)*HEIGHT/3;
+    if (x == 0)
+      canvas.moveTo(x, y);
+    else
+      canvas.lineTo(x, y);
+  }
+  canvas.setStrokeWidth(6);
+  canvas.setStrokeColor(255, 255, 255);
+  canvas.stroke();
+  canvas.setFillColor(0, 0, 0);
+}
+
+struct benchCase
+{
+  const char* name;
+  void (*draw)(pxCanvas& canvas, const std::vector<path>& paths);
+  bool texture;
+};
+
+static const benchCase cases[] =
+{
+  { "complex.data",            drawComplex,        false },
+  { "complex.data alpha",      drawComplexAlpha,   false },
+  { "complex.data bilinear",   drawComplexTexture, true  },
+  { "round rect background",   drawRoundRect,      false },
+  { "chart fill and stroke",   drawChart,          false },
+};
+
+int main(int argc, char* argv[])
+{
+  int frames = 5;
+  int maxThreads = (int)std::thread::hardware_concurrency();
+  int c;
+  while ((c = getopt(argc, argv, "n:t:")) != -1)
+  {
+    switch (c)
+    {
+      case 'n': frames = atoi(optarg); break;
+      case 't': maxThreads = atoi(optarg); break;
+      default:
+        fprintf(stderr, "usage: %s [-n frames] [-t threads] [complex.data]\n", argv[0]);
+        return 1;
+    }
+  }
+  if (maxThreads < 1)
+    maxThreads = 1;
+  const char* file = (optind < argc)?argv[optind]:"./complex.data";
+
+  std::vector<path> paths;
+  if (!loadPaths(file, paths))
+  {
+    fprintf(stderr, "could not read %s\n", file);
+    return 1;
+  }
+  fitPaths(paths);
+
+  printf("%dx%d, %d paths from %s, up to %d threads\n\n", WIDTH, HEIGHT,
+         (int)paths.size(), file, maxThreads);
+
+  pxOffscreen texture;
+  texture.init(256, 256);
+  drawTexture(texture);
+
+  pxOffscreen reference, offscreen;
+  reference.init(WIDTH, HEIGHT);
+  offscreen.init(WIDTH, HEIGHT);
+
+  int failed = 0;
+  for (size_t i = 0; i < sizeof(cases)/sizeof(cases[0]); i++)
+  {
+    const benchCase& bc = cases[i];
+    printf("%s\n", bc.name);
+
+    pxCanvas canvas;
+    canvas.initWithBuffer(&offscreen);
+    if (bc.texture)
+      canvas.setTexture(&texture);
+
+    double oneThread = 0;
+    for (int threads = 1; ; threads *= 2)
+    {
+      if (threads > maxThreads)
+        threads = maxThreads;
+      canvas.setThreadCount(threads);
+
+      drawBackground(offscreen);
+      bc.draw(canvas, paths);
+      bool same = true;
+      if (threads == 1)
+        memcpy(reference.base(), offscreen.base(), offscreen.sizeInBytes());
+      else
+        same = memcmp(reference.base(), offscreen.base(), offscreen.sizeInBytes()) == 0;
+
+      // best of a few runs, the machine may be busy
+      double ms = 0;
+      for (int run = 0; run < 5; run++)
+      {
+        double start = pxMilliseconds();
+        for (int f = 0; f < frames; f++)
+          bc.draw(canvas, paths);
+        double t = (pxMilliseconds() - start) / frames;
+        if (run == 0 || t < ms)
+          ms = t;
+      }
+      if (threads == 1)
+        oneThread = ms;
+
+      printf("  %2d threads %8.2f ms/frame  %5.2fx%s\n", threads, ms, oneThread/ms,
+             same?"":"  MISMATCH");
+      if (!same)
+        failed++;
+
+      if (threads == maxThreads)
+        break;
+    }
+  }
+
+  return failed?1:0;
+}
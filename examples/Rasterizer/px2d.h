@@ -179,6 +179,23 @@ inline bool pxPreMultipliedBlendBehind (
 }
 
 
+// Assumes premultiplied source and destination
+// d = s*a + d*(1-srcAlpha*a) where a is the coverage (0-255)
+inline void pxPreMultipliedBlend(uint32_t a, uint32_t &d, const uint32_t s)
+{
+  uint32 a1 = a + (a >> 7);   // 0-256
+
+  uint32 srcrb = ((( s       & 0xFF00FF) * a1) >> 8) & 0xFF00FF;
+  uint32 srcag = ((((s >> 8) & 0xFF00FF) * a1) >> 8) & 0xFF00FF;
+
+  uint32 alpha1 = 256 - (srcag >> 16);
+
+  uint32 dstrb = ((( d       & 0xFF00FF) * alpha1) >> 8) & 0xFF00FF;
+  uint32 dstag = ((((d >> 8) & 0xFF00FF) * alpha1) >> 8) & 0xFF00FF;
+
+  d = ((srcrb + dstrb) & 0xFF00FF) | (((srcag + dstag) & 0xFF00FF) << 8);
+}
+
 inline pxPixel pxBlend4(const pxPixel& s1, const pxPixel& s2, 
                         const pxPixel& s3, const pxPixel& s4, 
                         const uint32_t xp, const uint32_t yp)
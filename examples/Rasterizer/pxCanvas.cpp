@@ -5,6 +5,12 @@
 
 #include "pxTimer.h"
 
+#include "rtThreadTask.h"
+#include "rtThreadPool.h"
+
+// Paths shorter than this many rows per thread aren't worth splitting up
+#define PX_CANVAS_MIN_BAND_ROWS 32
+
 class Vector
 {
 public:
@@ -93,7 +99,8 @@ void DoLineSegmentIntersection(const Vector& p0, const Vector& p1, const Vector&
 }
 #endif
 
-pxCanvas::pxCanvas(): mOffscreen(NULL)
+pxCanvas::pxCanvas(): mThreadCount(1), mTextureCoordinatesSet(false), mThreadPool(NULL),
+  mPending(0), mOffscreen(NULL)
 {
   mVertexCount = 0;
 }
@@ -101,6 +108,10 @@ pxCanvas::pxCanvas(): mOffscreen(NULL)
 pxCanvas::~pxCanvas()
 {
   term();
+
+  delete mThreadPool;
+  for (size_t i = 0; i < mBands.size(); i++)
+    delete mBands[i];
 }
 
 pxError pxCanvas::term()
@@ -240,7 +251,7 @@ void pxCanvas::fill(bool time)
 
       mMatrix.multiply(mVertices[i], mMatrix, a);
       mMatrix.multiply(mVertices[i+1], mMatrix, b);
-      mRasterizer.addEdge(a.x,a.y,b.x, b.y);
+      addEdge(a.x,a.y,b.x, b.y);
     }
     if (mVertices[i].x < extentLeft) extentLeft = mVertices[i].x;
     if (mVertices[i].x > extentRight) extentRight = mVertices[i].x;
@@ -303,19 +314,19 @@ void pxCanvas::fill(bool time)
   mTextureMatrix.multiply(t3, mTextureMatrix, n3);
   mTextureMatrix.multiply(t4, mTextureMatrix, n4);
 
-  mRasterizer.setTextureCoordinates(o1, o2, o3, o4, n1, n2, n3, n4);
+  setTextureCoordinates(o1, o2, o3, o4, n1, n2, n3, n4);
 #endif
 
   if (time)
   {
     double start = pxMilliseconds();
-    mRasterizer.rasterize();
+    rasterize();
     double end = pxMilliseconds();
     printf("**Elapsed Time %gms FPS: %g\n", (end-start), 1000/(end-start));
   }
   else
   {
-    mRasterizer.rasterize();
+    rasterize();
   }
 
   //mRasterizer.reset();
@@ -362,7 +373,7 @@ void pxCanvas::fill(bool time)
           if (mVertices[i].y > extentBottom) extentBottom = mVertices[i].y;
 #endif
 
-          mRasterizer.addEdge(mVertices[i].x,mVertices[i].y,mVertices[i+1].x, mVertices[i+1].y);
+          addEdge(mVertices[i].x,mVertices[i].y,mVertices[i+1].x, mVertices[i+1].y);
         }
 #if 1
         if (mVertices[i].x < extentLeft) extentLeft = mVertices[i].x;
@@ -383,7 +394,7 @@ void pxCanvas::fill(bool time)
 
         while(vp < vlast)
         {
-          mRasterizer.addEdge(vp->x,vp->y,(vp+1)->x, (vp+1)->y);
+          addEdge(vp->x,vp->y,(vp+1)->x, (vp+1)->y);
           vp++;
         }
 
@@ -404,7 +415,7 @@ void pxCanvas::fill(bool time)
 
         mMatrix.multiply(mVertices[i], mMatrix, a);
         mMatrix.multiply(mVertices[i+1], mMatrix, b);
-        mRasterizer.addEdge(a.x,a.y,b.x, b.y);
+        addEdge(a.x,a.y,b.x, b.y);
       }
       if (mVertices[i].x < extentLeft) extentLeft = mVertices[i].x;
       if (mVertices[i].x > extentRight) extentRight = mVertices[i].x;
@@ -463,14 +474,14 @@ void pxCanvas::fill(bool time)
     mTextureMatrix.multiply(t3, mTextureMatrix, n3);
     mTextureMatrix.multiply(t4, mTextureMatrix, n4);
 
-    mRasterizer.setTextureCoordinates(o1, o2, o3, o4, n1, n2, n3, n4);
+    setTextureCoordinates(o1, o2, o3, o4, n1, n2, n3, n4);
 #endif
   }
 
   if (time)
   {
     double startScan = pxMilliseconds();
-    mRasterizer.rasterize();
+    rasterize();
     double endScan = pxMilliseconds();
 
     double total = (endEdge-startEdge) + (endScan-startScan);
@@ -481,7 +492,7 @@ void pxCanvas::fill(bool time)
   else
   {
 
-    mRasterizer.rasterize();
+    rasterize();
   }
 
   //mRasterizer.reset();
@@ -526,10 +537,10 @@ void pxCanvas::stroke()
       dx1 *= halfStrokeWidth;
       dy1 *= halfStrokeWidth;
 
-      mRasterizer.addEdge(b.x-dy1,b.y + dx1 ,a.x-dy1, a.y + dx1);
-      mRasterizer.addEdge(a.x-dy1, a.y + dx1,a.x+dy1, a.y-dx1);
-      mRasterizer.addEdge(a.x+dy1,a.y-dx1,b.x+dy1, b.y-dx1);
-      mRasterizer.addEdge(b.x+dy1,b.y - dx1 ,b.x-dy1,b.y+dx1);
+      addEdge(b.x-dy1,b.y + dx1 ,a.x-dy1, a.y + dx1);
+      addEdge(a.x-dy1, a.y + dx1,a.x+dy1, a.y-dx1);
+      addEdge(a.x+dy1,a.y-dx1,b.x+dy1, b.y-dx1);
+      addEdge(b.x+dy1,b.y - dx1 ,b.x-dy1,b.y+dx1);
     }
 #else
     pxVertex firstA1, firstA2;
@@ -559,8 +570,8 @@ void pxCanvas::stroke()
       dy1 *= halfStrokeWidth;
 
 
-      mRasterizer.addEdge(a.x+dy1,a.y-dx1,b.x+dy1, b.y-dx1);
-      mRasterizer.addEdge(b.x-dy1,b.y + dx1 ,a.x-dy1, a.y + dx1);
+      addEdge(a.x+dy1,a.y-dx1,b.x+dy1, b.y-dx1);
+      addEdge(b.x-dy1,b.y + dx1 ,a.x-dy1, a.y + dx1);
 
       if (i == 0) 
       {
@@ -574,8 +585,8 @@ void pxCanvas::stroke()
       // join this segment to the last segment
       if (i > 0)
       {
-        mRasterizer.addEdge(lastB1.x,lastB1.y,a.x+dy1,a.y-dx1);
-        mRasterizer.addEdge(a.x-dy1, a.y + dx1 ,lastB2.x, lastB2.y);                                
+        addEdge(lastB1.x,lastB1.y,a.x+dy1,a.y-dx1);
+        addEdge(a.x-dy1, a.y + dx1 ,lastB2.x, lastB2.y);                                
       }
 #endif
 
@@ -589,10 +600,10 @@ void pxCanvas::stroke()
       {
         // buttcaps
         if (i == 0)
-          mRasterizer.addEdge(a.x-dy1, a.y + dx1,a.x+dy1, a.y-dx1);
+          addEdge(a.x-dy1, a.y + dx1,a.x+dy1, a.y-dx1);
 
         if (i == mVertexCount-2)
-          mRasterizer.addEdge(b.x+dy1,b.y - dx1 ,b.x-dy1,b.y+dx1);
+          addEdge(b.x+dy1,b.y - dx1 ,b.x-dy1,b.y+dx1);
       }
       else
       {
@@ -600,8 +611,8 @@ void pxCanvas::stroke()
 #if 1
         if (i == mVertexCount-2)
         {
-          mRasterizer.addEdge(lastB1.x,lastB1.y, firstA1.x, firstA1.y);
-          mRasterizer.addEdge(firstA2.x, firstA2.y ,lastB2.x, lastB2.y); 
+          addEdge(lastB1.x,lastB1.y, firstA1.x, firstA1.y);
+          addEdge(firstA2.x, firstA2.y ,lastB2.x, lastB2.y); 
         }
 #endif
       }
@@ -664,10 +675,10 @@ void pxCanvas::stroke()
       dy3 *= halfStrokeWidth;
 
 #if 0
-      mRasterizer.addEdge(b.x-dy1,b.y + dx1 ,a.x-dy1, a.y + dx1);
-      // mRasterizer.addEdge(a.x-dy1, a.y + dx1,a.x+dy1, a.y-dx1);
-      mRasterizer.addEdge(a.x+dy1,a.y-dx1,b.x+dy1, b.y-dx1);
-      // mRasterizer.addEdge(b.x+dy1,b.y - dx1 ,b.x-dy1,b.y+dx1);
+      addEdge(b.x-dy1,b.y + dx1 ,a.x-dy1, a.y + dx1);
+      // addEdge(a.x-dy1, a.y + dx1,a.x+dy1, a.y-dx1);
+      addEdge(a.x+dy1,a.y-dx1,b.x+dy1, b.y-dx1);
+      // addEdge(b.x+dy1,b.y - dx1 ,b.x-dy1,b.y+dx1);
 #else
 #if 1
       {
@@ -678,8 +689,8 @@ void pxCanvas::stroke()
         l1.Intersect(l2, i1);
         l3.Intersect(l2, i2);
 
-        //            mRasterizer.addEdge(c.x-dy2,c.y + dx2 ,b.x-dy2, b.y + dx2);
-        mRasterizer.addEdge(i2.x_, i2.y_ , i1.x_ , i1.y_);
+        //            addEdge(c.x-dy2,c.y + dx2 ,b.x-dy2, b.y + dx2);
+        addEdge(i2.x_, i2.y_ , i1.x_ , i1.y_);
       }
 #endif
       {
@@ -690,9 +701,9 @@ void pxCanvas::stroke()
         l1.Intersect(l2, i1);
         l3.Intersect(l2, i2);
 
-        //            mRasterizer.addEdge(c.x-dy2,c.y + dx2 ,b.x-dy2, b.y + dx2);
-        //mRasterizer.addEdge(i2.x_, i2.y_ , i1.x_ , i1.y_);
-        mRasterizer.addEdge(i1.x_, i1.y_ , i2.x_ , i2.y_);
+        //            addEdge(c.x-dy2,c.y + dx2 ,b.x-dy2, b.y + dx2);
+        //addEdge(i2.x_, i2.y_ , i1.x_ , i1.y_);
+        addEdge(i1.x_, i1.y_ , i2.x_ , i2.y_);
       }
 #endif
 
@@ -708,7 +719,7 @@ void pxCanvas::stroke()
   mFillMode = oldFillMode;
 #else
   mRasterizer.setColor(mStrokeColor);
-  mRasterizer.rasterize();
+  rasterize();
   mRasterizer.setFillMode(oldFillMode);
 #endif
 }
@@ -808,8 +819,8 @@ void pxCanvas::addCurve(double x1, double y1, double x2, double y2, double x3, d
 {
   if (depth > 3)
   {
-    mRasterizer.addEdge(x1, y1, x2, y2);
-    mRasterizer.addEdge(x2, y2, x3, y3);
+    addEdge(x1, y1, x2, y2);
+    addEdge(x2, y2, x3, y3);
     return;
   }
 
@@ -834,8 +845,8 @@ void pxCanvas::addCurve2(double x1, double y1, double x2, double y2, double x3,
   if (depth > 3)
   {
 #if 0
-    mRasterizer.addEdge(x1, y1, x2, y2);
-    mRasterizer.addEdge(x2, y2, x3, y3);
+    addEdge(x1, y1, x2, y2);
+    addEdge(x2, y2, x3, y3);
 #else
     lineTo(x2, y2);
     lineTo(x3, y3);
@@ -892,7 +903,7 @@ void pxCanvas::TextLineTo(double x, double y)
   x = x/mTextScale;
   y = (2048-y)/mTextScale;
 
-  mRasterizer.addEdge(lastX + textX, lastY+textY-mBaseLineAdjust, x+textX, y+textY-mBaseLineAdjust);
+  addEdge(lastX + textX, lastY+textY-mBaseLineAdjust, x+textX, y+textY-mBaseLineAdjust);
   lastX = x;
   lastY = y;
 }
@@ -1009,7 +1020,7 @@ pxError pxCanvas::drawChar(const wchar_t c)
     //fill();
     //setFillMode(fillEvenOdd);
     mRasterizer.setFillMode(fillWinding);
-    mRasterizer.rasterize();
+    rasterize();
     //rasterizeSolid();
     e = PX_OK;
 
@@ -1057,6 +1068,175 @@ void pxCanvas::clear()
 bool pxCanvas::alphaTexture() const { return mRasterizer.alphaTexture(); }
 void pxCanvas::setAlphaTexture(bool f) { mRasterizer.setAlphaTexture(f); }
 
+void pxCanvas::setThreadCount(int threads)
+{
+  threads = pxMax<int>(threads, 1);
+  if (threads != mThreadCount)
+  {
+    delete mThreadPool;
+    mThreadPool = NULL;
+    mThreadCount = threads;
+  }
+}
+
+void pxCanvas::addEdge(double x1, double y1, double x2, double y2)
+{
+  // overdraw keeps per row span state in the rasterizer, it can't be split
+  if (mThreadCount <= 1 || mRasterizer.overdraw())
+  {
+    mRasterizer.addEdge(x1, y1, x2, y2);
+    return;
+  }
+
+  if (mEdges.empty())
+  {
+    mEdgesTop = pxMin<double>(y1, y2);
+    mEdgesBottom = pxMax<double>(y1, y2);
+  }
+  else
+  {
+    mEdgesTop = pxMin<double>(mEdgesTop, pxMin<double>(y1, y2));
+    mEdgesBottom = pxMax<double>(mEdgesBottom, pxMax<double>(y1, y2));
+  }
+
+  Edge e;
+  e.x1 = x1;
+  e.y1 = y1;
+  e.x2 = x2;
+  e.y2 = y2;
+  mEdges.push_back(e);
+}
+
+void pxCanvas::setTextureCoordinates(pxVertex& e1, pxVertex& e2, pxVertex& e3, pxVertex& e4,
+                                     pxVertex& t1, pxVertex& t2, pxVertex& t3, pxVertex& t4)
+{
+  mRasterizer.setTextureCoordinates(e1, e2, e3, e4, t1, t2, t3, t4);
+
+  // the bands each need their own copy
+  pxVertex* v = mTextureCoordinates;
+  v[0] = e1; v[1] = e2; v[2] = e3; v[3] = e4;
+  v[4] = t1; v[5] = t2; v[6] = t3; v[7] = t4;
+  mTextureCoordinatesSet = true;
+}
+
+void pxCanvas::rasterize()
+{
+  if (mEdges.empty())
+  {
+    mTextureCoordinatesSet = false;
+    mRasterizer.rasterize();
+    return;
+  }
+
+  // the rows the path can touch, with a row to spare either side for
+  // rounding
+  pxRect clip = mRasterizer.clip();
+  int top = pxMax<int>((int)floor(mEdgesTop)-1, clip.top());
+  int bottom = pxMin<int>((int)floor(mEdgesBottom)+2, clip.bottom());
+  int rows = bottom-top;
+  int bands = pxMin<int>(mThreadCount, rows/PX_CANVAS_MIN_BAND_ROWS);
+
+  if (bands <= 1)
+  {
+    for (size_t i = 0; i < mEdges.size(); i++)
+    {
+      const Edge& e = mEdges[i];
+      mRasterizer.addEdge(e.x1, e.y1, e.x2, e.y2);
+    }
+    mEdges.clear();
+    mTextureCoordinatesSet = false;
+    mRasterizer.rasterize();
+    return;
+  }
+
+  while ((int)mBands.size() < bands)
+    mBands.push_back(new Band);
+
+  for (int i = 0; i < bands; i++)
+  {
+    Band& b = *mBands[i];
+    b.canvas = this;
+    b.top = top + (rows*i)/bands;
+    b.bottom = top + (rows*(i+1))/bands;
+  }
+
+  // the calling thread takes the first band
+  if (mThreadPool == NULL)
+    mThreadPool = new rtThreadPool(mThreadCount-1);
+
+  mPending = bands-1;
+  for (int i = 1; i < bands; i++)
+    mThreadPool->executeTask(new rtThreadTask(rasterizeBandTask, mBands[i], ""));
+
+  rasterizeBand(*mBands[0]);
+
+  mMutex.lock();
+  while (mPending > 0)
+    mCondition.wait(mMutex.getNativeMutexDescription());
+  mMutex.unlock();
+
+  mEdges.clear();
+  mTextureCoordinatesSet = false;
+  mRasterizer.reset();
+}
+
+void pxCanvas::rasterizeBandTask(void* data)
+{
+  Band* b = (Band*)data;
+  pxCanvas* c = b->canvas;
+  c->rasterizeBand(*b);
+
+  c->mMutex.lock();
+  if (--c->mPending == 0)
+    c->mCondition.signal();
+  c->mMutex.unlock();
+}
+
+void pxCanvas::rasterizeBand(Band& b)
+{
+  pxRasterizer& r = b.rasterizer;
+  r.copySettings(mRasterizer);
+
+  // Each band picks out the edges within a row of it, the rasterizer
+  // doesn't need anything further away to get the band's rows right
+  int edges = 0;
+  for (size_t i = 0; i < mEdges.size(); i++)
+  {
+    const Edge& e = mEdges[i];
+    if (pxMin<double>(e.y1, e.y2) < b.bottom+1 && pxMax<double>(e.y1, e.y2) >= b.top-1)
+    {
+      r.addEdge(e.x1, e.y1, e.x2, e.y2);
+      edges++;
+    }
+  }
+
+  if (edges == 0)
+    return;
+
+  // Two edges on their own can pass for a rectangle, which is filled
+  // without scan converting and doesn't round quite the same.  Such a band
+  // takes the whole path so the rectangle fill is only used when a single
+  // pass would use it.
+  if (r.edgeCount() == 2 && edges < (int)mEdges.size())
+  {
+    r.reset();
+    for (size_t i = 0; i < mEdges.size(); i++)
+    {
+      const Edge& e = mEdges[i];
+      r.addEdge(e.x1, e.y1, e.x2, e.y2);
+    }
+  }
+
+  if (mTextureCoordinatesSet)
+  {
+    pxVertex* v = mTextureCoordinates;
+    r.setTextureCoordinates(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7]);
+  }
+
+  r.setBand(b.top, b.bottom);
+  r.rasterize();
+}
+
 
 void pxCanvas::roundRect(/*pxCanvas& c, */double x, double y, double w, double h, double rad)
 {
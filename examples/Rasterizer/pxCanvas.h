@@ -9,6 +9,11 @@
 #include "pxMatrix.h"
 #include "pxRasterizer.h"
 
+#include "rtMutex.h"
+
+#include <vector>
+
+class rtThreadPool;
 
 #ifdef RTPLATFORM_WINDOWS
 #include "rtString.h"
@@ -112,6 +117,9 @@ public:
   bool biLerp() const { return mRasterizer.biLerp(); }
   void setBiLerp(bool f) { mRasterizer.setBiLerp(f); }
 
+  bool preMultipliedAlpha() const { return mRasterizer.preMultipliedAlpha(); }
+  void setPreMultipliedAlpha(bool f) { mRasterizer.setPreMultipliedAlpha(f); }
+
 #if 0
   bool alphaTexture() const { return mRasterizer.alphaTexture(); }
   void setAlphaTexture(bool f) { mRasterizer.setAlphaTexture(f); }
@@ -123,6 +131,13 @@ public:
   bool overdraw() const { return mRasterizer.overdraw(); }
   void setOverdraw(bool f) { mRasterizer.setOverdraw(f); }
 
+  // With more than one thread fill() and stroke() split paths that are tall
+  // enough into horizontal bands, each rasterized on its own thread by its
+  // own pxRasterizer.  The output is the same for any thread count.  Overdraw
+  // always runs on the calling thread.  Defaults to 1.
+  int threadCount() const { return mThreadCount; }
+  void setThreadCount(int threads);
+
   void roundRect(/*pxCanvas& c, */double x, double y, double w, double h, double rad);
   //void roundRectangle(double x, double y, double w, double h, double rad);
 	void rectangle(double x1, double y1, double x2, double y2);
@@ -135,6 +150,28 @@ public:
   void addCurve2(double x1, double y1, double x2, double y2, double x3, double y3);
   void addCurve2(double x1, double y1, double x2, double y2, double x3, double y3, int depth);
 
+  // Edges go straight to mRasterizer unless they're being banded, then
+  // they're kept until rasterize()
+  void addEdge(double x1, double y1, double x2, double y2);
+  void setTextureCoordinates(pxVertex& e1, pxVertex& e2, pxVertex& e3, pxVertex& e4,
+                             pxVertex& t1, pxVertex& t2, pxVertex& t3, pxVertex& t4);
+  void rasterize();
+
+  struct Edge
+  {
+    double x1, y1, x2, y2;
+  };
+
+  struct Band
+  {
+    pxCanvas* canvas;
+    int top, bottom;
+    pxRasterizer rasterizer;
+  };
+
+  static void rasterizeBandTask(void* data);
+  void rasterizeBand(Band& b);
+
 
 
 #ifdef RTPLATFORM_WINDOWS
@@ -164,6 +201,17 @@ public:
   pxColor mStrokeColor;
   double mStrokeWidth;
 
+  int mThreadCount;
+  std::vector<Edge> mEdges;
+  double mEdgesTop, mEdgesBottom;
+  bool mTextureCoordinatesSet;
+  pxVertex mTextureCoordinates[8];
+  std::vector<Band*> mBands;
+  rtThreadPool* mThreadPool;
+  rtMutex mMutex;
+  rtThreadCondition mCondition;
+  int mPending;
+
 public: // BUGBUG
   pxRasterizer mRasterizer;
 
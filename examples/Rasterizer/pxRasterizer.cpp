@@ -1,13 +1,16 @@
 #include "pxTimer.h"
 #include "pxRasterizer.h"
+#include "pxSpan.h"
 
 #include "xs_Core.h"
 #include "xs_Float.h"
 //#include "rtLog.h"
 
 #include <algorithm>
+#include <limits.h>
 
 #define MINEDGES 200000
+#define MAXTEXTUREEDGES 10
 
 #define UVFIXED 65536
 #define UVFIXEDSHIFT 16
@@ -30,13 +33,11 @@ inline T pxWrap(T v, T min, T max)
   return (v>max)?min:((v<min)?max:v);
 }
 
-uint32_t overSampleShift;
-uint32_t fixedScanlineShift;
-uint32_t xShift;
-
 // Design Notes and Assumptions
 // * AddEdge, Rasterize/Reset must be called "atomically".  No pxBuffer changes in width or height can be made after the first call
 // to AddEdge and until after Reset has been called.  In addition setClip should not be called during this timeframe as well.
+// * All working state (edge pools, span buffer, texture edges) belongs to the pxRasterizer instance so that
+// several rasterizers can run on different threads as long as they write to disjoint parts of the buffer.
 // 
 
 // BIGBUCKETS
@@ -364,8 +365,6 @@ private:
 };
 
 
-pxSpanBuffer mSpanBuffer;
-
 struct edge
 {
 #if 1
@@ -421,6 +420,7 @@ public:
   {
     bucketPos = buckets;
     bucketEnd = buckets+BUCKET_COUNT;
+    nextPool = NULL;
   }
 
   inline edgeBucket* getNewBucket()
@@ -455,6 +455,14 @@ public:
 
   ~edgePoolManager()
   {
+    // everything goes back on the free list first
+    reset();
+    while (freePool)
+    {
+      edgePool* nextPool = freePool->nextPool;
+      delete freePool;
+      freePool = nextPool;
+    }
   }
 
   inline void reset()
@@ -508,6 +516,9 @@ public:
 
   bool getTwoEdges(edge*& e1, edge*& e2)
   {
+    if (!headPool)
+      return false;
+
     edge* tb = headPool->buckets[0].edges;
     edge* te = headPool->buckets[0].edgePos;
 
@@ -526,8 +537,6 @@ private:
   edgePool* freePool;
 };
 
-edgePoolManager mPoolManager;
-
 class edgeLine
 {
 public:
@@ -544,7 +553,7 @@ public:
   }
 
 
-  inline edge* getNewEdge()
+  inline edge* getNewEdge(edgePoolManager& poolManager)
   {
     edge* e = NULL;
     if (tailBucket != NULL)
@@ -554,7 +563,7 @@ public:
       return e;
     else
     {
-      edgeBucket* newBucket = mPoolManager.getNewBucket();
+      edgeBucket* newBucket = poolManager.getNewBucket();
 
       // Link it in
       if (!headBucket)
@@ -658,9 +667,14 @@ struct CompareEnds {
   }
 };
 
+// Edges at the same x are ordered by direction.  Otherwise their order
+// depends on which edges were active on earlier scanlines, and with a
+// winding fill a different order can split a span in two.
 struct CompareX {
   inline bool operator()(edge* e1, edge* e2) {
-    return e1->mXCurrent < e2->mXCurrent;
+    if (e1->mXCurrent != e2->mXCurrent)
+      return e1->mXCurrent < e2->mXCurrent;
+    return e1->mLeft < e2->mLeft;
   }
 };
 
@@ -947,6 +961,9 @@ public:
   {
 
     term();
+#ifdef EDGEBUCKETS
+    delete [] mStartLines;
+#endif
   }
 
   inline void init(uint32_t maxScanlines)
@@ -1048,7 +1065,7 @@ public:
   inline edge* addEdge(int32_t scanline, int32_t x1, int32_t y1, int32_t x2, int32_t y2, bool left)
   {
 #ifdef EDGEBUCKETS
-    edge *e = mStartLines[scanline].getNewEdge();
+    edge *e = mStartLines[scanline].getNewEdge(mPoolManager);
 #else
     edge *e = &mStartLines[scanline].scanlineEdges[mStartLines[scanline].scanlineEdgeCount];
     mStartLines[scanline].scanlineEdgeCount++;
@@ -1093,6 +1110,10 @@ public:
 
   int32_t mFirstStart, mLastStart;
   uint32_t mMaxScanlines;
+
+#ifdef EDGEBUCKETS
+  edgePoolManager mPoolManager;
+#endif
 };
 
 
@@ -1238,7 +1259,7 @@ struct endPointArray
   }
 
   int32_t mCount;
-  endPoint mEndPoints[MINEDGES];
+  endPoint mEndPoints[MAXTEXTUREEDGES];
 };
 #endif
 
@@ -1275,14 +1296,16 @@ struct edgeArray
 typedef edgeArray edges;
 
 
-textureedge mTextureEdges[10];
-int mTextureEdgeCount = 0;
+struct textureEdgeList
+{
+  textureEdgeList(): mCount(0) {}
 
-endPointArray textureStartsX;
-endPointArray textureEndsX;
+  textureedge mEdges[MAXTEXTUREEDGES];
+  int mCount;
 
-endPointArray* textureStarts = &textureStartsX;
-endPointArray* textureEnds = &textureEndsX;
+  endPointArray mStarts;
+  endPointArray mEnds;
+};
 
 pxRasterizer::pxRasterizer(): 
   mBuffer(NULL),
@@ -1291,8 +1314,10 @@ pxRasterizer::pxRasterizer():
 #else
   mEdgeManager(NULL),
 #endif
+  mSpanBuffer(NULL), mTextureEdges(NULL),
   mClipValid(false), mClipInternalCalculated(false), mCoverage(NULL), mTexture(NULL), 
-  mTextureClamp(false), mTextureClampColor(false), mBiLerp(false), mAlphaTexture(false), mOverdraw(false)
+  mTextureClamp(false), mTextureClampColor(false), mBiLerp(false), mAlphaTexture(false), mOverdraw(false),
+  mPreMultipliedAlpha(false), mTextureUnscaled(false)
 {
 	mMatrix.identity();
   mTextureMatrix.identity();
@@ -1301,6 +1326,15 @@ pxRasterizer::pxRasterizer():
 pxRasterizer::~pxRasterizer()
 {
   term();
+
+#ifdef EDGECLEANUP
+  delete (edgeManager*)mEdgeManager;
+  mEdgeManager = NULL;
+#endif
+  delete (pxSpanBuffer*)mSpanBuffer;
+  mSpanBuffer = NULL;
+  delete (textureEdgeList*)mTextureEdges;
+  mTextureEdges = NULL;
 }
 
 void pxRasterizer::init(pxBuffer* buffer)
@@ -1310,18 +1344,25 @@ void pxRasterizer::init(pxBuffer* buffer)
   xShift = 4;
   mBuffer = buffer;
 
+  if (!mSpanBuffer)
+    mSpanBuffer = new pxSpanBuffer;
+  if (!mTextureEdges)
+    mTextureEdges = new textureEdgeList;
+
 #ifdef FRONT2BACK
+  pxSpanBuffer& spanBuffer = *(pxSpanBuffer*)mSpanBuffer;
+
   // use fixed pt x coordinates
-  mSpanBuffer.init(mBuffer->bounds());
+  spanBuffer.init(mBuffer->bounds());
 
   // Some test clipping
 #if 0
   for(int i = 0; i < 200; i++)
   {
-    mSpanBuffer.setCurrentRow(i);
+    spanBuffer.setCurrentRow(i);
     for(int j = 0; j < 10; j++)
     {
-      mSpanBuffer.addSpan((i+(j*100))<<4, (i+(j*100)+50)<<4);
+      spanBuffer.addSpan((i+(j*100))<<4, (i+(j*100)+50)<<4);
     }
   }
 #endif
@@ -1340,6 +1381,7 @@ void pxRasterizer::init(pxBuffer* buffer)
   mCachedBufferWidth = -1;
 
   setClip(NULL);
+  setBand(0, INT_MAX);
   mColor.u = 0xff000000;  // black
   setAlpha(1.0);
   //mYOversample = 2;
@@ -1376,7 +1418,7 @@ void pxRasterizer::term()
   edgeMgr = NULL;
 #endif
 #endif
-  delete mCoverage;
+  delete [] mCoverage;
   mCoverage = NULL;
 }
 
@@ -1418,6 +1460,12 @@ void pxRasterizer::setClip(const pxRect* r)
   mClipInternalCalculated = false;
 }
 
+void pxRasterizer::setBand(int top, int bottom)
+{
+  mBandTop = top;
+  mBandBottom = bottom;
+}
+
 pxFillMode pxRasterizer::fillMode() const
 {
   return mFillMode;
@@ -1452,7 +1500,11 @@ void pxRasterizer::setAlpha(double alpha)
 
 void pxRasterizer::calculateEffectiveAlpha()
 {
-  mEffectiveAlpha = (unsigned char)xs_RoundToInt(mColor.a * mAlpha);
+  // premultiplied colors carry their own alpha
+  if (mPreMultipliedAlpha)
+    mEffectiveAlpha = (unsigned char)xs_RoundToInt(255 * mAlpha);
+  else
+    mEffectiveAlpha = (unsigned char)xs_RoundToInt(mColor.a * mAlpha);
   if (mEffectiveAlpha < 255)
   {
     for (int i = 0; i < 256; i++)
@@ -1466,6 +1518,10 @@ void pxRasterizer::calculateEffectiveAlpha()
 void pxRasterizer::addTextureEdge(double x1, double y1, double x2, double y2,
                                   double u1, double v1, double u2, double v2)
 {
+  textureEdgeList& textureEdges = *(textureEdgeList*)mTextureEdges;
+  if (textureEdges.mCount >= MAXTEXTUREEDGES)
+    return;
+
   textureedge textureEdge;
 
   textureEdge.mX1 = xs_CRoundToInt(x1 * UVFIXED);
@@ -1526,22 +1582,24 @@ void pxRasterizer::addTextureEdge(double x1, double y1, double x2, double y2,
   textureEdge.mCurrentU = textureEdge.mU1;
   textureEdge.mCurrentV = textureEdge.mV1;
 
-  mTextureEdges[mTextureEdgeCount] = textureEdge;
+  textureedge* e = &textureEdges.mEdges[textureEdges.mCount];
+  *e = textureEdge;
 #if 1
-  textureStarts->add(textureEdge.mY1 >> UVFIXEDSHIFT, &mTextureEdges[mTextureEdgeCount]);
-  textureEnds->add(textureEdge.mY2 >> UVFIXEDSHIFT, &mTextureEdges[mTextureEdgeCount]);
+  textureEdges.mStarts.add(textureEdge.mY1 >> UVFIXEDSHIFT, e);
+  textureEdges.mEnds.add(textureEdge.mY2 >> UVFIXEDSHIFT, e);
 #else
-  textureStarts->add(FIXEDSCANLINE(textureEdge.mY1), &mTextureEdges[mTextureEdgeCount]);
-  textureEnds->add(FIXEDSCANLINE(textureEdge.mY2), &mTextureEdges[mTextureEdgeCount]);
+  textureEdges.mStarts.add(FIXEDSCANLINE(textureEdge.mY1), e);
+  textureEdges.mEnds.add(FIXEDSCANLINE(textureEdge.mY2), e);
 #endif
-  mTextureEdgeCount++;
+  textureEdges.mCount++;
 }
 
 void pxRasterizer::resetTextureEdges()
 {
-  mTextureEdgeCount = 0;
-  textureStarts->removeAll();
-  textureEnds->removeAll();
+  textureEdgeList& textureEdges = *(textureEdgeList*)mTextureEdges;
+  textureEdges.mCount = 0;
+  textureEdges.mStarts.removeAll();
+  textureEdges.mEnds.removeAll();
 }
 
 void pxRasterizer::addEdge(double x1, double y1, double x2, double y2)
@@ -1714,7 +1772,7 @@ void pxRasterizer::addEdge(double x1, double y1, double x2, double y2)
   if (scanlineY1 >= edgeMgr->mMaxScanlines)
     rtLog("Scanline(%d) Too Large\n", scanlineY1);
 #endif
-  edge *e = edgeMgr->mStartLines[scanlineY1].getNewEdge();
+  edge *e = edgeMgr->mStartLines[scanlineY1].getNewEdge(edgeMgr->mPoolManager);
 #else
   edge *e = &mStartLines[scanlineY1].scanlineEdges[mStartLines[scanlineY1].scanlineEdgeCount];
   mStartLines[scanlineY1].scanlineEdgeCount++;
@@ -1811,12 +1869,22 @@ void pxRasterizer::addEdge(double x1, double y1, double x2, double y2)
 #endif
 }
 
+int pxRasterizer::edgeCount() const
+{
+  return ((edgeManager*)mEdgeManager)->getEdgeCount();
+}
+
 void pxRasterizer::setTextureCoordinates(pxVertex& e1, pxVertex& e2, pxVertex& e3, pxVertex& e4,
                                          pxVertex& t1, pxVertex& t2, pxVertex& t3, pxVertex& t4)
 {
   resetTextureEdges();
-  mTextureOriginX = xs_CRoundToInt(e1.x * UVFIXED);
-  mTextureOriginY = xs_CRoundToInt(e1.y * UVFIXED);
+  // where texel 0,0 lands
+  mTextureOriginX = xs_CRoundToInt((e1.x - t1.x) * UVFIXED);
+  mTextureOriginY = xs_CRoundToInt((e1.y - t1.y) * UVFIXED);
+
+  // the rectangle fast path copies texels 1:1
+  mTextureUnscaled = (t2.x-t1.x == e2.x-e1.x && t2.y-t1.y == e2.y-e1.y &&
+                      t4.x-t1.x == e4.x-e1.x && t4.y-t1.y == e4.y-e1.y);
 
   addTextureEdge(e1.x, e1.y, e2.x, e2.y, t1.x, t1.y, t2.x, t2.y);
   addTextureEdge(e2.x, e2.y, e3.x, e3.y, t2.x, t2.y, t3.x, t3.y);
@@ -1833,6 +1901,8 @@ int compareEdge(const void* e1, const void* e2)
 
 void pxRasterizer::rasterize()
 {
+  pxSpanBuffer& spanBuffer = *(pxSpanBuffer*)mSpanBuffer;
+
   //    reset();
   //return;
   if (mAlphaDirty) 
@@ -1852,21 +1922,24 @@ void pxRasterizer::rasterize()
 
     edge* e1;
     edge* e2;
-    if (mPoolManager.getTwoEdges(e1, e2))
+    // the first bucket only holds the edges starting on one scanline
+    if (edgeMgr->getEdgeCount() == 2 && edgeMgr->mPoolManager.getTwoEdges(e1, e2))
     {
       // special case for "rectanglar" fill
 #ifdef FIXEDPOINTEDGES
       int32_t e1x1 = FIXEDX(e1->mX1);
       int32_t e1x2 = FIXEDX(e1->mX2);
       int32_t e1y1 = FIXEDSCANLINE(e1->mY1);
-      int32_t e1y2 = FIXEDSCANLINE(e2->mY2);
+      int32_t e1y2 = FIXEDSCANLINE(e1->mY2);
 
       int32_t e2x1 = FIXEDX(e2->mX1);
       int32_t e2x2 = FIXEDX(e2->mX2);
-      int32_t e2y1 = FIXEDSCANLINE(e1->mY1);
+      int32_t e2y1 = FIXEDSCANLINE(e2->mY1);
       int32_t e2y2 = FIXEDSCANLINE(e2->mY2);
 
-      if ((e1x1 == e1x2 && e2x2 == e2x2 && e1y1 == e2y1 && e1y2 == e2y2) &&
+      // both edges vertical and spanning the same rows, anything else has
+      // to go through the scan converter
+      if ((e1x1 == e1x2 && e2x1 == e2x2 && e1y1 == e2y1 && e1y2 == e2y2) &&
           (!(e1x1 & 0xf) && !(e2x1 & 0xf) && !(e1y1 & overSampleMask) && !(e1y2 & overSampleMask)))
 #else
         if ((e1->mX1 == e1->mX2 && e2->mX1 == e2->mX2 && e1->mY1 == e2->mY1 && e1->mY2 == e2->mY2) &&                (!(e1->mX1 & 0xf) && !(e2->mX1 & 0xf) && !(e1->mY1 & overSampleMask) && !(e1->mY2 & overSampleMask)))
@@ -1903,6 +1976,9 @@ void pxRasterizer::rasterize()
           left = pxClamp<int>(left, mClipInternal.left(), mClipInternal.right());
           right = pxClamp<int>(right, mClipInternal.left(), mClipInternal.right());
           bot = pxClamp<int>(bot, mClipInternal.top(), mClipInternal.bottom());
+          int clippedTop = top;
+          top = pxMax<int>(top, mBandTop);
+          bot = pxMax<int>(pxMin<int>(bot, mBandBottom), top);
 #endif
 
           if (!mTexture)
@@ -1917,32 +1993,28 @@ void pxRasterizer::rasterize()
 
             if (!mOverdraw)
             {
-              if (mEffectiveAlpha == 255)
+              const pxSpanKernels& k = pxSpan();
+              if (mEffectiveAlpha == 255 && (!mPreMultipliedAlpha || mColor.a == 255))
               {
-                uint32_t *d, *ed;
                 while (ycount--)
                 {
-                  register int c = mColor.u;
-                  d = (uint32_t*)s;
-                  ed = d + w;
-                  while (d<ed) 
-                    *d++=c;   
+                  k.fill((uint32_t*)s, w, mColor.u);
+                  s += stride;
+                }
+              }
+              else if (mPreMultipliedAlpha)
+              {
+                while (ycount--)
+                {
+                  k.preMultipliedBlend((uint32_t*)s, w, mColor.u, mEffectiveAlpha);
                   s += stride;
                 }
               }
               else
               {
-                uint32_t *d, *ed;
                 while (ycount--)
                 {
-                  register int c = mColor.u;
-                  d = (uint32_t*)s;
-                  ed = d + w;
-                  while (d<ed)
-                  {
-                    pxLerp2(mEffectiveAlpha, *d, c);
-                    d++;   
-                  }
+                  k.lerp((uint32_t*)s, w, mColor.u, mEffectiveAlpha);
                   s += stride;
                 }
               }
@@ -1961,11 +2033,11 @@ void pxRasterizer::rasterize()
                 register int c = t.u;
 
                 //mSpanBuffer.setCurrentRow(top);
-                mSpanBuffer.setCurrentRow(y);
-                mSpanBuffer.startClipRow(y);
-                mSpanBuffer.startClipSpan(left<<4, right<<4);
+                spanBuffer.setCurrentRow(y);
+                spanBuffer.startClipRow(y);
+                spanBuffer.startClipSpan(left<<4, right<<4);
                 int32_t x0, x1;
-                while(mSpanBuffer.getClip(x0, x1))
+                while(spanBuffer.getClip(x0, x1))
                 {
                   x0 >>= 4;
                   x1 >>= 4;
@@ -1981,13 +2053,13 @@ void pxRasterizer::rasterize()
                     else
                     {
                       if (opaqueCount)
-                        mSpanBuffer.addSpan(opaqueStart<<4, (opaqueStart+opaqueCount)<<4);
+                        spanBuffer.addSpan(opaqueStart<<4, (opaqueStart+opaqueCount)<<4);
                       // Add an opaqueSpan
                       opaqueStart = d-r+1;
                       opaqueCount = 0;
                     }
                     if (opaqueCount)
-                      mSpanBuffer.addSpan(opaqueStart<<4, (opaqueStart+opaqueCount)<<4);
+                      spanBuffer.addSpan(opaqueStart<<4, (opaqueStart+opaqueCount)<<4);
                     d++;   
                   }                                
                 }
@@ -1998,11 +2070,8 @@ void pxRasterizer::rasterize()
             reset();
             return;
           }
-          else if (mMatrix.isTranslatedOnly() && mTextureMatrix.isTranslatedOnly())  // filtered // BUGBUG not taking non texture affine into account
+          else if (mTextureUnscaled && mMatrix.isTranslatedOnly() && mTextureMatrix.isTranslatedOnly())  // filtered // BUGBUG not taking non texture affine into account
           {
-            texLeft -= xs_RoundToInt(mTextureMatrix.translateX());
-            texTop -= xs_RoundToInt(mTextureMatrix.translateY());
-
             pxPixel* s = mBuffer->scanline(top);
 
             int stride = mBuffer->width();
@@ -2013,16 +2082,30 @@ void pxRasterizer::rasterize()
             //int maxU = mTexture->width()-1;
             //int maxV = mTexture->height()-1;
 
+            // mEffectiveAlpha for each pixel for the masked span kernels
+            uint8_t alphas[PX_SPAN_CHUNK];
+            memset(alphas, mEffectiveAlpha, sizeof(alphas));
+            const pxSpanKernels& k = pxSpan();
+
             //if (mEffectiveAlpha == 255)
             {
               pxPixel *d, *ed;
-              int ty = (top-texTop)%mTexture->height();
+              int ty = (clippedTop-texTop)%mTexture->height();
+              if (ty < 0)
+                ty += mTexture->height();
+              // a band further down carries on from there, wrapping or
+              // clamping like the rows above it would have
+              ty += top-clippedTop;
+              if (ty >= mTexture->height())
+                ty = mTextureClamp?mTexture->height()-1:ty%mTexture->height();
               for (int y = top; y < bot;)
               {                            
                 for (; y < bot && ty < mTexture->height(); ty++)
                 {
                   pxPixel* t0 = mTexture->scanline(ty);
                   int textureOffset = (left-texLeft)%mTexture->width();
+                  if (textureOffset < 0)
+                    textureOffset += mTexture->width();
                   pxPixel* t = t0 + textureOffset;
                   pxPixel* te = t + (mTexture->width()-textureOffset);                    
 
@@ -2032,20 +2115,19 @@ void pxRasterizer::rasterize()
                   {
                     if (!mOverdraw)
                     {
-                      if (!mAlphaTexture)
+                      if (mPreMultipliedAlpha || !mAlphaTexture)
                       {
-                        if (mEffectiveAlpha == 255)
-                        {
-                          while(d < ed && t < te)
-                            *d++=*t++;
-                        }
-                        else
+                        int n = pxMin<int>(ed-d, te-t);
+                        while (n > 0)
                         {
-                          while(d < ed && t < te)
-                          {
-                            pxLerp2(mCoverage2Alpha[t->a], d->u, t->u);
-                            t++;
-                          }
+                          int chunk = pxMin<int>(n, PX_SPAN_CHUNK);
+                          if (mPreMultipliedAlpha)
+                            k.preMultipliedBlendMasked(&d->u, &t->u, alphas, chunk);
+                          else
+                            k.lerpMasked(&d->u, &t->u, alphas, chunk);
+                          d += chunk;
+                          t += chunk;
+                          n -= chunk;
                         }
                       }
                       else
@@ -2096,14 +2178,14 @@ void pxRasterizer::rasterize()
 #else
 #if 1
                       int32_t x0, x1;
-                      mSpanBuffer.startClipRow(y);
+                      spanBuffer.startClipRow(y);
                       int curSpanLeft = (d-(pxPixel*)s);
                       int curSpanRight = curSpanLeft + ww;
-                      mSpanBuffer.startClipSpan(curSpanLeft<<4, curSpanRight<<4);
-                      while(mSpanBuffer.getClip(x0, x1))
+                      spanBuffer.startClipSpan(curSpanLeft<<4, curSpanRight<<4);
+                      while(spanBuffer.getClip(x0, x1))
                       {                                            
-                        mSpanBuffer.setCurrentRow(y);
-                        mSpanBuffer.addSpan(x0, x1);
+                        spanBuffer.setCurrentRow(y);
+                        spanBuffer.addSpan(x0, x1);
                         int tX0 = (x0>>4)-curSpanLeft;
                         int tX1 = (x1>>4)-curSpanLeft;
 
@@ -2133,8 +2215,19 @@ void pxRasterizer::rasterize()
 
                       if (!mOverdraw)
                       {
-                        while(d<ed)
-                          *d++ = *lastTextureSample;
+                        if (mPreMultipliedAlpha)
+                        {
+                          while(d<ed)
+                          {
+                            pxPreMultipliedBlend(mEffectiveAlpha, d->u, lastTextureSample->u);
+                            d++;
+                          }
+                        }
+                        else
+                        {
+                          while(d<ed)
+                            *d++ = *lastTextureSample;
+                        }
                       }
                       else
                       {
@@ -2191,6 +2284,54 @@ void pxRasterizer::rasterize()
   rasterizeComplex();
 }
 
+// Fills [p, pe) with the solid color at the given coverage (0-127)
+void pxRasterizer::fillCoverageSpan(uint32_t* p, uint32_t* pe, int coverage, uint32_t c)
+{
+  uint32_t a = (coverage >= 127)?255:(coverage<<1);
+  if (mEffectiveAlpha < 255)
+    a = mCoverage2Alpha[a];
+
+  const pxSpanKernels& k = pxSpan();
+  if (a == 255 && (!mPreMultipliedAlpha || (c >> 24) == 255))
+    k.fill(p, pe-p, c);
+  else if (mPreMultipliedAlpha)
+    k.preMultipliedBlend(p, pe-p, c, a);
+  else
+    k.lerp(p, pe-p, c, a);
+}
+
+// Composites n texture samples onto d at the given coverages (0-255, alpha
+// already applied).  texelAlpha is only needed for alpha textures.
+void pxRasterizer::blendTextureSpan(uint32_t* d, const uint32_t* samples, const uint8_t* coverage,
+                                    const uint8_t* texelAlpha, int n)
+{
+  if (mPreMultipliedAlpha)
+    pxSpan().preMultipliedBlendMasked(d, samples, coverage, n);
+  else if (!mAlphaTexture)
+    pxSpan().lerpMasked(d, samples, coverage, n);
+  else
+  {
+    for (int i = 0; i < n; i++)
+    {
+      int c = coverage[i];
+      if (texelAlpha[i] == 255)
+      {
+        if (c == 255)
+          d[i] = samples[i];
+        else if (c != 0)
+          pxLerp2(c, d[i], samples[i]);
+      }
+      else
+      {
+        // a dreaded divide
+        int a = (texelAlpha[i] * c) / 255;
+
+        pxLerp2(a, d[i], samples[i]);
+      }
+    }
+  }
+}
+
 // Used to scan out the the coverage for non-filtered polys
 void pxRasterizer::scanCoverage(pxPixel* scanline, int32_t x0, int32_t x1)
 {
@@ -2234,10 +2375,8 @@ void pxRasterizer::scanCoverage(pxPixel* scanline, int32_t x0, int32_t x1)
       {
         currentCoverage += *o;
 
-        if (currentCoverage == 127) 
-          *p = c;
-        else if (currentCoverage > 0) 
-          pxLerp2(currentCoverage<<1, *p, c);
+        if (currentCoverage > 0) 
+          fillCoverageSpan(p, p+1, currentCoverage, c);
 
         *o = 0;
 
@@ -2255,18 +2394,9 @@ void pxRasterizer::scanCoverage(pxPixel* scanline, int32_t x0, int32_t x1)
 
         pe = p + coverageRun;
 
-        if (currentCoverage == 127)
-        {
-          while(p < pe)
-            *p++ = c;
-        }
-        else if (currentCoverage > 0)
-        {
-          int cc = currentCoverage<<1;
-          while(p < pe)
-            pxLerp2(cc, *p++, c);
-        }
-        else p += coverageRun;
+        if (currentCoverage > 0)
+          fillCoverageSpan(p, pe, currentCoverage, c);
+        p = pe;
 
         coverageRun = 1;
       }
@@ -2325,8 +2455,8 @@ inline pxPixel* pxRasterizer::getTextureSample(int32_t maxU, int32_t maxV, int32
 
 void pxRasterizer::rasterizeComplex()
 {
-
-  bool textureUpsideDown = false;
+  pxSpanBuffer& spanBuffer = *(pxSpanBuffer*)mSpanBuffer;
+  textureEdgeList& textureEdges = *(textureEdgeList*)mTextureEdges;
 
   int32_t maxU;
   int32_t maxV;
@@ -2341,7 +2471,7 @@ void pxRasterizer::rasterizeComplex()
       mBuffer->width() != mCachedBufferWidth)
   {
     //setClip(NULL);
-    delete mCoverage;
+    delete [] mCoverage;
     mCoverage = NULL;
 
 #ifndef USELONGCOVERAGE
@@ -2354,11 +2484,6 @@ void pxRasterizer::rasterizeComplex()
     mCachedBufferWidth = mBuffer->width();
   }
 
-  if (mTexture)
-  {
-    textureUpsideDown = mTexture->upsideDown();
-  }
-
   edge* mActiveList[1000];
   int mActiveCount = 0;
 
@@ -2419,8 +2544,38 @@ void pxRasterizer::rasterizeComplex()
       if (last > (mClipInternal.bottom()*mYOversample)-1)
         last = (mClipInternal.bottom())*mYOversample-1;
 #endif
+      if (mBandBottom < INT_MAX/mYOversample && last > mBandBottom*mYOversample-1)
+        last = mBandBottom*mYOversample-1;
 
-      for (int l = mFirst; l <= last; l++)
+      int first = mFirst;
+#if defined(FIXEDPOINTEDGES) && defined(EDGEBUCKETS)
+      // Rows above the band aren't written.  Rather than stepping through
+      // them, edges starting there are stepped straight down to the band,
+      // which lands them exactly where stepping line by line would.
+      if (!mOverdraw && mBandTop > 0 && mBandTop*mYOversample > first)
+      {
+        int bandFirst = mBandTop*mYOversample;
+        for (int l = first; l < bandFirst && l <= last; l++)
+        {
+          edgeBucket* b = edgeMgr->mStartLines[l].headBucket;
+          while (b)
+          {
+            for (edge* e = b->edges; e < b->edgePos; e++)
+            {
+              if (FIXEDSCANLINE(e->mY2) >= bandFirst)
+              {
+                e->mXCurrent += e->mXDelta * (bandFirst-l);
+                mActiveList[mActiveCount++] = e;
+              }
+            }
+            b = b->nextBucket;
+          }
+        }
+        first = bandFirst;
+      }
+#endif
+
+      for (int l = first; l <= last; l++)
       {
         //continue;
         bool spanBufferFull = false;
@@ -2430,14 +2585,17 @@ void pxRasterizer::rasterizeComplex()
         // Clip Edges against complex region
         if (mOverdraw)
         {
-          mSpanBuffer.setCurrentRow(l>>overSampleShift);
-          spanBufferFull = mSpanBuffer.isCurrentRowFull();
+          spanBuffer.setCurrentRow(l>>overSampleShift);
+          spanBufferFull = spanBuffer.isCurrentRowFull();
         }
 #endif
 #endif
 
         int subline = l & overSampleMask;
 
+        // rows above the band still step the edges
+        bool inBand = (l>>overSampleShift) >= mBandTop;
+
         if (!spanBufferFull)
         {
 
@@ -2541,10 +2699,10 @@ void pxRasterizer::rasterizeComplex()
 
 #if 1
 
-          mSpanBuffer.startClipRow(l>>overSampleShift);
+          spanBuffer.startClipRow(l>>overSampleShift);
 
           // Fill scan line
-          bool done = false;
+          bool done = !inBand;
           int z = 0;
           int winding = 0;
           bool inside = false;
@@ -2614,8 +2772,8 @@ void pxRasterizer::rasterizeComplex()
               // Do Complex Clipping
               int32_t pSave = p;
               int32_t pEndSave = pEnd;
-              mSpanBuffer.startClipSpan(p, pEnd);
-              while(mSpanBuffer.getClip(p, pEnd)) // This is destructive to p and pEnd
+              spanBuffer.startClipSpan(p, pEnd);
+              while(spanBuffer.getClip(p, pEnd)) // This is destructive to p and pEnd
               {
 #endif
 #endif
@@ -2721,7 +2879,7 @@ void pxRasterizer::rasterizeComplex()
 
 #if 1
         // scan out mCoverage
-        if (subline == overSampleFlush)
+        if (subline == overSampleFlush && inBand)
         {
           pxPixel* s = mBuffer->scanline(l>>overSampleShift);
           {
@@ -2747,9 +2905,9 @@ void pxRasterizer::rasterizeComplex()
               if (mCoverageFirst <= mCoverageLast && mOverdraw)
               {
                 int32_t discard1, discard2;
-                mSpanBuffer.startClipRow(l>>overSampleShift);
-                mSpanBuffer.startClipSpan(mCoverageFirst<<4, mCoverageLast<<4);
-                overdrawDetected = !mSpanBuffer.getClip(discard1, discard2);
+                spanBuffer.startClipRow(l>>overSampleShift);
+                spanBuffer.startClipSpan(mCoverageFirst<<4, mCoverageLast<<4);
+                overdrawDetected = !spanBuffer.getClip(discard1, discard2);
                 if (overdrawDetected)
                 {
                   char* s = mCoverage + mCoverageFirst;
@@ -2777,7 +2935,7 @@ void pxRasterizer::rasterizeComplex()
 
                 // Add any edges starting on this line
                 {
-                  const endPoint* p = textureStarts->get(textureStartsCursor);
+                  const endPoint* p = textureEdges.mStarts.get(textureStartsCursor);
                   while(p && p->mY <= textureY)
                   {
                     //                        if (p->mY == textureY)
@@ -2789,13 +2947,13 @@ void pxRasterizer::rasterizeComplex()
                       p->mEdge->mCurrentV += (p->mEdge->mdv * delta);
                     }
                     textureStartsCursor++;
-                    p = textureStarts->get(textureStartsCursor);
+                    p = textureEdges.mStarts.get(textureStartsCursor);
                   }
                 }
 
                 // Remove any edges that end on this scanline
                 {
-                  const endPoint* p = textureEnds->get(textureEndsCursor);
+                  const endPoint* p = textureEdges.mEnds.get(textureEndsCursor);
                   while(p && p->mY < textureY)
                   {
                     //if (p->mY <= textureY)
@@ -2811,7 +2969,7 @@ void pxRasterizer::rasterizeComplex()
                       mActiveTextureCount = newCount;
                     }
                     textureEndsCursor++;
-                    p = textureEnds->get(textureEndsCursor);
+                    p = textureEdges.mEnds.get(textureEndsCursor);
                   }
                 }
 #if 0
@@ -2819,11 +2977,11 @@ void pxRasterizer::rasterizeComplex()
 
                 if (mOverdraw)
                 {
-                  mSpanBuffer.setCurrentRow(l>>overSampleShift);
+                  spanBuffer.setCurrentRow(l>>overSampleShift);
                   int32_t t1 = mCoverageFirst+1;
                   int32_t t2 = mCoverageLast-1;
                   if (t1 < t2)
-                    mSpanBuffer.addSpan(t1<<4, t2<<4);
+                    spanBuffer.addSpan(t1<<4, t2<<4);
                 }
 #endif
 #endif
@@ -2903,9 +3061,9 @@ void pxRasterizer::rasterizeComplex()
 #if 1
                     if (mOverdraw)
                     {
-                      mSpanBuffer.startClipRow(l>>overSampleShift);
-                      mSpanBuffer.startClipSpan(mCoverageFirst<<4, mCoverageLast<<4);
-                      if (mSpanBuffer.getClip(startSpan, endSpan))
+                      spanBuffer.startClipRow(l>>overSampleShift);
+                      spanBuffer.startClipSpan(mCoverageFirst<<4, mCoverageLast<<4);
+                      if (spanBuffer.getClip(startSpan, endSpan))
                       {
                         startSpan = startSpan >> 4;
                         endSpan = endSpan >> 4;
@@ -2926,14 +3084,14 @@ void pxRasterizer::rasterizeComplex()
 #if 0
                       if (mOverdraw)
                       {
-                        mSpanBuffer.setCurrentRow(l>>overSampleShift);
+                        spanBuffer.setCurrentRow(l>>overSampleShift);
 #if 1
                         int32_t t1 = startSpan+1;
                         int32_t t2 = endSpan-1;
                         if (t1 <= t2)
-                          mSpanBuffer.addSpan(t1<<4, t2<<4);
+                          spanBuffer.addSpan(t1<<4, t2<<4);
 #else
-                        mSpanBuffer.addSpan(startSpan<<4, endSpan<<4);
+                        spanBuffer.addSpan(startSpan<<4, endSpan<<4);
 #endif
                       }
 
@@ -3033,8 +3191,8 @@ void pxRasterizer::rasterizeComplex()
                               {
                                 int32_t endOpaque = startOpaque + coverageRun;
                                 endOpaque = pxMin<int32_t>(endOpaque, mCoverageLast);
-                                mSpanBuffer.setCurrentRow(l>>overSampleShift);
-                                mSpanBuffer.addSpan(startOpaque<<4, endOpaque<<4);
+                                spanBuffer.setCurrentRow(l>>overSampleShift);
+                                spanBuffer.addSpan(startOpaque<<4, endOpaque<<4);
                               }
                               //mSpanBuffer.addSpan(0, mBuffer->width()<<4);
 
@@ -3136,66 +3294,57 @@ void pxRasterizer::rasterizeComplex()
 #else
 
                       int currentCoverage = 0;
-                      int i;
-                      for (i = startSpan; i <= endSpan; i++)
+                      uint32_t samples[PX_SPAN_CHUNK];
+                      uint8_t coverage[PX_SPAN_CHUNK];
+                      uint8_t texelAlpha[PX_SPAN_CHUNK];
+                      int i = startSpan;
+                      while (i <= endSpan)
                       {
-                        currentCoverage += mCoverage[i];
-                        mCoverage[i] = 0;
-                        register int c;
+                        int n = pxMin<int>(endSpan-i+1, PX_SPAN_CHUNK);
+                        uint32_t* d = &s[i].u;
+                        for (int j = 0; j < n; j++, i++)
+                        {
+                          currentCoverage += mCoverage[i];
+                          mCoverage[i] = 0;
+                          register int c;
 
-                        if (mEffectiveAlpha == 255) 
-                          c = currentCoverage<<1;
-                        else 
-                          c = mCoverage2Alpha[currentCoverage<<1];
+                          c = (currentCoverage >= 127)?255:(currentCoverage<<1);
+                          if (mEffectiveAlpha < 255) 
+                            c = mCoverage2Alpha[c];
 
 #if 0
                                             
-                        int32_t texU, texV;
-                        if (mTextureClamp)
-                        {
-                          texU = pxClamp<int32_t>(curU, 0, maxU);
-                          texV = pxClamp<int32_t>(curV, 0, maxV);
-                          texU = texU>>UVFIXEDSHIFT;
-                          texV = texV>>UVFIXEDSHIFT;
-                        }
-                        else
-                        {                                               
-                          curU = pxWrap<int32_t>(curU, 0, maxU);
-                          curV = pxWrap<int32_t>(curV, 0, maxV);
-                          texU = curU>>UVFIXEDSHIFT;
-                          texV = curV>>UVFIXEDSHIFT;
-                        }
-
-                        pxPixel* textureSample = mTexture->pixel(texU, texV);
-#else
-                        pxPixel* textureSample = getTextureSample(maxU, maxV, curU, curV);
-#endif
-
-                        if (!mAlphaTexture || textureSample->a == 255)
-                        {
-                          if (c == 255)
+                          int32_t texU, texV;
+                          if (mTextureClamp)
                           {
-                            s[i].u = textureSample->u;
+                            texU = pxClamp<int32_t>(curU, 0, maxU);
+                            texV = pxClamp<int32_t>(curV, 0, maxV);
+                            texU = texU>>UVFIXEDSHIFT;
+                            texV = texV>>UVFIXEDSHIFT;
                           }
                           else
-                          {
-                            if (c != 0)
-                              pxLerp2(c, s[i].u, textureSample->u);
+                          {                                               
+                            curU = pxWrap<int32_t>(curU, 0, maxU);
+                            curV = pxWrap<int32_t>(curV, 0, maxV);
+                            texU = curU>>UVFIXEDSHIFT;
+                            texV = curV>>UVFIXEDSHIFT;
                           }
-                        }
-                        else
-                        {
-                          // a dreaded divide
-                          int a = (textureSample->a * c) / 255;
 
-                          pxLerp2(a, s[i].u, textureSample->u);
-                        }
-                                            
+                          pxPixel* textureSample = mTexture->pixel(texU, texV);
+#else
+                          pxPixel* textureSample = getTextureSample(maxU, maxV, curU, curV);
+#endif
+
+                          samples[j] = textureSample->u;
+                          coverage[j] = c;
+                          texelAlpha[j] = textureSample->a;
 
-                        textureX++;
-                        curU += du;
-                        curV += dv;
+                          textureX++;
+                          curU += du;
+                          curV += dv;
 
+                        }
+                        blendTextureSpan(d, samples, coverage, texelAlpha, n);
                       }
                       mCoverage[i] = 0;
 #endif
@@ -3203,124 +3352,59 @@ void pxRasterizer::rasterizeComplex()
                     else  // bilerp
                     {
                       unsigned int currentCoverage = 0;
-                      int i;
-                      for (i = startSpan; i <= endSpan; i++)
+                      uint32_t samples[PX_SPAN_CHUNK];
+                      uint32_t t1[PX_SPAN_CHUNK], t2[PX_SPAN_CHUNK], t3[PX_SPAN_CHUNK], t4[PX_SPAN_CHUNK];
+                      uint8_t fracUs[PX_SPAN_CHUNK], fracVs[PX_SPAN_CHUNK];
+                      uint8_t coverage[PX_SPAN_CHUNK];
+                      uint8_t texelAlpha[PX_SPAN_CHUNK];
+                      int i = startSpan;
+                      while (i <= endSpan)
                       {
-                        currentCoverage += mCoverage[i];
-                        mCoverage[i] = 0;
-
-#if 1
-                        int32_t texV = ((curV>>UVFIXEDSHIFT)/*%mTexture->height()*/);
-                        //                                if (texV < 0) texV += mTexture->height();
-                        int32_t texU =  ((curU>>UVFIXEDSHIFT)/*%mTexture->width()*/);
-#else
-                        int32_t texV = (curV-dv/2)>>UVFIXEDSHIFT/*%mTexture->height()*/;
-                        //                                if (texV < 0) texV += mTexture->height();
-                        int32_t texU =  (curU-du/2)>>UVFIXEDSHIFT/*%mTexture->width()*/;
-                        //                                if (texU < 0) texU += mTexture->width();
-                        int32_t texV2 = (curV+du/2) >> UVFIXEDSHIFT;
-                        int32_t texU2 = (curU+du/2) >> UVFIXEDSHIFT;
-
-                                            
-#endif
-
-#if 0
-                        if (texV2 >= mTexture->height())
-                          texV2 = mTexture->height()-1;
-
-                        if (texU2 >= mTexture->width())
-                          texU2 = mTexture->width()-1;
-#else
-                        texU = pxWrap<int32_t>(texU,0,mTexture->width()-1);
-                        texV = pxWrap<int32_t>(texV,0,mTexture->height()-1);
-                        //          texU2 = pxWrap<int32_t>(texU2,0,mTexture->width()-1);
-                        //          texV2 = pxWrap<int32_t>(texV2,0,mTexture->height()-1);
-#endif
-                        bool blend = true;
-                        if (mTextureClamp)
-                        {
-                          bool clampedV = true;
-                          bool clampedU = true;
-                          // Clamp to texture extents
-                          if (texV < 0) texV = 0;
-                          else if (texV >= mTexture->height()) texV = mTexture->height()-1;
-                          else clampedV = false;
-                          if (texU < 0) texU = 0;
-                          else if (texU >= mTexture->width()) texU = mTexture->width()-1;
-                          else clampedU = false;
-
-                          blend = (!clampedV && !clampedU);
-                        }
-                        else
-                        {
-                          // Simple Wrap
-#if 1
-                          texV %= mTexture->height();
-                          texU %= mTexture->width();
-                          if (texV < 0) texV += mTexture->height();
-                          if (texU < 0) texU += mTexture->width();
-#else
-
-                          texU = pxWrap<int32_t>(texU, 0, mTexture->width()-1);
-                          texV = pxWrap<int32_t>(texV, 0, mTexture->height()-1);
-#endif
-                        }
-
-                        pxPixel textureSample;
-
-                        pxPixel* texel = mTexture->pixel(texU, texV);
-                        if (blend)
+                        int n = pxMin<int>(endSpan-i+1, PX_SPAN_CHUNK);
+                        uint32_t* d = &s[i].u;
+                        // gather the four texels and weights for each pixel, the
+                        // filtering and compositing are then done a span at a time
+                        for (int j = 0; j < n; j++, i++)
                         {
-#if 1
-#if 0  // I think this is right.. but it was whacking the mag in screenjot ... try later
-                          int fracU = ((((curU) >> 8)) & 0xff);
-                          int fracV = ((((curV) >> 8)) & 0xff);
-#else
-                          int dd = 1 << 15;
-                          //int dd = (1<<14)+(du>>2);
+                          currentCoverage += mCoverage[i];
+                          mCoverage[i] = 0;
 
-                          int fracU = ((((curU+(dd)) >> 8)) & 0xff);
-                          int fracV = ((((curV+(dd)) >> 8)) & 0xff);
-#endif
-#else
-                          int fracU = ((((curU >> 8)) & 0xff)>>2) + baseX;
-                          int fracV = (((curV >> 8)) & 0xff);
-                          baseX+=16;
-                          if (baseX >= 128) baseX = 0;
-#endif
+                          int32_t texV = ((curV>>UVFIXEDSHIFT)/*%mTexture->height()*/);
+                          int32_t texU =  ((curU>>UVFIXEDSHIFT)/*%mTexture->width()*/);
 
-                          pxPixel *texel2, *texel3, *texel4;
-#if 0
-                          int nextU = (curU + du) >> 16;
-                          int nextV = (curV + dv) >> 16;
-                          //int nextU = (texU < mTexture->width()-1);
-                          if (nextU >= mTexture->width()-1)
-                            nextU = texU;
-                          if (nextV >= mTexture->height()-1)
-                            nextV = texV;
-                          //int nextV = (texV < mTexture->height()-1);
-#else
-                          int nextU = (texU < mTexture->width()-1);
-                          int nextV = (texV < mTexture->height()-1);
-#endif
-                          if (textureUpsideDown)
-                            nextV = - nextV;
+                          texU = pxWrap<int32_t>(texU,0,mTexture->width()-1);
+                          texV = pxWrap<int32_t>(texV,0,mTexture->height()-1);
 
-                          texel2 = texel + nextU;
-                          texel3 = texel + (mTexture->width() * nextV);
-                          texel4 = texel3 + nextU;
+                          bool blend = true;
+                          if (mTextureClamp)
+                          {
+                            bool clampedV = true;
+                            bool clampedU = true;
+                            // Clamp to texture extents
+                            if (texV < 0) texV = 0;
+                            else if (texV >= mTexture->height()) texV = mTexture->height()-1;
+                            else clampedV = false;
+                            if (texU < 0) texU = 0;
+                            else if (texU >= mTexture->width()) texU = mTexture->width()-1;
+                            else clampedU = false;
+
+                            blend = (!clampedV && !clampedU);
+                          }
+                          else
+                          {
+                            // Simple Wrap
+                            texV %= mTexture->height();
+                            texU %= mTexture->width();
+                            if (texV < 0) texV += mTexture->height();
+                            if (texU < 0) texU += mTexture->width();
+                          }
 
-#if 1
-#if 0
-                          textureSample = pxBlend4(
-                            *texel,
-                            *texel2, 
-                            *texel3,
-                            *texel4,
-                            fracU, fracV);
-#else
+                          pxPixel* texel = mTexture->pixel(texU, texV);
+                          if (blend)
                           {
+                            // sample between the four texel centers around the pixel
                             int32_t texU2, texV2;
+                            int fracU, fracV;
 
                             int up = (curU >> 8) & 0xff;
                             int vp = (curV >> 8) & 0xff;
@@ -3357,72 +3441,37 @@ void pxRasterizer::rasterizeComplex()
                             texV2 = pxClamp<int32_t>(texV2, 0, mTexture->height()-1);
 
                             texel = mTexture->pixel(texU, texV);
-                            texel2 = mTexture->pixel(texU2, texV);
-                            texel3 = mTexture->pixel(texU, texV2);
-                            texel4 = mTexture->pixel(texU2, texV2);
-
-                            textureSample = pxBlend4(
-                              *texel,
-                              *texel2, 
-                              *texel3,
-                              *texel4,
-                              fracU, fracV);
-                          }
-
-#endif
-#else
-                          textureSample = pxBlend4(
-                            *texel,
-                            *mTexture->pixel(texU2, texV), 
-                            *mTexture->pixel(texU, texV2),
-                            *mTexture->pixel(texU2, texV2),
-                            fracU, fracV);
-#endif
-                        }
-                        else
-                        {
-                          textureSample = *texel;
-                        }
-
-
-                        textureX++;
-                        register int c;
-
-#if 0
-                        if (mEffectiveAlpha == 255) c = mCoverage[i];
-                        else c = mCoverage2Alpha[mCoverage[i]];
-#else
-                        if (mEffectiveAlpha == 255) 
-                          c = currentCoverage<<1;
-                        else 
-                          c = mCoverage2Alpha[currentCoverage<<1];
-#endif
-
-
-                        if (!mAlphaTexture || texel->a == 255)
-                        {
-                          if (c == 255 )
-                          {
-                            s[i].u = textureSample.u;
+                            t1[j] = texel->u;
+                            t2[j] = mTexture->pixel(texU2, texV)->u;
+                            t3[j] = mTexture->pixel(texU, texV2)->u;
+                            t4[j] = mTexture->pixel(texU2, texV2)->u;
+                            fracUs[j] = fracU;
+                            fracVs[j] = fracV;
                           }
                           else
                           {
-                            if (c != 0)
-                              pxLerp2(c, s[i].u, textureSample.u);
-                            // todo handle color with alpha
+                            // no weight on the other three
+                            t1[j] = t2[j] = t3[j] = t4[j] = texel->u;
+                            fracUs[j] = fracVs[j] = 0;
                           }
-                        }
-                        else
-                        {
-                          int a = (texel->a * c) / 255;
 
-                          pxLerp2(a, s[i].u, textureSample.u);
+                          textureX++;
+                          register int c;
 
-                        }
+                          c = (currentCoverage >= 127)?255:(currentCoverage<<1);
+                          if (mEffectiveAlpha < 255) 
+                            c = mCoverage2Alpha[c];
+
+                          coverage[j] = c;
+                          texelAlpha[j] = texel->a;
 
-                        curU += du;
-                        curV += dv;
+                          curU += du;
+                          curV += dv;
+                        }
 
+                        const pxSpanKernels& k = pxSpan();
+                        k.biLerp(samples, t1, t2, t3, t4, fracUs, fracVs, n);
+                        blendTextureSpan(d, samples, coverage, texelAlpha, n);
                       }
                       mCoverage[i] = 0;
                     }
@@ -3430,7 +3479,7 @@ void pxRasterizer::rasterizeComplex()
                     if (mOverdraw)
                     {
 #if 1
-                      done2 = !mSpanBuffer.getClip(startSpan, endSpan);
+                      done2 = !spanBuffer.getClip(startSpan, endSpan);
                       if (!done2)
                       {
                         startSpan >>= 4;
@@ -3529,7 +3578,7 @@ void pxRasterizer::rasterizeComplex()
               {
 #if 0
 #if 1
-                mSpanBuffer.setCurrentRow(l>>overSampleShift);
+                spanBuffer.setCurrentRow(l>>overSampleShift);
                 int32_t t1 = mCoverageFirst;
                 int32_t t2 = mCoverageLast;
 #if 1
@@ -3537,10 +3586,10 @@ void pxRasterizer::rasterizeComplex()
                 t2--;
 #endif
                 if (t1 <= t2)
-                  mSpanBuffer.addSpan(t1<<4, t2<<4);
+                  spanBuffer.addSpan(t1<<4, t2<<4);
 #else
-                mSpanBuffer.setCurrentRow(l>>overSampleShift);
-                mSpanBuffer.addSpan(0, mBuffer->width()<<4);
+                spanBuffer.setCurrentRow(l>>overSampleShift);
+                spanBuffer.addSpan(0, mBuffer->width()<<4);
 #endif
 #endif
                 //if (mCoverageFirst <= mCoverageLast)
@@ -3650,7 +3699,40 @@ void pxRasterizer::clear()
   mBuffer->fill(br, c);
   br.setLeft(br.left() << 4);
   br.setRight(br.right() << 4);
-  mSpanBuffer.init(br);
+  ((pxSpanBuffer*)mSpanBuffer)->init(br);
+}
+
+void pxRasterizer::copySettings(const pxRasterizer& r)
+{
+  if (mBuffer != r.mBuffer)
+    init(r.mBuffer);
+
+  // both of these reset and rebuild tables
+  if (mYOversample != r.mYOversample)
+    setYOversample(r.mYOversample);
+  if (mXResolution != r.mXResolution)
+    setXResolution(r.mXResolution);
+
+  mFillMode = r.mFillMode;
+  mColor = r.mColor;
+  mAlpha = r.mAlpha;
+  mAlphaDirty = true;
+
+  mClip = r.mClip;
+  mClipValid = r.mClipValid;
+
+  mTexture = r.mTexture;
+  mTextureClamp = r.mTextureClamp;
+  mTextureClampColor = r.mTextureClampColor;
+  mBiLerp = r.mBiLerp;
+  mAlphaTexture = r.mAlphaTexture;
+  mOverdraw = r.mOverdraw;
+  mPreMultipliedAlpha = r.mPreMultipliedAlpha;
+
+  mMatrix = r.mMatrix;
+  mTextureMatrix = r.mTextureMatrix;
+
+  reset();
 }
 
 bool pxRasterizer::alphaTexture() const { return mAlphaTexture; }
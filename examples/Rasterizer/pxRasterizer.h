@@ -26,6 +26,10 @@ public:
 
   void addEdge(double x1, double y1, double x2, double y2);
 
+  // Edges kept since the last reset.  Horizontal edges and edges outside the
+  // clip are dropped.
+  int edgeCount() const;
+
   void rasterize();
   //void rasterize2();
 
@@ -50,6 +54,11 @@ public:
   pxRect clip();
   void setClip(const pxRect* r);
 
+  // Only rows [top, bottom) are written.  Unlike the clip this doesn't change
+  // how edges are stepped, so adjoining bands rasterized separately match a
+  // single pass exactly.
+  void setBand(int top, int bottom);
+
   pxBuffer* texture() const {return mTexture;}
   void setTexture(pxBuffer* texture);
 
@@ -85,8 +94,22 @@ public:
   bool overdraw() const { return mOverdraw; }
   void setOverdraw(bool f) { mOverdraw = f;; }
 
+  // When set the buffer, the color and textures are all premultiplied and
+  // pixels are composited with src + dst*(1-srcAlpha).  The color's alpha is
+  // then part of the color and alpha() alone scales the coverage.
+  bool preMultipliedAlpha() const { return mPreMultipliedAlpha; }
+  void setPreMultipliedAlpha(bool f) 
+  { 
+    mPreMultipliedAlpha = f; 
+    mAlphaDirty = true;
+  }
+
   void clear();
 
+  // Takes on the buffer and every setting of r apart from the band, and
+  // resets.  Edges and texture coordinates aren't copied.
+  void copySettings(const pxRasterizer& r);
+
 private:
 
   void rasterizeComplex();
@@ -96,6 +119,9 @@ private:
                       double u1, double v1, double u2, double v2);
 
   inline void scanCoverage(pxPixel* scanline, int32_t x0, int32_t x1);
+  inline void fillCoverageSpan(uint32_t* p, uint32_t* pe, int coverage, uint32_t c);
+  inline void blendTextureSpan(uint32_t* d, const uint32_t* samples, const uint8_t* coverage,
+                               const uint8_t* texelAlpha, int n);
   inline pxPixel* getTextureSample(int32_t maxU, int32_t maxV, int32_t& curU, int32_t& curV);
 
   void calculateEffectiveAlpha();
@@ -120,6 +146,9 @@ private:
   void* mEdgeManager;
 #endif
 
+  void* mSpanBuffer;
+  void* mTextureEdges;
+
 #ifdef USELONGCOVERAGE
   char* mCoverage;
 #else
@@ -139,6 +168,8 @@ private:
   pxRect mClipInternal;  // mClip interescted with the bounds of the current buffer.
   bool mClipInternalCalculated;
 
+  int mBandTop, mBandBottom;
+
   int mCachedBufferHeight;
   int mCachedBufferWidth;
 
@@ -149,7 +180,11 @@ private:
   uint32_t overSampleAdd4;
   uint32_t overSampleFlush;
   uint32_t overSampleMask;
-  //   uint32_t overSampleShift;
+  uint32_t overSampleShift;
+  uint32_t fixedScanlineShift;
+
+  // mXResolution derived
+  uint32_t xShift;
 
   pxBuffer* mTexture;
 
@@ -160,6 +195,10 @@ private:
   bool mAlphaTexture;
 
   bool mOverdraw;
+  bool mPreMultipliedAlpha;
+
+  // texture coordinates map 1:1 onto the edges, only a translation apart
+  bool mTextureUnscaled;
 
   unsigned char ltEdgeCover[16];  // static?  can be shared
   unsigned char rtEdgeCover[16];
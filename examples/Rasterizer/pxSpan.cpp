@@ -0,0 +1,727 @@
+// Copyright 2007 John Robinson
+
+// pxSpan.cpp
+//
+// Everything the px2d.h helpers do with masks and shifts on packed pairs of
+// channels works out, per channel, to
+//
+//   d + ((s-d)*a >> 8)  ==  (d*(256-a) + s*a) >> 8
+//
+// which never leaves 16 bits for a <= 256.  So the vector versions widen
+// each channel to 16 bits and produce the same bits as the scalar ones.
+
+#include "pxSpan.h"
+#include "px2d.h"
+
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define PX_SPAN_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PX_SPAN_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PX_SPAN_NEON
+#include <arm_neon.h>
+#endif
+
+//
+// Scalar
+//
+
+static void fillScalar(uint32_t* d, int n, uint32_t c)
+{
+  uint32_t* de = d + n;
+  while (d < de)
+    *d++ = c;
+}
+
+static void lerpScalar(uint32_t* d, int n, uint32_t c, uint32_t a)
+{
+  uint32_t* de = d + n;
+  while (d < de)
+    pxLerp2(a, *d++, c);
+}
+
+static void preMultipliedBlendScalar(uint32_t* d, int n, uint32_t c, uint32_t a)
+{
+  uint32_t* de = d + n;
+  while (d < de)
+    pxPreMultipliedBlend(a, *d++, c);
+}
+
+static void lerpMaskedScalar(uint32_t* d, const uint32_t* s, const uint8_t* a, int n)
+{
+  for (int i = 0; i < n; i++)
+  {
+    if (a[i] == 255)
+      d[i] = s[i];
+    else if (a[i] != 0)
+      pxLerp2(a[i], d[i], s[i]);
+  }
+}
+
+static void preMultipliedBlendMaskedScalar(uint32_t* d, const uint32_t* s, const uint8_t* a, int n)
+{
+  for (int i = 0; i < n; i++)
+  {
+    if (a[i] == 255 && (s[i] >> 24) == 255)
+      d[i] = s[i];
+    else if (a[i] != 0)
+      pxPreMultipliedBlend(a[i], d[i], s[i]);
+  }
+}
+
+static void biLerpScalar(uint32_t* d, const uint32_t* t1, const uint32_t* t2,
+                         const uint32_t* t3, const uint32_t* t4,
+                         const uint8_t* u, const uint8_t* v, int n)
+{
+  for (int i = 0; i < n; i++)
+    d[i] = pxBlend4(pxPixel(t1[i]), pxPixel(t2[i]), pxPixel(t3[i]), pxPixel(t4[i]),
+                    u[i], v[i]).u;
+}
+
+// pxPreMultipliedBlend's scaled source for a constant color
+static inline uint32_t scaleColor(uint32_t c, uint32_t a)
+{
+  uint32_t a1 = a + (a >> 7);
+  uint32_t rb = (((c & 0xFF00FF) * a1) >> 8) & 0xFF00FF;
+  uint32_t ag = ((((c >> 8) & 0xFF00FF) * a1) >> 8) & 0xFF00FF;
+  return rb | (ag << 8);
+}
+
+#ifdef PX_SPAN_SSE2
+
+//
+// SSE2, 4 pixels at a time
+//
+
+// (d*(256-a) + s*a) >> 8 on 16 bit channels
+static inline __m128i lerp16(__m128i d, __m128i s, __m128i a)
+{
+  __m128i ia = _mm_sub_epi16(_mm_set1_epi16(256), a);
+  return _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(d, ia), _mm_mullo_epi16(s, a)), 8);
+}
+
+// each of 4 bytes repeated over the 4 channels of a pixel, as 16 bit values
+static inline void expand4(const uint8_t* p, __m128i& lo, __m128i& hi)
+{
+  int32_t v;
+  memcpy(&v, p, 4);
+  __m128i x = _mm_unpacklo_epi8(_mm_cvtsi32_si128(v), _mm_setzero_si128());
+  x = _mm_unpacklo_epi16(x, x);
+  lo = _mm_unpacklo_epi32(x, x);
+  hi = _mm_unpackhi_epi32(x, x);
+}
+
+// all ones for the pixels where a is 255
+static inline __m128i opaque4(const uint8_t* p)
+{
+  int32_t v;
+  memcpy(&v, p, 4);
+  __m128i x = _mm_unpacklo_epi8(_mm_cvtsi32_si128(v), _mm_setzero_si128());
+  x = _mm_unpacklo_epi16(x, _mm_setzero_si128());
+  return _mm_cmpeq_epi32(x, _mm_set1_epi32(255));
+}
+
+static inline __m128i selectPixels(__m128i m, __m128i a, __m128i b)
+{
+  return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b));
+}
+
+static void fillSSE2(uint32_t* d, int n, uint32_t c)
+{
+  if (n < 4)
+    return fillScalar(d, n, c);
+
+  __m128i c4 = _mm_set1_epi32(c);
+  int i = 0;
+  for (; i + 4 <= n; i += 4)
+    _mm_storeu_si128((__m128i*)(d+i), c4);
+  fillScalar(d+i, n-i, c);
+}
+
+static void lerpSSE2(uint32_t* d, int n, uint32_t c, uint32_t a)
+{
+  if (n < 4)
+    return lerpScalar(d, n, c, a);
+
+  __m128i z = _mm_setzero_si128();
+  __m128i ia = _mm_set1_epi16(256-a);
+  __m128i sa = _mm_mullo_epi16(_mm_unpacklo_epi8(_mm_set1_epi32(c), z), _mm_set1_epi16(a));
+  int i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    __m128i x = _mm_loadu_si128((__m128i*)(d+i));
+    __m128i lo = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(x, z), ia), sa), 8);
+    __m128i hi = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(x, z), ia), sa), 8);
+    _mm_storeu_si128((__m128i*)(d+i), _mm_packus_epi16(lo, hi));
+  }
+  lerpScalar(d+i, n-i, c, a);
+}
+
+static void preMultipliedBlendSSE2(uint32_t* d, int n, uint32_t c, uint32_t a)
+{
+  if (n < 4)
+    return preMultipliedBlendScalar(d, n, c, a);
+
+  uint32_t sc = scaleColor(c, a);
+  __m128i z = _mm_setzero_si128();
+  __m128i ff = _mm_set1_epi16(0xff);
+  __m128i src = _mm_unpacklo_epi8(_mm_set1_epi32(sc), z);
+  __m128i alpha1 = _mm_set1_epi16(256 - (sc >> 24));
+  int i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    __m128i x = _mm_loadu_si128((__m128i*)(d+i));
+    __m128i lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(x, z), alpha1), 8);
+    __m128i hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(x, z), alpha1), 8);
+    lo = _mm_and_si128(_mm_add_epi16(lo, src), ff);
+    hi = _mm_and_si128(_mm_add_epi16(hi, src), ff);
+    _mm_storeu_si128((__m128i*)(d+i), _mm_packus_epi16(lo, hi));
+  }
+  preMultipliedBlendScalar(d+i, n-i, c, a);
+}
+
+static void lerpMaskedSSE2(uint32_t* d, const uint32_t* s, const uint8_t* a, int n)
+{
+  if (n < 4)
+    return lerpMaskedScalar(d, s, a, n);
+
+  __m128i z = _mm_setzero_si128();
+  int i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    __m128i x = _mm_loadu_si128((__m128i*)(d+i));
+    __m128i y = _mm_loadu_si128((__m128i*)(s+i));
+    __m128i alo, ahi;
+    expand4(a+i, alo, ahi);
+    __m128i lo = lerp16(_mm_unpacklo_epi8(x, z), _mm_unpacklo_epi8(y, z), alo);
+    __m128i hi = lerp16(_mm_unpackhi_epi8(x, z), _mm_unpackhi_epi8(y, z), ahi);
+    __m128i r = selectPixels(opaque4(a+i), y, _mm_packus_epi16(lo, hi));
+    _mm_storeu_si128((__m128i*)(d+i), r);
+  }
+  lerpMaskedScalar(d+i, s+i, a+i, n-i);
+}
+
+// d*(256 - srcAlpha) >> 8 + src, where src is s scaled by a
+static inline __m128i preMultipliedBlend16(__m128i d, __m128i s, __m128i a)
+{
+  __m128i src = _mm_srli_epi16(_mm_mullo_epi16(s, _mm_add_epi16(a, _mm_srli_epi16(a, 7))), 8);
+  __m128i srcAlpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(src, _MM_SHUFFLE(3,3,3,3)),
+                                         _MM_SHUFFLE(3,3,3,3));
+  __m128i alpha1 = _mm_sub_epi16(_mm_set1_epi16(256), srcAlpha);
+  __m128i dst = _mm_srli_epi16(_mm_mullo_epi16(d, alpha1), 8);
+  return _mm_and_si128(_mm_add_epi16(src, dst), _mm_set1_epi16(0xff));
+}
+
+static void preMultipliedBlendMaskedSSE2(uint32_t* d, const uint32_t* s, const uint8_t* a, int n)
+{
+  if (n < 4)
+    return preMultipliedBlendMaskedScalar(d, s, a, n);
+
+  __m128i z = _mm_setzero_si128();
+  __m128i ff = _mm_set1_epi32(255);
+  int i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    __m128i x = _mm_loadu_si128((__m128i*)(d+i));
+    __m128i y = _mm_loadu_si128((__m128i*)(s+i));
+    __m128i alo, ahi;
+    expand4(a+i, alo, ahi);
+    __m128i lo = preMultipliedBlend16(_mm_unpacklo_epi8(x, z), _mm_unpacklo_epi8(y, z), alo);
+    __m128i hi = preMultipliedBlend16(_mm_unpackhi_epi8(x, z), _mm_unpackhi_epi8(y, z), ahi);
+    __m128i m = _mm_and_si128(opaque4(a+i), _mm_cmpeq_epi32(_mm_srli_epi32(y, 24), ff));
+    _mm_storeu_si128((__m128i*)(d+i), selectPixels(m, y, _mm_packus_epi16(lo, hi)));
+  }
+  preMultipliedBlendMaskedScalar(d+i, s+i, a+i, n-i);
+}
+
+static void biLerpSSE2(uint32_t* d, const uint32_t* t1, const uint32_t* t2,
+                       const uint32_t* t3, const uint32_t* t4,
+                       const uint8_t* u, const uint8_t* v, int n)
+{
+  if (n < 4)
+    return biLerpScalar(d, t1, t2, t3, t4, u, v, n);
+
+  __m128i z = _mm_setzero_si128();
+  int i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    __m128i p1 = _mm_loadu_si128((__m128i*)(t1+i));
+    __m128i p2 = _mm_loadu_si128((__m128i*)(t2+i));
+    __m128i p3 = _mm_loadu_si128((__m128i*)(t3+i));
+    __m128i p4 = _mm_loadu_si128((__m128i*)(t4+i));
+    __m128i ulo, uhi, vlo, vhi;
+    expand4(u+i, ulo, uhi);
+    expand4(v+i, vlo, vhi);
+
+    __m128i top = lerp16(_mm_unpacklo_epi8(p1, z), _mm_unpacklo_epi8(p2, z), ulo);
+    __m128i bot = lerp16(_mm_unpacklo_epi8(p3, z), _mm_unpacklo_epi8(p4, z), ulo);
+    __m128i lo = lerp16(top, bot, vlo);
+    top = lerp16(_mm_unpackhi_epi8(p1, z), _mm_unpackhi_epi8(p2, z), uhi);
+    bot = lerp16(_mm_unpackhi_epi8(p3, z), _mm_unpackhi_epi8(p4, z), uhi);
+    __m128i hi = lerp16(top, bot, vhi);
+
+    _mm_storeu_si128((__m128i*)(d+i), _mm_packus_epi16(lo, hi));
+  }
+  biLerpScalar(d+i, t1+i, t2+i, t3+i, t4+i, u+i, v+i, n-i);
+}
+
+#endif // PX_SPAN_SSE2
+
+#ifdef PX_SPAN_AVX2
+
+//
+// AVX2, 8 pixels at a time.  The unpacks work within each 128 bit half so
+// the low half of a widened register holds pixels 0, 1, 4, 5 and the high
+// half 2, 3, 6, 7.
+//
+
+// The leftovers go to the SSE2 versions, with the upper halves of the
+// registers cleared first to avoid the penalty for mixing the two.
+
+#define PX_AVX2 __attribute__((target("avx2")))
+
+PX_AVX2 static inline __m256i lerp16x(__m256i d, __m256i s, __m256i a)
+{
+  __m256i ia = _mm256_sub_epi16(_mm256_set1_epi16(256), a);
+  return _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(d, ia), _mm256_mullo_epi16(s, a)), 8);
+}
+
+PX_AVX2 static inline __m256i combine(__m128i lo, __m128i hi)
+{
+  return _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+}
+
+PX_AVX2 static inline void expand8(const uint8_t* p, __m256i& lo, __m256i& hi)
+{
+  __m128i x = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)p), _mm_setzero_si128());
+  __m128i x0 = _mm_unpacklo_epi16(x, x);
+  __m128i x1 = _mm_unpackhi_epi16(x, x);
+  lo = combine(_mm_unpacklo_epi32(x0, x0), _mm_unpacklo_epi32(x1, x1));
+  hi = combine(_mm_unpackhi_epi32(x0, x0), _mm_unpackhi_epi32(x1, x1));
+}
+
+PX_AVX2 static inline __m256i opaque8(const uint8_t* p)
+{
+  __m256i x = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)p));
+  return _mm256_cmpeq_epi32(x, _mm256_set1_epi32(255));
+}
+
+PX_AVX2 static void fillAVX2(uint32_t* d, int n, uint32_t c)
+{
+  if (n < 8)
+    return fillSSE2(d, n, c);
+
+  __m256i c8 = _mm256_set1_epi32(c);
+  int i = 0;
+  for (; i + 8 <= n; i += 8)
+    _mm256_storeu_si256((__m256i*)(d+i), c8);
+  _mm256_zeroupper();
+  fillSSE2(d+i, n-i, c);
+}
+
+PX_AVX2 static void lerpAVX2(uint32_t* d, int n, uint32_t c, uint32_t a)
+{
+  if (n < 8)
+    return lerpSSE2(d, n, c, a);
+
+  __m256i z = _mm256_setzero_si256();
+  __m256i ia = _mm256_set1_epi16(256-a);
+  __m256i sa = _mm256_mullo_epi16(_mm256_unpacklo_epi8(_mm256_set1_epi32(c), z), _mm256_set1_epi16(a));
+  int i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    __m256i x = _mm256_loadu_si256((__m256i*)(d+i));
+    __m256i lo = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(x, z), ia), sa), 8);
+    __m256i hi = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(x, z), ia), sa), 8);
+    _mm256_storeu_si256((__m256i*)(d+i), _mm256_packus_epi16(lo, hi));
+  }
+  _mm256_zeroupper();
+  lerpSSE2(d+i, n-i, c, a);
+}
+
+PX_AVX2 static void preMultipliedBlendAVX2(uint32_t* d, int n, uint32_t c, uint32_t a)
+{
+  if (n < 8)
+    return preMultipliedBlendSSE2(d, n, c, a);
+
+  uint32_t sc = scaleColor(c, a);
+  __m256i z = _mm256_setzero_si256();
+  __m256i ff = _mm256_set1_epi16(0xff);
+  __m256i src = _mm256_unpacklo_epi8(_mm256_set1_epi32(sc), z);
+  __m256i alpha1 = _mm256_set1_epi16(256 - (sc >> 24));
+  int i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    __m256i x = _mm256_loadu_si256((__m256i*)(d+i));
+    __m256i lo = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(x, z), alpha1), 8);
+    __m256i hi = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(x, z), alpha1), 8);
+    lo = _mm256_and_si256(_mm256_add_epi16(lo, src), ff);
+    hi = _mm256_and_si256(_mm256_add_epi16(hi, src), ff);
+    _mm256_storeu_si256((__m256i*)(d+i), _mm256_packus_epi16(lo, hi));
+  }
+  _mm256_zeroupper();
+  preMultipliedBlendSSE2(d+i, n-i, c, a);
+}
+
+PX_AVX2 static void lerpMaskedAVX2(uint32_t* d, const uint32_t* s, const uint8_t* a, int n)
+{
+  if (n < 8)
+    return lerpMaskedSSE2(d, s, a, n);
+
+  __m256i z = _mm256_setzero_si256();
+  int i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    __m256i x = _mm256_loadu_si256((__m256i*)(d+i));
+    __m256i y = _mm256_loadu_si256((__m256i*)(s+i));
+    __m256i alo, ahi;
+    expand8(a+i, alo, ahi);
+    __m256i lo = lerp16x(_mm256_unpacklo_epi8(x, z), _mm256_unpacklo_epi8(y, z), alo);
+    __m256i hi = lerp16x(_mm256_unpackhi_epi8(x, z), _mm256_unpackhi_epi8(y, z), ahi);
+    __m256i r = _mm256_blendv_epi8(_mm256_packus_epi16(lo, hi), y, opaque8(a+i));
+    _mm256_storeu_si256((__m256i*)(d+i), r);
+  }
+  _mm256_zeroupper();
+  lerpMaskedSSE2(d+i, s+i, a+i, n-i);
+}
+
+PX_AVX2 static inline __m256i preMultipliedBlend16x(__m256i d, __m256i s, __m256i a)
+{
+  __m256i src = _mm256_srli_epi16(_mm256_mullo_epi16(s, _mm256_add_epi16(a, _mm256_srli_epi16(a, 7))), 8);
+  __m256i srcAlpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(src, _MM_SHUFFLE(3,3,3,3)),
+                                            _MM_SHUFFLE(3,3,3,3));
+  __m256i alpha1 = _mm256_sub_epi16(_mm256_set1_epi16(256), srcAlpha);
+  __m256i dst = _mm256_srli_epi16(_mm256_mullo_epi16(d, alpha1), 8);
+  return _mm256_and_si256(_mm256_add_epi16(src, dst), _mm256_set1_epi16(0xff));
+}
+
+PX_AVX2 static void preMultipliedBlendMaskedAVX2(uint32_t* d, const uint32_t* s, const uint8_t* a, int n)
+{
+  if (n < 8)
+    return preMultipliedBlendMaskedSSE2(d, s, a, n);
+
+  __m256i z = _mm256_setzero_si256();
+  __m256i ff = _mm256_set1_epi32(255);
+  int i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    __m256i x = _mm256_loadu_si256((__m256i*)(d+i));
+    __m256i y = _mm256_loadu_si256((__m256i*)(s+i));
+    __m256i alo, ahi;
+    expand8(a+i, alo, ahi);
+    __m256i lo = preMultipliedBlend16x(_mm256_unpacklo_epi8(x, z), _mm256_unpacklo_epi8(y, z), alo);
+    __m256i hi = preMultipliedBlend16x(_mm256_unpackhi_epi8(x, z), _mm256_unpackhi_epi8(y, z), ahi);
+    __m256i m = _mm256_and_si256(opaque8(a+i), _mm256_cmpeq_epi32(_mm256_srli_epi32(y, 24), ff));
+    _mm256_storeu_si256((__m256i*)(d+i), _mm256_blendv_epi8(_mm256_packus_epi16(lo, hi), y, m));
+  }
+  _mm256_zeroupper();
+  preMultipliedBlendMaskedSSE2(d+i, s+i, a+i, n-i);
+}
+
+PX_AVX2 static void biLerpAVX2(uint32_t* d, const uint32_t* t1, const uint32_t* t2,
+                               const uint32_t* t3, const uint32_t* t4,
+                               const uint8_t* u, const uint8_t* v, int n)
+{
+  if (n < 8)
+    return biLerpSSE2(d, t1, t2, t3, t4, u, v, n);
+
+  __m256i z = _mm256_setzero_si256();
+  int i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    __m256i p1 = _mm256_loadu_si256((__m256i*)(t1+i));
+    __m256i p2 = _mm256_loadu_si256((__m256i*)(t2+i));
+    __m256i p3 = _mm256_loadu_si256((__m256i*)(t3+i));
+    __m256i p4 = _mm256_loadu_si256((__m256i*)(t4+i));
+    __m256i ulo, uhi, vlo, vhi;
+    expand8(u+i, ulo, uhi);
+    expand8(v+i, vlo, vhi);
+
+    __m256i top = lerp16x(_mm256_unpacklo_epi8(p1, z), _mm256_unpacklo_epi8(p2, z), ulo);
+    __m256i bot = lerp16x(_mm256_unpacklo_epi8(p3, z), _mm256_unpacklo_epi8(p4, z), ulo);
+    __m256i lo = lerp16x(top, bot, vlo);
+    top = lerp16x(_mm256_unpackhi_epi8(p1, z), _mm256_unpackhi_epi8(p2, z), uhi);
+    bot = lerp16x(_mm256_unpackhi_epi8(p3, z), _mm256_unpackhi_epi8(p4, z), uhi);
+    __m256i hi = lerp16x(top, bot, vhi);
+
+    _mm256_storeu_si256((__m256i*)(d+i), _mm256_packus_epi16(lo, hi));
+  }
+  _mm256_zeroupper();
+  biLerpSSE2(d+i, t1+i, t2+i, t3+i, t4+i, u+i, v+i, n-i);
+}
+
+#endif // PX_SPAN_AVX2
+
+#ifdef PX_SPAN_NEON
+
+//
+// NEON, 4 pixels at a time
+//
+
+static inline uint16x8_t lerp16n(uint16x8_t d, uint16x8_t s, uint16x8_t a)
+{
+  uint16x8_t ia = vsubq_u16(vdupq_n_u16(256), a);
+  return vshrq_n_u16(vmlaq_u16(vmulq_u16(d, ia), s, a), 8);
+}
+
+// bytes i and i+1 repeated over the 4 channels of their pixels
+static inline uint16x8_t expand2(const uint8_t* p)
+{
+  return vcombine_u16(vdup_n_u16(p[0]), vdup_n_u16(p[1]));
+}
+
+static inline uint32x4_t opaque4n(const uint8_t* p)
+{
+  uint32_t a[4] = { p[0], p[1], p[2], p[3] };
+  return vceqq_u32(vld1q_u32(a), vdupq_n_u32(255));
+}
+
+static inline uint8x16_t narrow(uint16x8_t lo, uint16x8_t hi)
+{
+  return vcombine_u8(vmovn_u16(lo), vmovn_u16(hi));
+}
+
+static void fillNEON(uint32_t* d, int n, uint32_t c)
+{
+  if (n < 4)
+    return fillScalar(d, n, c);
+
+  uint32x4_t c4 = vdupq_n_u32(c);
+  int i = 0;
+  for (; i + 4 <= n; i += 4)
+    vst1q_u32(d+i, c4);
+  fillScalar(d+i, n-i, c);
+}
+
+static void lerpNEON(uint32_t* d, int n, uint32_t c, uint32_t a)
+{
+  if (n < 4)
+    return lerpScalar(d, n, c, a);
+
+  uint16x8_t ia = vdupq_n_u16(256-a);
+  uint16x8_t sa = vmulq_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(c))), vdupq_n_u16(a));
+  int i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    uint8x16_t x = vreinterpretq_u8_u32(vld1q_u32(d+i));
+    uint16x8_t lo = vshrq_n_u16(vmlaq_u16(sa, vmovl_u8(vget_low_u8(x)), ia), 8);
+    uint16x8_t hi = vshrq_n_u16(vmlaq_u16(sa, vmovl_u8(vget_high_u8(x)), ia), 8);
+    vst1q_u32(d+i, vreinterpretq_u32_u8(narrow(lo, hi)));
+  }
+  lerpScalar(d+i, n-i, c, a);
+}
+
+static void preMultipliedBlendNEON(uint32_t* d, int n, uint32_t c, uint32_t a)
+{
+  if (n < 4)
+    return preMultipliedBlendScalar(d, n, c, a);
+
+  uint32_t sc = scaleColor(c, a);
+  uint16x8_t ff = vdupq_n_u16(0xff);
+  uint16x8_t src = vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(sc)));
+  uint16x8_t alpha1 = vdupq_n_u16(256 - (sc >> 24));
+  int i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    uint8x16_t x = vreinterpretq_u8_u32(vld1q_u32(d+i));
+    uint16x8_t lo = vshrq_n_u16(vmulq_u16(vmovl_u8(vget_low_u8(x)), alpha1), 8);
+    uint16x8_t hi = vshrq_n_u16(vmulq_u16(vmovl_u8(vget_high_u8(x)), alpha1), 8);
+    lo = vandq_u16(vaddq_u16(lo, src), ff);
+    hi = vandq_u16(vaddq_u16(hi, src), ff);
+    vst1q_u32(d+i, vreinterpretq_u32_u8(narrow(lo, hi)));
+  }
+  preMultipliedBlendScalar(d+i, n-i, c, a);
+}
+
+static void lerpMaskedNEON(uint32_t* d, const uint32_t* s, const uint8_t* a, int n)
+{
+  if (n < 4)
+    return lerpMaskedScalar(d, s, a, n);
+
+  int i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    uint32x4_t y = vld1q_u32(s+i);
+    uint8x16_t x8 = vreinterpretq_u8_u32(vld1q_u32(d+i));
+    uint8x16_t y8 = vreinterpretq_u8_u32(y);
+    uint16x8_t lo = lerp16n(vmovl_u8(vget_low_u8(x8)), vmovl_u8(vget_low_u8(y8)), expand2(a+i));
+    uint16x8_t hi = lerp16n(vmovl_u8(vget_high_u8(x8)), vmovl_u8(vget_high_u8(y8)), expand2(a+i+2));
+    uint32x4_t r = vreinterpretq_u32_u8(narrow(lo, hi));
+    vst1q_u32(d+i, vbslq_u32(opaque4n(a+i), y, r));
+  }
+  lerpMaskedScalar(d+i, s+i, a+i, n-i);
+}
+
+static inline uint16x8_t preMultipliedBlend16n(uint16x8_t d, uint16x8_t s, uint16x8_t a)
+{
+  uint16x8_t src = vshrq_n_u16(vmulq_u16(s, vaddq_u16(a, vshrq_n_u16(a, 7))), 8);
+  uint16x8_t srcAlpha = vcombine_u16(vdup_lane_u16(vget_low_u16(src), 3),
+                                     vdup_lane_u16(vget_high_u16(src), 3));
+  uint16x8_t alpha1 = vsubq_u16(vdupq_n_u16(256), srcAlpha);
+  uint16x8_t dst = vshrq_n_u16(vmulq_u16(d, alpha1), 8);
+  return vandq_u16(vaddq_u16(src, dst), vdupq_n_u16(0xff));
+}
+
+static void preMultipliedBlendMaskedNEON(uint32_t* d, const uint32_t* s, const uint8_t* a, int n)
+{
+  if (n < 4)
+    return preMultipliedBlendMaskedScalar(d, s, a, n);
+
+  int i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    uint32x4_t y = vld1q_u32(s+i);
+    uint8x16_t x8 = vreinterpretq_u8_u32(vld1q_u32(d+i));
+    uint8x16_t y8 = vreinterpretq_u8_u32(y);
+    uint16x8_t lo = preMultipliedBlend16n(vmovl_u8(vget_low_u8(x8)), vmovl_u8(vget_low_u8(y8)), expand2(a+i));
+    uint16x8_t hi = preMultipliedBlend16n(vmovl_u8(vget_high_u8(x8)), vmovl_u8(vget_high_u8(y8)), expand2(a+i+2));
+    uint32x4_t r = vreinterpretq_u32_u8(narrow(lo, hi));
+    uint32x4_t m = vandq_u32(opaque4n(a+i), vceqq_u32(vshrq_n_u32(y, 24), vdupq_n_u32(255)));
+    vst1q_u32(d+i, vbslq_u32(m, y, r));
+  }
+  preMultipliedBlendMaskedScalar(d+i, s+i, a+i, n-i);
+}
+
+static void biLerpNEON(uint32_t* d, const uint32_t* t1, const uint32_t* t2,
+                       const uint32_t* t3, const uint32_t* t4,
+                       const uint8_t* u, const uint8_t* v, int n)
+{
+  if (n < 4)
+    return biLerpScalar(d, t1, t2, t3, t4, u, v, n);
+
+  int i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    uint8x16_t p1 = vreinterpretq_u8_u32(vld1q_u32(t1+i));
+    uint8x16_t p2 = vreinterpretq_u8_u32(vld1q_u32(t2+i));
+    uint8x16_t p3 = vreinterpretq_u8_u32(vld1q_u32(t3+i));
+    uint8x16_t p4 = vreinterpretq_u8_u32(vld1q_u32(t4+i));
+    uint16x8_t ulo = expand2(u+i), uhi = expand2(u+i+2);
+    uint16x8_t vlo = expand2(v+i), vhi = expand2(v+i+2);
+
+    uint16x8_t top = lerp16n(vmovl_u8(vget_low_u8(p1)), vmovl_u8(vget_low_u8(p2)), ulo);
+    uint16x8_t bot = lerp16n(vmovl_u8(vget_low_u8(p3)), vmovl_u8(vget_low_u8(p4)), ulo);
+    uint16x8_t lo = lerp16n(top, bot, vlo);
+    top = lerp16n(vmovl_u8(vget_high_u8(p1)), vmovl_u8(vget_high_u8(p2)), uhi);
+    bot = lerp16n(vmovl_u8(vget_high_u8(p3)), vmovl_u8(vget_high_u8(p4)), uhi);
+    uint16x8_t hi = lerp16n(top, bot, vhi);
+
+    vst1q_u32(d+i, vreinterpretq_u32_u8(narrow(lo, hi)));
+  }
+  biLerpScalar(d+i, t1+i, t2+i, t3+i, t4+i, u+i, v+i, n-i);
+}
+
+#endif // PX_SPAN_NEON
+
+//
+// Dispatch
+//
+
+static const pxSpanKernels gScalar =
+{
+  fillScalar, lerpScalar, preMultipliedBlendScalar,
+  lerpMaskedScalar, preMultipliedBlendMaskedScalar, biLerpScalar
+};
+
+#ifdef PX_SPAN_SSE2
+static const pxSpanKernels gSSE2 =
+{
+  fillSSE2, lerpSSE2, preMultipliedBlendSSE2,
+  lerpMaskedSSE2, preMultipliedBlendMaskedSSE2, biLerpSSE2
+};
+#endif
+
+#ifdef PX_SPAN_AVX2
+static const pxSpanKernels gAVX2 =
+{
+  fillAVX2, lerpAVX2, preMultipliedBlendAVX2,
+  lerpMaskedAVX2, preMultipliedBlendMaskedAVX2, biLerpAVX2
+};
+#endif
+
+#ifdef PX_SPAN_NEON
+static const pxSpanKernels gNEON =
+{
+  fillNEON, lerpNEON, preMultipliedBlendNEON,
+  lerpMaskedNEON, preMultipliedBlendMaskedNEON, biLerpNEON
+};
+#endif
+
+static const pxSpanKernels* kernels(pxSpanImpl impl)
+{
+  switch (impl)
+  {
+    case pxSpanImplScalar: return &gScalar;
+#ifdef PX_SPAN_SSE2
+    case pxSpanImplSSE2: return &gSSE2;
+#endif
+#ifdef PX_SPAN_AVX2
+    case pxSpanImplAVX2:
+      return __builtin_cpu_supports("avx2")?&gAVX2:NULL;
+#endif
+#ifdef PX_SPAN_NEON
+    case pxSpanImplNEON: return &gNEON;
+#endif
+    default: return NULL;
+  }
+}
+
+static pxSpanImpl bestImpl()
+{
+#ifdef PX_SPAN_AVX2
+  // this runs from a static initializer, possibly before libgcc's own
+  __builtin_cpu_init();
+#endif
+  for (int i = pxSpanImplCount-1; i > pxSpanImplScalar; i--)
+  {
+    if (kernels((pxSpanImpl)i))
+      return (pxSpanImpl)i;
+  }
+  return pxSpanImplScalar;
+}
+
+// scalar until the cpu has been checked, in case a rasterizer is used
+// during static initialization
+static pxSpanImpl gImpl = pxSpanImplScalar;
+static const pxSpanKernels* gKernels = &gScalar;
+
+const pxSpanKernels& pxSpan()
+{
+  return *gKernels;
+}
+
+bool pxSpanSetImpl(pxSpanImpl impl)
+{
+  const pxSpanKernels* k = kernels(impl);
+  if (!k)
+    return false;
+  gImpl = impl;
+  gKernels = k;
+  return true;
+}
+
+pxSpanImpl pxSpanGetImpl()
+{
+  return gImpl;
+}
+
+static bool gSpanInit = pxSpanSetImpl(bestImpl());
+
+const char* pxSpanImplName(pxSpanImpl impl)
+{
+  switch (impl)
+  {
+    case pxSpanImplScalar: return "scalar";
+    case pxSpanImplSSE2: return "sse2";
+    case pxSpanImplAVX2: return "avx2";
+    case pxSpanImplNEON: return "neon";
+    default: return "unknown";
+  }
+}
@@ -0,0 +1,54 @@
+// Copyright 2007 John Robinson
+
+#ifndef _H_PXSPAN
+#define _H_PXSPAN
+
+#include <stdint.h>
+
+// Span kernels used by pxRasterizer to write out a run of pixels.  Each one
+// gives exactly the same result as the per pixel px2d.h helper it replaces
+// (pxLerp2, pxPreMultipliedBlend and pxBlend4).  The best implementation for
+// the cpu is picked the first time the kernels are used.
+
+// Spans longer than this are handed to the kernels in pieces
+#define PX_SPAN_CHUNK 64
+
+enum pxSpanImpl
+{
+  pxSpanImplScalar,
+  pxSpanImplSSE2,
+  pxSpanImplAVX2,
+  pxSpanImplNEON,
+  pxSpanImplCount
+};
+
+struct pxSpanKernels
+{
+  // d[i] = c
+  void (*fill)(uint32_t* d, int n, uint32_t c);
+  // pxLerp2(a, d[i], c)
+  void (*lerp)(uint32_t* d, int n, uint32_t c, uint32_t a);
+  // pxPreMultipliedBlend(a, d[i], c)
+  void (*preMultipliedBlend)(uint32_t* d, int n, uint32_t c, uint32_t a);
+
+  // d[i] = s[i] where a[i] is 255 otherwise pxLerp2(a[i], d[i], s[i])
+  void (*lerpMasked)(uint32_t* d, const uint32_t* s, const uint8_t* a, int n);
+  // d[i] = s[i] where a[i] and the alpha of s[i] are 255 otherwise
+  // pxPreMultipliedBlend(a[i], d[i], s[i])
+  void (*preMultipliedBlendMasked)(uint32_t* d, const uint32_t* s, const uint8_t* a, int n);
+
+  // d[i] = pxBlend4(t1[i], t2[i], t3[i], t4[i], u[i], v[i])
+  void (*biLerp)(uint32_t* d, const uint32_t* t1, const uint32_t* t2,
+                 const uint32_t* t3, const uint32_t* t4,
+                 const uint8_t* u, const uint8_t* v, int n);
+};
+
+const pxSpanKernels& pxSpan();
+
+// Returns false if impl isn't available on this cpu.  Not safe to call
+// while anything is being rasterized.
+bool pxSpanSetImpl(pxSpanImpl impl);
+pxSpanImpl pxSpanGetImpl();
+const char* pxSpanImplName(pxSpanImpl impl);
+
+#endif // _H_PXSPAN
@@ -0,0 +1,290 @@
+// Copyright 2007 John Robinson
+
+// spanBench.cpp
+//
+// Fills the paths in complex.data (one path per line, x,y pairs), scaled up
+// so the spans dominate, plus one large rotated rectangle.  Does this with
+// solid colors and textures, once for every span kernel implementation this
+// cpu supports.  Prints the best time per frame over a few runs and checks
+// that each implementation matches the scalar one.
+//
+//  ./spanBench [-n frames] [-s scale] [complex.data]
+
+#include "pxCore.h"
+#include "pxOffscreen.h"
+#include "pxTimer.h"
+#include "pxCanvas.h"
+#include "pxSpan.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <math.h>
+#include <string>
+#include <vector>
+
+typedef std::vector<pxVertex> path;
+
+static bool loadPaths(const char* file, std::vector<path>& paths)
+{
+  FILE* f = fopen(file, "r");
+  if (!f)
+    return false;
+
+  std::vector<char> line(1 << 16);
+  std::string s;
+  while (fgets(&line[0], line.size(), f))
+  {
+    s += &line[0];
+    if (s.empty() || s[s.size()-1] != '\n')
+      continue;
+
+    path p;
+    const char* c = s.c_str();
+    char* e;
+    for (;;)
+    {
+      pxVertex v;
+      v.x = strtod(c, &e);
+      if (e == c || *e != ',')
+        break;
+      c = e+1;
+      v.y = strtod(c, &e);
+      if (e == c)
+        break;
+      p.push_back(v);
+      c = (*e == ',')?e+1:e;
+    }
+    if (p.size() > 1)
+      paths.push_back(p);
+    s.clear();
+  }
+  fclose(f);
+  return true;
+}
+
+// a gradient to composite onto
+static void drawBackground(pxBuffer& b)
+{
+  for (int y = 0; y < b.height(); y++)
+  {
+    pxPixel* p = b.scanline(y);
+    for (int x = 0; x < b.width(); x++, p++)
+    {
+      p->r = (x + y) & 0xff;
+      p->g = y & 0xff;
+      p->b = x & 0xff;
+      p->a = 255;
+    }
+  }
+}
+
+// opaque stripes with see through premultiplied holes
+static void drawTexture(pxBuffer& b)
+{
+  for (int y = 0; y < b.height(); y++)
+  {
+    pxPixel* p = b.scanline(y);
+    for (int x = 0; x < b.width(); x++, p++)
+    {
+      if (((x >> 3) + (y >> 3)) & 1)
+      {
+        p->r = x*4;
+        p->g = y*4;
+        p->b = 128;
+        p->a = 255;
+      }
+      else
+      {
+        p->r = p->g = p->b = 16;
+        p->a = 32;
+      }
+    }
+  }
+}
+
+struct benchCase
+{
+  const char* name;
+  bool texture;
+  bool biLerp;
+  bool alphaTexture;
+  bool preMultiplied;
+  double alpha;
+};
+
+static const benchCase cases[] =
+{
+  { "solid",                   false, false, false, false, 1.0 },
+  { "solid alpha",             false, false, false, false, 0.5 },
+  { "solid premultiplied",     false, false, false, true,  0.5 },
+  { "texture",                 true,  false, false, false, 1.0 },
+  { "texture premultiplied",   true,  false, false, true,  0.75 },
+  { "bilinear",                true,  true,  false, false, 1.0 },
+  { "bilinear premultiplied",  true,  true,  false, true,  0.75 },
+  { "bilinear alpha texture",  true,  true,  true,  false, 1.0 },
+};
+
+// a rectangle w x h rotated a little about its center
+static path rotatedRect(double w, double h)
+{
+  double a = 0.1;
+  double c = cos(a), s = sin(a);
+  double x[] = { -w/2, w/2, w/2, -w/2, -w/2 };
+  double y[] = { -h/2, -h/2, h/2, h/2, -h/2 };
+  path p;
+  for (int i = 0; i < 5; i++)
+  {
+    pxVertex v;
+    v.x = w/2 + x[i]*c - y[i]*s;
+    v.y = h/2 + x[i]*s + y[i]*c;
+    p.push_back(v);
+  }
+  return p;
+}
+
+static void drawFrame(pxCanvas& canvas, const std::vector<path>& paths)
+{
+  for (size_t i = 0; i < paths.size(); i++)
+  {
+    const path& p = paths[i];
+    canvas.newPath();
+    canvas.moveTo(p[0].x, p[0].y);
+    for (size_t j = 1; j < p.size(); j++)
+      canvas.lineTo(p[j].x, p[j].y);
+    canvas.fill();
+  }
+}
+
+static int maxDiff(pxBuffer& a, pxBuffer& b)
+{
+  int m = 0;
+  for (int y = 0; y < a.height(); y++)
+  {
+    unsigned char* p = (unsigned char*)a.scanline(y);
+    unsigned char* q = (unsigned char*)b.scanline(y);
+    for (int x = 0; x < a.width()*4; x++)
+      m = pxMax<int>(m, abs(p[x] - q[x]));
+  }
+  return m;
+}
+
+int main(int argc, char* argv[])
+{
+  int frames = 10;
+  double scale = 3;
+  int c;
+  while ((c = getopt(argc, argv, "n:s:")) != -1)
+  {
+    switch (c)
+    {
+      case 'n': frames = atoi(optarg); break;
+      case 's': scale = atof(optarg); break;
+      default:
+        fprintf(stderr, "usage: %s [-n frames] [-s scale] [complex.data]\n", argv[0]);
+        return 1;
+    }
+  }
+  const char* file = (optind < argc)?argv[optind]:"./complex.data";
+
+  std::vector<path> paths;
+  if (!loadPaths(file, paths))
+  {
+    fprintf(stderr, "could not read %s\n", file);
+    return 1;
+  }
+
+  size_t points = 0;
+  double right = 0, bottom = 0;
+  for (size_t i = 0; i < paths.size(); i++)
+  {
+    for (size_t j = 0; j < paths[i].size(); j++)
+    {
+      pxVertex& v = paths[i][j];
+      v.x *= scale;
+      v.y *= scale;
+      right = pxMax<double>(right, v.x);
+      bottom = pxMax<double>(bottom, v.y);
+    }
+    points += paths[i].size();
+  }
+  int w = (int)right + 1;
+  int h = (int)bottom + 1;
+  paths.push_back(rotatedRect(w, h));
+
+  printf("%s: %d paths, %d points, %dx%d\n\n", file, (int)paths.size(), (int)points, w, h);
+
+  pxOffscreen texture;
+  texture.init(128, 96);
+  drawTexture(texture);
+
+  pxOffscreen reference, offscreen;
+  reference.init(w, h);
+  offscreen.init(w, h);
+
+  int failed = 0;
+  for (size_t i = 0; i < sizeof(cases)/sizeof(cases[0]); i++)
+  {
+    const benchCase& bc = cases[i];
+    printf("%s\n", bc.name);
+
+    double scalarTime = 0;
+    for (int impl = pxSpanImplScalar; impl < pxSpanImplCount; impl++)
+    {
+      if (!pxSpanSetImpl((pxSpanImpl)impl))
+        continue;
+
+      pxCanvas canvas;
+      canvas.initWithBuffer(&offscreen);
+      canvas.setPreMultipliedAlpha(bc.preMultiplied);
+      // premultiplied a third of the way to transparent
+      if (bc.preMultiplied)
+        canvas.setFillColor(0, 112, 170, 170);
+      else
+        canvas.setFillColor(0, 168, 255);
+      canvas.setAlpha(bc.alpha);
+      if (bc.texture)
+      {
+        canvas.setTexture(&texture);
+        canvas.setBiLerp(bc.biLerp);
+        canvas.setAlphaTexture(bc.alphaTexture);
+        pxMatrix m;
+        m.identity();
+        m.rotate(0.3);
+        m.scale(1.7);
+        canvas.setTextureMatrix(m);
+      }
+
+      drawBackground(offscreen);
+      drawFrame(canvas, paths);
+      int diff = 0;
+      if (impl == pxSpanImplScalar)
+        memcpy(reference.base(), offscreen.base(), offscreen.sizeInBytes());
+      else
+        diff = maxDiff(reference, offscreen);
+
+      // best of a few runs, the machine may be busy
+      double ms = 0;
+      for (int run = 0; run < 5; run++)
+      {
+        double start = pxMilliseconds();
+        for (int f = 0; f < frames; f++)
+          drawFrame(canvas, paths);
+        double t = (pxMilliseconds() - start) / frames;
+        if (run == 0 || t < ms)
+          ms = t;
+      }
+      if (impl == pxSpanImplScalar)
+        scalarTime = ms;
+
+      printf("  %-8s %8.2f ms/frame  %5.2fx  max diff %d%s\n",
+             pxSpanImplName((pxSpanImpl)impl), ms, scalarTime/ms, diff,
+             (diff > 1)?"  MISMATCH":"");
+      if (diff > 1)
+        failed++;
+    }
+  }
+
+  return failed?1:0;
+}
@@ -90,6 +90,30 @@ rtError pxArchive::getFileAsString(const char* fileName, rtString& s)
   return e;
 }
 
+rtError pxArchive::getFileAsBuffer(const char* fileName, rtBufferRef& b)
+{
+  rtError e = RT_FAIL;
+  if (mLoadStatus.get<int32_t>("statusCode") == 0)
+  {
+    if (mIsFile)
+    {
+      // Ignore fileName.  The buffer aliases mData, see the header, and
+      // keeps the archive, and so mData, alive.
+      AddRef();
+      b = rtBuffer::wrap(mData.data(), mData.length(), releaseData, this);
+      e = RT_OK;
+    }
+    else
+      e = mZip.getFileData(fileName, b);
+  }
+  return e;
+}
+
+void pxArchive::releaseData(void* context, uint8_t* /*data*/)
+{
+  ((pxArchive*)context)->Release();
+}
+
 rtError pxArchive::fileNames(rtObjectRef& array) const
 {
   rtError e = RT_FAIL;
@@ -203,4 +227,5 @@ rtDefineObject(pxArchive,rtObject);
 rtDefineProperty(pxArchive,ready);
 rtDefineProperty(pxArchive,loadStatus);
 rtDefineMethod(pxArchive,getFileAsString);
+rtDefineMethod(pxArchive,getFileAsBuffer);
 rtDefineProperty(pxArchive,fileNames);
@@ -41,6 +41,7 @@ public:
   rtReadOnlyProperty(loadStatus,loadStatus,rtObjectRef);
   rtReadOnlyProperty(fileNames,fileNames,rtObjectRef);
   rtMethod1ArgAndReturn("getFileAsString",getFileAsString,rtString,rtString);
+  rtMethod1ArgAndReturn("getFileAsBuffer",getFileAsBuffer,rtString,rtBufferRef);
 
   pxArchive();
   virtual ~pxArchive();
@@ -51,11 +52,17 @@ public:
   rtError loadStatus(rtObjectRef& v) const;
 
   rtError getFileAsString(const char* fileName, rtString& s);
+  // An ArrayBuffer to script.  A zip entry is unpacked into a buffer of its
+  // own, but a single file's buffer is over the archive's own bytes, not a
+  // copy: every buffer for it is the same memory, and what a script writes
+  // into one is what getFileAsString returns afterwards.
+  rtError getFileAsBuffer(const char* fileName, rtBufferRef& b);
   rtError fileNames(rtObjectRef& names) const;
 
 private:
   static void onDownloadComplete(rtFileDownloadRequest* downloadRequest);
   static void onDownloadCompleteUI(void* context, void* data);
+  static void releaseData(void* context, uint8_t* data);
   void process(void* data, size_t dataSize);
 
   bool mIsFile;
@@ -31,8 +31,10 @@
 #include "pxTexture.h"
 #include "pxContextFramebuffer.h"
 
-#ifdef ENABLE_DFB
+#if defined(ENABLE_DFB)
 #include "pxContextDescDFB.h"
+#elif defined(ENABLE_SW)
+#include "pxContextDescSW.h"
 #else
 #include "pxContextDescGL.h"
 #endif //ENABLE_DFB
@@ -49,6 +51,62 @@
   #define PXSCENE_DEFAULT_TEXTURE_MEMORY_LIMIT_THRESHOLD_PADDING_IN_BYTES (5 * 1024 * 1024)
 #endif
 
+// Frames since it was last drawn before an offscreen texture can be evicted
+// to get back under the texture memory limit
+#define PXSCENE_DEFAULT_TEXTURE_EVICTION_AGE_IN_FRAMES 60
+
+// Texture bytes uploaded in a frame before the rest waits for the next one
+#define PXSCENE_DEFAULT_TEXTURE_UPLOAD_BUDGET_IN_BYTES (4 * 1024 * 1024)
+
+// Frames a released framebuffer is kept for another render target
+#define PXSCENE_DEFAULT_FRAMEBUFFER_POOL_AGE_IN_FRAMES 120
+
+struct pxTextureResidencyStats
+{
+  pxTextureResidencyStats(): residentTextures(0), residentBytes(0), evictedTextures(0),
+                             evictions(0), reloads(0) {}
+
+  // offscreen textures in texture memory
+  int32_t residentTextures;
+  int64_t residentBytes;
+  // evicted ones waiting to be drawn again, or being decoded
+  int32_t evictedTextures;
+  // since startup
+  uint32_t evictions;
+  uint32_t reloads;
+};
+
+struct pxTextureUploadStats
+{
+  pxTextureUploadStats(): budget(0), frameBytes(0), frameMs(0), frameDeferred(0),
+                          maxFrameBytes(0), maxFrameMs(0) {}
+
+  int64_t budget;
+  // the last frame drawn, the time is what the upload calls took
+  int64_t frameBytes;
+  double frameMs;
+  // textures left to go up in later frames
+  int32_t frameDeferred;
+  // the most in one frame since startup
+  int64_t maxFrameBytes;
+  double maxFrameMs;
+};
+
+struct pxFramebufferPoolStats
+{
+  pxFramebufferPoolStats(): allocated(0), reused(0), released(0), pooled(0), pooledBytes(0) {}
+
+  // since startup, framebuffers made and the times one wasn't needed
+  // because a pooled one or the current storage did
+  uint32_t allocated;
+  uint32_t reused;
+  // pooled ones freed after going unused
+  uint32_t released;
+  // released by their render targets, waiting for new ones
+  int32_t pooled;
+  int64_t pooledBytes;
+};
+
 //enum pxStretch { PX_NONE = 0, PX_STRETCH = 1, PX_REPEAT = 2 };
 
 class pxContext {
@@ -111,6 +169,39 @@ class pxContext {
   void setTextureMemoryLimit(int64_t textureMemoryLimitInBytes);
   bool isTextureSpaceAvailable(pxTextureRef texture);
   int64_t currentTextureMemoryUsageInBytes();
+  int64_t textureMemoryLimitInBytes() const { return mTextureMemoryLimitInBytes; }
+
+  // Texture residency.  When texture memory is over the limit, offscreen
+  // textures that haven't been drawn for a while give up their copy in
+  // texture memory and are decoded again from their image data the next
+  // time they're drawn.  Only the GL context evicts.
+  //
+  // endFrame is called once a frame is drawn.  evictTextures evicts the
+  // least recently drawn textures that weren't drawn in the last minAge
+  // frames until bytes more fit under the limit, and returns whether they do.
+  void endFrame();
+  bool evictTextures(int64_t bytes, uint32_t minAge);
+  void setTextureEvictionAge(uint32_t frames);
+  // True once after textures that draws skipped are ready to draw again, or
+  // have more to upload
+  bool texturesReady();
+  void textureResidencyStats(pxTextureResidencyStats& stats);
+
+  // Texture uploads happen when a texture is first drawn.  Once bytes have
+  // gone up in a frame the rest wait for the next, and a texture bigger
+  // than that goes up over several.  0 for no limit.  Textures drawn into
+  // a render target other than the screen go up whole.  Only the GL context
+  // uploads.
+  void setTextureUploadBudget(int64_t bytesPerFrame);
+  void textureUploadStats(pxTextureUploadStats& stats);
+
+  // Render targets from createFramebuffer get their storage from a pool of
+  // released ones, with sizes rounded up so resizing a little reuses it.
+  // Pooled ones are freed after the given number of frames unused, or at
+  // the end of a frame over the texture memory limit.  Only the GL context
+  // pools.
+  void setFramebufferPoolAge(uint32_t frames);
+  void framebufferPoolStats(pxFramebufferPoolStats& stats);
 
 private:
   bool mShowOutlines;
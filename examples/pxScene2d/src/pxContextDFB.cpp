@@ -29,6 +29,7 @@
 
 #include "pxContext.h"
 #include "pxUtil.h"
+#include "pxPixelConvert.h"
 
 #include <directfb.h>
 
@@ -545,26 +546,9 @@ public:
     mOffscreen.init(o.width(), o.height());
 
 //#ifndef DEBUG_SKIP_BLIT
-    o.blit(mOffscreen);
+    pxPremultiply(mOffscreen, o);
 //#endif
 
-
-    // premultiply
-#if 1
-    for (int y = 0; y < mOffscreen.height(); y++)
-    {
-      pxPixel* d  = mOffscreen.scanline(y);
-      pxPixel* de = d + mOffscreen.width();
-      while (d < de)
-      {
-        d->r = (d->r * d->a)/255;
-        d->g = (d->g * d->a)/255;
-        d->b = (d->b * d->a)/255;
-        d++;
-      }
-    }
-#endif
-
     mWidth = mOffscreen.width();
     mHeight = mOffscreen.height();
 
@@ -2392,7 +2376,7 @@ void pxContext::adjustCurrentTextureMemorySize(int64_t changeInBytes)
   {
     rtLogDebug("\n ###  Texture Memory: %3.2f %%  <<<   GARBAGE COLLECT", pc);
 #ifdef RUNINMAIN
-    script.garbageCollect();
+    script.memoryPressure(true);
 #else
     uv_async_send(&gcTrigger);
 #endif
@@ -2431,6 +2415,48 @@ int64_t pxContext::currentTextureMemoryUsageInBytes()
   return mCurrentTextureMemorySizeInBytes;
 }
 
+// no residency here, textures stay until they're deleted
+void pxContext::endFrame()
+{
+}
+
+bool pxContext::evictTextures(int64_t bytes, uint32_t)
+{
+  return mCurrentTextureMemorySizeInBytes + bytes <= mTextureMemoryLimitInBytes;
+}
+
+void pxContext::setTextureEvictionAge(uint32_t)
+{
+}
+
+bool pxContext::texturesReady()
+{
+  return false;
+}
+
+void pxContext::textureResidencyStats(pxTextureResidencyStats& stats)
+{
+  stats = pxTextureResidencyStats();
+}
+
+void pxContext::setTextureUploadBudget(int64_t)
+{
+}
+
+void pxContext::textureUploadStats(pxTextureUploadStats& stats)
+{
+  stats = pxTextureUploadStats();
+}
+
+void pxContext::setFramebufferPoolAge(uint32_t)
+{
+}
+
+void pxContext::framebufferPoolStats(pxFramebufferPoolStats& stats)
+{
+  stats = pxFramebufferPoolStats();
+}
+
 //====================================================================================================================================================================================
 
 #ifdef DEBUG
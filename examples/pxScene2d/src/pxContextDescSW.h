@@ -0,0 +1,41 @@
+/*
+
+ pxCore Copyright 2005-2017 John Robinson
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*/
+
+// pxContextDescSW.h
+
+#ifndef PX_CONTEXT_DESC_H
+#define PX_CONTEXT_DESC_H
+
+class pxOffscreen;
+
+typedef struct
+{
+  // premultiplied, top down
+  pxOffscreen *offscreen;
+
+  int width;
+  int height;
+}
+pxContextSurfaceNativeDesc;
+
+// Draws are replayed across this many horizontal bands, each on its own
+// thread.  Defaults to $PXSCENE_SW_BANDS, or the number of cpus.
+void pxSwSetBandCount(int bands);
+int pxSwBandCount();
+
+#endif //PX_CONTEXT_DESC_H
@@ -28,6 +28,11 @@
 
 #include "pxContext.h"
 #include "pxUtil.h"
+#include "pxPixelConvert.h"
+#include "pxTimer.h"
+
+#include <list>
+#include <vector>
 
 #ifdef __APPLE__
 #include <GLUT/glut.h>
@@ -199,10 +204,77 @@ inline void premultiply(float* d, const float* s)
 
 //====================================================================================================================================================================================
 
+// Frames drawn, see pxContext::endFrame
+static uint32_t gTextureFrame = 0;
+
+// Framebuffer pool.  Snapshot, mask and text box render targets come and go
+// as objects animate, so the gl framebuffers and textures behind them are
+// kept for a while to be used again.  Their sizes are rounded up to buckets,
+// so a target that changes size a little keeps its storage.  Only touched on
+// the ui thread.
+struct pxPooledFramebuffer
+{
+  GLuint framebufferId;
+  GLuint textureId;
+  int width;
+  int height;
+  uint32_t releasedFrame;
+};
+
+// Never freed, framebuffers held by other globals can outlive it at exit
+static std::vector<pxPooledFramebuffer>& framebufferPool()
+{
+  static std::vector<pxPooledFramebuffer>* pool = new std::vector<pxPooledFramebuffer>;
+  return *pool;
+}
+static uint32_t gFramebufferPoolAge = PXSCENE_DEFAULT_FRAMEBUFFER_POOL_AGE_IN_FRAMES;
+static pxFramebufferPoolStats gFramebufferPoolStats;
+
+// Rounds up to a multiple of an eighth of the next power of two, at least
+// 16, so a bucket wastes at most about an eighth of each side
+static int framebufferBucket(int size)
+{
+  if (size <= 0)
+    return 0;
+  int p = 16;
+  while (p < size)
+    p <<= 1;
+  int step = pxMax<int>(16, p/8);
+  return (size + step - 1)/step*step;
+}
+
+static void deletePooledFramebuffer(const pxPooledFramebuffer& f)
+{
+  glDeleteFramebuffers(1, &f.framebufferId);
+  glDeleteTextures(1, &f.textureId);
+  context.adjustCurrentTextureMemorySize(-1*f.width*f.height*4);
+  gFramebufferPoolStats.pooled--;
+  gFramebufferPoolStats.pooledBytes -= f.width*f.height*4;
+  gFramebufferPoolStats.released++;
+}
+
+// Frees pooled framebuffers released at least minAge frames ago, oldest
+// first
+static void trimFramebufferPool(uint32_t minAge)
+{
+  std::vector<pxPooledFramebuffer>& pool = framebufferPool();
+  size_t kept = 0;
+  for (size_t i = 0; i < pool.size(); i++)
+  {
+    if (gTextureFrame - pool[i].releasedFrame >= minAge)
+      deletePooledFramebuffer(pool[i]);
+    else
+      pool[kept++] = pool[i];
+  }
+  pool.resize(kept);
+}
+
 class pxFBOTexture : public pxTexture
 {
 public:
-  pxFBOTexture() : mWidth(0), mHeight(0), mFramebufferId(0), mTextureId(0), mBindTexture(true)
+  pxFBOTexture() : mWidth(0), mHeight(0), mAllocatedWidth(0), mAllocatedHeight(0),
+                   mFramebufferId(0), mTextureId(0), mBindTexture(true),
+                   mClearUnused(false)
   {
     mTextureType = PX_TEXTURE_FRAME_BUFFER;
   }
@@ -218,28 +290,62 @@ public:
 
     mWidth  = w;
     mHeight = h;
+    mAllocatedWidth = framebufferBucket(w);
+    mAllocatedHeight = framebufferBucket(h);
+    mBindTexture = true;
+    mClearUnused = true;
+
+    // the most recently released one of the same bucket
+    std::vector<pxPooledFramebuffer>& pool = framebufferPool();
+    for (size_t i = pool.size(); i > 0; i--)
+    {
+      pxPooledFramebuffer& f = pool[i-1];
+      if (f.width == mAllocatedWidth && f.height == mAllocatedHeight)
+      {
+        mFramebufferId = f.framebufferId;
+        mTextureId = f.textureId;
+        gFramebufferPoolStats.pooled--;
+        gFramebufferPoolStats.pooledBytes -= f.width*f.height*4;
+        gFramebufferPoolStats.reused++;
+        pool.erase(pool.begin() + (i-1));
+        return;
+      }
+    }
 
     glGenFramebuffers(1, &mFramebufferId);
     glGenTextures(1, &mTextureId);
 
     glBindTexture(GL_TEXTURE_2D, mTextureId); TRACK_TEX_CALLS();
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
-                 mWidth, mHeight, 0, GL_RGBA,
+                 mAllocatedWidth, mAllocatedHeight, 0, GL_RGBA,
                  GL_UNSIGNED_BYTE, NULL);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, PX_TEXTURE_MIN_FILTER);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, PX_TEXTURE_MAG_FILTER);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    context.adjustCurrentTextureMemorySize(mWidth*mHeight*4);
-    mBindTexture = true;
+    context.adjustCurrentTextureMemorySize(mAllocatedWidth*mAllocatedHeight*4);
+    gFramebufferPoolStats.allocated++;
   }
 
   pxError resizeTexture(int w, int h)
   {
-    if (mWidth != w || mHeight != h ||
-        mFramebufferId == 0 || mTextureId == 0)
+    if (mFramebufferId == 0 || mTextureId == 0)
+    {
+      createFboTexture(w, h);
+      return PX_OK;
+    }
+    if (mWidth != w || mHeight != h)
     {
+      // still fits the storage it has
+      if (framebufferBucket(w) == mAllocatedWidth && framebufferBucket(h) == mAllocatedHeight)
+      {
+        mWidth = w;
+        mHeight = h;
+        mClearUnused = true;
+        gFramebufferPoolStats.reused++;
+        return PX_OK;
+      }
       createFboTexture(w, h);
       return PX_OK;
     }
@@ -263,24 +369,34 @@ public:
     return PX_OK;
   }
 
+  // Back to the pool for another render target of this bucket
   virtual pxError deleteTexture()
   {
-    if (mFramebufferId!= 0)
+    if (mFramebufferId != 0 && mTextureId != 0)
     {
-      glDeleteFramebuffers(1, &mFramebufferId);
+      pxPooledFramebuffer f;
+      f.framebufferId = mFramebufferId;
+      f.textureId = mTextureId;
+      f.width = mAllocatedWidth;
+      f.height = mAllocatedHeight;
+      f.releasedFrame = gTextureFrame;
+      framebufferPool().push_back(f);
+      gFramebufferPoolStats.pooled++;
+      gFramebufferPoolStats.pooledBytes += f.width*f.height*4;
       mFramebufferId = 0;
-    }
-
-    if (mTextureId != 0)
-    {
-      glDeleteTextures(1, &mTextureId);
       mTextureId = 0;
-      context.adjustCurrentTextureMemorySize(-1*mWidth*mHeight*4);
     }
 
     return PX_OK;
   }
 
+  // The part of the texture the render target uses
+  void uvScale(float& sx, float& sy)
+  {
+    sx = mAllocatedWidth?(float)mWidth/mAllocatedWidth:1;
+    sy = mAllocatedHeight?(float)mHeight/mAllocatedHeight:1;
+  }
+
   virtual unsigned int getNativeId()
   {
     return mTextureId;
@@ -304,6 +420,11 @@ public:
       }
       mBindTexture = false;
     }
+    if (mClearUnused)
+    {
+      clearUnused();
+      mClearUnused = false;
+    }
     //glActiveTexture(GL_TEXTURE3);
     //glBindTexture(GL_TEXTURE_2D, mTextureId);
     glViewport ( 0, 0, mWidth, mHeight);
@@ -355,11 +476,47 @@ public:
   virtual int height() { return mHeight; }
 
 private:
+  // Clears the storage past the used size.  Drawing never reaches it, but
+  // linear filtering at the edge of the render target does, and a pooled
+  // texture still holds whatever its last owner drew there.
+  void clearUnused()
+  {
+    if (mWidth >= mAllocatedWidth && mHeight >= mAllocatedHeight)
+      return;
+
+    GLboolean scissor = glIsEnabled(GL_SCISSOR_TEST);
+    GLint box[4];
+    glGetIntegerv(GL_SCISSOR_BOX, box);
+    float color[4];
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, color);
+
+    glEnable(GL_SCISSOR_TEST);
+    glClearColor(0, 0, 0, 0);
+    if (mWidth < mAllocatedWidth)
+    {
+      glScissor(mWidth, 0, mAllocatedWidth-mWidth, mAllocatedHeight);
+      glClear(GL_COLOR_BUFFER_BIT);
+    }
+    if (mHeight < mAllocatedHeight)
+    {
+      glScissor(0, mHeight, mWidth, mAllocatedHeight-mHeight);
+      glClear(GL_COLOR_BUFFER_BIT);
+    }
+
+    glClearColor(color[0], color[1], color[2], color[3]);
+    glScissor(box[0], box[1], box[2], box[3]);
+    if (!scissor)
+      glDisable(GL_SCISSOR_TEST);
+  }
+
   int mWidth;
   int mHeight;
+  int mAllocatedWidth;
+  int mAllocatedHeight;
   GLuint mFramebufferId;
   GLuint mTextureId;
   bool mBindTexture;
+  bool mClearUnused;
 
 };// CLASS - pxFBOTexture
 
@@ -385,6 +542,27 @@ public:
 
 class pxTextureOffscreen;
 
+// Texture residency.  Offscreen textures that are in gl, most recently drawn
+// first.  Only touched on the ui thread.  Never freed, textures held by
+// other globals can outlive it at exit otherwise.
+static std::list<pxTextureOffscreen*>& residentTextures()
+{
+  static std::list<pxTextureOffscreen*>* textures = new std::list<pxTextureOffscreen*>;
+  return *textures;
+}
+static uint32_t gTextureEvictionAge = PXSCENE_DEFAULT_TEXTURE_EVICTION_AGE_IN_FRAMES;
+static int32_t gEvictedTextures = 0;
+static uint32_t gTextureEvictions = 0;
+static uint32_t gTextureReloads = 0;
+static bool gTexturesReady = false;
+
+// Texture uploads, counted over the frame being drawn
+static int64_t gTextureUploadBudget = PXSCENE_DEFAULT_TEXTURE_UPLOAD_BUDGET_IN_BYTES;
+static int64_t gFrameUploadBytes = 0;
+static double gFrameUploadSeconds = 0;
+static int32_t gFrameUploadsDeferred = 0;
+static pxTextureUploadStats gTextureUploadStats;
+
 struct DecodeImageData
 {
     DecodeImageData(pxTextureRef t, pxOffscreen* o) : textureOffscreen(t), offscreen(o)
@@ -474,18 +652,20 @@ void cleanupOffscreen(void* data)
 class pxTextureOffscreen : public pxTexture
 {
 public:
-  pxTextureOffscreen() : mOffscreen(), mInitialized(false),
+  pxTextureOffscreen() : mOffscreen(), mInitialized(false), mTextureName(0),
                          mTextureUploaded(false), mTextureDataAvailable(false),
                          mLoadTextureRequested(false), mWidth(0), mHeight(0), mOffscreenMutex(),
-                         mFreeOffscreenDataRequested(false)
+                         mFreeOffscreenDataRequested(false), mTextureBytes(0), mUploadedRows(0), mResident(false),
+                         mResidentPos(), mLastDrawFrame(0), mEvicted(false)
   {
     mTextureType = PX_TEXTURE_OFFSCREEN;
   }
 
-  pxTextureOffscreen(pxOffscreen& o) : mOffscreen(), mInitialized(false),
+  pxTextureOffscreen(pxOffscreen& o) : mOffscreen(), mInitialized(false), mTextureName(0),
                                        mTextureUploaded(false), mTextureDataAvailable(false),
                                        mLoadTextureRequested(false), mWidth(0), mHeight(0), mOffscreenMutex(),
-                                       mFreeOffscreenDataRequested(false)
+                                       mFreeOffscreenDataRequested(false), mTextureBytes(0), mUploadedRows(0), mResident(false),
+                                       mResidentPos(), mLastDrawFrame(0), mEvicted(false)
   {
     mTextureType = PX_TEXTURE_OFFSCREEN;
     createTexture(o);
@@ -495,6 +675,16 @@ public:
 
   virtual pxError createTexture(pxOffscreen& o)
   {
+    if (mTextureName && !mTextureUploaded)
+    {
+      // part way through uploading the old image, start again
+      glDeleteTextures(1, &mTextureName);
+      context.adjustCurrentTextureMemorySize(-1 * mTextureBytes);
+      mTextureName = 0;
+      mTextureBytes = 0;
+      mUploadedRows = 0;
+    }
+
     mOffscreenMutex.lock();
 #ifdef ENABLE_MAX_TEXTURE_SIZE
     int verticalScale = 1;
@@ -531,37 +721,25 @@ public:
              o.blit(mOffscreen, x, y, 1,1,k,j);
           }
        }
+       pxPremultiply(mOffscreen);
     }
     else
     {
       mOffscreen.init(o.width(), o.height());
       // Flip the image data here so we match GL FBO layout
       mOffscreen.setUpsideDown(true);
-      o.blit(mOffscreen);
+      pxPremultiply(mOffscreen, o);
     }
 #else
     mOffscreen.init(o.width(), o.height());
-    // Flip the image data here so we match GL FBO layout
+    // Flip the image data here so we match GL FBO layout, premultiplying
+    // on the way
     mOffscreen.setUpsideDown(true);
-    o.blit(mOffscreen);
+    pxPremultiply(mOffscreen, o);
     mWidth = mOffscreen.width();
     mHeight = mOffscreen.height();
 #endif //ENABLE_MAX_TEXTURE_SIZE
 
-    // premultiply
-    for (int y = 0; y < mOffscreen.height(); y++)
-    {
-      pxPixel* d = mOffscreen.scanline(y);
-      pxPixel* de = d + mOffscreen.width();
-      while (d < de)
-      {
-        d->r = (d->r * d->a)/255;
-        d->g = (d->g * d->a)/255;
-        d->b = (d->b * d->a)/255;
-        d++;
-      }
-    }
-
     mOffscreen.transferCompressedDataFrom(o);
     mFreeOffscreenDataRequested = false;
     mOffscreenMutex.unlock();
@@ -570,6 +748,57 @@ public:
     mLoadTextureRequested = false;
     mInitialized = true;
 
+    if (mEvicted)
+    {
+      // decoded again, it goes back into gl on the next bind
+      mEvicted = false;
+      gEvictedTextures--;
+      gTextureReloads++;
+      gTexturesReady = true;
+    }
+
+    return PX_OK;
+  }
+
+  virtual pxError updateTexture(pxOffscreen& o, int x, int y, int w, int h)
+  {
+    // nothing in GL yet, the whole image goes up on the next bind anyway
+    if (!mInitialized || !mTextureUploaded)
+      return createTexture(o);
+
+    if (o.width() != mWidth || o.height() != mHeight)
+      return PX_FAIL;
+#ifdef ENABLE_MAX_TEXTURE_SIZE
+    // a scaled down texture doesn't line up with the source rect
+    if (mWidth > MAX_TEXTURE_WIDTH || mHeight > MAX_TEXTURE_HEIGHT)
+      return PX_FAIL;
+#endif //ENABLE_MAX_TEXTURE_SIZE
+
+    pxRect r(x, y, x + w, y + h);
+    pxRect bounds(0, 0, mWidth, mHeight);
+    r.intersect(bounds);
+    if (r.isEmpty())
+      return PX_OK;
+
+    // Flip the band to match the GL FBO layout of the rest of the texture
+    pxOffscreen band;
+    band.init(r.width(), r.height());
+    band.setUpsideDown(true);
+    o.blit(band, 0, 0, r.width(), r.height(), r.left(), r.top());
+    pxPremultiply(band);
+
+    // keep the copy the texture is uploaded from again after an unload or
+    // eviction in step, if it's still around
+    mOffscreenMutex.lock();
+    if (mOffscreen.width() == mWidth && mOffscreen.height() == mHeight)
+      band.blit(mOffscreen, r.left(), r.top(), r.width(), r.height(), 0, 0);
+    mOffscreenMutex.unlock();
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, mTextureName);   TRACK_TEX_CALLS();
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, r.left(), mHeight - r.bottom(),
+                    r.width(), r.height(), GL_RGBA, GL_UNSIGNED_BYTE, band.base());
     return PX_OK;
   }
 
@@ -582,6 +811,11 @@ public:
     mOffscreen.freeCompressedData();
     mTextureDataAvailable = false;
     mInitialized = false;
+    if (mEvicted)
+    {
+      mEvicted = false;
+      gEvictedTextures--;
+    }
     return PX_OK;
   }
 
@@ -606,12 +840,15 @@ public:
       if (mTextureName)
       {
         glDeleteTextures(1, &mTextureName);
-        context.adjustCurrentTextureMemorySize(-1 * mWidth * mHeight * 4);
+        context.adjustCurrentTextureMemorySize(-1 * mTextureBytes);
       }
 
       mTextureName = 0;
+      mTextureBytes = 0;
+      mUploadedRows = 0;
       mInitialized = false;
       mTextureUploaded = false;
+      removeResident();
       mOffscreenMutex.lock();
       mOffscreen.term();
       mFreeOffscreenDataRequested = false;
@@ -637,42 +874,19 @@ public:
   {
     if (!mInitialized)
     {
+      if (mEvicted)
+        loadTextureData();
       return PX_NOTINITIALIZED;
     }
 
-
     glActiveTexture(GL_TEXTURE1);
 
-
-// TODO would be nice to do the upload in createTexture but right now it's getting called on wrong thread
-    if (!mTextureUploaded)
+    pxError e = upload();
+    if (e != PX_OK)
     {
-      if (!context.isTextureSpaceAvailable(this))
-      {
-        rtLogError("not enough texture memory remaining to create texture");
-        mInitialized = false;
-        freeOffscreenDataInBackground();
-        return PX_FAIL;
-      }
-      glGenTextures(1, &mTextureName);
-      glBindTexture(GL_TEXTURE_2D, mTextureName);   TRACK_TEX_CALLS();
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, PX_TEXTURE_MIN_FILTER);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, PX_TEXTURE_MAG_FILTER);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-      glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
-      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
-                   mOffscreen.width(), mOffscreen.height(), 0, GL_RGBA,
-                   GL_UNSIGNED_BYTE, mOffscreen.base());
-      mTextureUploaded = true;
-      context.adjustCurrentTextureMemorySize(mOffscreen.width()*mOffscreen.height()*4);
-      //free up unneeded offscreen memory
-      freeOffscreenDataInBackground();
-    }
-    else
-    {
-      glBindTexture(GL_TEXTURE_2D, mTextureName);   TRACK_TEX_CALLS();
+      return e;
     }
+    markDrawn();
 
     glUniform1i(tLoc, 1);
     return PX_OK;
@@ -682,14 +896,128 @@ public:
   {
     if (!mInitialized)
     {
+      if (mEvicted)
+        loadTextureData();
       return PX_NOTINITIALIZED;
     }
 
     glActiveTexture(GL_TEXTURE2);
 
-    if (!mTextureUploaded)
+    pxError e = upload();
+    if (e != PX_OK)
+    {
+      return e;
+    }
+    markDrawn();
+
+    glUniform1i(mLoc, 2);
+
+    return PX_OK;
+  }
+
+  virtual pxError getOffscreen(pxOffscreen& o)
+  {
+    if (!mInitialized)
+    {
+      return PX_NOTINITIALIZED;
+    }
+
+    char* compressedImageData = NULL;
+    size_t compressedImageDataSize = 0;
+    mOffscreen.compressedDataWeakReference(compressedImageData, compressedImageDataSize);
+    if (compressedImageData != NULL)
+    {
+      pxLoadImage(compressedImageData, compressedImageDataSize, o);
+    }
+
+    return PX_OK;
+  }
+
+  virtual int width()  { return mWidth;  }
+  virtual int height() { return mHeight; }
+
+  virtual bool loading() { return mEvicted || needsUpload(); }
+
+  // Whether drawing the texture would upload some of it
+  bool needsUpload() { return mInitialized && !mTextureUploaded; }
+
+  // Gives up the copy in gl, keeping the compressed image to decode it from
+  // again the next time the texture is drawn.  Textures without one, like
+  // animation frames, stay.
+  bool evict()
+  {
+    char* compressedImageData = NULL;
+    size_t compressedImageDataSize = 0;
+    mOffscreen.compressedDataWeakReference(compressedImageData, compressedImageDataSize);
+    if (!mTextureUploaded || compressedImageData == NULL)
+    {
+      return false;
+    }
+
+    rtLogDebug("evicting %dx%d texture last drawn %u frames ago", mWidth, mHeight,
+               gTextureFrame - mLastDrawFrame);
+    glDeleteTextures(1, &mTextureName);
+    context.adjustCurrentTextureMemorySize(-1 * mTextureBytes);
+    mTextureName = 0;
+    mTextureBytes = 0;
+    mUploadedRows = 0;
+    mTextureUploaded = false;
+    mInitialized = false;
+    mOffscreenMutex.lock();
+    mOffscreen.term();
+    mFreeOffscreenDataRequested = false;
+    mOffscreenMutex.unlock();
+    removeResident();
+
+    mEvicted = true;
+    gEvictedTextures++;
+    gTextureEvictions++;
+    return true;
+  }
+
+  uint32_t lastDrawFrame() { return mLastDrawFrame; }
+  int64_t textureBytes() { return mTextureBytes; }
+
+private:
+
+  // Binds the texture to the active unit, uploading as much of it as is
+  // left of this frame's upload budget first.  A texture too big for what's
+  // left goes up a band of rows at a time over the next frames, and isn't
+  // drawn until all of it is there.
+// TODO would be nice to do the upload in createTexture but right now it's getting called on wrong thread
+  pxError upload()
+  {
+    if (mTextureUploaded)
+    {
+      glBindTexture(GL_TEXTURE_2D, mTextureName);   TRACK_TEX_CALLS();
+      return PX_OK;
+    }
+
+    int w = mOffscreen.width();
+    int h = mOffscreen.height();
+    int64_t rowBytes = w*4;
+    int rows = h - mUploadedRows;
+    // only what's drawn to the screen is drawn again for the rest, a
+    // snapshot or cached render target gets the whole texture
+    if (gTextureUploadBudget > 0 && currentFramebuffer == defaultFramebuffer)
     {
-      if (!context.isTextureSpaceAvailable(this))
+      int64_t left = gTextureUploadBudget - gFrameUploadBytes;
+      int budgetRows = (left > 0)?(int)(left/rowBytes):0;
+      // something goes up every frame, however small the budget
+      if (budgetRows == 0 && gFrameUploadBytes == 0)
+        budgetRows = 1;
+      rows = pxMin<int>(rows, budgetRows);
+    }
+    if (rows == 0)
+    {
+      gFrameUploadsDeferred++;
+      return PX_NOTINITIALIZED;
+    }
+
+    double start = pxSeconds();
+    if (!mTextureName)
+    {
+      if (!context.isTextureSpaceAvailable(this) && !makeTextureSpace())
       {
         rtLogError("not enough texture memory remaining to create texture");
         mInitialized = false;
@@ -703,47 +1031,70 @@ public:
       glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
       glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
       glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
-      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
-                   mOffscreen.width(), mOffscreen.height(), 0, GL_RGBA,
-                   GL_UNSIGNED_BYTE, mOffscreen.base());
-      mTextureUploaded = true;
-      context.adjustCurrentTextureMemorySize(mOffscreen.width()*mOffscreen.height()*4);
-      
-      //free up unneeded offscreen memory
-      freeOffscreenDataInBackground();
+      // all at once when it fits, otherwise storage first and bands into it
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                   (rows == h)?mOffscreen.base():NULL);
+      mTextureBytes = rowBytes*h;
+      context.adjustCurrentTextureMemorySize(mTextureBytes);
+      if (rows == h)
+        mUploadedRows = h;
     }
     else
     {
       glBindTexture(GL_TEXTURE_2D, mTextureName);   TRACK_TEX_CALLS();
+      glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+    if (mUploadedRows < h)
+    {
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, mUploadedRows, w, rows, GL_RGBA, GL_UNSIGNED_BYTE,
+                      (uint8_t*)mOffscreen.base() + mUploadedRows*rowBytes);
+      mUploadedRows += rows;
     }
+    gFrameUploadBytes += rows*rowBytes;
+    gFrameUploadSeconds += pxSeconds() - start;
 
-    glUniform1i(mLoc, 2);
+    if (mUploadedRows < h)
+    {
+      gFrameUploadsDeferred++;
+      return PX_NOTINITIALIZED;
+    }
 
+    mTextureUploaded = true;
+    //free up unneeded offscreen memory
+    freeOffscreenDataInBackground();
     return PX_OK;
   }
 
-  virtual pxError getOffscreen(pxOffscreen& o)
+  void markDrawn()
   {
-    if (!mInitialized)
+    if (mResident)
     {
-      return PX_NOTINITIALIZED;
+      std::list<pxTextureOffscreen*>& textures = residentTextures();
+      textures.splice(textures.begin(), textures, mResidentPos);
     }
-
-    char* compressedImageData = NULL;
-    size_t compressedImageDataSize = 0;
-    mOffscreen.compressedDataWeakReference(compressedImageData, compressedImageDataSize);
-    if (compressedImageData != NULL)
+    else
     {
-      pxLoadImage(compressedImageData, compressedImageDataSize, o);
+      residentTextures().push_front(this);
+      mResidentPos = residentTextures().begin();
+      mResident = true;
     }
-
-    return PX_OK;
+    mLastDrawFrame = gTextureFrame;
   }
 
-  virtual int width()  { return mWidth;  }
-  virtual int height() { return mHeight; }
+  void removeResident()
+  {
+    if (mResident)
+    {
+      residentTextures().erase(mResidentPos);
+      mResident = false;
+    }
+  }
 
-private:
+  // Evicts textures that weren't drawn this frame until this one fits
+  bool makeTextureSpace()
+  {
+    return context.evictTextures(mOffscreen.width()*mOffscreen.height()*4, 1);
+  }
 
   void freeOffscreenDataInBackground()
   {
@@ -768,6 +1119,12 @@ private:
   int mHeight;
   rtMutex mOffscreenMutex;
   bool mFreeOffscreenDataRequested;
+  int64_t mTextureBytes;
+  int mUploadedRows;
+  bool mResident;
+  std::list<pxTextureOffscreen*>::iterator mResidentPos;
+  uint32_t mLastDrawFrame;
+  bool mEvicted;
 
 }; // CLASS - pxTextureOffscreen
 
@@ -1375,6 +1732,28 @@ static void drawRectOutline(GLfloat x, GLfloat y, GLfloat w, GLfloat h, GLfloat
   gSolidShader->draw(gResW,gResH,gMatrix.data(),gAlpha,GL_TRIANGLE_STRIP,verts,10,colorPM);
 }
 
+// Whether any of the x,y,w,h rect lands in the render target
+static bool isRectOnScreen(float x, float y, float w, float h)
+{
+  const float corners[4][2] = { { x, y }, { x+w, y }, { x, y+h }, { x+w, y+h } };
+  float l = 0, t = 0, r = 0, b = 0;
+  for (int i = 0; i < 4; i++)
+  {
+    pxVector4f v = gMatrix.multiply(pxVector4f(corners[i][0], corners[i][1]));
+    float sx = v.x(), sy = v.y();
+    if (v.w() != 0)
+    {
+      sx /= v.w();
+      sy /= v.w();
+    }
+    l = (i == 0)?sx:pxMin<float>(l, sx);
+    r = (i == 0)?sx:pxMax<float>(r, sx);
+    t = (i == 0)?sy:pxMin<float>(t, sy);
+    b = (i == 0)?sy:pxMax<float>(b, sy);
+  }
+  return r > 0 && b > 0 && l < gResW && t < gResH;
+}
+
 static void drawImageTexture(float x, float y, float w, float h, pxTextureRef texture,
                              pxTextureRef mask, bool useTextureDimsAlways, float* color, // default: "color = BLACK"
                              pxConstantsStretch::constants xStretch,
@@ -1398,6 +1777,17 @@ static void drawImageTexture(float x, float y, float w, float h, pxTextureRef te
       h = ih;
   }
 
+  // Uploads are spread over frames, so images that aren't on screen don't
+  // take any of the budget from ones that are.  Render targets aren't
+  // drawn again, so everything drawn into them goes up
+  if (currentFramebuffer == defaultFramebuffer &&
+      texture->getType() == PX_TEXTURE_OFFSCREEN &&
+      static_cast<pxTextureOffscreen*>(texture.getPtr())->needsUpload() &&
+      !isRectOnScreen(x, y, w, h))
+  {
+    return;
+  }
+
    const float verts[4][2] =
    {
      { x,     y },
@@ -1442,6 +1832,16 @@ static void drawImageTexture(float x, float y, float w, float h, pxTextureRef te
   float firstTextureY  = 1.0;
   float secondTextureY = 1.0-th;
 
+  if (texture->getType() == PX_TEXTURE_FRAME_BUFFER)
+  {
+    // a render target only uses the bottom left of its pooled texture
+    float sx, sy;
+    static_cast<pxFBOTexture*>(texture.getPtr())->uvScale(sx, sy);
+    tw *= sx;
+    firstTextureY *= sy;
+    secondTextureY *= sy;
+  }
+
   const float uv[4][2] =
   {
     { 0,  firstTextureY  },
@@ -1457,7 +1857,8 @@ static void drawImageTexture(float x, float y, float w, float h, pxTextureRef te
 
   if (mask.getPtr() == NULL && texture->getType() != PX_TEXTURE_ALPHA)
   {
-    if (gTextureShader->draw(gResW,gResH,gMatrix.data(),gAlpha,4,verts,uv,texture,xStretch,yStretch) != PX_OK)
+    if (gTextureShader->draw(gResW,gResH,gMatrix.data(),gAlpha,4,verts,uv,texture,xStretch,yStretch) != PX_OK &&
+        !texture->loading())
     {
       drawRect2(0, 0, iw, ih, blackColor);
     }
@@ -1471,7 +1872,8 @@ static void drawImageTexture(float x, float y, float w, float h, pxTextureRef te
   }
   else if (mask.getPtr() != NULL)
   {
-    if (gTextureMaskedShader->draw(gResW,gResH,gMatrix.data(),gAlpha,4,verts,uv,texture,mask) != PX_OK)
+    if (gTextureMaskedShader->draw(gResW,gResH,gMatrix.data(),gAlpha,4,verts,uv,texture,mask) != PX_OK &&
+        !texture->loading() && !mask->loading())
     {
       drawRect2(0, 0, iw, ih, blackColor);
     }
@@ -2137,7 +2539,7 @@ void pxContext::adjustCurrentTextureMemorySize(int64_t changeInBytes)
   {
     rtLogDebug("the texture size is too large: %" PRId64 ".  doing a garbage collect!!!\n", mCurrentTextureMemorySizeInBytes);
 #ifdef RUNINMAIN
-	script.garbageCollect();
+	script.memoryPressure(true);
 #else
   uv_async_send(&gcTrigger);
 #endif
@@ -2176,3 +2578,101 @@ int64_t pxContext::currentTextureMemoryUsageInBytes()
   return mCurrentTextureMemorySizeInBytes;
 }
 
+bool pxContext::evictTextures(int64_t bytes, uint32_t minAge)
+{
+  // least recently drawn first, stopping at the first one drawn too recently
+  std::list<pxTextureOffscreen*>& textures = residentTextures();
+  std::list<pxTextureOffscreen*>::iterator it = textures.end();
+  while (mCurrentTextureMemorySizeInBytes + bytes > mTextureMemoryLimitInBytes &&
+         it != textures.begin())
+  {
+    --it;
+    pxTextureOffscreen* texture = *it;
+    if (gTextureFrame - texture->lastDrawFrame() < minAge)
+    {
+      break;
+    }
+    std::list<pxTextureOffscreen*>::iterator next = it;
+    ++next;
+    if (texture->evict())
+    {
+      it = next;
+    }
+  }
+  return mCurrentTextureMemorySizeInBytes + bytes <= mTextureMemoryLimitInBytes;
+}
+
+void pxContext::endFrame()
+{
+  // pooled framebuffers go before any textures are evicted
+  trimFramebufferPool((mCurrentTextureMemorySizeInBytes > mTextureMemoryLimitInBytes)?0:gFramebufferPoolAge);
+  if (mCurrentTextureMemorySizeInBytes > mTextureMemoryLimitInBytes)
+  {
+    evictTextures(0, gTextureEvictionAge);
+  }
+  gTextureFrame++;
+
+  double ms = gFrameUploadSeconds*1000;
+  gTextureUploadStats.budget = gTextureUploadBudget;
+  gTextureUploadStats.frameBytes = gFrameUploadBytes;
+  gTextureUploadStats.frameMs = ms;
+  gTextureUploadStats.frameDeferred = gFrameUploadsDeferred;
+  gTextureUploadStats.maxFrameBytes = pxMax<int64_t>(gTextureUploadStats.maxFrameBytes, gFrameUploadBytes);
+  gTextureUploadStats.maxFrameMs = pxMax<double>(gTextureUploadStats.maxFrameMs, ms);
+  if (gFrameUploadsDeferred)
+  {
+    // draw again for the rest
+    gTexturesReady = true;
+  }
+  gFrameUploadBytes = 0;
+  gFrameUploadSeconds = 0;
+  gFrameUploadsDeferred = 0;
+}
+
+void pxContext::setTextureEvictionAge(uint32_t frames)
+{
+  gTextureEvictionAge = frames;
+}
+
+bool pxContext::texturesReady()
+{
+  bool reloaded = gTexturesReady;
+  gTexturesReady = false;
+  return reloaded;
+}
+
+void pxContext::setTextureUploadBudget(int64_t bytesPerFrame)
+{
+  gTextureUploadBudget = bytesPerFrame;
+}
+
+void pxContext::textureUploadStats(pxTextureUploadStats& stats)
+{
+  stats = gTextureUploadStats;
+  stats.budget = gTextureUploadBudget;
+}
+
+void pxContext::setFramebufferPoolAge(uint32_t frames)
+{
+  gFramebufferPoolAge = frames;
+}
+
+void pxContext::framebufferPoolStats(pxFramebufferPoolStats& stats)
+{
+  stats = gFramebufferPoolStats;
+}
+
+void pxContext::textureResidencyStats(pxTextureResidencyStats& stats)
+{
+  std::list<pxTextureOffscreen*>& textures = residentTextures();
+  stats.residentTextures = (int32_t)textures.size();
+  stats.residentBytes = 0;
+  for (std::list<pxTextureOffscreen*>::iterator it = textures.begin(); it != textures.end(); ++it)
+  {
+    stats.residentBytes += (*it)->textureBytes();
+  }
+  stats.evictedTextures = gEvictedTextures;
+  stats.evictions = gTextureEvictions;
+  stats.reloads = gTextureReloads;
+}
+
@@ -0,0 +1,1503 @@
+/*
+
+ pxCore Copyright 2005-2017 John Robinson
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*/
+
+// pxContextSW.cpp
+//
+// Headless pxContext that renders with the Rasterizer into main memory.
+// Everything is premultiplied like the GL context, but unlike GL the
+// surfaces are kept top down.
+
+#include "rtCore.h"
+#include "rtLog.h"
+
+#include "rtThreadTask.h"
+#include "rtThreadPool.h"
+#include "rtThreadQueue.h"
+#include "rtMutex.h"
+#include "rtNode.h"
+
+#include "pxContext.h"
+#include "pxUtil.h"
+#include "pxPixelConvert.h"
+
+#include "../../Rasterizer/pxRasterizer.h"
+
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////
+//
+// Debug macros...
+
+// NOTE:  Comment out these defines for 'normal' operation.
+//
+// #define DEBUG_SKIP_RECT
+// #define DEBUG_SKIP_IMAGE
+// #define DEBUG_SKIP_IMAGE9
+
+// #define DEBUG_SKIP_DIAG_RECT
+// #define DEBUG_SKIP_DIAG_LINE
+
+// Pending draws are replayed once there are this many
+#define PX_SW_MAX_PENDING_DRAWS 4096
+
+////////////////////////////////////////////////////////////////
+//
+// Debug Statistics
+#ifdef USE_RENDER_STATS
+  extern uint32_t gDrawCalls;
+  extern uint32_t gTexBindCalls;
+  extern uint32_t gFboBindCalls;
+
+  #define TRACK_DRAW_CALLS()   { gDrawCalls++;    }
+  #define TRACK_TEX_CALLS()    { gTexBindCalls++; }
+  #define TRACK_FBO_CALLS()    { gFboBindCalls++; }
+#else
+  #define TRACK_DRAW_CALLS()
+  #define TRACK_TEX_CALLS()
+  #define TRACK_FBO_CALLS()
+#endif
+
+pxContextSurfaceNativeDesc defaultContextSurface;
+pxContextSurfaceNativeDesc* currentContextSurface = &defaultContextSurface;
+
+pxContextFramebufferRef defaultFramebuffer(new pxContextFramebuffer());
+pxContextFramebufferRef currentFramebuffer = defaultFramebuffer;
+
+#ifdef RUNINMAIN
+extern rtNode script;
+#else
+extern uv_async_t gcTrigger;
+#endif
+extern pxContext context;
+rtThreadQueue gUIThreadQueue;
+
+static int gResW, gResH;
+static pxMatrix4f gMatrix;
+static float gAlpha = 1.0;
+
+static pxOffscreen gDefaultOffscreen;
+
+// scissor, top down
+static bool gClipEnabled = false;
+static pxRect gClip;
+
+//====================================================================================================================================================================================
+
+inline void premultiply(float* d, const float* s)
+{
+  d[0] = s[0]*s[3];
+  d[1] = s[1]*s[3];
+  d[2] = s[2]*s[3];
+  d[3] = s[3];
+}
+
+inline pxColor toColor(const float* c)
+{
+  return pxColor((uint8_t)(pxClamp<float>(c[0], 0, 1)*255+0.5),
+                 (uint8_t)(pxClamp<float>(c[1], 0, 1)*255+0.5),
+                 (uint8_t)(pxClamp<float>(c[2], 0, 1)*255+0.5),
+                 (uint8_t)(pxClamp<float>(c[3], 0, 1)*255+0.5));
+}
+
+//====================================================================================================================================================================================
+
+// A quad, a clear or a solid fill, in target coordinates
+struct pxSwDraw
+{
+  enum pxSwDrawType { CLEAR, FILL, TEXTURE };
+
+  pxSwDraw(): type(FILL), alpha(1.0), clamp(true), clipped(false) {}
+
+  pxSwDrawType type;
+  pxVertex verts[4];
+  pxVertex uvs[4];      // in texels
+  pxTextureRef texture; // its getSurface() is the pxOffscreen to sample
+  pxColor color;        // premultiplied
+  double alpha;
+  bool clamp;
+  bool clipped;
+  pxRect clip;
+};
+
+// Draws are recorded against the current target and replayed when the target
+// changes, its pixels are needed or a texture they read from is about to
+// change.  Replay splits the target into horizontal bands, each rasterized on
+// its own thread by its own pxRasterizer, so bands never share pixels or
+// rasterizer state and the result doesn't depend on the band count.
+class pxSwRenderer
+{
+public:
+  pxSwRenderer(): mTarget(NULL), mBandCount(0), mThreadPool(NULL), mPending(0) {}
+
+  ~pxSwRenderer()
+  {
+    delete mThreadPool;
+    for (size_t i = 0; i < mRasterizers.size(); i++)
+      delete mRasterizers[i];
+  }
+
+  pxOffscreen* target() { return mTarget; }
+
+  void setTarget(pxOffscreen* target)
+  {
+    if (target != mTarget)
+    {
+      flush();
+      mTarget = target;
+    }
+  }
+
+  int bandCount()
+  {
+    if (mBandCount <= 0)
+    {
+      const char* s = getenv("PXSCENE_SW_BANDS");
+      mBandCount = s?atoi(s):(int)std::thread::hardware_concurrency();
+      if (mBandCount <= 0)
+        mBandCount = 1;
+    }
+    return mBandCount;
+  }
+
+  void setBandCount(int bands)
+  {
+    flush();
+    mBandCount = bands;
+  }
+
+  void addDraw(const pxSwDraw& d)
+  {
+    if (mTarget == NULL || mTarget->base() == NULL)
+      return;
+
+    mDraws.push_back(d);
+    if (mDraws.size() >= PX_SW_MAX_PENDING_DRAWS)
+      flush();
+  }
+
+  void flush()
+  {
+    if (mDraws.empty())
+      return;
+
+    int bands = pxClamp<int>(bandCount(), 1, pxMax<int>(mTarget->height(), 1));
+    while ((int)mRasterizers.size() < bands)
+      mRasterizers.push_back(new pxRasterizer);
+
+    if (bands > 1)
+    {
+      // the calling thread takes the first band
+      if (mThreadPool == NULL || (int)mBands.size() != bands)
+      {
+        delete mThreadPool;
+        mThreadPool = new rtThreadPool(bands-1);
+        mBands.resize(bands);
+      }
+
+      mPending = bands-1;
+      for (int i = 1; i < bands; i++)
+      {
+        mBands[i].renderer = this;
+        mBands[i].band = i;
+        mBands[i].bands = bands;
+        mThreadPool->executeTask(new rtThreadTask(renderBandTask, &mBands[i], ""));
+      }
+    }
+
+    renderBand(0, bands);
+
+    if (bands > 1)
+    {
+      mMutex.lock();
+      while (mPending > 0)
+        mCondition.wait(mMutex.getNativeMutexDescription());
+      mMutex.unlock();
+    }
+
+    mDraws.clear();
+  }
+
+private:
+  struct Band
+  {
+    pxSwRenderer* renderer;
+    int band;
+    int bands;
+  };
+
+  static void renderBandTask(void* data)
+  {
+    Band* b = (Band*)data;
+    b->renderer->renderBand(b->band, b->bands);
+
+    b->renderer->mMutex.lock();
+    if (--b->renderer->mPending == 0)
+      b->renderer->mCondition.signal();
+    b->renderer->mMutex.unlock();
+  }
+
+  void renderBand(int band, int bands)
+  {
+    int h = mTarget->height();
+    int top = (h*band)/bands;
+    int bottom = (h*(band+1))/bands;
+    pxRect bandRect(0, top, mTarget->width(), bottom);
+
+    pxRasterizer& r = *mRasterizers[band];
+    r.init(mTarget);
+    r.setPreMultipliedAlpha(true);
+    r.setBiLerp(true);
+
+    for (size_t i = 0; i < mDraws.size(); i++)
+    {
+      const pxSwDraw& d = mDraws[i];
+
+      if (d.type == pxSwDraw::CLEAR)
+      {
+        pxRect clip = bandRect;
+        if (d.clipped)
+          clip.intersect(d.clip);
+        if (!clip.isEmpty())
+          mTarget->fill(clip, d.color);
+        continue;
+      }
+
+      float minY = d.verts[0].y, maxY = d.verts[0].y;
+      for (int j = 1; j < 4; j++)
+      {
+        minY = pxMin<float>(minY, d.verts[j].y);
+        maxY = pxMax<float>(maxY, d.verts[j].y);
+      }
+      if (maxY < top || minY >= bottom)
+        continue;
+
+      pxOffscreen* texture = NULL;
+      if (d.type == pxSwDraw::TEXTURE)
+      {
+        texture = (pxOffscreen*)d.texture->getSurface();
+        if (texture == NULL || texture->base() == NULL)
+          continue;
+      }
+
+      // the clip is the same in every band, the band only limits the rows
+      // written, see pxRasterizer::setBand
+      r.setClip(d.clipped?&d.clip:NULL);
+      r.setBand(top, bottom);
+      r.setColor(d.color);
+      r.setAlpha(d.alpha);
+      r.setTexture(texture);
+      r.setTextureClamp(d.clamp);
+
+      for (int j = 0; j < 4; j++)
+        r.addEdge(d.verts[j].x, d.verts[j].y, d.verts[(j+1)%4].x, d.verts[(j+1)%4].y);
+
+      if (texture)
+      {
+        pxVertex e1 = d.verts[0], e2 = d.verts[1], e3 = d.verts[2], e4 = d.verts[3];
+        pxVertex t1 = d.uvs[0], t2 = d.uvs[1], t3 = d.uvs[2], t4 = d.uvs[3];
+        r.setTextureCoordinates(e1, e2, e3, e4, t1, t2, t3, t4);
+      }
+
+      r.rasterize();
+      TRACK_DRAW_CALLS();
+    }
+  }
+
+  pxOffscreen* mTarget;
+  int mBandCount;
+  std::vector<pxSwDraw> mDraws;
+  std::vector<pxRasterizer*> mRasterizers;
+  std::vector<Band> mBands;
+  rtThreadPool* mThreadPool;
+  rtMutex mMutex;
+  rtThreadCondition mCondition;
+  int mPending;
+};
+
+static pxSwRenderer gRenderer;
+
+void pxSwSetBandCount(int bands)
+{
+  gRenderer.setBandCount(bands);
+}
+
+int pxSwBandCount()
+{
+  return gRenderer.bandCount();
+}
+
+//====================================================================================================================================================================================
+
+class pxFBOTexture : public pxTexture
+{
+public:
+  pxFBOTexture() : mOffscreen()
+  {
+    mTextureType = PX_TEXTURE_FRAME_BUFFER;
+  }
+
+  ~pxFBOTexture() { deleteTexture(); }
+
+  void createFboTexture(int w, int h)
+  {
+    deleteTexture();
+
+    mOffscreen.initWithColor(w, h, pxColor(0, 0, 0, 0));
+    context.adjustCurrentTextureMemorySize(w*h*4);
+  }
+
+  pxError resizeTexture(int w, int h)
+  {
+    if (mOffscreen.width() != w || mOffscreen.height() != h || mOffscreen.base() == NULL)
+    {
+      createFboTexture(w, h);
+    }
+    return PX_OK;
+  }
+
+  virtual pxError deleteTexture()
+  {
+    // draws still reading or writing these pixels go first
+    gRenderer.flush();
+    if (gRenderer.target() == &mOffscreen)
+      gRenderer.setTarget(NULL);
+
+    if (mOffscreen.base() != NULL)
+    {
+      context.adjustCurrentTextureMemorySize(-1*mOffscreen.width()*mOffscreen.height()*4);
+      mOffscreen.term();
+    }
+    return PX_OK;
+  }
+
+  virtual pxError prepareForRendering()
+  {
+    if (mOffscreen.base() == NULL)
+    {
+      if ((mOffscreen.width() != 0) && (mOffscreen.height() != 0))
+      {
+        rtLogWarn("error setting the render surface");
+      }
+      return PX_FAIL;
+    }
+
+    gRenderer.setTarget(&mOffscreen);   TRACK_FBO_CALLS();
+    gResW = mOffscreen.width();
+    gResH = mOffscreen.height();
+
+    return PX_OK;
+  }
+
+  virtual pxError bindGLTexture(int /*tLoc*/)       { return PX_FAIL; }
+  virtual pxError bindGLTextureAsMask(int /*mLoc*/) { return PX_FAIL; }
+
+  virtual pxError getOffscreen(pxOffscreen& o)
+  {
+    if (mOffscreen.base() == NULL)
+      return PX_NOTINITIALIZED;
+
+    gRenderer.flush();
+    o = mOffscreen;
+    return PX_OK;
+  }
+
+  virtual void* getSurface() { return &mOffscreen; }
+
+  virtual int width() { return mOffscreen.width(); }
+  virtual int height() { return mOffscreen.height(); }
+
+private:
+  pxOffscreen mOffscreen;
+
+};// CLASS - pxFBOTexture
+
+//====================================================================================================================================================================================
+
+class pxTextureNone : public pxTexture
+{
+public:
+  pxTextureNone() {}
+
+  virtual int width()                                 { return 0;}
+  virtual int height()                                { return 0;}
+  virtual pxError deleteTexture()                     { return PX_FAIL; }
+  virtual pxError resizeTexture(int /*w*/, int /*h*/) { return PX_FAIL; }
+  virtual pxError getOffscreen(pxOffscreen& /*o*/)    { return PX_FAIL; }
+  virtual pxError bindGLTexture(int /*tLoc*/)         { return PX_FAIL; }
+  virtual pxError bindGLTextureAsMask(int /*mLoc*/)   { return PX_FAIL; }
+
+};// CLASS - pxTextureNone
+
+//====================================================================================================================================================================================
+
+// Pixels composited on the cpu for a single draw, e.g. an image multiplied
+// by its mask.  The draw holds the only reference.
+class pxTextureComposite : public pxTexture
+{
+public:
+  pxTextureComposite(int w, int h)
+  {
+    mTextureType = PX_TEXTURE_OFFSCREEN;
+    mOffscreen.init(w, h);
+  }
+
+  pxOffscreen& offscreen() { return mOffscreen; }
+
+  virtual int width()                                 { return mOffscreen.width(); }
+  virtual int height()                                { return mOffscreen.height(); }
+  virtual pxError deleteTexture()                     { return PX_OK; }
+  virtual pxError getOffscreen(pxOffscreen& /*o*/)    { return PX_FAIL; }
+  virtual pxError bindGLTexture(int /*tLoc*/)         { return PX_FAIL; }
+  virtual pxError bindGLTextureAsMask(int /*mLoc*/)   { return PX_FAIL; }
+  virtual void* getSurface()                          { return &mOffscreen; }
+
+private:
+  pxOffscreen mOffscreen;
+
+};// CLASS - pxTextureComposite
+
+//====================================================================================================================================================================================
+
+struct DecodeImageData
+{
+    DecodeImageData(pxTextureRef t, pxOffscreen* o) : textureOffscreen(t), offscreen(o)
+    {
+    }
+    pxTextureRef textureOffscreen;
+    pxOffscreen* offscreen;
+
+};
+
+void onDecodeComplete(void* context, void* data)
+{
+  DecodeImageData* imageData = (DecodeImageData*)context;
+  pxOffscreen* decodedOffscreen = (pxOffscreen*)data;
+  if (imageData != NULL && decodedOffscreen != NULL)
+  {
+    pxTextureRef texture = imageData->textureOffscreen;
+    if (texture.getPtr() != NULL)
+    {
+      texture->createTexture(*decodedOffscreen);
+    }
+  }
+
+  if (decodedOffscreen != NULL)
+  {
+    delete decodedOffscreen;
+    decodedOffscreen = NULL;
+    data = NULL;
+  }
+
+  if (imageData != NULL)
+  {
+    delete imageData;
+    imageData = NULL;
+  }
+}
+
+void decodeTextureData(void* data)
+{
+  if (data != NULL)
+  {
+    DecodeImageData* imageData = (DecodeImageData*)data;
+    pxOffscreen* offscreen = imageData->offscreen;
+    if (offscreen != NULL)
+    {
+      char *compressedImageData = NULL;
+      size_t compressedImageDataSize = 0;
+      offscreen->compressedDataWeakReference(compressedImageData, compressedImageDataSize);
+      pxOffscreen *decodedOffscreen = new pxOffscreen();
+      pxLoadImage(compressedImageData, compressedImageDataSize, *decodedOffscreen);
+      gUIThreadQueue.addTask(onDecodeComplete, data, decodedOffscreen);
+    }
+    else
+    {
+      gUIThreadQueue.addTask(onDecodeComplete, data, NULL);
+    }
+  }
+}
+
+// The premultiplied pixels stay resident, they're what the rasterizer samples
+class pxTextureOffscreen : public pxTexture
+{
+public:
+  pxTextureOffscreen() : mOffscreen(), mInitialized(false), mTextureDataAvailable(false),
+                         mLoadTextureRequested(false), mWidth(0), mHeight(0), mOffscreenMutex()
+  {
+    mTextureType = PX_TEXTURE_OFFSCREEN;
+  }
+
+  pxTextureOffscreen(pxOffscreen& o) : mOffscreen(), mInitialized(false), mTextureDataAvailable(false),
+                                       mLoadTextureRequested(false), mWidth(0), mHeight(0), mOffscreenMutex()
+  {
+    mTextureType = PX_TEXTURE_OFFSCREEN;
+    createTexture(o);
+  }
+
+  ~pxTextureOffscreen() { deleteTexture(); };
+
+  virtual pxError createTexture(pxOffscreen& o)
+  {
+    // pending draws may still sample the old pixels
+    gRenderer.flush();
+
+    if (mInitialized)
+      context.adjustCurrentTextureMemorySize(-1 * mWidth * mHeight * 4);
+
+    mOffscreenMutex.lock();
+    mOffscreen.init(o.width(), o.height());
+    pxPremultiply(mOffscreen, o);
+    mWidth = mOffscreen.width();
+    mHeight = mOffscreen.height();
+
+    mOffscreen.transferCompressedDataFrom(o);
+    mOffscreenMutex.unlock();
+
+    context.adjustCurrentTextureMemorySize(mWidth * mHeight * 4);
+
+    mTextureDataAvailable = true;
+    mLoadTextureRequested = false;
+    mInitialized = true;
+
+    return PX_OK;
+  }
+
+  virtual pxError updateTexture(pxOffscreen& o, int x, int y, int w, int h)
+  {
+    if (!mInitialized)
+      return createTexture(o);
+
+    if (o.width() != mWidth || o.height() != mHeight)
+      return PX_FAIL;
+
+    pxRect r(x, y, x + w, y + h);
+    pxRect bounds(0, 0, mWidth, mHeight);
+    r.intersect(bounds);
+    if (r.isEmpty())
+      return PX_OK;
+
+    pxOffscreen band;
+    band.init(r.width(), r.height());
+    o.blit(band, 0, 0, r.width(), r.height(), r.left(), r.top());
+    pxPremultiply(band);
+
+    gRenderer.flush();
+
+    mOffscreenMutex.lock();
+    band.blit(mOffscreen, r.left(), r.top(), r.width(), r.height(), 0, 0);
+    mOffscreenMutex.unlock();
+    return PX_OK;
+  }
+
+  virtual pxError deleteTexture()
+  {
+    rtLogDebug("pxTextureOffscreen::deleteTexture()");
+
+    unloadTextureData();
+
+    mOffscreen.freeCompressedData();
+    mTextureDataAvailable = false;
+    mInitialized = false;
+    return PX_OK;
+  }
+
+  virtual pxError loadTextureData()
+  {
+    if (!mLoadTextureRequested && mTextureDataAvailable && !mInitialized)
+    {
+      rtThreadPool *mainThreadPool = rtThreadPool::globalInstance();
+      DecodeImageData *decodeImageData = new DecodeImageData(this, &mOffscreen);
+      rtThreadTask *task = new rtThreadTask(decodeTextureData, decodeImageData, "");
+      mainThreadPool->executeTask(task);
+      mLoadTextureRequested = true;
+    }
+
+    return PX_OK;
+  }
+
+  virtual pxError unloadTextureData()
+  {
+    if (mInitialized)
+    {
+      gRenderer.flush();
+      context.adjustCurrentTextureMemorySize(-1 * mWidth * mHeight * 4);
+
+      mInitialized = false;
+      mOffscreenMutex.lock();
+      mOffscreen.term();
+      mOffscreenMutex.unlock();
+    }
+    return PX_OK;
+  }
+
+  virtual pxError bindGLTexture(int /*tLoc*/)       { return mInitialized?PX_OK:PX_NOTINITIALIZED; }
+  virtual pxError bindGLTextureAsMask(int /*mLoc*/) { return mInitialized?PX_OK:PX_NOTINITIALIZED; }
+
+  virtual pxError getOffscreen(pxOffscreen& o)
+  {
+    if (!mInitialized)
+    {
+      return PX_NOTINITIALIZED;
+    }
+
+    char* compressedImageData = NULL;
+    size_t compressedImageDataSize = 0;
+    mOffscreen.compressedDataWeakReference(compressedImageData, compressedImageDataSize);
+    if (compressedImageData != NULL)
+    {
+      pxLoadImage(compressedImageData, compressedImageDataSize, o);
+    }
+
+    return PX_OK;
+  }
+
+  virtual void* getSurface() { return mInitialized?&mOffscreen:NULL; }
+
+  virtual int width()  { return mWidth;  }
+  virtual int height() { return mHeight; }
+
+private:
+  pxOffscreen mOffscreen;
+
+  bool mInitialized;
+  bool mTextureDataAvailable;
+  bool mLoadTextureRequested;
+  int mWidth;
+  int mHeight;
+  rtMutex mOffscreenMutex;
+
+}; // CLASS - pxTextureOffscreen
+
+//====================================================================================================================================================================================
+
+class pxTextureAlpha : public pxTexture
+{
+public:
+  pxTextureAlpha() : mDrawWidth(0.0), mDrawHeight (0.0), mImageWidth(0),
+                     mImageHeight(0), mBuffer(NULL)
+  {
+    mTextureType = PX_TEXTURE_ALPHA;
+  }
+
+  pxTextureAlpha(float w, float h, float iw, float ih, void* buffer)
+    : mDrawWidth(w),    mDrawHeight (h),
+      mImageWidth((int32_t)iw), mImageHeight((int32_t)ih), mBuffer(NULL)
+  {
+    mTextureType = PX_TEXTURE_ALPHA;
+
+    // copy the pixels, top down like everything else here
+    int bitmapSize = mImageWidth*mImageHeight;
+    mBuffer = malloc(bitmapSize);
+    memcpy(mBuffer, buffer, bitmapSize);
+    context.adjustCurrentTextureMemorySize(bitmapSize);
+  }
+
+  ~pxTextureAlpha()
+  {
+    deleteTexture();
+  }
+
+  // The glyphs in the given premultiplied color.  The last one is kept, the
+  // same text tends to be drawn in the same color every frame.
+  pxTextureRef colorTexture(const pxColor& c)
+  {
+    if (mColorTexture.getPtr() == NULL || mColor.u != c.u)
+    {
+      // a new texture rather than an update, pending draws still hold the old one
+      pxTextureComposite* t = new pxTextureComposite(mImageWidth, mImageHeight);
+      pxOffscreen& o = t->offscreen();
+      for (int32_t i = 0; i < mImageHeight; i++)
+      {
+        uint8_t* s = (uint8_t*)mBuffer+(mImageWidth*i);
+        uint32_t* d = (uint32_t*)o.scanline(i);
+        uint32_t* de = d + mImageWidth;
+        while (d < de)
+        {
+          uint32_t a = *s++;
+          a += a >> 7;
+          *d++ = (((c.u & 0xFF00FF) * a >> 8) & 0xFF00FF) | ((((c.u >> 8) & 0xFF00FF) * a) & 0xFF00FF00);
+        }
+      }
+      mColorTexture = t;
+      mColor = c;
+    }
+    return mColorTexture;
+  }
+
+  virtual pxError deleteTexture()
+  {
+    if (mBuffer)
+    {
+      free(mBuffer);
+      mBuffer = NULL;
+      context.adjustCurrentTextureMemorySize(-1*mImageWidth*mImageHeight);
+    }
+    mColorTexture = NULL;
+    return PX_OK;
+  }
+
+  virtual pxError bindGLTexture(int /*tLoc*/)       { return mBuffer?PX_OK:PX_NOTINITIALIZED; }
+  virtual pxError bindGLTextureAsMask(int /*mLoc*/) { return mBuffer?PX_OK:PX_NOTINITIALIZED; }
+
+  virtual pxError getOffscreen(pxOffscreen& /*o*/)
+  {
+    if (!mBuffer)
+    {
+      return PX_NOTINITIALIZED;
+    }
+    return PX_FAIL;
+  }
+
+  virtual int width()  {return mDrawWidth;  }
+  virtual int height() {return mDrawHeight; }
+
+private:
+  float mDrawWidth;
+  float mDrawHeight;
+  int32_t mImageWidth;
+  int32_t mImageHeight;
+  void* mBuffer;
+  pxTextureRef mColorTexture;
+  pxColor mColor;
+
+}; // CLASS - pxTextureAlpha
+
+//====================================================================================================================================================================================
+
+static void addQuad(pxSwDraw& d, float x1, float y1, float x2, float y2)
+{
+  const float* m = gMatrix.data();
+  float xs[4] = { x1, x2, x2, x1 };
+  float ys[4] = { y1, y1, y2, y2 };
+  for (int i = 0; i < 4; i++)
+  {
+    d.verts[i].x = m[0] * xs[i] + m[4] * ys[i] + m[12];
+    d.verts[i].y = m[1] * xs[i] + m[5] * ys[i] + m[13];
+  }
+
+  d.alpha = gAlpha;
+  d.clipped = gClipEnabled;
+  d.clip = gClip;
+
+  gRenderer.addDraw(d);
+}
+
+static void drawRect2(float x, float y, float w, float h, const float* c)
+{
+  // args are tested at call site...
+
+  float colorPM[4];
+  premultiply(colorPM,c);
+
+  pxSwDraw d;
+  d.type = pxSwDraw::FILL;
+  d.color = toColor(colorPM);
+  addQuad(d, x, y, x+w, y+h);
+}
+
+static void drawRectOutline(float x, float y, float w, float h, float lw, const float* c)
+{
+  // args are tested at call site...
+
+  // four bands that don't overlap, so translucent outlines blend once
+  lw = pxMin<float>(lw, pxMin<float>(w, h)/2);
+  drawRect2(x, y, w, lw, c);
+  drawRect2(x, y+h-lw, w, lw, c);
+  drawRect2(x, y+lw, lw, h-lw-lw, c);
+  drawRect2(x+w-lw, y+lw, lw, h-lw-lw, c);
+}
+
+static void drawTexturedQuad(pxTextureRef texture, bool clamp,
+                             float x1, float y1, float x2, float y2,
+                             float u1, float v1, float u2, float v2)
+{
+  if (x1 >= x2 || y1 >= y2)
+    return;
+
+  pxSwDraw d;
+  d.type = pxSwDraw::TEXTURE;
+  d.texture = texture;
+  d.clamp = clamp;
+  d.uvs[0].x = u1; d.uvs[0].y = v1;
+  d.uvs[1].x = u2; d.uvs[1].y = v1;
+  d.uvs[2].x = u2; d.uvs[2].y = v2;
+  d.uvs[3].x = u1; d.uvs[3].y = v2;
+  addQuad(d, x1, y1, x2, y2);
+}
+
+// texture * mask alpha, with the mask scaled to the texture like a shader
+// sampling both at the same uv would
+static pxTextureRef maskTexture(pxTextureRef texture, pxTextureRef mask)
+{
+  pxOffscreen* t = (pxOffscreen*)texture->getSurface();
+  pxOffscreen* m = (pxOffscreen*)mask->getSurface();
+  if (t == NULL || m == NULL || t->base() == NULL || m->base() == NULL)
+    return NULL;
+
+  int w = t->width();
+  int h = t->height();
+  pxTextureComposite* result = new pxTextureComposite(w, h);
+  pxOffscreen& o = result->offscreen();
+
+  for (int y = 0; y < h; y++)
+  {
+    pxPixel* s = t->scanline(y);
+    pxPixel* ms = m->scanline((y*m->height())/h);
+    uint32_t* d = (uint32_t*)o.scanline(y);
+    for (int x = 0; x < w; x++)
+    {
+      uint32_t a = ms[(x*m->width())/w].a;
+      a += a >> 7;
+      uint32_t c = s[x].u;
+      d[x] = (((c & 0xFF00FF) * a >> 8) & 0xFF00FF) | ((((c >> 8) & 0xFF00FF) * a) & 0xFF00FF00);
+    }
+  }
+  return result;
+}
+
+static void drawImageTexture(float x, float y, float w, float h, pxTextureRef texture,
+                             pxTextureRef mask, bool useTextureDimsAlways, float* color, // default: "color = BLACK"
+                             pxConstantsStretch::constants xStretch,
+                             pxConstantsStretch::constants yStretch)
+{
+  // args are tested at call site...
+
+  float iw = texture->width();
+  float ih = texture->height();
+
+  if( useTextureDimsAlways)
+  {
+      w = iw;
+      h = ih;
+  }
+  else
+  {
+    if (w == -1)
+      w = iw;
+    if (h == -1)
+      h = ih;
+  }
+
+  float tw = 1.0;
+  switch(xStretch) {
+  case pxConstantsStretch::NONE:
+  case pxConstantsStretch::REPEAT:
+    tw = w/iw;
+    break;
+  case pxConstantsStretch::STRETCH:
+    tw = 1.0;
+    break;
+  }
+
+  float th = 1.0;
+  switch(yStretch) {
+  case pxConstantsStretch::NONE:
+  case pxConstantsStretch::REPEAT:
+    th = h/ih;
+    break;
+  case pxConstantsStretch::STRETCH:
+    th = 1.0;
+    break;
+  }
+
+  static float blackColor[4] = {0.0, 0.0, 0.0, 1.0};
+
+  pxTextureRef source;
+  if (mask.getPtr() == NULL && texture->getType() != PX_TEXTURE_ALPHA)
+  {
+    source = texture;
+  }
+  else if (mask.getPtr() == NULL && texture->getType() == PX_TEXTURE_ALPHA)
+  {
+    float colorPM[4];
+    premultiply(colorPM,color);
+    source = ((pxTextureAlpha*)texture.getPtr())->colorTexture(toColor(colorPM));
+  }
+  else if (mask.getPtr() != NULL)
+  {
+    source = maskTexture(texture, mask);
+  }
+  else
+  {
+    rtLogError("Unhandled case");
+  }
+
+  pxOffscreen* o = source.getPtr()?(pxOffscreen*)source->getSurface():NULL;
+  if (o == NULL || o->base() == NULL)
+  {
+    drawRect2(0, 0, iw, ih, blackColor);
+    return;
+  }
+  TRACK_TEX_CALLS();
+
+  // the rasterizer has one wrap mode for both axes
+  bool clamp = (xStretch != pxConstantsStretch::REPEAT && yStretch != pxConstantsStretch::REPEAT);
+  drawTexturedQuad(source, clamp, x, y, x+w, y+h, 0, 0, tw*o->width(), th*o->height());
+}
+
+static void drawImage92(float x, float y, float w, float h, float x1, float y1, float x2,
+                        float y2, pxTextureRef texture)
+{
+  // args are tested at call site...
+
+  pxOffscreen* o = (pxOffscreen*)texture->getSurface();
+  if (o == NULL || o->base() == NULL)
+    return;
+  TRACK_TEX_CALLS();
+
+  float w2 = o->width();
+  float h2 = o->height();
+
+  float xs[4] = { x, x+x1, x+w-x2, x+w };
+  float ys[4] = { y, y+y1, y+h-y2, y+h };
+
+  // sanitize values
+  float us[4] = { 0, pxClamp<float>(x1, 0, w2), pxClamp<float>(w2-x2, 0, w2), w2 };
+  float vs[4] = { 0, pxClamp<float>(y1, 0, h2), pxClamp<float>(h2-y2, 0, h2), h2 };
+  if (us[1] > us[2])
+    std::swap(us[1], us[2]);
+  if (vs[1] > vs[2])
+    std::swap(vs[1], vs[2]);
+
+  for (int j = 0; j < 3; j++)
+  {
+    for (int i = 0; i < 3; i++)
+    {
+      drawTexturedQuad(texture, true, xs[i], ys[j], xs[i+1], ys[j+1],
+                       us[i], vs[j], us[i+1], vs[j+1]);
+    }
+  }
+}
+
+pxContext::~pxContext()
+{
+  gRenderer.setTarget(NULL);
+}
+
+void pxContext::init()
+{
+  defaultContextSurface.offscreen = &gDefaultOffscreen;
+  if (currentFramebuffer == defaultFramebuffer)
+  {
+    gRenderer.setTarget(&gDefaultOffscreen);
+  }
+
+  setTextureMemoryLimit(PXSCENE_DEFAULT_TEXTURE_MEMORY_LIMIT_IN_BYTES);
+}
+
+void pxContext::setSize(int w, int h)
+{
+  gResW = w;
+  gResH = h;
+
+  if (gDefaultOffscreen.width() != w || gDefaultOffscreen.height() != h)
+  {
+    gRenderer.flush();
+    gDefaultOffscreen.initWithColor(w, h, pxColor(0, 0, 0, 0));
+  }
+
+  defaultContextSurface.offscreen = &gDefaultOffscreen;
+  defaultContextSurface.width = w;
+  defaultContextSurface.height = h;
+
+  if (currentFramebuffer == defaultFramebuffer)
+  {
+    gRenderer.setTarget(&gDefaultOffscreen);
+    gResW = w;
+    gResH = h;
+  }
+}
+
+void pxContext::getSize(int& w, int& h)
+{
+   w = gResW;
+   h = gResH;
+}
+
+void pxContext::clear(int /*w*/, int /*h*/)
+{
+  pxSwDraw d;
+  d.type = pxSwDraw::CLEAR;
+  d.color = pxColor(0, 0, 0, 0);
+  d.clipped = gClipEnabled;
+  d.clip = gClip;
+  gRenderer.addDraw(d);
+}
+
+void pxContext::clear(int /*w*/, int /*h*/, float *fillColor )
+{
+  pxSwDraw d;
+  d.type = pxSwDraw::CLEAR;
+  d.color = toColor(fillColor);
+  d.clipped = gClipEnabled;
+  d.clip = gClip;
+  gRenderer.addDraw(d);
+  currentFramebuffer->enableDirtyRectangles(false);
+}
+
+void pxContext::clear(int left, int top, int right, int bottom)
+{
+  // right and bottom are really the width and height, as with glScissor
+  currentFramebuffer->setDirtyRectangle(left, top, left+right, top+bottom);
+  currentFramebuffer->enableDirtyRectangles(true);
+
+  gClipEnabled = true;
+  gClip = currentFramebuffer->dirtyRectangle();
+}
+
+void pxContext::enableClipping(bool enable)
+{
+  gClipEnabled = enable;
+}
+
+void pxContext::setMatrix(pxMatrix4f& m)
+{
+  gMatrix.multiply(m);
+}
+
+pxMatrix4f pxContext::getMatrix()
+{
+  return gMatrix;
+}
+
+void pxContext::setAlpha(float a)
+{
+  gAlpha *= a;
+}
+
+float pxContext::getAlpha()
+{
+  return gAlpha;
+}
+
+pxContextFramebufferRef pxContext::createFramebuffer(int width, int height)
+{
+  pxContextFramebuffer* fbo = new pxContextFramebuffer();
+  pxFBOTexture* texture = new pxFBOTexture();
+
+  texture->createFboTexture(width, height);
+
+  fbo->setTexture(texture);
+
+  return fbo;
+}
+
+pxError pxContext::updateFramebuffer(pxContextFramebufferRef fbo, int width, int height)
+{
+  if (fbo.getPtr() == NULL || fbo->getTexture().getPtr() == NULL)
+  {
+    return PX_FAIL;
+  }
+
+  return fbo->getTexture()->resizeTexture(width, height);
+}
+
+pxContextFramebufferRef pxContext::getCurrentFramebuffer()
+{
+  return currentFramebuffer;
+}
+
+pxError pxContext::setFramebuffer(pxContextFramebufferRef fbo)
+{
+  if (fbo.getPtr() == NULL || fbo->getTexture().getPtr() == NULL)
+  {
+    gResW = defaultContextSurface.width;
+    gResH = defaultContextSurface.height;
+
+    gRenderer.setTarget(defaultContextSurface.offscreen);  TRACK_FBO_CALLS();
+    currentFramebuffer = defaultFramebuffer;
+
+    pxContextState contextState;
+    currentFramebuffer->currentState(contextState);
+
+    gAlpha = contextState.alpha;
+    gMatrix = contextState.matrix;
+
+#ifdef PX_DIRTY_RECTANGLES
+    gClipEnabled = currentFramebuffer->isDirtyRectanglesEnabled();
+    gClip = currentFramebuffer->dirtyRectangle();
+#endif //PX_DIRTY_RECTANGLES
+    return PX_OK;
+  }
+
+  currentFramebuffer = fbo;
+  pxContextState contextState;
+  currentFramebuffer->currentState(contextState);
+  gAlpha = contextState.alpha;
+  gMatrix = contextState.matrix;
+
+#ifdef PX_DIRTY_RECTANGLES
+  gClipEnabled = currentFramebuffer->isDirtyRectanglesEnabled();
+  gClip = currentFramebuffer->dirtyRectangle();
+#endif //PX_DIRTY_RECTANGLES
+
+  return fbo->getTexture()->prepareForRendering();
+}
+
+void pxContext::enableDirtyRectangles(bool enable)
+{
+  currentFramebuffer->enableDirtyRectangles(enable);
+  gClipEnabled = enable;
+  gClip = currentFramebuffer->dirtyRectangle();
+}
+
+void pxContext::drawRect(float w, float h, float lineWidth, float* fillColor, float* lineColor)
+{
+#ifdef DEBUG_SKIP_RECT
+#warning "DEBUG_SKIP_RECT enabled ... Skipping "
+  return;
+#endif
+
+  // TRANSPARENT / DIMENSIONLESS
+  if(gAlpha == 0.0 || w <= 0.0 || h <= 0.0)
+  {
+    return;
+  }
+
+  // COLORLESS
+  if(fillColor == NULL && lineColor == NULL)
+  {
+    return;
+  }
+
+  // Fill ...
+  if(fillColor != NULL && fillColor[3] > 0.0) // with non-transparent color
+  {
+    float half = lineWidth/2;
+    drawRect2(half, half, w-lineWidth, h-lineWidth, fillColor);
+  }
+
+  // Frame ...
+  if(lineColor != NULL && lineColor[3] > 0.0 && lineWidth > 0) // with non-transparent color and non-zero stroke
+  {
+    drawRectOutline(0, 0, w, h, lineWidth, lineColor);
+  }
+}
+
+void pxContext::drawImage9(float w, float h, float x1, float y1,
+                           float x2, float y2, pxTextureRef texture)
+{
+#ifdef DEBUG_SKIP_IMAGE9
+#warning "DEBUG_SKIP_IMAGE9 enabled ... Skipping "
+  return;
+#endif
+
+  // TRANSPARENT / DIMENSIONLESS
+  if(gAlpha == 0.0 || w <= 0.0 || h <= 0.0)
+  {
+    return;
+  }
+
+  // TEXTURELESS
+  if (texture.getPtr() == NULL)
+  {
+    return;
+  }
+
+  drawImage92(0, 0, w, h, x1, y1, x2, y2, texture);
+}
+
+void pxContext::drawImage(float x, float y, float w, float h,
+                          pxTextureRef t, pxTextureRef mask,
+                          bool useTextureDimsAlways, float* color,
+                          pxConstantsStretch::constants stretchX,
+                          pxConstantsStretch::constants stretchY)
+{
+#ifdef DEBUG_SKIP_IMAGE
+#warning "DEBUG_SKIP_IMAGE enabled ... Skipping "
+  return;
+#endif
+
+  // TRANSPARENT / DIMENSIONLESS
+  if(gAlpha == 0.0 || w <= 0.0 || h <= 0.0)
+  {
+    return;
+  }
+
+  // TEXTURELESS
+  if (t.getPtr() == NULL)
+  {
+    return;
+  }
+
+  float black[4] = {0,0,0,1};
+  drawImageTexture(x, y, w, h, t, mask, useTextureDimsAlways,
+                  color? color : black, stretchX, stretchY);
+}
+
+void pxContext::drawDiagRect(float x, float y, float w, float h, float* color)
+{
+#ifdef DEBUG_SKIP_DIAG_RECT
+#warning "DEBUG_SKIP_DIAG_RECT enabled ... Skipping "
+   return;
+#endif
+
+  if (!mShowOutlines) return;
+
+  // TRANSPARENT / DIMENSIONLESS
+  if(gAlpha == 0.0 || w <= 0.0 || h <= 0.0)
+  {
+    rtLogError("cannot drawDiagRect() - width/height/gAlpha cannot be Zero.");
+    return;
+  }
+
+  // COLORLESS
+  if(color == NULL || color[3] == 0.0)
+  {
+    return;
+  }
+
+  drawRectOutline(x, y, w, h, 1, color);
+}
+
+void pxContext::drawDiagLine(float x1, float y1, float x2, float y2, float* color)
+{
+#ifdef DEBUG_SKIP_DIAG_LINE
+#warning "DEBUG_SKIP_DIAG_LINE enabled ... Skipping "
+   return;
+#endif
+
+  if (!mShowOutlines) return;
+
+  if(gAlpha == 0.0)
+  {
+    return; // TRANSPARENT
+  }
+
+  if(color == NULL || color[3] == 0.0)
+  {
+    return; // COLORLESS
+  }
+
+  // a one pixel wide quad along the line
+  float dx = x2-x1;
+  float dy = y2-y1;
+  float l = sqrt(dx*dx+dy*dy);
+  if (l == 0)
+    return;
+  float nx = -dy/l/2;
+  float ny = dx/l/2;
+
+  float colorPM[4];
+  premultiply(colorPM,color);
+
+  pxSwDraw d;
+  d.type = pxSwDraw::FILL;
+  d.color = toColor(colorPM);
+
+  const float* m = gMatrix.data();
+  float xs[4] = { x1+nx, x2+nx, x2-nx, x1-nx };
+  float ys[4] = { y1+ny, y2+ny, y2-ny, y1-ny };
+  for (int i = 0; i < 4; i++)
+  {
+    d.verts[i].x = m[0] * xs[i] + m[4] * ys[i] + m[12];
+    d.verts[i].y = m[1] * xs[i] + m[5] * ys[i] + m[13];
+  }
+  d.alpha = gAlpha;
+  d.clipped = gClipEnabled;
+  d.clip = gClip;
+  gRenderer.addDraw(d);
+}
+
+pxTextureRef pxContext::createTexture()
+{
+  pxTextureNone* noneTexture = new pxTextureNone();
+  return noneTexture;
+}
+
+pxTextureRef pxContext::createTexture(pxOffscreen& o)
+{
+  pxTextureOffscreen* offscreenTexture = new pxTextureOffscreen(o);
+  return offscreenTexture;
+}
+
+pxTextureRef pxContext::createTexture(float w, float h, float iw, float ih, void* buffer)
+{
+  pxTextureAlpha* alphaTexture = new pxTextureAlpha(w,h,iw,ih,buffer);
+  return alphaTexture;
+}
+
+void pxContext::pushState()
+{
+  pxContextState contextState;
+  contextState.matrix = gMatrix;
+  contextState.alpha = gAlpha;
+
+  currentFramebuffer->pushState(contextState);
+}
+
+void pxContext::popState()
+{
+  pxContextState contextState;
+  if (currentFramebuffer->popState(contextState) == PX_OK)
+  {
+    gAlpha = contextState.alpha;
+    gMatrix = contextState.matrix;
+  }
+
+  // the end of a frame
+  if (currentFramebuffer == defaultFramebuffer &&
+      currentFramebuffer->currentState(contextState) != PX_OK)
+  {
+    gRenderer.flush();
+  }
+}
+
+void pxContext::snapshot(pxOffscreen& o)
+{
+  gRenderer.flush();
+
+  o.init(gResW,gResH);
+  pxOffscreen* target = gRenderer.target();
+  if (target != NULL && target->base() != NULL)
+    target->blit(o);
+}
+
+void pxContext::mapToScreenCoordinates(float inX, float inY, int &outX, int &outY)
+{
+  pxVector4f positionVector(inX, inY, 0, 1);
+  pxVector4f positionCoords = gMatrix.multiply(positionVector);
+
+  if (positionCoords.w() == 0)
+  {
+    outX = positionCoords.x();
+    outY = positionCoords.y();
+  }
+  else
+  {
+    outX = positionCoords.x() / positionCoords.w();
+    outY = positionCoords.y() / positionCoords.w();
+  }
+}
+
+void pxContext::mapToScreenCoordinates(pxMatrix4f& m, float inX, float inY, int &outX, int &outY)
+{
+  pxVector4f positionVector(inX, inY, 0, 1);
+  pxVector4f positionCoords = m.multiply(positionVector);
+
+  if (positionCoords.w() == 0)
+  {
+    outX = positionCoords.x();
+    outY = positionCoords.y();
+  }
+  else
+  {
+    outX = positionCoords.x() / positionCoords.w();
+    outY = positionCoords.y() / positionCoords.w();
+  }
+}
+
+bool pxContext::isObjectOnScreen(float /*x*/, float /*y*/, float /*width*/, float /*height*/)
+{
+  return true;
+}
+
+void pxContext::adjustCurrentTextureMemorySize(int64_t changeInBytes)
+{
+  mCurrentTextureMemorySizeInBytes += changeInBytes;
+  if (mCurrentTextureMemorySizeInBytes < 0)
+  {
+    mCurrentTextureMemorySizeInBytes = 0;
+  }
+#ifdef ENABLE_PX_SCENE_TEXTURE_USAGE_MONITORING
+  if (changeInBytes > 0 && mCurrentTextureMemorySizeInBytes > mTextureMemoryLimitInBytes)
+  {
+    rtLogDebug("the texture size is too large: %" PRId64 ".  doing a garbage collect!!!\n", mCurrentTextureMemorySizeInBytes);
+#ifdef RUNINMAIN
+	script.memoryPressure(true);
+#else
+  uv_async_send(&gcTrigger);
+#endif
+  }
+#endif // ENABLE_PX_SCENE_TEXTURE_USAGE_MONITORING
+}
+
+void pxContext::setTextureMemoryLimit(int64_t textureMemoryLimitInBytes)
+{
+  mTextureMemoryLimitInBytes = textureMemoryLimitInBytes;
+}
+
+#ifdef ENABLE_PX_SCENE_TEXTURE_USAGE_MONITORING
+bool pxContext::isTextureSpaceAvailable(pxTextureRef texture)
+#else
+bool pxContext::isTextureSpaceAvailable(pxTextureRef)
+#endif
+{
+#ifdef ENABLE_PX_SCENE_TEXTURE_USAGE_MONITORING
+  int textureSize = (texture->width()*texture->height()*4);
+  if ((textureSize + mCurrentTextureMemorySizeInBytes) >
+             (mTextureMemoryLimitInBytes  + PXSCENE_DEFAULT_TEXTURE_MEMORY_LIMIT_THRESHOLD_PADDING_IN_BYTES))
+  {
+    return false;
+  }
+  else
+  {
+    return true;
+  }
+#endif //ENABLE_PX_SCENE_TEXTURE_USAGE_MONITORING
+  return true;
+}
+
+int64_t pxContext::currentTextureMemoryUsageInBytes()
+{
+  return mCurrentTextureMemorySizeInBytes;
+}
+
+// no residency here, textures stay until they're deleted
+void pxContext::endFrame()
+{
+}
+
+bool pxContext::evictTextures(int64_t bytes, uint32_t)
+{
+  return mCurrentTextureMemorySizeInBytes + bytes <= mTextureMemoryLimitInBytes;
+}
+
+void pxContext::setTextureEvictionAge(uint32_t)
+{
+}
+
+bool pxContext::texturesReady()
+{
+  return false;
+}
+
+void pxContext::textureResidencyStats(pxTextureResidencyStats& stats)
+{
+  stats = pxTextureResidencyStats();
+}
+
+void pxContext::setTextureUploadBudget(int64_t)
+{
+}
+
+void pxContext::textureUploadStats(pxTextureUploadStats& stats)
+{
+  stats = pxTextureUploadStats();
+}
+
+void pxContext::setFramebufferPoolAge(uint32_t)
+{
+}
+
+void pxContext::framebufferPoolStats(pxFramebufferPoolStats& stats)
+{
+  stats = pxFramebufferPoolStats();
+}
@@ -296,7 +296,8 @@ void pxFont::measureTextInternal(const char* text, uint32_t size,  float sx, flo
 
 void pxFont::renderText(const char *text, uint32_t size, float x, float y, 
                         float sx, float sy, 
-                        float* color, float mw) 
+                        float* color, float mw,
+                        std::vector<pxTextGlyph>* glyphs)
 {
   if (!text || !mInitialized)
   { 
@@ -324,6 +325,19 @@ void pxFont::renderText(const char *text, uint32_t size, float x, float y,
     
     if (codePoint != '\n')
     {
+      if (glyphs)
+      {
+        pxTextGlyph g;
+        g.texture = entry->mTexture;
+        g.x = x2;
+        g.y = y2;
+        g.w = w;
+        g.h = h;
+        glyphs->push_back(g);
+        x += (entry->advancedotx >> 6) * sx;
+        continue;
+      }
+
       if (x == 0) 
       {
         float c[4] = {0, 1, 0, 1};
@@ -346,6 +360,15 @@ void pxFont::renderText(const char *text, uint32_t size, float x, float y,
   }
 }
 
+void pxFont::drawGlyphs(const std::vector<pxTextGlyph>& glyphs, float* color)
+{
+  pxTextureRef nullImage;
+  for (std::vector<pxTextGlyph>::const_iterator it = glyphs.begin(); it != glyphs.end(); ++it)
+  {
+    context.drawImage(it->x, it->y, it->w, it->h, it->texture, nullImage, false, color);
+  }
+}
+
 void pxFont::measureTextChar(u_int32_t codePoint, uint32_t size,  float sx, float sy, 
                          float& w, float& h) 
 {
@@ -30,6 +30,7 @@
 
 #include "pxScene2d.h"
 #include <map>
+#include <vector>
 
 class pxText;
 class pxFont;
@@ -53,6 +54,17 @@ struct GlyphCacheEntry
   pxTextureRef mTexture;
 };
 
+// A glyph as renderText would draw it, for drawing the same text again
+// without laying it out
+struct pxTextGlyph
+{
+  pxTextureRef texture;
+  float x;
+  float y;
+  float w;
+  float h;
+};
+
 
 
 /**********************************************************************
@@ -162,9 +174,12 @@ public:
                    float& w, float& h);
   void measureTextChar(u_int32_t codePoint, uint32_t size,  float sx, float sy, 
                          float& w, float& h);                   
+  // With glyphs, adds the glyphs to it rather than drawing them
   void renderText(const char *text, uint32_t size, float x, float y, 
                   float sx, float sy, 
-                  float* color, float mw);
+                  float* color, float mw,
+                  std::vector<pxTextGlyph>* glyphs = NULL);
+  static void drawGlyphs(const std::vector<pxTextGlyph>& glyphs, float* color);
 
   virtual void init() {}
   bool isFontLoaded() { return mInitialized;}
@@ -211,6 +211,12 @@ void pxImage::resourceReady(rtString readyResolution)
   }
 }
 
+void pxImage::resourcePreview()
+{
+  // draw the preview texture, the promise waits for the whole image
+  mScene->mDirty = true;
+}
+
 void pxImage::dispose()
 {
   if (mListenerAdded)
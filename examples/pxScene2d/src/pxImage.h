@@ -64,6 +64,7 @@ public:
   rtError setResource(rtObjectRef o);
 
   virtual void resourceReady(rtString readyResolution);
+  virtual void resourcePreview();
   //virtual bool onTextureReady(pxTextureCacheObject* textureCacheObject) {return true;}
   // !CLF: To Do: These names are terrible... find better ones!
   virtual float getOnscreenWidth();
@@ -21,22 +21,183 @@
 #include "pxImageA.h"
 #include "pxContext.h"
 
+#include "rtThreadPool.h"
+#include "rtThreadTask.h"
+#include "rtMutex.h"
+
+#include <deque>
+
 extern pxContext context;
 
 //TODO UGH!!
 static pxTextureRef nullMaskRef;
 
+// Frames of an animated png, decoded on the thread pool into a few recycled
+// buffers just ahead of playback. Reference counted since a decode task can
+// still be running when the image lets go of it.
+class pxImageAFrameQueue
+{
+public:
+  struct Frame
+  {
+    pxOffscreen mOffscreen;
+    pxRect mDirty;
+    double mDuration;
+  };
+
+  pxImageAFrameQueue(): mRef(1), mDecoding(false), mStopped(false), mFailed(false) {}
+
+  unsigned long AddRef()
+  {
+    return rtAtomicInc(&mRef);
+  }
+
+  unsigned long Release()
+  {
+    unsigned long l = rtAtomicDec(&mRef);
+    if (l == 0)
+      delete this;
+    return l;
+  }
+
+  rtError init(const char* imageData, size_t imageDataSize)
+  {
+    rtError e = mDecoder.init(imageData, imageDataSize);
+    if (e == RT_OK)
+    {
+      for (int i = 0; i < kNumFrames; i++)
+        mFree.push_back(new Frame());
+    }
+    return e;
+  }
+
+  uint32_t width() const { return mDecoder.width(); }
+  uint32_t height() const { return mDecoder.height(); }
+  uint32_t numFrames() const { return mDecoder.numFrames(); }
+  uint32_t numPlays() const { return mDecoder.numPlays(); }
+
+  // i'th decoded frame not yet popped, NULL if the decoder hasn't got there.
+  // The frame stays put until it's popped
+  Frame* peek(size_t i)
+  {
+    rtMutexLockGuard lock(mMutex);
+    return i < mReady.size() ? mReady[i] : NULL;
+  }
+
+  void pop()
+  {
+    {
+      rtMutexLockGuard lock(mMutex);
+      if (mReady.empty())
+        return;
+      mFree.push_back(mReady.front());
+      mReady.pop_front();
+    }
+    fill();
+  }
+
+  bool failed()
+  {
+    rtMutexLockGuard lock(mMutex);
+    return mFailed;
+  }
+
+  void stop()
+  {
+    rtMutexLockGuard lock(mMutex);
+    mStopped = true;
+  }
+
+  // starts a decode task if there's an empty buffer and none is running
+  void fill()
+  {
+    {
+      rtMutexLockGuard lock(mMutex);
+      if (mDecoding || mStopped || mFailed || mFree.empty())
+        return;
+      mDecoding = true;
+    }
+    AddRef();
+    rtThreadPool::globalInstance()->executeTask(new rtThreadTask(decodeTask, this, ""));
+  }
+
+private:
+  static const int kNumFrames = 3;
+
+  ~pxImageAFrameQueue()
+  {
+    for (size_t i = 0; i < mReady.size(); i++)
+      delete mReady[i];
+    for (size_t i = 0; i < mFree.size(); i++)
+      delete mFree[i];
+  }
+
+  static void decodeTask(void* data)
+  {
+    pxImageAFrameQueue* q = (pxImageAFrameQueue*)data;
+    q->decode();
+    q->Release();
+  }
+
+  // only one decode task runs at a time, so the decoder and a frame taken
+  // off the free list belong to it outside the lock
+  void decode()
+  {
+    while (true)
+    {
+      Frame* f = NULL;
+      {
+        rtMutexLockGuard lock(mMutex);
+        if (mStopped || mFree.empty())
+        {
+          mDecoding = false;
+          return;
+        }
+        f = mFree.front();
+        mFree.pop_front();
+      }
+
+      rtError e = mDecoder.decodeFrame(f->mOffscreen, f->mDirty, f->mDuration);
+
+      rtMutexLockGuard lock(mMutex);
+      if (e != RT_OK)
+      {
+        mFree.push_back(f);
+        mFailed = true;
+        mDecoding = false;
+        return;
+      }
+      mReady.push_back(f);
+    }
+  }
+
+  pxAPNGDecoder mDecoder;
+  rtMutex mMutex;
+  std::deque<Frame*> mReady;
+  std::deque<Frame*> mFree;
+  rtAtomic mRef;
+  bool mDecoding;
+  bool mStopped;
+  bool mFailed;
+};
+
 pxImageA::pxImageA(pxScene2d *scene) : pxObject(scene), mStretchX(pxConstantsStretch::NONE), mStretchY(pxConstantsStretch::NONE)
 {
   mCurFrame = 0;
   mCachedFrame = UINT32_MAX;
   mFrameTime = -1;
   mPlays = 0;
+  mFrameQueue = NULL;
+  mNumFrames = 0;
+  mNumPlays = 0;
+  mFrameDuration = 0;
+  mFrameTextureIndex = 0;
 }
 
 pxImageA::~pxImageA()
 {
   gUIThreadQueue.removeAllTasksForObject(this);
+  releaseFrames();
 }
 
 void pxImageA::onInit() 
@@ -64,6 +225,13 @@ rtError pxImageA::setUrl(const char *s)
   mImageHeight = 0;
 
   mImageSequence.init();
+  releaseFrames();
+  mTexture = NULL;
+  for (int i = 0; i < kNumFrameTextures; i++)
+  {
+    mFrameTextures[i] = NULL;
+    mFrameTextureDirty[i].setEmpty();
+  }
   if (mURL)
   {
     // Since this object can be released before we get a async completion
@@ -90,6 +258,17 @@ void pxImageA::onDownloadComplete(rtFileDownloadRequest* downloadRequest)
       char* data;
       size_t dataSize;
       downloadRequest->downloadedData(data, dataSize);
+
+      // animated pngs are played from their compressed data
+      pxImageAFrameQueue* q = new pxImageAFrameQueue;
+      if (q->init(data, dataSize) == RT_OK && q->numFrames() > 1)
+      {
+        q->fill();
+        gUIThreadQueue.addTask(pxImageA::onFramesReadyUI, image, q);
+        return;
+      }
+      q->Release();
+
       pxTimedOffscreenSequence* s = new pxTimedOffscreenSequence;
 
       if (pxLoadAImage(data, dataSize, *s) == RT_OK)
@@ -134,11 +313,122 @@ void pxImageA::onDownloadCompleteUI(void* context, void* data)
   }
 }
 
+void pxImageA::onFramesReadyUI(void* context, void* data)
+{
+  pxImageA* image = (pxImageA*)context;
+  pxImageAFrameQueue* q = (pxImageAFrameQueue*)data;
+
+  if (image)
+  {
+    image->releaseFrames();
+    image->mFrameQueue = q;
+    image->mNumFrames = q->numFrames();
+    image->mNumPlays = q->numPlays();
+    image->mImageWidth = q->width();
+    image->mImageHeight = q->height();
+    image->mw = image->mImageWidth;
+    image->mh = image->mImageHeight;
+    image->mReady.send("resolve", image);
+
+    // Balancing explicit AddRef call
+    image->Release();
+  }
+  else if (q)
+    q->Release();
+}
+
+void pxImageA::releaseFrames()
+{
+  if (mFrameQueue)
+  {
+    mFrameQueue->stop();
+    mFrameQueue->Release();
+    mFrameQueue = NULL;
+  }
+}
+
+// plays whatever the decoder has ready. If it's fallen behind the current
+// frame is held rather than skipping ahead
+void pxImageA::updateFrames(double t)
+{
+  size_t consumed = 0;
+  pxRect dirty;
+  bool done = false;
+
+  while (mFrameTime < 0 || mFrameTime + mFrameDuration < t)
+  {
+    uint32_t next = (mFrameTime < 0) ? 0 : mCurFrame + 1;
+    if (next >= mNumFrames)
+    {
+      if (mNumPlays && mPlays >= mNumPlays)
+      {
+        done = true; // snap animation to last frame
+        break;
+      }
+      mPlays++;
+      next = 0;
+    }
+
+    pxImageAFrameQueue::Frame* f = mFrameQueue->peek(consumed);
+    if (!f)
+      break;
+
+    if (mFrameTime < 0)
+      mFrameTime = t;
+    else
+      mFrameTime += mFrameDuration;
+    mFrameDuration = f->mDuration;
+    mCurFrame = next;
+    dirty.unionRect(f->mDirty);
+    consumed++;
+  }
+
+  if (consumed > 0)
+  {
+    for (int i = 0; i < kNumFrameTextures; i++)
+      mFrameTextureDirty[i].unionRect(dirty);
+
+    mFrameTextureIndex = (mFrameTextureIndex + 1) % kNumFrameTextures;
+    pxTextureRef& texture = mFrameTextures[mFrameTextureIndex];
+    pxRect& stale = mFrameTextureDirty[mFrameTextureIndex];
+
+    pxOffscreen& o = mFrameQueue->peek(consumed - 1)->mOffscreen;
+    if (!texture.getPtr() ||
+        texture->updateTexture(o, stale.left(), stale.top(), stale.width(), stale.height()) != PX_OK)
+      texture = context.createTexture(o);
+    stale.setEmpty();
+    mTexture = texture;
+
+    while (consumed--)
+      mFrameQueue->pop();
+
+    pxRect r(0, 0, mImageWidth, mImageHeight);
+    mScene->invalidateRect(&r);
+  }
+
+  if (done || mFrameQueue->failed())
+  {
+    // the texture on screen is all that's needed from here on
+    releaseFrames();
+    for (int i = 0; i < kNumFrameTextures; i++)
+    {
+      if (i != mFrameTextureIndex)
+        mFrameTextures[i] = NULL;
+    }
+  }
+}
+
 // animation happens here
 void pxImageA::update(double t)
 {
   pxObject::update(t);
 
+  if (mFrameQueue)
+  {
+    updateFrames(t);
+    return;
+  }
+
   uint32_t numFrames = mImageSequence.numFrames();
 
   if (numFrames > 0)
@@ -173,7 +463,7 @@ void pxImageA::update(double t)
       pxOffscreen &o = mImageSequence.getFrameBuffer(mCurFrame);
       mTexture = context.createTexture(o);
       mCachedFrame = mCurFrame;
-      pxRect r(0, 0, mImageHeight, mImageWidth);
+      pxRect r(0, 0, mImageWidth, mImageHeight);
       mScene->invalidateRect(&r);
     }
   }
@@ -181,7 +471,7 @@ void pxImageA::update(double t)
 
 void pxImageA::draw()
 {
-  if (mImageSequence.numFrames() > 0)
+  if (mTexture.getPtr())
     context.drawImage(0, 0, mw, mh, mTexture, nullMaskRef, false, NULL, mStretchX, mStretchY);
 }
 
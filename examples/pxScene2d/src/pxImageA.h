@@ -26,6 +26,8 @@
 #include "rtFileDownloader.h"
 #include "pxUtil.h"
 
+class pxImageAFrameQueue;
+
 class pxImageA: public pxObject
 {
 public:
@@ -58,7 +60,11 @@ protected:
 
   static void onDownloadComplete(rtFileDownloadRequest* downloadRequest);
   static void onDownloadCompleteUI(void* context, void* data);
-  
+  static void onFramesReadyUI(void* context, void* data);
+
+  void updateFrames(double t);
+  void releaseFrames();
+
   pxTimedOffscreenSequence mImageSequence;
   uint32_t mCurFrame;
   uint32_t mCachedFrame;
@@ -69,6 +75,19 @@ protected:
 
   pxTextureRef mTexture;
 
+  // Animated pngs are decoded a few frames ahead of playback instead of all
+  // up front. Frames go into whichever texture of the ring wasn't drawn
+  // last, and only the part that changed since that texture was last
+  // updated is uploaded.
+  static const int kNumFrameTextures = 2;
+  pxImageAFrameQueue* mFrameQueue;
+  uint32_t mNumFrames;
+  uint32_t mNumPlays;
+  double mFrameDuration;
+  pxTextureRef mFrameTextures[kNumFrameTextures];
+  pxRect mFrameTextureDirty[kNumFrameTextures];
+  int mFrameTextureIndex;
+
   double mFrameTime;
   rtString mURL;
   pxConstantsStretch::constants mStretchX;
@@ -0,0 +1,356 @@
+/*
+
+ pxCore Copyright 2005-2017 John Robinson
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*/
+
+// pxImageBench.cpp
+//
+// Times pxLoadImage on whole images against the region decodes of
+// pxImageDecodeParams (a crop, scaled down, both) and prints the time to
+// first pixel: how long until a preview of a progressive jpeg or interlaced
+// png is ready, or the whole decode for anything else.  Checks that a crop
+// is the same as that part of the whole image and that decoding with a
+// preview ends with the same pixels.  With no images on the command line it
+// makes a 1920x1080 baseline and progressive jpeg and a plain and interlaced
+// png to run on.
+//
+//  ./pximage-bench [-n runs] [image ...]
+
+#include "pxCore.h"
+#include "pxOffscreen.h"
+#include "pxTimer.h"
+#include "pxUtil.h"
+#include "rtFile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <math.h>
+#include <string>
+#include <vector>
+
+#include <png.h>
+extern "C" {
+#include <jpeglib.h>
+}
+
+#define WIDTH 1920
+#define HEIGHT 1080
+
+struct benchImage
+{
+  std::string name;
+  std::vector<unsigned char> data;
+};
+
+// something with both smooth areas and detail, so the compressed sizes and
+// decode times look like a photo's more than a flat test pattern's
+static void makePicture(pxOffscreen& o)
+{
+  o.init(WIDTH, HEIGHT);
+  uint32_t noise = 1;
+  for (int y = 0; y < HEIGHT; y++)
+  {
+    pxPixel* p = o.scanline(y);
+    for (int x = 0; x < WIDTH; x++, p++)
+    {
+      noise = noise*1103515245 + 12345;
+      int n = (noise >> 16) & 15;
+      double d = sin(x/37.0) * cos(y/23.0);
+      p->r = (uint8_t)pxClamp<int>((int)(x*255/WIDTH + d*40) + n, 0, 255);
+      p->g = (uint8_t)pxClamp<int>((int)(y*255/HEIGHT + d*60) + n, 0, 255);
+      p->b = (uint8_t)pxClamp<int>(128 + (int)(d*100) + n, 0, 255);
+      p->a = 255;
+    }
+  }
+}
+
+static void encodeJPG(pxOffscreen& o, bool progressive, std::vector<unsigned char>& out)
+{
+  jpeg_compress_struct c;
+  jpeg_error_mgr e;
+  c.err = jpeg_std_error(&e);
+  jpeg_create_compress(&c);
+
+  unsigned char* data = NULL;
+  unsigned long size = 0;
+  jpeg_mem_dest(&c, &data, &size);
+  c.image_width = o.width();
+  c.image_height = o.height();
+  c.input_components = 3;
+  c.in_color_space = JCS_RGB;
+  jpeg_set_defaults(&c);
+  jpeg_set_quality(&c, 85, TRUE);
+  if (progressive)
+    jpeg_simple_progression(&c);
+  jpeg_start_compress(&c, TRUE);
+
+  std::vector<JSAMPLE> row(o.width()*3);
+  while (c.next_scanline < c.image_height)
+  {
+    pxPixel* p = o.scanline(c.next_scanline);
+    for (int x = 0; x < o.width(); x++, p++)
+    {
+      row[x*3] = p->r;
+      row[x*3+1] = p->g;
+      row[x*3+2] = p->b;
+    }
+    JSAMPROW r = &row[0];
+    jpeg_write_scanlines(&c, &r, 1);
+  }
+  jpeg_finish_compress(&c);
+  jpeg_destroy_compress(&c);
+
+  out.assign(data, data + size);
+  free(data);
+}
+
+static void writePNGData(png_structp png, png_bytep data, png_size_t length)
+{
+  std::vector<unsigned char>* out = (std::vector<unsigned char>*)png_get_io_ptr(png);
+  out->insert(out->end(), data, data + length);
+}
+
+static void encodePNG(pxOffscreen& o, bool interlaced, std::vector<unsigned char>& out)
+{
+  png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+  png_infop info = png_create_info_struct(png);
+  png_set_write_fn(png, &out, writePNGData, NULL);
+  png_set_IHDR(png, info, o.width(), o.height(), 8, PNG_COLOR_TYPE_RGB_ALPHA,
+               interlaced?PNG_INTERLACE_ADAM7:PNG_INTERLACE_NONE,
+               PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+  png_write_info(png, info);
+
+  std::vector<png_bytep> rows(o.height());
+  std::vector<png_byte> image(o.width()*o.height()*4);
+  for (int y = 0; y < o.height(); y++)
+  {
+    rows[y] = &image[y*o.width()*4];
+    pxPixel* p = o.scanline(y);
+    for (int x = 0; x < o.width(); x++, p++)
+    {
+      rows[y][x*4] = p->r;
+      rows[y][x*4+1] = p->g;
+      rows[y][x*4+2] = p->b;
+      rows[y][x*4+3] = p->a;
+    }
+  }
+  png_write_image(png, &rows[0]);
+  png_write_end(png, NULL);
+  png_destroy_write_struct(&png, &info);
+}
+
+struct previewTimer
+{
+  double start;
+  double first;
+};
+
+static void onPreview(void* context, pxOffscreen&)
+{
+  previewTimer* t = (previewTimer*)context;
+  if (t->first < 0)
+    t->first = pxMilliseconds() - t->start;
+}
+
+// best of a few runs, the machine may be busy
+static double timeDecode(const benchImage& image, const pxImageDecodeParams& params,
+                         int runs, pxOffscreen& o)
+{
+  double ms = 0;
+  for (int r = 0; r < runs; r++)
+  {
+    double start = pxMilliseconds();
+    if (pxLoadImage((const char*)&image.data[0], image.data.size(), o, params) != RT_OK)
+      return -1;
+    double t = pxMilliseconds() - start;
+    if (r == 0 || t < ms)
+      ms = t;
+  }
+  return ms;
+}
+
+static bool sameRegion(pxOffscreen& whole, pxOffscreen& part, int left, int top)
+{
+  for (int y = 0; y < part.height(); y++)
+  {
+    if (memcmp(whole.scanline(top + y) + left, part.scanline(y), part.width()*4))
+      return false;
+  }
+  return true;
+}
+
+struct regionCase
+{
+  const char* name;
+  // fractions of the image
+  double left, top, right, bottom;
+  int32_t scale;
+};
+
+static const regionCase regions[] =
+{
+  { "center quarter",          0.25, 0.25, 0.75, 0.75, 1 },
+  { "bottom right sixteenth",  0.75, 0.75, 1.00, 1.00, 1 },
+  { "scale 1/2",               0,    0,    0,    0,    2 },
+  { "scale 1/4",               0,    0,    0,    0,    4 },
+  { "scale 1/8",               0,    0,    0,    0,    8 },
+  { "center quarter 1/4",      0.25, 0.25, 0.75, 0.75, 4 },
+};
+
+int main(int argc, char* argv[])
+{
+  int runs = 5;
+  int c;
+  while ((c = getopt(argc, argv, "n:")) != -1)
+  {
+    switch (c)
+    {
+      case 'n': runs = atoi(optarg); break;
+      default:
+        fprintf(stderr, "usage: %s [-n runs] [image ...]\n", argv[0]);
+        return 1;
+    }
+  }
+  if (runs < 1)
+    runs = 1;
+
+  std::vector<benchImage> images;
+  for (int i = optind; i < argc; i++)
+  {
+    rtData d;
+    if (rtLoadFile(argv[i], d) != RT_OK)
+    {
+      fprintf(stderr, "could not read %s\n", argv[i]);
+      return 1;
+    }
+    benchImage image;
+    image.name = argv[i];
+    image.data.assign(d.data(), d.data() + d.length());
+    images.push_back(image);
+  }
+  if (images.empty())
+  {
+    pxOffscreen picture;
+    makePicture(picture);
+    const char* names[] = { "baseline jpg", "progressive jpg", "png", "interlaced png" };
+    for (int i = 0; i < 4; i++)
+    {
+      benchImage image;
+      image.name = names[i];
+      if (i < 2)
+        encodeJPG(picture, i == 1, image.data);
+      else
+        encodePNG(picture, i == 3, image.data);
+      images.push_back(image);
+    }
+  }
+
+  printf("best of %d runs\n\n", runs);
+
+  int failed = 0;
+  for (size_t i = 0; i < images.size(); i++)
+  {
+    const benchImage& image = images[i];
+
+    pxOffscreen whole;
+    double wholeMs = timeDecode(image, pxImageDecodeParams(), runs, whole);
+    if (wholeMs < 0)
+    {
+      fprintf(stderr, "could not decode %s\n", image.name.c_str());
+      failed++;
+      continue;
+    }
+    printf("%s, %d bytes, %dx%d\n", image.name.c_str(), (int)image.data.size(),
+           whole.width(), whole.height());
+    printf("  %-24s %8.2f ms  %8d KB\n", "whole image", wholeMs,
+           (int)(whole.sizeInBytes()/1024));
+
+    // time to first pixel
+    double firstMs = 0, previewWholeMs = 0;
+    bool same = true, hasPreview = false;
+    for (int r = 0; r < runs; r++)
+    {
+      pxOffscreen o;
+      previewTimer t;
+      t.start = pxMilliseconds();
+      t.first = -1;
+      if (pxLoadImage((const char*)&image.data[0], image.data.size(), o,
+                      pxImageDecodeParams(), onPreview, &t) != RT_OK)
+      {
+        same = false;
+        break;
+      }
+      double total = pxMilliseconds() - t.start;
+      hasPreview = t.first >= 0;
+      double first = hasPreview?t.first:total;
+      if (r == 0 || first < firstMs)
+        firstMs = first;
+      if (r == 0 || total < previewWholeMs)
+        previewWholeMs = total;
+      if (r == 0)
+        same = o.width() == whole.width() && o.height() == whole.height() &&
+               memcmp(o.base(), whole.base(), o.sizeInBytes()) == 0;
+    }
+    if (hasPreview)
+    {
+      printf("  %-24s %8.2f ms  %5.2fx sooner%s\n", "first pixel (preview)",
+             firstMs, wholeMs/firstMs, same?"":"  MISMATCH");
+      printf("  %-24s %8.2f ms\n", "whole image with preview", previewWholeMs);
+    }
+    else
+      printf("  %-24s %8.2f ms%s\n", "first pixel (no preview)", firstMs,
+             same?"":"  MISMATCH");
+    if (!same)
+      failed++;
+
+    for (size_t j = 0; j < sizeof(regions)/sizeof(regions[0]); j++)
+    {
+      const regionCase& rc = regions[j];
+      pxImageDecodeParams params;
+      params.crop.setLTRB((int32_t)(rc.left*whole.width()), (int32_t)(rc.top*whole.height()),
+                          (int32_t)(rc.right*whole.width()), (int32_t)(rc.bottom*whole.height()));
+      params.scale = rc.scale;
+
+      pxOffscreen o;
+      double ms = timeDecode(image, params, runs, o);
+      if (ms < 0)
+      {
+        printf("  %-24s failed\n", rc.name);
+        failed++;
+        continue;
+      }
+
+      pxRect crop = params.crop;
+      if (crop.isEmpty())
+        crop.setLTRB(0, 0, whole.width(), whole.height());
+      int s = rc.scale;
+      bool ok = o.width() == (crop.right() + s - 1)/s - crop.left()/s &&
+                o.height() == (crop.bottom() + s - 1)/s - crop.top()/s;
+      if (ok && s == 1)
+        ok = sameRegion(whole, o, crop.left(), crop.top());
+
+      printf("  %-24s %8.2f ms  %8d KB  %5.2fx%s\n", rc.name, ms,
+             (int)(o.sizeInBytes()/1024), wholeMs/ms, ok?"":"  MISMATCH");
+      if (!ok)
+        failed++;
+    }
+    printf("\n");
+  }
+
+  return failed?1:0;
+}
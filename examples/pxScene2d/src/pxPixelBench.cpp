@@ -0,0 +1,329 @@
+/*
+
+ pxCore Copyright 2005-2017 John Robinson
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*/
+
+// pxPixelBench.cpp
+//
+// Runs every pixel conversion in pxPixelConvert.h over a 1920x1080 image,
+// once for every implementation this cpu supports, and prints the best
+// throughput over a few runs in MB/s of pixels written.  Checks that each
+// implementation writes exactly what the scalar one does, for all 256x256
+// color and alpha pairs and for every length up to a few vectors.  Images
+// given on the command line are decoded with pxLoadImage the same way.
+//
+//  ./pxpixel-bench [-n runs] [image ...]
+
+#include "pxCore.h"
+#include "pxOffscreen.h"
+#include "pxTimer.h"
+#include "pxUtil.h"
+#include "pxPixelConvert.h"
+#include "rtFile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <vector>
+
+#define WIDTH 1920
+#define HEIGHT 1080
+
+enum benchOp
+{
+  RGB_TO_RGBA,
+  RGB_TO_BGRA,
+  SWAP_RB,
+  PREMULTIPLY_OPAQUE,
+  PREMULTIPLY,
+  BLEND_OVER
+};
+
+struct benchCase
+{
+  const char* name;
+  benchOp op;
+};
+
+static const benchCase cases[] =
+{
+  { "rgb to rgba",              RGB_TO_RGBA },
+  { "rgb to bgra",              RGB_TO_BGRA },
+  { "swap red and blue",        SWAP_RB },
+  { "premultiply opaque",       PREMULTIPLY_OPAQUE },
+  { "premultiply translucent",  PREMULTIPLY },
+  { "blend over",               BLEND_OVER },
+};
+
+struct benchData
+{
+  std::vector<uint8_t> rgb;
+  std::vector<uint32_t> opaque;
+  std::vector<uint32_t> translucent;
+  // a frame of an animation, opaque and clear areas with soft edges
+  std::vector<uint32_t> frame;
+};
+
+static uint32_t pixel(uint8_t r, uint8_t g, uint8_t b, uint8_t a)
+{
+  uint32_t p;
+  uint8_t* c = (uint8_t*)&p;
+  c[0] = r; c[1] = g; c[2] = b; c[3] = a;
+  return p;
+}
+
+static void makeData(benchData& data, int n)
+{
+  data.rgb.resize(n*3);
+  data.opaque.resize(n);
+  data.translucent.resize(n);
+  data.frame.resize(n);
+  for (int i = 0; i < n; i++)
+  {
+    int x = i % WIDTH, y = i / WIDTH;
+    data.rgb[i*3] = x;
+    data.rgb[i*3+1] = y;
+    data.rgb[i*3+2] = x ^ y;
+    data.opaque[i] = pixel(x, y, x ^ y, 255);
+    data.translucent[i] = pixel(x, y, x ^ y, (x + y) & 0xff);
+    int d = (x % 256) - 128;
+    uint8_t a = (d < -8)?255:(d > 8)?0:(uint8_t)((8 - d)*255/16);
+    data.frame[i] = pixel(y, x, 128, a);
+  }
+}
+
+static void run(const pxConvertKernels& k, benchOp op, const benchData& data,
+                uint32_t* d, int n)
+{
+  switch (op)
+  {
+    case RGB_TO_RGBA: k.rgbToRgba(d, &data.rgb[0], n); break;
+    case RGB_TO_BGRA: k.rgbToBgra(d, &data.rgb[0], n); break;
+    case SWAP_RB: k.swapRB(d, &data.translucent[0], n); break;
+    case PREMULTIPLY_OPAQUE: k.premultiply(d, &data.opaque[0], n); break;
+    case PREMULTIPLY: k.premultiply(d, &data.translucent[0], n); break;
+    case BLEND_OVER:
+      // over a translucent background, so every path through it is taken
+      memcpy(d, &data.translucent[0], n*4);
+      k.blendOver(d, &data.frame[0], n);
+      break;
+  }
+}
+
+// Every color against every alpha, then every length up to 80 pixels at
+// every offset into a vector
+static bool check(const pxConvertKernels& k, const pxConvertKernels& scalar)
+{
+  std::vector<uint32_t> all(256*256);
+  for (int a = 0; a < 256; a++)
+  {
+    for (int c = 0; c < 256; c++)
+      all[a*256 + c] = pixel(c, 255 - c, c ^ a, a);
+  }
+  std::vector<uint32_t> e(all.size()), r(all.size());
+  scalar.premultiply(&e[0], &all[0], all.size());
+  k.premultiply(&r[0], &all[0], all.size());
+  if (e != r)
+    return false;
+  r = all;
+  k.premultiply(&r[0], &r[0], r.size());
+  if (e != r)
+    return false;
+
+  std::vector<uint32_t> over(all.size());
+  for (size_t i = 0; i < over.size(); i++)
+    over[i] = all[(i*7919) % all.size()];
+  e = all;
+  r = all;
+  scalar.blendOver(&e[0], &over[0], over.size());
+  k.blendOver(&r[0], &over[0], over.size());
+  if (e != r)
+    return false;
+
+  benchData data;
+  makeData(data, 96);
+  const benchOp ops[] = { RGB_TO_RGBA, RGB_TO_BGRA, SWAP_RB, PREMULTIPLY, BLEND_OVER };
+  for (size_t o = 0; o < sizeof(ops)/sizeof(ops[0]); o++)
+  {
+    for (int offset = 0; offset < 8; offset++)
+    {
+      for (int n = 0; n <= 80; n++)
+      {
+        uint32_t eb[96], rb[96];
+        memset(eb, 0xa5, sizeof(eb));
+        memset(rb, 0xa5, sizeof(rb));
+        run(scalar, ops[o], data, eb + offset, n);
+        run(k, ops[o], data, rb + offset, n);
+        if (memcmp(eb, rb, sizeof(eb)))
+          return false;
+      }
+    }
+  }
+  return true;
+}
+
+static bool loadImage(const char* file, rtData& d)
+{
+  if (rtLoadFile(file, d) != RT_OK)
+  {
+    fprintf(stderr, "could not read %s\n", file);
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  int runs = 10;
+  int c;
+  while ((c = getopt(argc, argv, "n:")) != -1)
+  {
+    switch (c)
+    {
+      case 'n': runs = atoi(optarg); break;
+      default:
+        fprintf(stderr, "usage: %s [-n runs] [image ...]\n", argv[0]);
+        return 1;
+    }
+  }
+  if (runs < 1)
+    runs = 1;
+
+  int n = WIDTH*HEIGHT;
+  benchData data;
+  makeData(data, n);
+  std::vector<uint32_t> reference(n), out(n);
+
+  const pxConvertImpl best = pxConvertGetImpl();
+  pxConvertSetImpl(pxConvertImplScalar);
+  const pxConvertKernels& scalar = pxConvert();
+
+  printf("%dx%d, best of %d runs, MB/s of pixels written\n\n", WIDTH, HEIGHT, runs);
+
+  int failed = 0;
+  for (int impl = pxConvertImplScalar + 1; impl < pxConvertImplCount; impl++)
+  {
+    if (!pxConvertSetImpl((pxConvertImpl)impl))
+      continue;
+    bool same = check(pxConvert(), scalar);
+    printf("%-8s exhaustive check %s\n", pxConvertImplName((pxConvertImpl)impl),
+           same?"ok":"MISMATCH");
+    if (!same)
+      failed++;
+  }
+  printf("\n");
+
+  for (size_t i = 0; i < sizeof(cases)/sizeof(cases[0]); i++)
+  {
+    const benchCase& bc = cases[i];
+    printf("%s\n", bc.name);
+
+    double scalarRate = 0;
+    for (int impl = pxConvertImplScalar; impl < pxConvertImplCount; impl++)
+    {
+      if (!pxConvertSetImpl((pxConvertImpl)impl))
+        continue;
+      const pxConvertKernels& k = pxConvert();
+
+      run(k, bc.op, data, &out[0], n);
+      bool same = true;
+      if (impl == pxConvertImplScalar)
+        reference = out;
+      else
+        same = reference == out;
+
+      // best of a few runs, the machine may be busy
+      double ms = 0;
+      for (int r = 0; r < runs; r++)
+      {
+        double start = pxMilliseconds();
+        run(k, bc.op, data, &out[0], n);
+        double t = pxMilliseconds() - start;
+        if (r == 0 || t < ms)
+          ms = t;
+      }
+      double rate = (n*4.0/(1024*1024)) / (pxMax<double>(ms, 0.001)/1000);
+      if (impl == pxConvertImplScalar)
+        scalarRate = rate;
+
+      printf("  %-8s %8.2f ms  %8.0f MB/s  %5.2fx%s\n",
+             pxConvertImplName((pxConvertImpl)impl), ms, rate, rate/scalarRate,
+             same?"":"  MISMATCH");
+      if (!same)
+        failed++;
+    }
+  }
+
+  // whole loads, decode included
+  for (int i = optind; i < argc; i++)
+  {
+    rtData file;
+    if (!loadImage(argv[i], file))
+    {
+      failed++;
+      continue;
+    }
+    printf("%s\n", argv[i]);
+
+    pxOffscreen first;
+    double scalarRate = 0;
+    for (int impl = pxConvertImplScalar; impl < pxConvertImplCount; impl++)
+    {
+      if (!pxConvertSetImpl((pxConvertImpl)impl))
+        continue;
+
+      pxOffscreen o;
+      double ms = 0;
+      for (int r = 0; r < runs; r++)
+      {
+        double start = pxMilliseconds();
+        if (pxLoadImage((const char*)file.data(), file.length(), o) != RT_OK)
+        {
+          fprintf(stderr, "could not decode %s\n", argv[i]);
+          break;
+        }
+        o.freeCompressedData();
+        double t = pxMilliseconds() - start;
+        if (r == 0 || t < ms)
+          ms = t;
+      }
+      if (!o.base())
+      {
+        failed++;
+        break;
+      }
+
+      bool same = true;
+      if (impl == pxConvertImplScalar)
+        first = o;
+      else
+        same = memcmp(first.base(), o.base(), o.sizeInBytes()) == 0;
+
+      double rate = (o.sizeInBytes()/(1024.0*1024)) / (pxMax<double>(ms, 0.001)/1000);
+      if (impl == pxConvertImplScalar)
+        scalarRate = rate;
+      printf("  %-8s %8.2f ms  %8.0f MB/s  %5.2fx%s\n",
+             pxConvertImplName((pxConvertImpl)impl), ms, rate, rate/scalarRate,
+             same?"":"  MISMATCH");
+      if (!same)
+        failed++;
+    }
+  }
+
+  pxConvertSetImpl(best);
+  return failed?1:0;
+}
@@ -144,6 +144,17 @@ void pxResource::notifyListeners(rtString readyResolution)
   mListenersMutex.unlock();
   
 }
+void pxResource::notifyListenersPreview()
+{
+  mListenersMutex.lock();
+  for (list<pxResourceListener*>::iterator it = mListeners.begin();
+         it != mListeners.end(); ++it)
+  {
+    (*it)->resourcePreview();
+  }
+  mListenersMutex.unlock();
+}
+
 void pxResource::raiseDownloadPriority()
 {
   if (!priorityRaised && !mUrl.isEmpty() && mDownloadRequest != NULL)
@@ -199,6 +210,7 @@ void rtImageResource::init()
 int32_t rtImageResource::w() const 
 { 
   //rtLogDebug("tImageResource::w()\n");
+  rtMutexLockGuard lock(mTextureMutex);
   if(mTexture.getPtr())  
     return mTexture->width(); 
   else 
@@ -207,15 +219,13 @@ int32_t rtImageResource::w() const
 rtError rtImageResource::w(int32_t& v) const 
 { 
   //rtLogDebug("tImageResource::w(int32_t)\n");
-  if(mTexture.getPtr()) 
-    v = mTexture->width(); 
-  else  
-    v = 0;  
+  v = w();
   return RT_OK; 
 }
 int32_t rtImageResource::h() const 
 { 
   //rtLogDebug("tImageResource::h()\n");
+  rtMutexLockGuard lock(mTextureMutex);
   if(mTexture.getPtr())
     return mTexture->height(); 
   else 
@@ -224,13 +234,31 @@ int32_t rtImageResource::h() const
 rtError rtImageResource::h(int32_t& v) const 
 { 
   //rtLogDebug("tImageResource::h(int32_t)\n");
-  if(mTexture.getPtr())
-    v = mTexture->height(); 
-  else 
-    v = 0;
+  v = h();
   return RT_OK; 
 } 
 
+static void releaseTextureUI(void* texture, void* /*data*/)
+{
+  ((pxTexture*)texture)->Release();
+}
+
+// A preview texture may have been drawn, so it's released on the UI thread
+// along with its gl texture
+void rtImageResource::setTexture(pxTextureRef texture)
+{
+  pxTexture* previous;
+  {
+    rtMutexLockGuard lock(mTextureMutex);
+    previous = mTexture.getPtr();
+    if (previous)
+      previous->AddRef();
+    mTexture = texture;
+  }
+  if (previous)
+    gUIThreadQueue.addTask(releaseTextureUI, previous, NULL);
+}
+
 /** 
  * rtImageResource::loadResource()
  * 
@@ -298,7 +326,7 @@ void rtImageResource::loadResourceFromFile()
   else
   {
     // create offscreen texture for local image
-    mTexture = context.createTexture(imageOffscreen);
+    setTexture(context.createTexture(imageOffscreen));
     mLoadStatus.set("statusCode",0);
     // Since this object can be released before we get a async completion
     // We need to maintain this object's lifetime
@@ -324,17 +352,39 @@ void pxResource::onDownloadComplete(rtFileDownloadRequest* fileDownloadRequest)
   }
 }
 
+// Called on the download thread partway through decoding a progressive jpeg
+// or an interlaced png.  The preview is drawn until the whole image is ready
+void rtImageResource::onPreview(void* resource, pxOffscreen& preview)
+{
+  rtImageResource* res = (rtImageResource*)resource;
+  res->setTexture(context.createTexture(preview));
+  // Since this object can be released before we get a async completion
+  // We need to maintain this object's lifetime
+  res->AddRef();
+  gUIThreadQueue.addTask(onPreviewUI, res, NULL);
+}
+
+void rtImageResource::onPreviewUI(void* context, void* /*data*/)
+{
+  rtImageResource* res = (rtImageResource*)context;
+  res->notifyListenersPreview();
+  res->Release();
+}
+
 bool rtImageResource::loadResourceData(rtFileDownloadRequest* fileDownloadRequest)
 {
       pxOffscreen imageOffscreen;
       if (pxLoadImage(fileDownloadRequest->downloadedData(),
                       fileDownloadRequest->downloadedDataSize(),
-                      imageOffscreen) == RT_OK)
+                      imageOffscreen, pxImageDecodeParams(),
+                      onPreview, this) == RT_OK)
       {
-        mTexture = context.createTexture(imageOffscreen);
+        setTexture(context.createTexture(imageOffscreen));
         return true;
       }
-      
+
+      // don't leave a preview of an image that failed to decode
+      setTexture(pxTextureRef());
       return false;
 }
 /** pxResource processDownloadedResource */
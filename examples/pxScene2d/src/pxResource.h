@@ -50,6 +50,9 @@ class pxResourceListener
 {
 public: 
   virtual void resourceReady(rtString readyResolution) = 0;
+  // A coarse version of the resource can be shown until it's ready.  Called
+  // on the UI thread
+  virtual void resourcePreview() {}
 };
 
 class pxResource : public rtObject
@@ -97,6 +100,7 @@ protected:
   virtual bool loadResourceData(rtFileDownloadRequest* fileDownloadRequest) = 0;
   
   void notifyListeners(rtString readyResolution);
+  void notifyListenersPreview();
 
   virtual void loadResourceFromFile() = 0;
 
@@ -130,7 +134,12 @@ public:
   int32_t h() const;
   rtError h(int32_t& v) const; 
 
-  pxTextureRef getTexture() { return mTexture; }  
+  // The decoder thread can replace a preview texture while it's drawn
+  pxTextureRef getTexture()
+  {
+    rtMutexLockGuard lock(mTextureMutex);
+    return mTexture;
+  }
  
   virtual void init();
 
@@ -140,7 +149,12 @@ protected:
 private: 
 
   void loadResourceFromFile();
+  void setTexture(pxTextureRef texture);
+  static void onPreview(void* resource, pxOffscreen& preview);
+  static void onPreviewUI(void* context, void* data);
+
   pxTextureRef mTexture;
+  mutable rtMutex mTextureMutex;
  
 };
 
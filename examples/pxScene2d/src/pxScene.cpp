@@ -246,6 +246,10 @@ EXITSCENELOCK()
     EXITSCENELOCK()
 #ifdef RUNINMAIN
     script.pump();
+    // the next app's context, while there's nothing else to do
+    script.warmContextPool();
+    // and then the garbage collector, until the next frame is due
+    script.idleGarbageCollect();
 #endif
   }
 
@@ -341,6 +345,10 @@ int pxMain(int argc, char* argv[])
 #ifdef RUNINMAIN
   script.initializeNode();
 #endif
+#endif
+#ifdef RUNINMAIN
+  // pooled contexts have run init.js already, see pxScriptView::runScript
+  script.setContextPool(script.contextPoolSize(), "init.js");
 #endif
   char buffer[256];
   sprintf(buffer, "pxscene: %s", xstr(PX_SCENE_VERSION));
@@ -474,8 +474,9 @@ rtError pxObject::animateTo(const char* prop, double to, double duration,
 // the set* method anyway.
 void pxObject::cancelAnimation(const char* prop, bool fastforward, bool rewind, bool resolve)
 {
-  if (!mCancelInSet)
+  if (!mCancelInSet || mAnimations.empty())
     return;
+  rtAtom name = rtAtom::find(prop);
   bool f = mCancelInSet;
   // Do not reenter
   mCancelInSet = false;
@@ -485,7 +486,7 @@ void pxObject::cancelAnimation(const char* prop, bool fastforward, bool rewind,
   while (it != mAnimations.end())
   {
     animation& a = (*it);
-    if (!a.cancelled && a.prop == prop)
+    if (!a.cancelled && (a.atom.isNull() ? strcmp(a.prop.cString(), prop) == 0 : a.atom == name))
     {
       // Fastforward or rewind, if specified
       if( fastforward)
@@ -534,6 +535,7 @@ void pxObject::animateToInternal(const char* prop, double to, double duration,
 
   a.cancelled = false;
   a.prop     = prop;
+  a.atom     = rtAtom::find(prop);
   a.from     = get<float>(prop);
   a.to       = to;
   a.start    = -1;
@@ -587,11 +589,11 @@ void pxObject::update(double t)
       // TODO this sort of blows since this triggers another
       // animation traversal to cancel animations
 #if 0
-      cancelAnimation(a.prop, true, false, true);
+      cancelAnimation(a.prop.cString(), true, false, true);
 #else
       assert(mCancelInSet);
       mCancelInSet = false;
-      set(a.prop, a.to);
+      set(a.prop.cString(), a.to);
       mCancelInSet = true;
 
       if (a.count != pxConstantsAnimation::COUNT_FOREVER && a.actualCount >= a.count )
@@ -645,7 +647,7 @@ void pxObject::update(double t)
       // Prevent one more loop through oscillate
       if(a.count != pxConstantsAnimation::COUNT_FOREVER && a.actualCount >= a.count )
       {
-        cancelAnimation(a.prop, false, false, true);
+        cancelAnimation(a.prop.cString(), false, false, true);
         it = mAnimations.erase(it);
         continue;
       }
@@ -655,7 +657,7 @@ void pxObject::update(double t)
     float v = from + (to - from) * d;
     assert(mCancelInSet);
     mCancelInSet = false;
-    set(a.prop, v);
+    set(a.prop.cString(), v);
     mCancelInSet = true;
     ++it;
   }
@@ -681,10 +683,8 @@ void pxObject::update(double t)
 #ifdef PX_DIRTY_RECTANGLES
     context.pushState();
 #endif //PX_DIRTY_RECTANGLES
-// JR TODO  this lock looks suspicious... why do we need it?
-ENTERSCENELOCK()
+    // the top scene's onUpdate holds the scene lock for the whole tree
     (*it)->update(t);
-EXITSCENELOCK()
 #ifdef PX_DIRTY_RECTANGLES
     context.popState();
 #endif //PX_DIRTY_RECTANGLES
@@ -1252,7 +1252,7 @@ rtDefineObject(pxRoot,pxObject);
 int gTag = 0;
 
 pxScene2d::pxScene2d(bool top)
-  : start(0), sigma_draw(0), sigma_update(0), frameCount(0), mContainer(NULL), mShowDirtyRectangle(false), mTestView(NULL)
+  : start(0), sigma_draw(0), sigma_update(0), mLastDrawSeconds(0), frameCount(0), mContainer(NULL), mShowDirtyRectangle(false), mTestView(NULL)
 {
   mRoot = new pxRoot(this);
   mFocusObj = mRoot;
@@ -1451,6 +1451,39 @@ rtError pxScene2d::clock(uint64_t & time)
 
   return RT_OK;
 }
+rtError pxScene2d::textureMemory(rtObjectRef& o)
+{
+  pxTextureResidencyStats stats;
+  context.textureResidencyStats(stats);
+
+  rtObjectRef m = new rtMapObject;
+  m.set("used", context.currentTextureMemoryUsageInBytes());
+  m.set("residentTextures", stats.residentTextures);
+  m.set("residentBytes", stats.residentBytes);
+  m.set("evictedTextures", stats.evictedTextures);
+  m.set("evictions", stats.evictions);
+  m.set("reloads", stats.reloads);
+
+  pxTextureUploadStats upload;
+  context.textureUploadStats(upload);
+  m.set("uploadBudget", upload.budget);
+  m.set("frameUploadBytes", upload.frameBytes);
+  m.set("frameUploadMs", upload.frameMs);
+  m.set("frameUploadsDeferred", upload.frameDeferred);
+  m.set("maxFrameUploadBytes", upload.maxFrameBytes);
+  m.set("maxFrameUploadMs", upload.maxFrameMs);
+
+  pxFramebufferPoolStats pool;
+  context.framebufferPoolStats(pool);
+  m.set("framebuffersAllocated", pool.allocated);
+  m.set("framebuffersReused", pool.reused);
+  m.set("framebuffersPooled", pool.pooled);
+  m.set("framebufferPoolBytes", pool.pooledBytes);
+  o = m;
+
+  return RT_OK;
+}
+
 rtError pxScene2d::createExternal(rtObjectRef p, rtObjectRef& o)
 {
   rtRef<pxViewContainer> c = new pxViewContainer(this);
@@ -1517,9 +1550,7 @@ void pxScene2d::draw()
   {
     context.pushState();
 
-ENTERSCENELOCK()
     mRoot->drawInternal(true);
-EXITSCENELOCK()
     context.popState();
     mDirtyRect.setEmpty();
   }
@@ -1551,9 +1582,7 @@ EXITSCENELOCK()
   {
     pxMatrix4f m;
     context.pushState();
-ENTERSCENELOCK()
     mRoot->drawInternal(true); // mask it !
-EXITSCENELOCK()
     context.popState();
   }
   #endif //PX_DIRTY_RECTANGLES
@@ -1604,6 +1633,10 @@ void pxScene2d::onUpdate(double t)
 
   sigma_update += (pxSeconds() - start_frame); //##
 
+  // textures that draws skipped are ready, or have more to upload
+  if (mTop && context.texturesReady())
+    mDirty = true;
+
   if (mDirty)
   {
     mDirty = false;
@@ -1613,6 +1646,15 @@ void pxScene2d::onUpdate(double t)
   // TODO get rid of mTop somehow
   if (mTop)
   {
+#ifdef ENABLE_RT_NODE
+    // what's left of this frame, less drawing it, can go to the garbage
+    // collector.  Textures filling up means a collection is due before
+    // the limit is hit and one has to happen right away.
+    script.setFrameDeadline(start_frame + 1.0/60 - mLastDrawSeconds);
+    if (context.currentTextureMemoryUsageInBytes() > context.textureMemoryLimitInBytes()/4*3)
+      script.memoryPressure(false);
+#endif //ENABLE_RT_NODE
+
     unsigned int target_frame_ms = 60;
     int targetFPS = (1.0 / ((double) target_frame_ms)) * 1000;
 
@@ -1652,6 +1694,36 @@ void pxScene2d::onUpdate(double t)
     // for accessing the values (events would be the primary usecase)
     rtObjectRef e = new rtMapObject;
     e.set("fps", fps);
+#ifdef ENABLE_RT_NODE
+    // how much of that second the scene lock was held and waited for
+    if (rtWrapperSceneLockStatsEnabled())
+    {
+      rtWrapperSceneLockStats lock;
+      rtWrapperSceneLockStatsCollect(lock);
+      rtLogInfo("scene lock: %u acquired, %u contended, wait %.2f ms (max %.2f), hold %.2f ms (max %.2f)",
+                lock.acquired, lock.contended, lock.waitMs, lock.maxWaitMs, lock.holdMs, lock.maxHoldMs);
+      e.set("lockAcquired", lock.acquired);
+      e.set("lockContended", lock.contended);
+      e.set("lockWaitMs", lock.waitMs);
+      e.set("lockHoldMs", lock.holdMs);
+      e.set("lockMaxHoldMs", lock.maxHoldMs);
+    }
+
+    rtNodeGcStats gc;
+    rtNodeGcStatsCollect(gc);
+    if (gc.collections > 0)
+    {
+      rtLogInfo("gc: %u collections, %.2f ms (max %.2f), pauses <1 <2 <4 <8 <16 <32 <64 ms: "
+                "%u %u %u %u %u %u %u, longer: %u, %.2f ms idle time in %u notifications",
+                gc.collections, gc.pauseMs, gc.maxPauseMs,
+                gc.pauses[0], gc.pauses[1], gc.pauses[2], gc.pauses[3], gc.pauses[4],
+                gc.pauses[5], gc.pauses[6], gc.pauses[7], gc.idleMs, gc.idleNotifications);
+    }
+    e.set("gcCollections", gc.collections);
+    e.set("gcPauseMs", gc.pauseMs);
+    e.set("gcMaxPauseMs", gc.maxPauseMs);
+    e.set("gcIdleMs", gc.idleMs);
+#endif //ENABLE_RT_NODE
     mEmit.send("onFPS", e);
 
       start = end2; // start of frame
@@ -1679,12 +1751,9 @@ void pxScene2d::onDraw()
     #endif //ENABLE_RT_NODE
     context.setSize(mWidth, mHeight);
   }
+  double start_draw = pxSeconds();
 #if 1
 
-#ifdef USE_RENDER_STATS
-  double start_draw = pxSeconds(); //##
-#endif //USE_RENDER_STATS
-
   draw();
 
 #ifdef USE_RENDER_STATS
@@ -1692,6 +1761,11 @@ void pxScene2d::onDraw()
 #endif //USE_RENDER_STATS
 
 #endif
+  if (mTop)
+  {
+    context.endFrame();
+    mLastDrawSeconds = pxSeconds() - start_draw;
+  }
   #ifdef ENABLE_RT_NODE
   if (mTop)
   {
@@ -2257,6 +2331,39 @@ rtError pxScene2d::screenshot(rtString type, rtString& pngData)
     return RT_FAIL;
 }
 
+static void deleteOffscreen(void* context, uint8_t* /*data*/)
+{
+  delete (pxOffscreen*)context;
+}
+
+rtError pxScene2d::screenshotBuffer(rtString type, rtBufferRef& b)
+{
+  if (type == "image/rgba")
+  {
+    pxOffscreen* o = new pxOffscreen;
+    context.snapshot(*o);
+    if (!o->base())
+    {
+      delete o;
+      return RT_FAIL;
+    }
+    b = rtBuffer::wrap((uint8_t*)o->base(), o->sizeInBytes(), deleteOffscreen, o);
+    return RT_OK;
+  }
+  else if (type == "image/png")
+  {
+    pxOffscreen o;
+    context.snapshot(o);
+
+    rtData pngData;
+    if (pxStorePNGImage(o, pngData) != RT_OK)
+      return RT_FAIL;
+    b = rtBuffer::create(pngData.data(), pngData.length());
+    return b?RT_OK:RT_FAIL;
+  }
+  return RT_FAIL;
+}
+
 rtError pxScene2d::clipboardSet(rtString type, rtString clipString)
 {
 //    rtLogDebug("\n ##########   clipboardSet()  >> %s ", type.cString() ); fflush(stdout);
@@ -2284,12 +2391,14 @@ rtDefineProperty(pxScene2d, showOutlines);
 rtDefineProperty(pxScene2d, showDirtyRect);
 rtDefineMethod(pxScene2d, create);
 rtDefineMethod(pxScene2d, clock);
+rtDefineMethod(pxScene2d, textureMemory);
 //rtDefineMethod(pxScene2d, createWayland);
 rtDefineMethod(pxScene2d, addListener);
 rtDefineMethod(pxScene2d, delListener);
 rtDefineMethod(pxScene2d, getFocus);
 //rtDefineMethod(pxScene2d, stopPropagation);
 rtDefineMethod(pxScene2d, screenshot);
+rtDefineMethod(pxScene2d, screenshotBuffer);
 
 rtDefineMethod(pxScene2d, clipboardGet);
 rtDefineMethod(pxScene2d, clipboardSet);
@@ -2494,6 +2603,7 @@ void pxScriptView::runScript()
 
   #ifdef ENABLE_RT_NODE
   rtLogWarn("pxScriptView::pxScriptView is just now creating a context for mUrl=%s\n",mUrl.cString());
+  double start = pxMilliseconds();
   mCtx = script.createContext();
 
   if (mCtx)
@@ -2509,7 +2619,10 @@ void pxScriptView::runScript()
 #ifdef RUNINMAIN
     mReady = new rtPromise();
 #endif
-    mCtx->runFile("init.js");
+    if (!mCtx->hasRunFile("init.js"))
+      mCtx->runFile("init.js");
+    rtLogInfo("pxScriptView context and init.js ready in %.2f ms, code cache %s",
+              pxMilliseconds() - start, rtNodeCodeCacheEnabled()?"on":"off");
 
     char buffer[1024];
 #ifdef RUNINMAIN
@@ -112,7 +112,10 @@ struct pxAnimationTarget
 struct animation 
 {
   bool cancelled;
+  // scripts can animate any name, so it's only looked up, not interned.
+  // Declared properties are interned and compare by atom.
   rtString prop;
+  rtAtom atom;
   float from;
   float to;
   bool flip;
@@ -1272,6 +1275,7 @@ public:
   rtMethod1ArgAndReturn("loadArchive",loadArchive,rtString,rtObjectRef); 
   rtMethod1ArgAndReturn("create", create, rtObjectRef, rtObjectRef);
   rtMethodNoArgAndReturn("clock", clock, uint64_t);
+  rtMethodNoArgAndReturn("textureMemory", textureMemory, rtObjectRef);
 /*
   rtMethod1ArgAndReturn("createExternal", createExternal, rtObjectRef,
                         rtObjectRef);
@@ -1290,6 +1294,7 @@ public:
 //  rtMethodNoArgAndNoReturn("stopPropagation",stopPropagation);
   
   rtMethod1ArgAndReturn("screenshot", screenshot, rtString, rtString);
+  rtMethod1ArgAndReturn("screenshotBuffer", screenshotBuffer, rtString, rtBufferRef);
 
   rtMethod1ArgAndReturn("clipboardGet", clipboardGet, rtString, rtString);
   rtMethod2ArgAndNoReturn("clipboardSet", clipboardSet, rtString, rtString);
@@ -1362,6 +1367,7 @@ public:
   rtError createWayland(rtObjectRef p, rtObjectRef& o);
 
   rtError clock(uint64_t & time);
+  rtError textureMemory(rtObjectRef& o);
 
   rtError addListener(rtString eventName, const rtFunctionRef& f)
   {
@@ -1474,6 +1480,9 @@ private:
 
   // Note: Only type currently supported is "image/png;base64"
   rtError screenshot(rtString type, rtString& pngData);
+  // "image/png" for the encoded image, "image/rgba" for the pixels as they
+  // are, width*height*4 bytes handed over without a copy
+  rtError screenshotBuffer(rtString type, rtBufferRef& b);
   rtError clipboardGet(rtString type, rtString& retString);
   rtError clipboardSet(rtString type, rtString clipString);
   
@@ -1481,6 +1490,8 @@ private:
   rtRef<pxObject> mRoot;
   rtObjectRef mFocusObj;
   double start, sigma_draw, sigma_update, end2;
+  // how long the last frame took to draw, kept out of the time given to GC
+  double mLastDrawSeconds;
 
   int frameCount;
   int mWidth;
@@ -0,0 +1,179 @@
+/*
+
+ pxCore Copyright 2005-2017 John Robinson
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*/
+
+// pxSceneBench.cpp
+//
+// Renders a scene headlessly with the software context (make sw) and prints
+// the time per frame for 1, 2, 4 ... bands, up to the number of cpus.
+//
+//  ./pxscene-bench [-w 1280] [-h 720] [-n 100] [-o frame.png] [scene.js]
+//
+// Without a url the native test scene is used, it loads its images from
+// ../images.
+
+#include "pxScene2d.h"
+
+#include "pxCore.h"
+#include "pxTimer.h"
+#include "pxContext.h"
+#include "pxUtil.h"
+#include "rtNode.h"
+#include "testScene.h"
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef RUNINMAIN
+extern rtNode script;
+#endif
+#ifdef ENABLE_DEBUG_MODE
+extern int g_argc;
+extern char** g_argv;
+#endif
+
+pxContext context;
+
+class benchContainer : public pxIViewContainer
+{
+public:
+  benchContainer(): mWidth(0), mHeight(0) {}
+
+  void setView(pxIView* v, int32_t w, int32_t h)
+  {
+    mWidth = w;
+    mHeight = h;
+    mView = v;
+    if (v)
+    {
+      v->setViewContainer(this);
+      v->onSize(w, h);
+    }
+  }
+
+  // every frame is drawn anyway
+  virtual void RT_STDCALL invalidateRect(pxRect* /*r*/) {}
+
+  virtual unsigned long RT_STDCALL AddRef() { return 1; }
+  virtual unsigned long RT_STDCALL Release() { return 1; }
+
+  void frame(double t)
+  {
+    if (!mView)
+      return;
+
+    mView->onUpdate(t);
+#ifdef RUNINMAIN
+    script.pump();
+#endif
+    mView->onDraw();
+  }
+
+private:
+  int32_t mWidth;
+  int32_t mHeight;
+  rtRef<pxIView> mView;
+};
+
+int main(int argc, char* argv[])
+{
+  int w = 1280;
+  int h = 720;
+  int frames = 100;
+  const char* out = NULL;
+
+  int c;
+  while ((c = getopt(argc, argv, "w:h:n:o:")) != -1)
+  {
+    switch (c)
+    {
+      case 'w': w = atoi(optarg); break;
+      case 'h': h = atoi(optarg); break;
+      case 'n': frames = atoi(optarg); break;
+      case 'o': out = optarg; break;
+      default:
+        fprintf(stderr, "usage: %s [-w width] [-h height] [-n frames] [-o out.png] [scene.js]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  rtLogSetLevel(RT_LOG_WARN);
+
+  context.init();
+  context.setSize(w, h);
+
+  benchContainer container;
+  if (optind < argc)
+  {
+#if defined(RUNINMAIN) && defined(ENABLE_DEBUG_MODE)
+    // same node arguments as pxscene
+    static char* nodeArgs[] = { (char*)"pxscene", (char*)"-e",
+                                (char*)"console.log(\"rtNode Initialized\");", NULL };
+    g_argc = 3;
+    g_argv = nodeArgs;
+    script.initializeNode();
+#endif
+    container.setView(new pxScriptView(argv[optind], "javascript/node/v8"), w, h);
+  }
+  else
+    container.setView(testScene().getPtr(), w, h);
+
+  // let images load and decode before timing anything
+  double t = 0;
+  double warmupEnd = pxSeconds() + 2;
+  while (pxSeconds() < warmupEnd)
+  {
+    container.frame(t);
+    t += 1.0/60;
+  }
+
+  int maxBands = pxSwBandCount();
+  for (int bands = 1; ; bands *= 2)
+  {
+    if (bands > maxBands)
+      bands = maxBands;
+
+    pxSwSetBandCount(bands);
+
+    double start = pxSeconds();
+    for (int i = 0; i < frames; i++)
+    {
+      // the context replays a frame's draws when its last popState returns
+      container.frame(t);
+      t += 1.0/60;
+    }
+    double elapsed = pxSeconds() - start;
+
+    printf("%2d bands  %8.2f ms/frame  %6.1f fps\n", bands,
+           elapsed*1000/frames, frames/elapsed);
+
+    if (bands == maxBands)
+      break;
+  }
+
+  if (out)
+  {
+    pxOffscreen o;
+    context.snapshot(o);
+    if (pxStorePNGImage(out, o) != RT_OK)
+      rtLogError("failed to write %s", out);
+  }
+
+  container.setView(NULL, 0, 0);
+  return 0;
+}
@@ -49,6 +49,9 @@ pxTextBox::pxTextBox(pxScene2d* s): pxText(s)
 
   mFontLoaded      = false;
   mInitialized     = false;
+  mGlyphsValid     = false;
+  mGlyphsX         = 0;
+  mGlyphsY         = 0;
   mWordWrap        = false;
   mEllipsis        = false;
   mNeedsRecalc     = true;
@@ -139,6 +142,8 @@ void pxTextBox::setNeedsRecalc(bool recalc)
 {
   //rtLogDebug("Setting mNeedsRecalc=%d\n",recalc);
   mNeedsRecalc = recalc;
+  if (recalc)
+    mGlyphsValid = false;
 
   if(recalc)
   {
@@ -215,8 +220,19 @@ void pxTextBox::draw() {
     }
   }
   else
+  {
+    // Lay the text out once, after that it's drawn from the glyphs until
+    // something it depends on changes.  Rows can be placed from the box's
+    // own position, so a move counts too.
+    if (!mGlyphsValid || mGlyphsX != mx || mGlyphsY != my)
     {
-    renderText(true);
+      mGlyphs.clear();
+      renderText(true);
+      mGlyphsValid = mInitialized && mFontLoaded;
+      mGlyphsX = mx;
+      mGlyphsY = my;
+    }
+    pxFont::drawGlyphs(mGlyphs, mTextColor);
   }
 
   //if (!mFontLoaded && getFontResource()->isDownloadInProgress())
@@ -852,7 +868,7 @@ void pxTextBox::renderOneLine(const char * tempStr, float tempX, float tempY, fl
   // Now, render the text
   if( render)
   {
-    getFontResource()->renderText(tempStr, size, xPos, tempY, sx, sy, color,lineWidth);
+    getFontResource()->renderText(tempStr, size, xPos, tempY, sx, sy, color,lineWidth,&mGlyphs);
   }
 }
 
@@ -1084,13 +1100,13 @@ void pxTextBox::renderTextRowWithTruncation(rtString & accString, float lineWidt
         if( lineNumber==0) {setLineMeasurements(true, xPos, tempY);}
 
         if( render) {
-          getFontResource()->renderText(tempStr, pixelSize, xPos, tempY, 1.0, 1.0, color,lineWidth);
+          getFontResource()->renderText(tempStr, pixelSize, xPos, tempY, 1.0, 1.0, color,lineWidth,&mGlyphs);
         }
         if( mEllipsis)
         {
           //rtLogDebug("rendering truncated text with ellipsis\n");
           if( render) {
-            getFontResource()->renderText(ELLIPSIS_STR, pixelSize, xPos+charW, tempY, 1.0, 1.0, color,lineWidth);
+            getFontResource()->renderText(ELLIPSIS_STR, pixelSize, xPos+charW, tempY, 1.0, 1.0, color,lineWidth,&mGlyphs);
           }
           if(!mWordWrap) { setMeasurementBounds(xPos, charW+ellipsisW, tempY, charH); }
           setLineMeasurements(false, xPos+charW+ellipsisW, tempY);
@@ -1135,14 +1151,14 @@ void pxTextBox::renderTextRowWithTruncation(rtString & accString, float lineWidt
           if( lineNumber==0) {setLineMeasurements(true, xPos, tempY);  }
           if( render)
           {
-            getFontResource()->renderText(tempStr, pixelSize, xPos, tempY, 1.0, 1.0, color,lineWidth);
+            getFontResource()->renderText(tempStr, pixelSize, xPos, tempY, 1.0, 1.0, color,lineWidth,&mGlyphs);
           }
         }
         if( mEllipsis)
         {
           //rtLogDebug("rendering  text on word boundary with ellipsis\n");
           if( render) {
-            getFontResource()->renderText(ELLIPSIS_STR, pixelSize, xPos+charW, tempY, 1.0, 1.0, color,lineWidth);
+            getFontResource()->renderText(ELLIPSIS_STR, pixelSize, xPos+charW, tempY, 1.0, 1.0, color,lineWidth,&mGlyphs);
           }
           if(!mWordWrap) { setMeasurementBounds(xPos, charW+ellipsisW, tempY, charH); }
           setLineMeasurements(false, xPos+charW+ellipsisW, tempY);
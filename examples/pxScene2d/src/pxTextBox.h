@@ -29,6 +29,9 @@
 #include "rtRef.h"
 #include "pxScene2d.h"
 #include "pxText.h"
+#include "pxFont.h"
+
+#include <vector>
 
 
 #define ELLIPSIS_STR "\u2026"
@@ -291,6 +294,11 @@ public:
 //  float startX;
   float startY;
 //  bool clippedLastLine;
+
+  // the glyphs the last layout drew
+  std::vector<pxTextGlyph> mGlyphs;
+  bool mGlyphsValid;
+  float mGlyphsX, mGlyphsY;
   
   void setNeedsRecalc(bool recalc);
   virtual float getFBOWidth();
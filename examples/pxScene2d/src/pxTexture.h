@@ -65,6 +65,11 @@ public:
   virtual pxError bindTexture() { return PX_FAIL; }
   virtual pxError bindTextureAsMask() { return PX_FAIL; }
   virtual pxError createTexture(pxOffscreen&) { return PX_FAIL; }
+  // Replaces the x,y,w,h part of the texture with the same part of o, which
+  // has to be the size of the texture. Callers fall back to a new texture
+  // when this fails.
+  virtual pxError updateTexture(pxOffscreen& o, int x, int y, int w, int h)
+  { (void)o; (void)x; (void)y; (void)w; (void)h; return PX_FAIL; }
   virtual pxError deleteTexture() = 0;
   virtual int width() = 0;
   virtual int height() = 0;
@@ -76,6 +81,9 @@ public:
   virtual pxError loadTextureData() { return PX_OK; }
   virtual pxError unloadTextureData() { return PX_OK; }
   virtual pxError freeOffscreenData() { return PX_OK; }
+  // True while an evicted texture is being decoded again, or the texture is
+  // waiting for its upload.  Draws skip it rather than fill in for it.
+  virtual bool loading() { return false; }
   bool premultipliedAlpha() { return mPremultipliedAlpha; }
   void enablePremultipliedAlpha(bool enable) { mPremultipliedAlpha = enable; }
   virtual void* getSurface() { return NULL; }
@@ -8,3 +8,22 @@ var vm            = require('vm');
 var require       = this.require;
 
 var _sandboxStuff = [ "console", "vm", "require" ];
+
+// Modules required from NODE_PATH (rcvrcore, init.js's requires) compile
+// through the V8 code cache, see rtNode.cpp.  Everything else, and anything
+// with options the cache doesn't take, goes to vm as before.
+if (typeof _rtRunCached === 'function' && process.env.NODE_PATH) {
+  var cachedPaths = process.env.NODE_PATH.split(':').filter(function(p) { return p.length > 0; });
+  var runInThisContext = vm.runInThisContext;
+
+  vm.runInThisContext = function(code, options) {
+    if (options && typeof options === 'object' && typeof options.filename === 'string' &&
+        !options.lineOffset && !options.columnOffset) {
+      for (var i = 0; i < cachedPaths.length; i++) {
+        if (options.filename.indexOf(cachedPaths[i]) === 0)
+          return _rtRunCached(code, options.filename);
+      }
+    }
+    return runInThisContext.apply(vm, arguments);
+  };
+}
@@ -88,3 +88,10 @@ rtGuid::toString() const
   uuid_unparse_lower(m_id, buff);
   return std::string(buff);
 }
+
+char const*
+rtGuid::toString(char* buff) const
+{
+  uuid_unparse_lower(m_id, buff);
+  return buff;
+}
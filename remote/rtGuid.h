@@ -22,6 +22,12 @@ public:
 
   std::string toString() const;
 
+  // writes the lowercase string form into buff, which must hold at least
+  // kStringLength + 1 chars. returns buff
+  char const* toString(char* buff) const;
+
+  static size_t const kStringLength = 36;
+
 
 private:
   rtGuid();
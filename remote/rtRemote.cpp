@@ -145,6 +145,62 @@ rtRemoteLocateObject(rtRemoteEnvironment* env, char const* id, rtObjectRef& obj,
   return env->Server->findObject(id, obj, timeout, cb, cbdata);
 }
 
+rtError
+rtRemoteLocateObjects(rtRemoteEnvironment* env, char const* const* ids, int count, rtObjectRef* objs,
+        int timeout, remoteDisconnectedCallback cb, void *cbdata)
+{
+  if (env == nullptr)
+    return RT_ERROR_INVALID_ARG;
+
+  if (ids == nullptr || objs == nullptr || count < 0)
+    return RT_ERROR_INVALID_ARG;
+
+  std::vector<std::string> objectIds;
+  for (int i = 0; i < count; ++i)
+  {
+    if (ids[i] == nullptr)
+      return RT_ERROR_INVALID_ARG;
+    objectIds.push_back(ids[i]);
+  }
+
+  std::vector<rtObjectRef> refs;
+  rtError e = env->Server->findObjects(objectIds, refs, timeout, cb, cbdata);
+  for (int i = 0; i < count; ++i)
+    objs[i] = refs[i];
+
+  return e;
+}
+
+rtError
+rtRemoteNotifyPropertyChanged(rtRemoteEnvironment* env, char const* id, char const* name)
+{
+  if (env == nullptr)
+    return RT_ERROR_INVALID_ARG;
+
+  if (id == nullptr || name == nullptr)
+    return RT_ERROR_INVALID_ARG;
+
+  return env->Server->notifyPropertyChanged(id, name);
+}
+
+rtError
+rtRemoteGetLiveObjectCount(rtRemoteEnvironment* env, uint32_t* objects, uint32_t* functions)
+{
+  if (env == nullptr)
+    return RT_ERROR_INVALID_ARG;
+
+  rtRemoteObjectCacheStats stats;
+  rtError e = env->ObjectCache->getStats(stats);
+  if (e != RT_OK)
+    return e;
+
+  if (objects)
+    *objects = stats.LiveObjects;
+  if (functions)
+    *functions = stats.LiveFunctions;
+  return RT_OK;
+}
+
 rtError
 rtRemoteRegisterQueueReadyHandler ( rtRemoteEnvironment* env, rtRemoteQueueReady handler, void* argp)
 {
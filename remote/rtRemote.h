@@ -67,6 +67,39 @@ rtError
 rtRemoteLocateObject(rtRemoteEnvironment* env, char const* id, rtObjectRef& obj, int timeout=3000,
         remoteDisconnectedCallback cb=NULL, void *cbdata=NULL);
 
+/**
+ * Locate several remote objects by id. All the ids are searched for at once,
+ * which is much quicker than calling rtRemoteLocateObject for each of them.
+ * @param ids The ids of the objects to locate.
+ * @param count The number of ids.
+ * @param objs Array of count object references. Objects not found are left null.
+ * @returns RT_OK if every object was found
+ */
+rtError
+rtRemoteLocateObjects(rtRemoteEnvironment* env, char const* const* ids, int count, rtObjectRef* objs,
+        int timeout=3000, remoteDisconnectedCallback cb=NULL, void *cbdata=NULL);
+
+/**
+ * Tell clients that have cached a property of a registered object that it
+ * changed. Sets that arrive through rtRemote are published automatically, this
+ * is for changes made locally on the server side.
+ * @param id The id of the registered object
+ * @param name The name of the property that changed
+ * @returns RT_OK for success
+ */
+rtError
+rtRemoteNotifyPropertyChanged(rtRemoteEnvironment* env, char const* id, char const* name);
+
+/**
+ * Get the number of objects and functions the environment currently keeps
+ * alive on behalf of remote peers.
+ * @param objects Receives the number of live objects
+ * @param functions Receives the number of live functions
+ * @returns RT_OK for success
+ */
+rtError
+rtRemoteGetLiveObjectCount(rtRemoteEnvironment* env, uint32_t* objects, uint32_t* functions);
+
 /**
  * Shutdown rtRemote sub-system
  * @returns RT_OK for success
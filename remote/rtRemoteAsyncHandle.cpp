@@ -46,15 +46,21 @@ rtRemoteAsyncHandle::wait(uint32_t timeoutInMilliseconds)
     while (timeout > time(nullptr))
     {
       rtRemoteCorrelationKey k = kInvalidCorrelationKey;
+      #ifdef RT_RPC_DEBUG
       rtLogDebug("Waiting for item with key = %s", m_key.toString().c_str());
+      #endif
 
       e = m_env->processSingleWorkItem(std::chrono::milliseconds(timeoutInMilliseconds), true, &k);
+      #ifdef RT_RPC_DEBUG
       rtLogDebug("Got response with key = %s, m_error = %d, error = %d", k.toString().c_str(), m_error, e);
+      #endif
 
       if ( (e == RT_OK) && ((m_error == RT_OK) || (k == m_key)) )
       {
+        #ifdef RT_RPC_DEBUG
         rtLogDebug("Got successful response: m_key = %s, key = %s, m_error = %d",
                 m_key.toString().c_str(), k.toString().c_str(), m_error);
+        #endif
         m_env->removeResponseHandler(m_key);
         m_key = kInvalidCorrelationKey;
         e = m_error = RT_OK;
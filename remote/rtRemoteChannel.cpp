@@ -0,0 +1,179 @@
+#include "rtRemoteChannel.h"
+#include "rtRemoteConfig.h"
+#include "rtRemoteEnvironment.h"
+#include "rtRemoteStream.h"
+
+#include <algorithm>
+#include <rtLog.h>
+
+using std::chrono::steady_clock;
+
+rtRemoteChannelSender::rtRemoteChannelSender(rtRemoteEnvironment* env)
+  : m_env(env)
+  , m_next_id(0)
+  , m_last_sent(0)
+  , m_running(true)
+{
+}
+
+rtRemoteChannelSender::~rtRemoteChannelSender()
+{
+  shutdown();
+}
+
+uint32_t
+rtRemoteChannelSender::add(rtString const& data)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  // most environments never send anything big enough to need a channel
+  if (!m_thread && m_running)
+    m_thread.reset(new std::thread(&rtRemoteChannelSender::run, this));
+
+  if (++m_next_id == 0)
+    ++m_next_id;
+
+  Channel& channel = m_channels[m_next_id];
+  channel.Data = data;
+  channel.Length = static_cast<uint32_t>(channel.Data.byteLength());
+  channel.Offset = 0;
+  channel.Credit = 0;
+  channel.Expires = steady_clock::now() + std::chrono::milliseconds(m_env->Config->channel_timeout());
+  channel.Cancelled = false;
+  return m_next_id;
+}
+
+void
+rtRemoteChannelSender::onCredit(std::shared_ptr<rtRemoteStream> const& stream, uint32_t channelId,
+  uint32_t credit)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  auto itr = m_channels.find(channelId);
+  if (itr == m_channels.end() || itr->second.Cancelled)
+  {
+    lock.unlock();
+
+    // expired, or we've been restarted. don't leave the receiver waiting
+    rtLogWarn("credit for unknown channel %u", channelId);
+    rtError e = stream->sendChannelFrame(rtRemoteChannelFrame::Reset, channelId, 0, nullptr, 0);
+    if (e != RT_OK)
+      rtLogDebug("failed to reset channel %u. %s", channelId, rtStrError(e));
+    return;
+  }
+
+  Channel& channel = itr->second;
+  channel.Stream = stream;
+  channel.Credit += credit;
+  channel.Expires = steady_clock::now() + std::chrono::milliseconds(m_env->Config->channel_timeout());
+  lock.unlock();
+  m_cond.notify_one();
+}
+
+void
+rtRemoteChannelSender::onCancel(uint32_t channelId)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  auto itr = m_channels.find(channelId);
+  if (itr != m_channels.end())
+    itr->second.Cancelled = true;
+  lock.unlock();
+  m_cond.notify_one();
+}
+
+void
+rtRemoteChannelSender::shutdown()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_running = false;
+  lock.unlock();
+  m_cond.notify_all();
+
+  if (m_thread)
+  {
+    m_thread->join();
+    m_thread.reset();
+  }
+
+  lock.lock();
+  m_channels.clear();
+}
+
+// picks the next channel with credit, starting after the one that went last
+bool
+rtRemoteChannelSender::nextChunk(ChannelMap::iterator& itr)
+{
+  auto isReady = [](ChannelMap::value_type const& v)
+  {
+    Channel const& channel = v.second;
+    return !channel.Cancelled && channel.Credit > 0 && channel.Offset < channel.Length;
+  };
+
+  itr = std::find_if(m_channels.upper_bound(m_last_sent), m_channels.end(), isReady);
+  if (itr == m_channels.end())
+    itr = std::find_if(m_channels.begin(), m_channels.end(), isReady);
+  return itr != m_channels.end();
+}
+
+void
+rtRemoteChannelSender::run()
+{
+  uint32_t const chunkSize = static_cast<uint32_t>(m_env->Config->channel_chunk_size());
+
+  // this is the only thread that erases channels, so a channel's data stays
+  // put while a chunk of it is being written outside the lock
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (m_running)
+  {
+    auto now = steady_clock::now();
+    for (auto itr = m_channels.begin(); itr != m_channels.end();)
+    {
+      if (itr->second.Cancelled || itr->second.Expires < now)
+      {
+        if (!itr->second.Cancelled)
+          rtLogWarn("channel %u expired after %u of %u bytes", itr->first, itr->second.Offset,
+            itr->second.Length);
+        itr = m_channels.erase(itr);
+      }
+      else
+      {
+        ++itr;
+      }
+    }
+
+    ChannelMap::iterator itr;
+    if (!nextChunk(itr))
+    {
+      m_cond.wait_for(lock, std::chrono::seconds(1));
+      continue;
+    }
+
+    uint32_t const channelId = itr->first;
+    Channel& channel = itr->second;
+
+    std::shared_ptr<rtRemoteStream> stream = channel.Stream.lock();
+    if (!stream)
+    {
+      m_channels.erase(itr);
+      continue;
+    }
+
+    uint32_t const offset = channel.Offset;
+    uint32_t const n = std::min(chunkSize, std::min(channel.Credit, channel.Length - offset));
+    char const* data = channel.Data.cString() + offset;
+
+    channel.Offset += n;
+    channel.Credit -= n;
+    m_last_sent = channelId;
+    bool const done = (channel.Offset == channel.Length);
+
+    lock.unlock();
+    rtError e = stream->sendChannelFrame(rtRemoteChannelFrame::Data, channelId, offset, data, n);
+    lock.lock();
+
+    if (e != RT_OK)
+      rtLogWarn("failed to send chunk of channel %u. %s", channelId, rtStrError(e));
+
+    if (e != RT_OK || done)
+      m_channels.erase(channelId);
+  }
+}
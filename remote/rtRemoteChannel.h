@@ -0,0 +1,92 @@
+#ifndef __RT_REMOTE_CHANNEL_H__
+#define __RT_REMOTE_CHANNEL_H__
+
+#include <rtError.h>
+#include <rtString.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <stdint.h>
+
+class rtRemoteEnvironment;
+class rtRemoteStream;
+
+// Channels carry large values beside the json messages that refer to them.
+// They share the connection with regular messages, but go out as binary
+// frames of at most rt.rpc.channel.chunk_size bytes. The length word of a
+// channel frame has kChannelFrameFlag set and is followed by a
+// rtRemoteChannelHeader, all in network byte order.
+//
+// The receiver pulls: it grants credit once somebody is waiting for the
+// value and tops it up as chunks arrive, so no more than
+// rt.rpc.channel.window bytes are ever in flight for one channel.
+static uint32_t const kChannelFrameFlag = 0x80000000;
+
+enum class rtRemoteChannelFrame : uint32_t
+{
+  Data    = 1,  // arg is the offset of the chunk
+  Credit  = 2,  // arg is the number of bytes the sender may add
+  Cancel  = 3,  // receiver doesn't want the rest
+  Reset   = 4   // sender can't provide the value
+};
+
+struct rtRemoteChannelHeader
+{
+  uint32_t Kind;
+  uint32_t ChannelId;
+  uint32_t Arg;
+};
+
+// Owns the outgoing side of every channel in an environment. Values are
+// parked here by the writer until a peer asks for them. Chunks are sent from
+// a thread of its own, round robin across channels, so a large transfer
+// neither holds up the caller nor the stream selector.
+class rtRemoteChannelSender
+{
+public:
+  rtRemoteChannelSender(rtRemoteEnvironment* env);
+  ~rtRemoteChannelSender();
+
+  rtRemoteChannelSender(rtRemoteChannelSender const&) = delete;
+  rtRemoteChannelSender& operator = (rtRemoteChannelSender const&) = delete;
+
+  // parks a value and returns the id the receiver pulls it by
+  uint32_t add(rtString const& data);
+
+  void onCredit(std::shared_ptr<rtRemoteStream> const& stream, uint32_t channelId, uint32_t credit);
+  void onCancel(uint32_t channelId);
+  void shutdown();
+
+private:
+  struct Channel
+  {
+    rtString                              Data;
+    uint32_t                              Length;
+    uint32_t                              Offset;
+    uint32_t                              Credit;
+    std::weak_ptr<rtRemoteStream>         Stream;
+    std::chrono::steady_clock::time_point Expires;
+    bool                                  Cancelled;
+  };
+
+  using ChannelMap = std::map< uint32_t, Channel >;
+
+  void run();
+  bool nextChunk(ChannelMap::iterator& itr);
+
+  rtRemoteEnvironment*                  m_env;
+  std::mutex                            m_mutex;
+  std::condition_variable               m_cond;
+  std::unique_ptr<std::thread>          m_thread;
+  ChannelMap                            m_channels;
+  uint32_t                              m_next_id;
+  uint32_t                              m_last_sent;
+  bool                                  m_running;
+};
+
+#endif
@@ -18,6 +18,7 @@
 #include <errno.h>
 
 #include <algorithm>
+#include <set>
 #include <rapidjson/document.h>
 
 namespace
@@ -61,6 +62,7 @@ rtRemoteClient::rtRemoteClient(rtRemoteEnvironment* env, int fd,
   sockaddr_storage const& local_endpoint, sockaddr_storage const& remoteEndpoint)
   : m_stream(new rtRemoteStream(env, fd, local_endpoint, remoteEndpoint))
   , m_env(env)
+  , m_cache_properties(env->Config->client_cache_properties())
 {
   m_stream->setStateChangedHandler(&rtRemoteClient::onStreamStateChanged_Dispatcher, this);
   m_stream->setMessageHandler(&rtRemoteClient::onIncomingMessage_Dispatcher, this);
@@ -69,6 +71,7 @@ rtRemoteClient::rtRemoteClient(rtRemoteEnvironment* env, int fd,
 rtRemoteClient::rtRemoteClient(rtRemoteEnvironment* env, sockaddr_storage const& remoteEndpoint)
   : m_stream(new rtRemoteStream(env, -1, sockaddr_storage(), remoteEndpoint))
   , m_env(env)
+  , m_cache_properties(env->Config->client_cache_properties())
 {
   m_stream->setStateChangedHandler(&rtRemoteClient::onStreamStateChanged_Dispatcher, this);
   m_stream->setMessageHandler(&rtRemoteClient::onIncomingMessage_Dispatcher, this);
@@ -94,6 +97,22 @@ rtRemoteClient::send(rtRemoteMessagePtr const& msg)
   return s->send(msg);
 }
 
+rtError
+rtRemoteClient::readChannel(uint32_t channelId, uint32_t length, rtString& result)
+{
+  std::shared_ptr<rtRemoteStream> s = getStream();
+  if (!s)
+    return RT_ERROR_STREAM_CLOSED;
+
+  // chunks land straight in the string
+  rtString buff;
+  rtError e = s->readChannel(channelId, buff.setLength(length), length,
+    static_cast<uint32_t>(m_env->Config->channel_timeout()));
+  if (e == RT_OK)
+    result = std::move(buff);
+  return e;
+}
+
 rtError
 rtRemoteClient::onIncomingMessage(rtRemoteMessagePtr const& doc)
 {
@@ -127,6 +146,13 @@ rtRemoteClient::onStreamStateChanged(std::shared_ptr<rtRemoteStream> const& /*st
       m_stream->close();
       m_stream.reset();
     }
+
+    // nobody is going to tell us about changes anymore. cached values may hold
+    // the last reference to a proxy, let them go outside of the lock
+    PropertyCache stale;
+    std::unique_lock<std::mutex> cacheLock(m_property_cache_mutex);
+    stale.swap(m_property_cache);
+    cacheLock.unlock();
   }
   else if (state == rtRemoteStream::State::Inactive)
   {
@@ -135,6 +161,12 @@ rtRemoteClient::onStreamStateChanged(std::shared_ptr<rtRemoteStream> const& /*st
     {
       rtLogWarn("failed to send keep alive. %s", rtStrError(e));
     }
+
+    e = sendDeref();
+    if (e != RT_OK)
+    {
+      rtLogWarn("failed to send deref. %s", rtStrError(e));
+    }
   }
   return RT_OK;
 }
@@ -188,10 +220,10 @@ rtRemoteClient::startSession(std::string const& objectId, uint32_t timeout)
 {
   rtRemoteCorrelationKey k = rtMessage_GetNextCorrelationKey();
 
-  rtRemoteMessagePtr req(new rapidjson::Document());
+  rtRemoteMessagePtr req = rtMessage_Create();
   req->SetObject();
   req->AddMember(kFieldNameMessageType, kMessageTypeOpenSessionRequest, req->GetAllocator());
-  req->AddMember(kFieldNameCorrelationKey, k.toString(), req->GetAllocator());
+  rtMessage_SetCorrelationKey(*req, k);
   req->AddMember(kFieldNameObjectId, objectId, req->GetAllocator());
 
   std::shared_ptr<rtRemoteStream> s = getStream();
@@ -214,19 +246,78 @@ rtRemoteClient::startSession(std::string const& objectId, uint32_t timeout)
 void rtRemoteClient::registerKeepAliveForObject(std::string const& s)
 {
   std::unique_lock<std::recursive_mutex> lock(m_mutex);
-  m_objects.push_back(s);
+  m_objects[s]++;
 }
 
 void rtRemoteClient::removeKeepAliveForObject(std::string const& s)
 {
   std::unique_lock<std::recursive_mutex> lock(m_mutex);
-  auto it = std::find(m_objects.begin(), m_objects.end(), s);
+  auto it = m_objects.find(s);
   if (it != m_objects.end())
   {
-    m_objects.erase(it);
+    if (--it->second == 0)
+      m_objects.erase(it);
+  }
+}
+
+void rtRemoteClient::queueDeref(std::string const& s)
+{
+  std::unique_lock<std::recursive_mutex> lock(m_mutex);
+  m_pending_derefs.push_back(s);
+
+  int32_t const batchSize = m_env->Config->client_deref_batch_size();
+  if (static_cast<int32_t>(m_pending_derefs.size()) >= batchSize)
+  {
+    rtError e = sendDeref();
+    if (e != RT_OK)
+      rtLogDebug("failed to send deref. %s", rtStrError(e));
   }
 }
 
+rtError
+rtRemoteClient::sendDeref()
+{
+  std::unique_lock<std::recursive_mutex> lock(m_mutex);
+  if (m_pending_derefs.empty())
+    return RT_OK;
+
+  rtRemoteMessagePtr msg = rtMessage_Create();
+  msg->SetObject();
+  msg->AddMember(kFieldNameMessageType, kMessageTypeDerefRequest, msg->GetAllocator());
+  rtMessage_SetCorrelationKey(*msg, rtMessage_GetNextCorrelationKey());
+
+  rapidjson::Value ids(rapidjson::kArrayType);
+  for (std::string const& id : m_pending_derefs)
+    ids.PushBack(rapidjson::Value().SetString(id.c_str(), id.size(), msg->GetAllocator()), msg->GetAllocator());
+  msg->AddMember(kFieldNameDerefIds, ids, msg->GetAllocator());
+
+  // the server stops pushing changes to objects this client has no proxy
+  // left for.  One that was made again since the deref was queued keeps its
+  // subscription.
+  if (m_cache_properties)
+  {
+    std::set<std::string> gone;
+    for (std::string const& id : m_pending_derefs)
+    {
+      if (m_objects.find(id) == m_objects.end())
+        gone.insert(id);
+    }
+
+    rapidjson::Value unsubscribe(rapidjson::kArrayType);
+    for (std::string const& id : gone)
+      unsubscribe.PushBack(rapidjson::Value().SetString(id.c_str(), id.size(), msg->GetAllocator()), msg->GetAllocator());
+    if (!unsubscribe.Empty())
+      msg->AddMember(kFieldNameUnsubscribeIds, unsubscribe, msg->GetAllocator());
+  }
+  m_pending_derefs.clear();
+
+  std::shared_ptr<rtRemoteStream> s = getStream();
+  if (!s)
+    return RT_ERROR_STREAM_CLOSED;
+
+  return s->send(msg);
+}
+
 rtError
 rtRemoteClient::sendKeepAlive()
 {
@@ -238,13 +329,14 @@ rtRemoteClient::sendKeepAlive()
   // we sent, and simply update the correlation key
   rtRemoteCorrelationKey k = rtMessage_GetNextCorrelationKey();
 
-  rtRemoteMessagePtr msg(new rapidjson::Document());
+  rtRemoteMessagePtr msg = rtMessage_Create();
   msg->SetObject();
   msg->AddMember(kFieldNameMessageType, kMessageTypeKeepAliveRequest, msg->GetAllocator());
-  msg->AddMember(kFieldNameCorrelationKey,k.toString(), msg->GetAllocator());
+  rtMessage_SetCorrelationKey(*msg, k);
 
-  for (std::string const& name : m_objects)
+  for (auto const& object : m_objects)
   {
+    std::string const& name = object.first;
     auto itr = msg->FindMember(kFieldNameKeepAliveIds);
     if (itr == msg->MemberEnd())
     {
@@ -270,15 +362,27 @@ rtRemoteClient::sendSet(std::string const& objectId, char const* propertyName, r
 {
   rtRemoteCorrelationKey k = rtMessage_GetNextCorrelationKey();
 
-  rtRemoteMessagePtr req(new rapidjson::Document());
+  rtRemoteMessagePtr req = rtMessage_Create();
   req->SetObject();
   req->AddMember(kFieldNameMessageType, kMessageTypeSetByNameRequest, req->GetAllocator());
   req->AddMember(kFieldNameObjectId, objectId, req->GetAllocator());
   req->AddMember(kFieldNamePropertyName, std::string(propertyName), req->GetAllocator());
-  req->AddMember(kFieldNameCorrelationKey, k.toString(), req->GetAllocator());
+  rtMessage_SetCorrelationKey(*req, k);
   addValue(req, m_env, value);
 
-  return sendSet(req, k);
+  if (!m_cache_properties)
+    return sendSet(req, k);
+
+  // read-your-writes: stop serving the old value before the set goes out, and
+  // don't accept any get response that was generated before the server
+  // applied it.
+  PropertyKey const key(objectId, propertyName);
+  invalidateCachedProperty(key, 0);
+
+  uint64_t version = 0;
+  rtError e = sendSet(req, k, &version);
+  invalidateCachedProperty(key, version);
+  return e;
 }
 
 rtError
@@ -286,19 +390,19 @@ rtRemoteClient::sendSet(std::string const& objectId, uint32_t propertyIdx, rtVal
 {
   rtRemoteCorrelationKey k = rtMessage_GetNextCorrelationKey();
 
-  rtRemoteMessagePtr req(new rapidjson::Document());
+  rtRemoteMessagePtr req = rtMessage_Create();
   req->SetObject();
   req->AddMember(kFieldNameMessageType, kMessageTypeSetByIndexRequest, req->GetAllocator());
   req->AddMember(kFieldNameObjectId, objectId, req->GetAllocator());
   req->AddMember(kFieldNamePropertyIndex, propertyIdx, req->GetAllocator());
-  req->AddMember(kFieldNameCorrelationKey, k.toString(), req->GetAllocator());
+  rtMessage_SetCorrelationKey(*req, k);
   addValue(req, m_env, value);
 
   return sendSet(req, k);
 }
 
 rtError
-rtRemoteClient::sendSet(rtRemoteMessagePtr const& req, rtRemoteCorrelationKey k)
+rtRemoteClient::sendSet(rtRemoteMessagePtr const& req, rtRemoteCorrelationKey k, uint64_t* version)
 {
   std::shared_ptr<rtRemoteStream> s = getStream();
   if (!s)
@@ -313,6 +417,9 @@ rtRemoteClient::sendSet(rtRemoteMessagePtr const& req, rtRemoteCorrelationKey k)
     if (!res)
       return RT_ERROR_PROTOCOL_ERROR;
 
+    if (version)
+      *version = rtMessage_GetPropertyVersion(*res);
+
     e = rtMessage_GetStatusCode(*res);
   }
   return e;
@@ -323,12 +430,12 @@ rtRemoteClient::sendGet(std::string const& objectId, char const* propertyName, r
 {
   rtRemoteCorrelationKey k = rtMessage_GetNextCorrelationKey();
 
-  rtRemoteMessagePtr req(new rapidjson::Document());
+  rtRemoteMessagePtr req = rtMessage_Create();
   req->SetObject();
   req->AddMember(kFieldNameMessageType, kMessageTypeGetByNameRequest, req->GetAllocator());
   req->AddMember(kFieldNameObjectId, objectId, req->GetAllocator());
   req->AddMember(kFieldNamePropertyName, std::string(propertyName), req->GetAllocator());
-  req->AddMember(kFieldNameCorrelationKey, k.toString(), req->GetAllocator());
+  rtMessage_SetCorrelationKey(*req, k);
 
   return sendGet(req, k, result);
 }
@@ -338,18 +445,146 @@ rtRemoteClient::sendGet(std::string const& objectId, uint32_t propertyIdx, rtVal
 {
   rtRemoteCorrelationKey k = rtMessage_GetNextCorrelationKey();
 
-  rtRemoteMessagePtr req(new rapidjson::Document());
+  rtRemoteMessagePtr req = rtMessage_Create();
   req->SetObject();
   req->AddMember(kFieldNameMessageType, kMessageTypeGetByNameRequest, req->GetAllocator());
   req->AddMember(kFieldNameObjectId, objectId, req->GetAllocator());
   req->AddMember(kFieldNamePropertyIndex, propertyIdx, req->GetAllocator());
-  req->AddMember(kFieldNameCorrelationKey, k.toString(), req->GetAllocator());
+  rtMessage_SetCorrelationKey(*req, k);
 
   return sendGet(req, k, result);
 }
 
 rtError
-rtRemoteClient::sendGet(rtRemoteMessagePtr const& req, rtRemoteCorrelationKey k, rtValue& value)
+rtRemoteClient::sendCachedGet(std::string const& objectId, char const* propertyName, rtValue& result)
+{
+  PropertyKey const key(objectId, propertyName);
+
+  uint64_t knownVersion = 0;
+  {
+    std::unique_lock<std::mutex> lock(m_property_cache_mutex);
+    auto itr = m_property_cache.find(key);
+    if (itr != m_property_cache.end())
+    {
+      if (itr->second.Valid)
+      {
+        result = itr->second.Value;
+        return RT_OK;
+      }
+      knownVersion = itr->second.Version;
+    }
+  }
+
+  rtRemoteCorrelationKey k = rtMessage_GetNextCorrelationKey();
+
+  rtRemoteMessagePtr req = rtMessage_Create();
+  req->SetObject();
+  req->AddMember(kFieldNameMessageType, kMessageTypeGetByNameRequest, req->GetAllocator());
+  req->AddMember(kFieldNameObjectId, objectId, req->GetAllocator());
+  req->AddMember(kFieldNamePropertyName, std::string(propertyName), req->GetAllocator());
+  rtMessage_SetCorrelationKey(*req, k);
+  req->AddMember(kFieldNamePropertySubscribe, true, req->GetAllocator());
+
+  uint64_t version = 0;
+  rtError e = sendGet(req, k, result, &version);
+  if (e != RT_OK)
+    return e;
+
+  // the server reads the version before the value, so a response carrying an
+  // older version than a change we've already been told about is stale.
+  // version zero means the server didn't take the subscription
+  if (version == 0)
+    return RT_OK;
+
+  rtValue previous;
+  std::unique_lock<std::mutex> lock(m_property_cache_mutex);
+  CachedProperty& entry = m_property_cache[key];
+  if (version >= knownVersion && version >= entry.Version)
+  {
+    previous = entry.Value;
+    entry.Value = result;
+    entry.Version = version;
+    entry.Valid = true;
+  }
+  return RT_OK;
+}
+
+rtError
+rtRemoteClient::onPropertyChanged(rtRemoteMessagePtr const& msg)
+{
+  char const* objectId = rtMessage_GetObjectId(*msg);
+  char const* name = rtMessage_GetPropertyName(*msg);
+  if (!objectId || !name)
+    return RT_ERROR_PROTOCOL_ERROR;
+
+  PropertyKey const key(objectId, name);
+  uint64_t const version = rtMessage_GetPropertyVersion(*msg);
+
+  auto itr = msg->FindMember(kFieldNameValue);
+  if (itr == msg->MemberEnd())
+  {
+    invalidateCachedProperty(key, version);
+    return RT_OK;
+  }
+
+  rtValue value;
+  rtError e = rtRemoteValueReader::read(value, itr->value, shared_from_this());
+  if (e != RT_OK)
+  {
+    invalidateCachedProperty(key, version);
+    return e;
+  }
+
+  rtValue previous;
+  std::unique_lock<std::mutex> lock(m_property_cache_mutex);
+  CachedProperty& entry = m_property_cache[key];
+  if (version > entry.Version)
+  {
+    previous = entry.Value;
+    entry.Value = value;
+    entry.Version = version;
+    entry.Valid = true;
+  }
+  return RT_OK;
+}
+
+void
+rtRemoteClient::invalidateCachedProperty(PropertyKey const& key, uint64_t version)
+{
+  // destroying a cached proxy calls back into clearPropertyCache, so values
+  // are only ever released after the lock is dropped
+  rtValue previous;
+  std::unique_lock<std::mutex> lock(m_property_cache_mutex);
+  auto itr = m_property_cache.find(key);
+  if (itr == m_property_cache.end())
+  {
+    if (version == 0)
+      return;
+    itr = m_property_cache.insert(PropertyCache::value_type(key, CachedProperty())).first;
+  }
+  previous = itr->second.Value;
+  itr->second.Valid = false;
+  itr->second.Value.setEmpty();
+  if (version > itr->second.Version)
+    itr->second.Version = version;
+}
+
+void
+rtRemoteClient::clearPropertyCache(std::string const& objectId)
+{
+  std::vector<rtValue> previous;
+  std::unique_lock<std::mutex> lock(m_property_cache_mutex);
+  auto itr = m_property_cache.lower_bound(PropertyKey(objectId, std::string()));
+  while (itr != m_property_cache.end() && itr->first.first == objectId)
+  {
+    previous.push_back(itr->second.Value);
+    itr = m_property_cache.erase(itr);
+  }
+}
+
+rtError
+rtRemoteClient::sendGet(rtRemoteMessagePtr const& req, rtRemoteCorrelationKey k, rtValue& value,
+  uint64_t* version)
 {
   std::shared_ptr<rtRemoteStream> s = getStream();
   if (!s)
@@ -372,6 +607,9 @@ rtRemoteClient::sendGet(rtRemoteMessagePtr const& req, rtRemoteCorrelationKey k,
     if (itr == res->MemberEnd())
       return RT_ERROR_PROTOCOL_ERROR;
 
+    if (version)
+      *version = rtMessage_GetPropertyVersion(*res);
+
     e = rtRemoteValueReader::read(value, itr->value, shared_from_this());
     if (e == RT_OK)
       e = rtMessage_GetStatusCode(*res);
@@ -385,11 +623,11 @@ rtRemoteClient::sendCall(std::string const& objectId, std::string const& methodN
 {
   rtRemoteCorrelationKey k = rtMessage_GetNextCorrelationKey();
 
-  rtRemoteMessagePtr req(new rapidjson::Document());
+  rtRemoteMessagePtr req = rtMessage_Create();
   req->SetObject();
   req->AddMember(kFieldNameMessageType, kMessageTypeMethodCallRequest, req->GetAllocator());
   req->AddMember(kFieldNameObjectId, objectId, req->GetAllocator());
-  req->AddMember(kFieldNameCorrelationKey, k.toString(), req->GetAllocator());
+  rtMessage_SetCorrelationKey(*req, k);
   req->AddMember(kFieldNameFunctionName, methodName, req->GetAllocator());
   
   for (int i = 0; i < argc; ++i)
@@ -48,22 +48,39 @@ public:
   rtError sendCall(std::string const& objectId, std::string const& methodName,
     int argc, rtValue const* argv, rtValue& result);
 
+  // cached-property mode (rt.rpc.client.cache_properties). The first get subscribes
+  // this client to changes of the property on the server. Subsequent gets are served
+  // from memory until the server pushes a property.changed message.
+  rtError sendCachedGet(std::string const& objectId, char const* propertyName, rtValue& result);
+  rtError onPropertyChanged(rtRemoteMessagePtr const& msg);
+  void clearPropertyCache(std::string const& objectId);
+
   void registerKeepAliveForObject(std::string const& s);
   rtError setStateChangedHandler(StateChangedHandler handler, void* argp);
 
   void removeKeepAliveForObject(std::string const& s);
 
+  // gives back the remote reference held by a proxy. derefs are batched and
+  // go out with the next keep-alive or once rt.rpc.client.deref_batch_size
+  // of them are pending.
+  void queueDeref(std::string const& s);
+
   inline rtRemoteEnvironment* getEnvironment() const
     { return m_env; }
 
   rtError send(rtRemoteMessagePtr const& msg);
 
+  // pulls a string the peer sent over a channel rather than inline
+  rtError readChannel(uint32_t channelId, uint32_t length, rtString& result);
+
   sockaddr_storage getRemoteEndpoint() const;
   sockaddr_storage getLocalEndpoint() const;
 
 private:
-  rtError sendGet(rtRemoteMessagePtr const& req, rtRemoteCorrelationKey k, rtValue& value);
-  rtError sendSet(rtRemoteMessagePtr const& req, rtRemoteCorrelationKey k);
+  rtError sendGet(rtRemoteMessagePtr const& req, rtRemoteCorrelationKey k, rtValue& value,
+    uint64_t* version = nullptr);
+  rtError sendSet(rtRemoteMessagePtr const& req, rtRemoteCorrelationKey k,
+    uint64_t* version = nullptr);
   rtError sendCall(rtRemoteMessagePtr const& req, rtRemoteCorrelationKey k, rtValue& result); 
 
   static rtError onIncomingMessage_Dispatcher(rtRemoteMessagePtr const& doc, void* argp)
@@ -77,6 +94,7 @@ private:
   rtError onStreamStateChanged(std::shared_ptr<rtRemoteStream> const& stream, rtRemoteStream::State state);
   rtError connectRpcEndpoint();
   rtError sendKeepAlive();
+  rtError sendDeref();
 
   static rtError onSynchronousResponse_Handler(std::shared_ptr<rtRemoteClient>& client,
         rtRemoteMessagePtr const& msg, void* argp)
@@ -98,11 +116,27 @@ private:
     return s;
   }
 
+  struct CachedProperty
+  {
+    rtValue   Value;
+    uint64_t  Version;
+    bool      Valid;
+  };
+
+  using PropertyKey = std::pair< std::string, std::string >;
+  using PropertyCache = std::map< PropertyKey, CachedProperty >;
+
+  void invalidateCachedProperty(PropertyKey const& key, uint64_t version);
+
   std::shared_ptr<rtRemoteStream>           m_stream;
-  std::vector<std::string>                  m_objects;
+  std::map<std::string, uint32_t>           m_objects;
+  std::vector<std::string>                  m_pending_derefs;
   std::recursive_mutex mutable              m_mutex;
   rtRemoteEnvironment*                      m_env;
   rtRemoteCallback<StateChangedHandler>     m_state_changed_handler;
+  PropertyCache                             m_property_cache;
+  std::mutex                                m_property_cache_mutex;
+  bool                                      m_cache_properties;
 };
 
 #endif
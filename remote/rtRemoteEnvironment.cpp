@@ -3,6 +3,7 @@
 #include "rtRemoteServer.h"
 #include "rtRemoteStreamSelector.h"
 #include "rtRemoteObjectCache.h"
+#include "rtRemoteChannel.h"
 #include "rtError.h"
 
 rtRemoteEnvironment::rtRemoteEnvironment(rtRemoteConfig* config)
@@ -10,8 +11,11 @@ rtRemoteEnvironment::rtRemoteEnvironment(rtRemoteConfig* config)
   , Server(nullptr)
   , ObjectCache(nullptr)
   , StreamSelector(nullptr)
+  , ChannelSender(nullptr)
   , RefCount(1)
   , Initialized(false)
+  , m_queue_head(0)
+  , m_queue_size(0)
   , m_running(false)
   , m_queue_ready_handler(nullptr)
   , m_queue_ready_context(nullptr)
@@ -21,6 +25,7 @@ rtRemoteEnvironment::rtRemoteEnvironment(rtRemoteConfig* config)
 
   Server = new rtRemoteServer(this);
   ObjectCache = new rtRemoteObjectCache(this);
+  ChannelSender = new rtRemoteChannelSender(this);
 }
 
 rtRemoteEnvironment::~rtRemoteEnvironment()
@@ -53,12 +58,15 @@ rtRemoteEnvironment::processRunQueue()
   while (true)
   {
     rtError e = processSingleWorkItem(timeout, true,  nullptr);
+
+    // processSingleWorkItem returns RT_OK once we're shut down
+    std::unique_lock<std::mutex> lock(m_queue_mutex);
+    if (!m_running)
+      return;
+    lock.unlock();
+
     if (e != RT_OK)
     {
-      std::unique_lock<std::mutex> lock(m_queue_mutex);
-      if (!m_running)
-        return;
-      lock.unlock();
       if (e != RT_ERROR_TIMEOUT)
         rtLogWarn("error processing queue. %s", rtStrError(e));
     }
@@ -75,20 +83,24 @@ rtRemoteEnvironment::registerResponseHandler(rtRemoteMessageHandler handler, voi
   std::unique_lock<std::mutex> lock(m_queue_mutex);
 
   {
-    auto ret = m_response_handlers.insert(ResponseHandlerMap::value_type(k, callback));
-    if (!ret.second)
+    bool const inserted = find(m_response_handlers, k) == m_response_handlers.end();
+    if (inserted)
+      m_response_handlers.push_back(ResponseHandler(k, callback));
+    else
       rtLogError("callback for %s already exists", k.toString().c_str());
-    RT_ASSERT(ret.second);
+    RT_ASSERT(inserted);
   }
 
   // prime response map. An entry in this map indicates that a caller is waiting
   // for a response
   if (Config->server_use_dispatch_thread())
   {
-    auto ret = m_waiters.insert(ResponseMap::value_type(k, ResponseState::Waiting));
-    if (!ret.second)
+    bool const inserted = find(m_waiters, k) == m_waiters.end();
+    if (inserted)
+      m_waiters.push_back(ResponseWaiter(k, ResponseState::Waiting));
+    else
       rtLogWarn("response indicator for %s already exists", k.toString().c_str());
-    RT_ASSERT(ret.second);
+    RT_ASSERT(inserted);
   }
 }
 
@@ -97,16 +109,16 @@ rtRemoteEnvironment::removeResponseHandler(rtRemoteCorrelationKey k)
 {
   std::unique_lock<std::mutex> lock(m_queue_mutex);
   {
-    auto itr = m_response_handlers.find(k);
+    auto itr = find(m_response_handlers, k);
     if (itr != m_response_handlers.end())
-      m_response_handlers.erase(itr);
+      erase(m_response_handlers, itr);
   }
 
   if (Config->server_use_dispatch_thread())
   {
-    auto itr = m_waiters.find(k);
+    auto itr = find(m_waiters, k);
     if (itr != m_waiters.end())
-      m_waiters.erase(itr);
+      erase(m_waiters, itr);
   }
 }
 
@@ -121,6 +133,12 @@ rtRemoteEnvironment::shutdown()
   for (auto& t : m_workers)
     t->join();
 
+  if (ChannelSender)
+  {
+    delete ChannelSender;
+    ChannelSender = nullptr;
+  }
+
   if (Server)
   {
     delete Server;
@@ -179,10 +197,10 @@ rtRemoteEnvironment::processSingleWorkItem(std::chrono::milliseconds timeout, bo
   auto delay = std::chrono::system_clock::now() + timeout;
 
   std::unique_lock<std::mutex> lock(m_queue_mutex);
-  if (!wait && m_queue.empty())
+  if (!wait && m_queue_size == 0)
     return RT_ERROR_QUEUE_EMPTY;
 
-  if (!m_queue_cond.wait_until(lock, delay, [this] { return !this->m_queue.empty() || !m_running; }))
+  if (!m_queue_cond.wait_until(lock, delay, [this] { return this->m_queue_size != 0 || !m_running; }))
   {
     e = RT_ERROR_TIMEOUT;
   }
@@ -191,11 +209,7 @@ rtRemoteEnvironment::processSingleWorkItem(std::chrono::milliseconds timeout, bo
     if (!m_running)
       return RT_OK;
 
-    if (!m_queue.empty())
-    {
-      workItem = m_queue.front();
-      m_queue.pop();
-    }
+    popWorkItem(workItem);
   }
 
   if (workItem.Message)
@@ -204,13 +218,15 @@ rtRemoteEnvironment::processSingleWorkItem(std::chrono::milliseconds timeout, bo
     void* argp = nullptr;
 
     rtRemoteCorrelationKey const k = rtMessage_GetCorrelationKey(*workItem.Message);
+    #ifdef RT_RPC_DEBUG
     rtLogDebug("got reply with key: %s", k.toString().c_str());
-    auto itr = m_response_handlers.find(k);
+    #endif
+    auto itr = find(m_response_handlers, k);
     if (itr != m_response_handlers.end())
     {
       messageHandler = itr->second.Func;
       argp = itr->second.Arg;
-      m_response_handlers.erase(itr);
+      erase(m_response_handlers, itr);
     }
     lock.unlock();
 
@@ -225,7 +241,7 @@ rtRemoteEnvironment::processSingleWorkItem(std::chrono::milliseconds timeout, bo
     if (Config->server_use_dispatch_thread())
     {
       std::unique_lock<std::mutex> lock(m_queue_mutex);
-      auto itr = m_waiters.find(k);
+      auto itr = find(m_waiters, k);
       if (itr != m_waiters.end())
         itr->second = ResponseState::Dispatched;
       lock.unlock();
@@ -245,7 +261,7 @@ rtRemoteEnvironment::enqueueWorkItem(std::shared_ptr<rtRemoteClient> const& clnt
   workItem.Message = doc;
 
   std::unique_lock<std::mutex> lock(m_queue_mutex);
-  m_queue.push(workItem);
+  pushWorkItem(workItem);
   lock.unlock();
   m_queue_cond.notify_all();
 
@@ -255,6 +271,36 @@ rtRemoteEnvironment::enqueueWorkItem(std::shared_ptr<rtRemoteClient> const& clnt
   }
 }
 
+// the run queue is a ring that doubles when full and never shrinks, so
+// queueing doesn't allocate once it's grown to the peak backlog
+void
+rtRemoteEnvironment::pushWorkItem(WorkItem const& workItem)
+{
+  if (m_queue_size == m_queue.size())
+  {
+    std::vector<WorkItem> queue(m_queue.empty() ? 16 : m_queue.size() * 2);
+    for (size_t i = 0; i < m_queue_size; ++i)
+      queue[i] = std::move(m_queue[(m_queue_head + i) % m_queue.size()]);
+    m_queue.swap(queue);
+    m_queue_head = 0;
+  }
+
+  m_queue[(m_queue_head + m_queue_size) % m_queue.size()] = workItem;
+  m_queue_size++;
+}
+
+bool
+rtRemoteEnvironment::popWorkItem(WorkItem& workItem)
+{
+  if (m_queue_size == 0)
+    return false;
+
+  workItem = std::move(m_queue[m_queue_head]);
+  m_queue_head = (m_queue_head + 1) % m_queue.size();
+  m_queue_size--;
+  return true;
+}
+
 void
 rtRemoteEnvironment::registerQueueReadyHandler(rtRemoteQueueReady handler, void* argp)
 {
@@ -8,13 +8,15 @@
 #include <condition_variable>
 #include <map>
 #include <mutex>
-#include <queue>
 #include <thread>
+#include <utility>
+#include <vector>
 
 class rtRemoteServer;
 class rtRemoteConfig;
 class rtRemoteStreamSelector;
 class rtRemoteObjectCache;
+class rtRemoteChannelSender;
 
 class rtRemoteEnvironment
 {
@@ -27,13 +29,14 @@ public:
   bool isQueueEmpty() const
   {
     std::unique_lock<std::mutex> lock(m_queue_mutex);
-    return m_queue.empty();
+    return m_queue_size == 0;
   }
 
   rtRemoteConfig const*     Config;
   rtRemoteServer*           Server;
   rtRemoteObjectCache*      ObjectCache;
   rtRemoteStreamSelector*   StreamSelector;
+  rtRemoteChannelSender*    ChannelSender;
 
   using rtRemoteQueueReady = void (*)(void*);
 
@@ -60,26 +63,55 @@ private:
     Dispatched
   };
 
-  using ResponseHandlerMap = std::map< rtRemoteCorrelationKey, rtRemoteCallback<rtRemoteMessageHandler> >;
-  using ResponseMap = std::map< rtRemoteCorrelationKey, ResponseState >;
+  // only a handful of requests are ever outstanding. flat lists get reused
+  // from one request to the next where a map allocates a node for each
+  using ResponseHandler = std::pair< rtRemoteCorrelationKey, rtRemoteCallback<rtRemoteMessageHandler> >;
+  using ResponseHandlerList = std::vector<ResponseHandler>;
+  using ResponseWaiter = std::pair< rtRemoteCorrelationKey, ResponseState >;
+  using ResponseWaiterList = std::vector<ResponseWaiter>;
 
   void processRunQueue();
+  void pushWorkItem(WorkItem const& workItem);
+  bool popWorkItem(WorkItem& workItem);
+
+  template<class T>
+  static typename std::vector<T>::iterator find(std::vector<T>& list, rtRemoteCorrelationKey const& k)
+  {
+    auto itr = list.begin();
+    while (itr != list.end() && itr->first != k)
+      ++itr;
+    return itr;
+  }
+
+  template<class T>
+  static void erase(std::vector<T>& list, typename std::vector<T>::iterator itr)
+  {
+    if (itr != list.end() - 1)
+      *itr = list.back();
+    list.pop_back();
+  }
 
   inline bool haveResponse(rtRemoteCorrelationKey k) const
   {
-    auto itr = m_waiters.find(k);
-    return (itr != m_waiters.end()) && (itr->second == ResponseState::Dispatched);
+    for (ResponseWaiter const& w : m_waiters)
+    {
+      if (w.first == k)
+        return w.second == ResponseState::Dispatched;
+    }
+    return false;
   }
 
   using thread_ptr = std::unique_ptr<std::thread>;
 
   mutable std::mutex            m_queue_mutex;
   std::condition_variable       m_queue_cond;
-  std::queue<WorkItem>          m_queue;
+  std::vector<WorkItem>         m_queue;
+  size_t                        m_queue_head;
+  size_t                        m_queue_size;
   std::vector< thread_ptr >     m_workers;
   bool                          m_running;
-  ResponseHandlerMap            m_response_handlers;
-  ResponseMap                   m_waiters;
+  ResponseHandlerList           m_response_handlers;
+  ResponseWaiterList            m_waiters;
   rtRemoteQueueReady            m_queue_ready_handler;
   void*                         m_queue_ready_context;
 };
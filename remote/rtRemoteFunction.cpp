@@ -21,6 +21,7 @@ rtRemoteFunction::~rtRemoteFunction()
   if (!strcmp(m_id.c_str(), "global"))
   {
     m_client->removeKeepAliveForObject(m_name);
+    m_client->queueDeref(m_name);
   }
   Release();
 }
@@ -50,7 +51,5 @@ rtRemoteFunction::Release()
   unsigned long n = rtAtomicDec(&m_ref_count);
   if (n == 0)
     delete this;
-
-  // TODO: send deref here
   return n;
 }
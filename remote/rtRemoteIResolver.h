@@ -1,8 +1,10 @@
 #ifndef __RT_REMOTE_OBJECT_RESOLVER_H__
 #define __RT_REMOTE_OBJECT_RESOLVER_H__
 
+#include <map>
 #include <memory>
 #include <string>
+#include <vector>
 #include <rtError.h>
 #include <sys/socket.h>
 #include <stdint.h>
@@ -18,6 +20,29 @@ public:
   virtual rtError registerObject(std::string const& name, sockaddr_storage const& endpoint) = 0;
   virtual rtError locateObject(std::string const& name, sockaddr_storage& endpoint, uint32_t timeout) = 0;
   virtual rtError unregisterObject(std::string const& name) = 0;
+
+  // Locate several objects at once. Resolvers that can put all the names in a
+  // single request override this, the default looks them up one at a time.
+  // Returns RT_OK only if every name was found.
+  virtual rtError locateObjects(std::vector<std::string> const& names,
+    std::map<std::string, sockaddr_storage>& endpoints, uint32_t timeout)
+  {
+    rtError result = RT_OK;
+    for (std::string const& name : names)
+    {
+      sockaddr_storage endpoint;
+      rtError e = locateObject(name, endpoint, timeout);
+      if (e == RT_OK)
+        endpoints[name] = endpoint;
+      else
+        result = RT_RESOURCE_NOT_FOUND;
+    }
+    return result;
+  }
+
+  // forget what's known about where name lives, e.g. after connecting to it
+  // failed
+  virtual void invalidateObject(std::string const& /*name*/) { }
 };
 
 #endif
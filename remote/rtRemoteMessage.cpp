@@ -1,5 +1,6 @@
 #include "rtRemoteMessage.h"
 #include "rtRemoteClient.h"
+#include "rtRemoteSocketUtils.h"
 #include "rtRemoteValueReader.h"
 #include "rtRemoteValueWriter.h"
 #include "rtError.h"
@@ -11,6 +12,9 @@
 
 #include <atomic>
 #include <memory>
+#include <mutex>
+#include <vector>
+#include <stdlib.h>
 
 #include <rapidjson/document.h>
 #include <rapidjson/memorystream.h>
@@ -24,7 +28,63 @@ namespace
   std::atomic<rtRemoteCorrelationKey> s_next_key;
   #endif
 
-  void dumpDoc(rapidjson::Document const& doc, char const* fmt, ...)
+  // the arena covers the common request/response without going to the heap.
+  // larger messages spill into chunks that are released on the next reset
+  size_t const kMessageArenaSize = 4096;
+  size_t const kMaxPooledMessages = 128;
+
+  struct PooledMessage
+  {
+    PooledMessage()
+      : Allocator(Arena, sizeof(Arena), kMessageArenaSize)
+      , Message(&Allocator)
+    { }
+
+    uint64_t                          Arena[kMessageArenaSize / sizeof(uint64_t)];
+    rapidjson::MemoryPoolAllocator<>  Allocator;
+    rtRemoteMessage                   Message;
+  };
+
+  std::mutex sMessagePoolMutex;
+  std::vector< std::shared_ptr<PooledMessage> > sMessagePool;
+  size_t sNextPooledMessage = 0;
+
+  // a parse uses two stacks, the document's and the reader's. blocks bigger
+  // than kMaxCachedStackSize aren't kept
+  int const kCachedStackBlocks = 2;
+  size_t const kMaxCachedStackSize = 64 * 1024;
+
+  // every block carries its capacity up front, Free() only gets the pointer
+  size_t const kStackHeaderSize = 16;
+
+  struct CachedStackBlocks
+  {
+    CachedStackBlocks()
+    {
+      for (int i = 0; i < kCachedStackBlocks; ++i)
+        Blocks[i] = nullptr;
+    }
+
+    ~CachedStackBlocks()
+    {
+      for (int i = 0; i < kCachedStackBlocks; ++i)
+      {
+        free(Blocks[i]);
+        Blocks[i] = nullptr;
+      }
+    }
+
+    char* Blocks[kCachedStackBlocks];
+  };
+
+  thread_local CachedStackBlocks sCachedStack;
+
+  inline size_t& stackCapacity(char* block)
+  {
+    return *reinterpret_cast<size_t *>(block);
+  }
+
+  void dumpDoc(rtRemoteMessage const& doc, char const* fmt, ...)
   {
     char msg[256];
     memset(msg, 0, sizeof(msg));
@@ -42,6 +102,105 @@ namespace
   }
 }
 
+void*
+rtRemoteParseStackAllocator::Malloc(size_t size)
+{
+  return Realloc(nullptr, 0, size);
+}
+
+void*
+rtRemoteParseStackAllocator::Realloc(void* originalPtr, size_t /*originalSize*/, size_t newSize)
+{
+  if (newSize == 0)
+  {
+    Free(originalPtr);
+    return nullptr;
+  }
+
+  char* block = nullptr;
+  if (originalPtr != nullptr)
+  {
+    block = static_cast<char *>(originalPtr) - kStackHeaderSize;
+  }
+  else
+  {
+    for (int i = 0; i < kCachedStackBlocks; ++i)
+    {
+      char* cached = sCachedStack.Blocks[i];
+      if (cached != nullptr && stackCapacity(cached) >= newSize)
+      {
+        sCachedStack.Blocks[i] = nullptr;
+        return cached + kStackHeaderSize;
+      }
+    }
+  }
+
+  block = static_cast<char *>(realloc(block, newSize + kStackHeaderSize));
+  if (block == nullptr)
+    return nullptr;
+
+  stackCapacity(block) = newSize;
+  return block + kStackHeaderSize;
+}
+
+void
+rtRemoteParseStackAllocator::Free(void* ptr)
+{
+  if (ptr == nullptr)
+    return;
+
+  char* block = static_cast<char *>(ptr) - kStackHeaderSize;
+  if (stackCapacity(block) <= kMaxCachedStackSize)
+  {
+    // keep the block in an empty slot, or in place of a smaller one
+    for (int i = 0; i < kCachedStackBlocks; ++i)
+    {
+      char*& cached = sCachedStack.Blocks[i];
+      if (cached == nullptr || stackCapacity(cached) < stackCapacity(block))
+      {
+        std::swap(cached, block);
+        if (block == nullptr)
+          return;
+      }
+    }
+  }
+  free(block);
+}
+
+rtRemoteMessagePtr
+rtMessage_Create()
+{
+  std::unique_lock<std::mutex> lock(sMessagePoolMutex);
+
+  size_t const n = sMessagePool.size();
+  for (size_t i = 0; i < n; ++i)
+  {
+    size_t const index = (sNextPooledMessage + i) % n;
+    std::shared_ptr<PooledMessage> const& entry = sMessagePool[index];
+
+    // only the pool holds it. whoever dropped the last reference did so with
+    // release semantics, the fence makes their writes visible before reuse
+    if (entry.use_count() == 1)
+    {
+      std::atomic_thread_fence(std::memory_order_acquire);
+      sNextPooledMessage = index + 1;
+      entry->Message.SetNull();
+      entry->Allocator.Clear();
+      return rtRemoteMessagePtr(entry, &entry->Message);
+    }
+  }
+
+  if (n < kMaxPooledMessages)
+  {
+    std::shared_ptr<PooledMessage> entry(new PooledMessage());
+    sMessagePool.push_back(entry);
+    return rtRemoteMessagePtr(entry, &entry->Message);
+  }
+
+  lock.unlock();
+  return rtRemoteMessagePtr(new rtRemoteMessage());
+}
+
 rtRemoteCorrelationKey
 rtMessage_GetNextCorrelationKey()
 {
@@ -77,7 +236,7 @@ from_json<uint32_t>(rapidjson::GenericValue<rapidjson::UTF8<> > const& v)
 }
 
 char const*
-rtMessage_GetPropertyName(rapidjson::Document const& doc)
+rtMessage_GetPropertyName(rtRemoteMessage const& doc)
 {
   rapidjson::Value::ConstMemberIterator itr = doc.FindMember(kFieldNamePropertyName);
   return itr != doc.MemberEnd() 
@@ -86,7 +245,7 @@ rtMessage_GetPropertyName(rapidjson::Document const& doc)
 }
 
 uint32_t
-rtMessage_GetPropertyIndex(rapidjson::Document const& doc)
+rtMessage_GetPropertyIndex(rtRemoteMessage const& doc)
 {
   rapidjson::Value::ConstMemberIterator itr = doc.FindMember(kFieldNamePropertyIndex);
   return itr != doc.MemberEnd() 
@@ -94,8 +253,17 @@ rtMessage_GetPropertyIndex(rapidjson::Document const& doc)
     : kInvalidPropertyIndex;
 }
 
+uint64_t
+rtMessage_GetPropertyVersion(rtRemoteMessage const& doc)
+{
+  rapidjson::Value::ConstMemberIterator itr = doc.FindMember(kFieldNamePropertyVersion);
+  return itr != doc.MemberEnd()
+    ? itr->value.GetUint64()
+    : 0;
+}
+
 char const*
-rtMessage_GetMessageType(rapidjson::Document const& doc)
+rtMessage_GetMessageType(rtRemoteMessage const& doc)
 {
   rapidjson::Value::ConstMemberIterator itr = doc.FindMember(kFieldNameMessageType);
   return itr != doc.MemberEnd() 
@@ -104,7 +272,7 @@ rtMessage_GetMessageType(rapidjson::Document const& doc)
 }
 
 rtRemoteCorrelationKey
-rtMessage_GetCorrelationKey(rapidjson::Document const& doc)
+rtMessage_GetCorrelationKey(rtRemoteMessage const& doc)
 {
   rtRemoteCorrelationKey k = kInvalidCorrelationKey;
   rapidjson::Value::ConstMemberIterator itr = doc.FindMember(kFieldNameCorrelationKey);
@@ -122,7 +290,7 @@ rtMessage_GetCorrelationKey(rapidjson::Document const& doc)
 }
 
 char const*
-rtMessage_GetObjectId(rapidjson::Document const& doc)
+rtMessage_GetObjectId(rtRemoteMessage const& doc)
 {
   rapidjson::Value::ConstMemberIterator itr = doc.FindMember(kFieldNameObjectId);
   return itr != doc.MemberEnd() 
@@ -131,7 +299,23 @@ rtMessage_GetObjectId(rapidjson::Document const& doc)
 }
 
 rtError
-rtMessage_GetStatusCode(rapidjson::Document const& doc)
+rtMessage_GetEndpoint(rapidjson::Value const& v, char const** objectId, sockaddr_storage& endpoint)
+{
+  if (!v.IsObject())
+    return RT_ERROR_PROTOCOL_ERROR;
+
+  rapidjson::Value::ConstMemberIterator id = v.FindMember(kFieldNameObjectId);
+  rapidjson::Value::ConstMemberIterator ip = v.FindMember(kFieldNameIp);
+  rapidjson::Value::ConstMemberIterator port = v.FindMember(kFieldNamePort);
+  if (id == v.MemberEnd() || ip == v.MemberEnd() || port == v.MemberEnd())
+    return RT_ERROR_PROTOCOL_ERROR;
+
+  *objectId = id->value.GetString();
+  return rtParseAddress(endpoint, ip->value.GetString(), port->value.GetInt(), nullptr);
+}
+
+rtError
+rtMessage_GetStatusCode(rtRemoteMessage const& doc)
 {
   rapidjson::Value::ConstMemberIterator itr = doc.FindMember(kFieldNameStatusCode);
   if (itr == doc.MemberEnd())
@@ -141,7 +325,7 @@ rtMessage_GetStatusCode(rapidjson::Document const& doc)
 }
 
 char const*
-rtMessage_GetStatusMessage(rapidjson::Document const& doc)
+rtMessage_GetStatusMessage(rtRemoteMessage const& doc)
 {
   rapidjson::Value::ConstMemberIterator itr = doc.FindMember(kFieldNameStatusMessage);
   return itr != doc.MemberEnd() 
@@ -150,7 +334,7 @@ rtMessage_GetStatusMessage(rapidjson::Document const& doc)
 }
 
 rtError
-rtMessage_DumpDocument(rapidjson::Document const& doc, FILE* out)
+rtMessage_DumpDocument(rtRemoteMessage const& doc, FILE* out)
 {
   if (out == nullptr)
     out = stdout;
@@ -161,8 +345,21 @@ rtMessage_DumpDocument(rapidjson::Document const& doc, FILE* out)
   return RT_OK;
 }
 
+void
+rtMessage_SetCorrelationKey(rtRemoteMessage& doc, rtRemoteCorrelationKey k)
+{
+  #ifdef RT_REMOTE_CORRELATION_KEY_IS_INT
+  doc.AddMember(kFieldNameCorrelationKey, k, doc.GetAllocator());
+  #else
+  char buff[rtGuid::kStringLength + 1];
+  rapidjson::Value key;
+  key.SetString(k.toString(buff), rtGuid::kStringLength, doc.GetAllocator());
+  doc.AddMember(kFieldNameCorrelationKey, key, doc.GetAllocator());
+  #endif
+}
+
 rtError
-rtMessage_SetStatus(rapidjson::Document& doc, rtError code)
+rtMessage_SetStatus(rtRemoteMessage& doc, rtError code)
 {
   rtError e = RT_OK;
   doc.AddMember(kFieldNameStatusCode, code, doc.GetAllocator());
@@ -170,7 +367,7 @@ rtMessage_SetStatus(rapidjson::Document& doc, rtError code)
 }
 
 rtError
-rtMessage_SetStatus(rapidjson::Document& doc, rtError code, char const* fmt, ...)
+rtMessage_SetStatus(rtRemoteMessage& doc, rtError code, char const* fmt, ...)
 {
   rtError e = RT_OK;
   doc.AddMember(kFieldNameStatusCode, code, doc.GetAllocator());
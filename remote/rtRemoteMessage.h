@@ -6,6 +6,7 @@
 #include <rapidjson/document.h>
 #include <rtError.h>
 #include <rtValue.h>
+#include <sys/socket.h>
 
 #include "rtLog.h"
 #include "rtRemoteCorrelationKey.h"
@@ -13,8 +14,12 @@
 #define kFieldNameMessageType "message.type"
 #define kFieldNameCorrelationKey "correlation.key"
 #define kFieldNameObjectId "object.id"
+#define kFieldNameObjectIds "object.ids"
+#define kFieldNameEndpoints "endpoints"
 #define kFieldNamePropertyName "property.name"
 #define kFieldNamePropertyIndex "property.index"
+#define kFieldNamePropertyVersion "property.version"
+#define kFieldNamePropertySubscribe "property.subscribe"
 #define kFieldNameStatusCode "status.code"
 #define kFieldNameStatusMessage "status.message"
 #define kFieldNameFunctionName "function.name"
@@ -24,8 +29,12 @@
 #define kFieldNameValue "value"
 #define kFieldNameValueType "type"
 #define kFieldNameValueValue "value"
+#define kFieldNameChannelId "channel.id"
+#define kFieldNameChannelLength "channel.length"
 #define kFieldNameSenderId "sender.id"
 #define kFieldNameKeepAliveIds "keep_alive.ids"
+#define kFieldNameDerefIds "deref.ids"
+#define kFieldNameUnsubscribeIds "unsubscribe.ids"
 #define kFieldNameIp "ip"
 #define kFieldNamePort "port"
 #define kFieldNamePath "path"
@@ -49,9 +58,13 @@
 #define kMessageTypeKeepAliveResponse "keep_alive.response"
 #define kMessageTypeSearch "search"
 #define kMessageTypeLocate "locate"
+#define kMessageTypeAnnounce "announce"
+#define kMessageTypeWithdraw "withdraw"
 #define kMessageTypeMethodCallRequest "method.call.request"
 #define kMessageTypeKeepAliveRequest "keep_alive.request"
+#define kMessageTypeDerefRequest "deref.request"
 #define kMessageTypeOpenSessionRequest "session.open.request"
+#define kMessageTypePropertyChanged "property.changed"
 
 #define kInvalidPropertyIndex std::numeric_limits<uint32_t>::max()
 
@@ -73,11 +86,30 @@
 #define kNsStatusSuccess "ns.status.success"
 #define kNsStatusFail "ns.status.fail"
 
-using rtRemoteMessage     = rapidjson::Document;
+// Parse stack for rtRemoteMessage. rapidjson frees the parse stack at the end
+// of every ParseStream(), this keeps the last block around on the parsing
+// thread so steady state parsing doesn't go back to the heap.
+class rtRemoteParseStackAllocator
+{
+public:
+  static const bool kNeedFree = true;
+  void* Malloc(size_t size);
+  void* Realloc(void* originalPtr, size_t originalSize, size_t newSize);
+  static void Free(void* ptr);
+};
+
+using rtRemoteMessage     = rapidjson::GenericDocument<rapidjson::UTF8<>,
+  rapidjson::MemoryPoolAllocator<>, rtRemoteParseStackAllocator>;
 using rtRemoteMessagePtr  = std::shared_ptr<rtRemoteMessage>;
 
+// Returns an empty message from a process wide pool. Each pooled message
+// carries its own arena, which is reset when the message is handed out again
+// once the last reference has been dropped.
+rtRemoteMessagePtr      rtMessage_Create();
+
 char const*             rtMessage_GetPropertyName(rtRemoteMessage const& m);
 uint32_t                rtMessage_GetPropertyIndex(rtRemoteMessage const& m);
+uint64_t                rtMessage_GetPropertyVersion(rtRemoteMessage const& m);
 char const*             rtMessage_GetMessageType(rtRemoteMessage const& m);
 rtRemoteCorrelationKey  rtMessage_GetCorrelationKey(rtRemoteMessage const& m);
 char const*             rtMessage_GetObjectId(rtRemoteMessage const& m);
@@ -86,6 +118,12 @@ char const*             rtMessage_GetStatusMessage(rtRemoteMessage const& m);
 rtError                 rtMessage_Dump(rtRemoteMessage const& m, FILE* out = stdout);
 rtError                 rtMessage_SetStatus(rtRemoteMessage& m, rtError code, char const* fmt, ...) RT_PRINTF_FORMAT(3, 4);
 rtError                 rtMessage_SetStatus(rtRemoteMessage& m, rtError code);
+void                    rtMessage_SetCorrelationKey(rtRemoteMessage& m, rtRemoteCorrelationKey k);
 rtRemoteCorrelationKey  rtMessage_GetNextCorrelationKey();
 
+// reads an { object.id, ip, port } record, as found in resolver replies and
+// announcements
+rtError                 rtMessage_GetEndpoint(rapidjson::Value const& v, char const** objectId,
+                          sockaddr_storage& endpoint);
+
 #endif
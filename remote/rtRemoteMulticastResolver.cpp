@@ -4,6 +4,7 @@
 #include "rtRemoteConfig.h"
 #include "rtRemoteEnvironment.h"
 
+#include <algorithm>
 #include <condition_variable>
 #include <thread>
 #include <mutex>
@@ -32,6 +33,12 @@
 #include <rapidjson/filewritestream.h>
 #include <rapidjson/pointer.h>
 
+namespace
+{
+  // keeps a batch search well inside a single datagram
+  size_t const kMaxNamesPerSearch = 64;
+}
+
 rtRemoteMulticastResolver::rtRemoteMulticastResolver(rtRemoteEnvironment* env)
   : m_mcast_fd(-1)
   , m_mcast_src_index(-1)
@@ -39,6 +46,7 @@ rtRemoteMulticastResolver::rtRemoteMulticastResolver(rtRemoteEnvironment* env)
   , m_ucast_len(0)
   , m_pid(getpid())
   , m_command_handlers()
+  , m_cache(env)
   , m_env(env)
 {
   memset(&m_mcast_dest, 0, sizeof(m_mcast_dest));
@@ -47,6 +55,8 @@ rtRemoteMulticastResolver::rtRemoteMulticastResolver(rtRemoteEnvironment* env)
 
   m_command_handlers.insert(CommandHandlerMap::value_type(kMessageTypeSearch, &rtRemoteMulticastResolver::onSearch));
   m_command_handlers.insert(CommandHandlerMap::value_type(kMessageTypeLocate, &rtRemoteMulticastResolver::onLocate));
+  m_command_handlers.insert(CommandHandlerMap::value_type(kMessageTypeAnnounce, &rtRemoteMulticastResolver::onAnnounce));
+  m_command_handlers.insert(CommandHandlerMap::value_type(kMessageTypeWithdraw, &rtRemoteMulticastResolver::onWithdraw));
 
   m_shutdown_pipe[0] = -1;
   m_shutdown_pipe[1] = -1;
@@ -66,68 +76,60 @@ rtRemoteMulticastResolver::~rtRemoteMulticastResolver()
     rtLogWarn("failed to close resolver: %s", rtStrError(err));
 }
 
-rtError rtRemoteMulticastResolver::sendSearchAndWait(const std::string& name, const int timeout, rtRemoteMessagePtr& response)
+rtError
+rtRemoteMulticastResolver::sendSearch(std::vector<std::string> const& names)
 {
+  std::string const replyTo = rtSocketToString(m_ucast_endpoint);
 
-  rtRemoteCorrelationKey seqId = rtMessage_GetNextCorrelationKey();
-
-  rapidjson::Document doc;
-  doc.SetObject();
-  doc.AddMember(kFieldNameMessageType, kMessageTypeSearch, doc.GetAllocator());
-  doc.AddMember(kFieldNameObjectId, name, doc.GetAllocator());
-  doc.AddMember(kFieldNameSenderId, m_pid, doc.GetAllocator());
-  doc.AddMember(kFieldNameCorrelationKey, seqId.toString(), doc.GetAllocator());
-
-  // m_ucast_endpoint
+  for (size_t i = 0; i < names.size(); i += kMaxNamesPerSearch)
   {
-    std::string responseEndpoint = rtSocketToString(m_ucast_endpoint);
-    doc.AddMember(kFieldNameReplyTo, responseEndpoint, doc.GetAllocator());
-  }
+    size_t const n = std::min(names.size() - i, kMaxNamesPerSearch);
 
+    rtRemoteMessage doc;
+    doc.SetObject();
+    doc.AddMember(kFieldNameMessageType, kMessageTypeSearch, doc.GetAllocator());
 
-  rtRemoteMessagePtr searchResponse;
-  RequestMap::const_iterator itr;
+    // a single name goes out the way it always did, so older peers still answer
+    if (n == 1)
+    {
+      doc.AddMember(kFieldNameObjectId, names[i], doc.GetAllocator());
+    }
+    else
+    {
+      rapidjson::Value ids(rapidjson::kArrayType);
+      for (size_t j = i; j < i + n; ++j)
+        ids.PushBack(rapidjson::Value(names[j], doc.GetAllocator()), doc.GetAllocator());
+      doc.AddMember(kFieldNameObjectIds, ids, doc.GetAllocator());
+    }
 
-  using namespace std::chrono;
-  auto iterationIncrement = milliseconds(m_env->Config->resolver_spin_init_ms());
-  auto iterationTime = system_clock::now() + iterationIncrement;
-  auto timeout_ = system_clock::now() + milliseconds(timeout);
-
-  // wait here until timeout expires or we get a response that matches out pid/seqid
-  std::unique_lock<std::mutex> lock(m_mutex);
-  itr = m_pending_searches.end();
-  do {
+    doc.AddMember(kFieldNameSenderId, m_pid, doc.GetAllocator());
+    doc.AddMember(kFieldNameReplyTo, replyTo, doc.GetAllocator());
+    rtMessage_SetCorrelationKey(doc, rtMessage_GetNextCorrelationKey());
 
     rtError err = rtSendDocument(doc, m_ucast_fd, &m_mcast_dest);
     if (err != RT_OK)
       return err;
+  }
 
-    rtLogInfo("Spinning for %llu ms", static_cast<long long unsigned int>(milliseconds(iterationIncrement).count()));
-
-    m_cond.wait_until(lock, iterationTime, [this, seqId, &searchResponse] {
-      auto itr = this->m_pending_searches.find(seqId);
-      if (itr != this->m_pending_searches.end()) {
-        searchResponse = itr->second;
-        this->m_pending_searches.erase(itr);
-      }
-      return searchResponse != nullptr;
-    });
-
-    if (searchResponse)
-    {
-      rtLogInfo("Search response received for %s", seqId.toString().c_str());
-      break;
-    }
-
-    iterationIncrement += milliseconds(m_env->Config->resolver_spin_iteration_ms());
-    iterationTime = system_clock::now() + iterationIncrement;
+  return RT_OK;
+}
 
-  } while (system_clock::now() < timeout_);
+rtError
+rtRemoteMulticastResolver::sendAnnouncement(char const* type, std::string const& name)
+{
+  if (m_ucast_fd == -1)
+    return RT_OK;
 
-  lock.unlock();
+  rtRemoteMessage doc;
+  doc.SetObject();
+  doc.AddMember(kFieldNameMessageType, rapidjson::StringRef(type), doc.GetAllocator());
+  doc.AddMember(kFieldNameObjectId, name, doc.GetAllocator());
+  doc.AddMember(kFieldNameIp, m_rpc_addr, doc.GetAllocator());
+  doc.AddMember(kFieldNamePort, m_rpc_port, doc.GetAllocator());
+  doc.AddMember(kFieldNameSenderId, m_pid, doc.GetAllocator());
+  rtMessage_SetCorrelationKey(doc, rtMessage_GetNextCorrelationKey());
 
-  response = searchResponse;
-  return searchResponse ? RT_OK : RT_RESOURCE_NOT_FOUND;
+  return rtSendDocument(doc, m_ucast_fd, &m_mcast_dest);
 }
 
 rtError
@@ -387,55 +389,151 @@ rtRemoteMulticastResolver::onSearch(rtRemoteMessagePtr const& doc, sockaddr_stor
 
   rtRemoteCorrelationKey key = rtMessage_GetCorrelationKey(*doc);
 
-  auto itr = m_hosted_objects.end();
+  rtRemoteMessage res;
+  res.SetObject();
+  res.AddMember(kFieldNameMessageType, kMessageTypeLocate, res.GetAllocator());
 
   char const* objectId = rtMessage_GetObjectId(*doc);
+  auto objectIds = doc->FindMember(kFieldNameObjectIds);
 
   std::unique_lock<std::mutex> lock(m_mutex);
-  itr = m_hosted_objects.find(objectId);
-  lock.unlock();
+  if (objectId != nullptr)
+  {
+    if (m_hosted_objects.find(objectId) == m_hosted_objects.end())
+      return RT_OK;
 
-  if (itr != m_hosted_objects.end())
+    res.AddMember(kFieldNameObjectId, std::string(objectId), res.GetAllocator());
+    res.AddMember(kFieldNameIp, m_rpc_addr, res.GetAllocator());
+    res.AddMember(kFieldNamePort, m_rpc_port, res.GetAllocator());
+  }
+  else if (objectIds != doc->MemberEnd() && objectIds->value.IsArray())
   {
-    rapidjson::Document doc;
-    doc.SetObject();
-    doc.AddMember(kFieldNameMessageType, kMessageTypeLocate, doc.GetAllocator());
-    doc.AddMember(kFieldNameObjectId, std::string(objectId), doc.GetAllocator());
-    doc.AddMember(kFieldNameIp, m_rpc_addr, doc.GetAllocator());
-    doc.AddMember(kFieldNamePort, m_rpc_port, doc.GetAllocator());
-    doc.AddMember(kFieldNameSenderId, senderId->value.GetInt(), doc.GetAllocator());
-    doc.AddMember(kFieldNameCorrelationKey, key.toString(), doc.GetAllocator());
-
-    sockaddr_storage replyToAddress;
-    rtError err = rtParseAddress(replyToAddress, replyTo->value.GetString());
-    if (err != RT_OK)
+    // batch search, answer with the names we host. nothing at all if none
+    rapidjson::Value endpoints(rapidjson::kArrayType);
+    for (rapidjson::Value::ConstValueIterator id = objectIds->value.Begin(); id != objectIds->value.End(); ++id)
     {
-      rtLogWarn("failed to parse reply-to address. %s", rtStrError(err));
-      return err;
+      if (!id->IsString() || m_hosted_objects.find(id->GetString()) == m_hosted_objects.end())
+        continue;
+
+      rapidjson::Value endpoint(rapidjson::kObjectType);
+      endpoint.AddMember(kFieldNameObjectId, std::string(id->GetString()), res.GetAllocator());
+      endpoint.AddMember(kFieldNameIp, m_rpc_addr, res.GetAllocator());
+      endpoint.AddMember(kFieldNamePort, m_rpc_port, res.GetAllocator());
+      endpoints.PushBack(endpoint, res.GetAllocator());
     }
 
+    if (endpoints.Empty())
+      return RT_OK;
 
-    return rtSendDocument(doc, m_ucast_fd, &replyToAddress);
+    res.AddMember(kFieldNameEndpoints, endpoints, res.GetAllocator());
   }
-  
-  return RT_OK;
+  else
+  {
+    return RT_ERROR_PROTOCOL_ERROR;
+  }
+  lock.unlock();
+
+  res.AddMember(kFieldNameSenderId, senderId->value.GetInt(), res.GetAllocator());
+  rtMessage_SetCorrelationKey(res, key);
+
+  sockaddr_storage replyToAddress;
+  rtError err = rtParseAddress(replyToAddress, replyTo->value.GetString());
+  if (err != RT_OK)
+  {
+    rtLogWarn("failed to parse reply-to address. %s", rtStrError(err));
+    return err;
+  }
+
+  return rtSendDocument(res, m_ucast_fd, &replyToAddress);
 }
 
 rtError
 rtRemoteMulticastResolver::onLocate(rtRemoteMessagePtr const& doc, sockaddr_storage const& /*soc*/)
 {
-  rtRemoteCorrelationKey key = rtMessage_GetCorrelationKey(*doc);
+  auto const now = std::chrono::steady_clock::now();
+
+  char const* objectId = nullptr;
+  sockaddr_storage endpoint;
+  rtError err = RT_OK;
 
   std::unique_lock<std::mutex> lock(m_mutex);
-  m_pending_searches[key] = doc;
+  auto endpoints = doc->FindMember(kFieldNameEndpoints);
+  if (endpoints != doc->MemberEnd() && endpoints->value.IsArray())
+  {
+    for (rapidjson::Value::ConstValueIterator v = endpoints->value.Begin(); v != endpoints->value.End(); ++v)
+    {
+      err = rtMessage_GetEndpoint(*v, &objectId, endpoint);
+      if (err != RT_OK)
+        break;
+      m_cache.insert(objectId, endpoint, now);
+    }
+  }
+  else
+  {
+    err = rtMessage_GetEndpoint(*doc, &objectId, endpoint);
+    if (err == RT_OK)
+      m_cache.insert(objectId, endpoint, now);
+  }
   lock.unlock();
   m_cond.notify_all();
 
+  return err;
+}
+
+rtError
+rtRemoteMulticastResolver::onAnnounce(rtRemoteMessagePtr const& doc, sockaddr_storage const& /*soc*/)
+{
+  auto senderId = doc->FindMember(kFieldNameSenderId);
+  if (senderId != doc->MemberEnd() && senderId->value.GetInt() == m_pid)
+    return RT_OK;
+
+  char const* objectId = nullptr;
+  sockaddr_storage endpoint;
+  rtError err = rtMessage_GetEndpoint(*doc, &objectId, endpoint);
+  if (err != RT_OK)
+    return err;
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_cache.insert(objectId, endpoint, std::chrono::steady_clock::now());
+  lock.unlock();
+  m_cond.notify_all();
+
+  return RT_OK;
+}
+
+rtError
+rtRemoteMulticastResolver::onWithdraw(rtRemoteMessagePtr const& doc, sockaddr_storage const& /*soc*/)
+{
+  auto senderId = doc->FindMember(kFieldNameSenderId);
+  if (senderId != doc->MemberEnd() && senderId->value.GetInt() == m_pid)
+    return RT_OK;
+
+  char const* objectId = rtMessage_GetObjectId(*doc);
+  if (objectId == nullptr)
+    return RT_ERROR_PROTOCOL_ERROR;
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_cache.erase(objectId);
   return RT_OK;
 }
 
 rtError
 rtRemoteMulticastResolver::locateObject(std::string const& name, sockaddr_storage& endpoint, uint32_t timeout)
+{
+  std::vector<std::string> names(1, name);
+  std::map<std::string, sockaddr_storage> endpoints;
+
+  rtError err = locateObjects(names, endpoints, timeout);
+  if (err != RT_OK)
+    return err;
+
+  endpoint = endpoints[name];
+  return RT_OK;
+}
+
+rtError
+rtRemoteMulticastResolver::locateObjects(std::vector<std::string> const& names,
+  std::map<std::string, sockaddr_storage>& endpoints, uint32_t timeout)
 {
   if (m_ucast_fd == -1)
   {
@@ -443,22 +541,87 @@ rtRemoteMulticastResolver::locateObject(std::string const& name, sockaddr_storag
     return RT_FAIL;
   }
 
-  rtRemoteMessagePtr searchResponse;
-  rtError err = sendSearchAndWait(name, timeout, searchResponse);
-  if (err != RT_OK)
-    return err;
+  using namespace std::chrono;
+  auto const start = steady_clock::now();
+  auto const deadline = start + milliseconds(timeout);
 
-  // response is in itr
-  RT_ASSERT(searchResponse->HasMember(kFieldNameIp));
-  RT_ASSERT(searchResponse->HasMember(kFieldNamePort));
+  // names that were searched for recently without an answer are not searched
+  // again until their negative entry expires
+  std::vector<std::string> unresolved;
+  bool notFound = false;
 
-  err = rtParseAddress(endpoint, (*searchResponse)[kFieldNameIp].GetString(),
-      (*searchResponse)[kFieldNamePort].GetInt(), nullptr);
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for (std::string const& name : names)
+  {
+    sockaddr_storage endpoint;
+    switch (m_cache.find(name, start, endpoint))
+    {
+      case rtRemoteResolverCache::Status::Found:
+        endpoints[name] = endpoint;
+        break;
+      case rtRemoteResolverCache::Status::NotFound:
+        notFound = true;
+        break;
+      case rtRemoteResolverCache::Status::Unknown:
+        if (std::find(unresolved.begin(), unresolved.end(), name) == unresolved.end())
+          unresolved.push_back(name);
+        break;
+    }
+  }
+  lock.unlock();
 
-  if (err != RT_OK)
-    return err;
+  auto iterationIncrement = milliseconds(m_env->Config->resolver_spin_init_ms());
+  while (!unresolved.empty())
+  {
+    rtError err = sendSearch(unresolved);
+    if (err != RT_OK)
+      return err;
 
-  return RT_OK;
+    rtLogInfo("Spinning for %llu ms on %d names",
+      static_cast<long long unsigned int>(iterationIncrement.count()),
+      static_cast<int>(unresolved.size()));
+
+    // replies go into the cache, pick up the ones that came in since we started
+    auto const iterationTime = std::min(steady_clock::now() + iterationIncrement, deadline);
+
+    lock.lock();
+    m_cond.wait_until(lock, iterationTime, [this, start, &unresolved, &endpoints]
+    {
+      auto resolved = std::remove_if(unresolved.begin(), unresolved.end(),
+        [this, start, &endpoints](std::string const& name)
+        {
+          sockaddr_storage endpoint;
+          if (!this->m_cache.foundSince(name, start, endpoint))
+            return false;
+          endpoints[name] = endpoint;
+          return true;
+        });
+      unresolved.erase(resolved, unresolved.end());
+      return unresolved.empty();
+    });
+
+    auto const now = steady_clock::now();
+    if (now >= deadline)
+    {
+      for (std::string const& name : unresolved)
+        m_cache.insertNotFound(name, now);
+    }
+    lock.unlock();
+
+    if (now >= deadline)
+      break;
+
+    iterationIncrement += milliseconds(m_env->Config->resolver_spin_iteration_ms());
+  }
+
+  return (notFound || !unresolved.empty()) ? RT_RESOURCE_NOT_FOUND : RT_OK;
+}
+
+void
+rtRemoteMulticastResolver::invalidateObject(std::string const& name)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_cache.erase(name);
 }
 
 void
@@ -600,6 +763,15 @@ rtRemoteMulticastResolver::registerObject(std::string const& name, sockaddr_stor
   std::unique_lock<std::mutex> lock(m_mutex);
   m_hosted_objects[name] = endpoint;
   lock.unlock(); // TODO this wasn't here before.  Make sure it's right to put it here
+
+  // let everyone listening know it's here, saves them the search
+  if (m_env->Config->resolver_announce())
+  {
+    rtError err = sendAnnouncement(kMessageTypeAnnounce, name);
+    if (err != RT_OK)
+      rtLogWarn("failed to announce %s. %s", name.c_str(), rtStrError(err));
+  }
+
   return RT_OK;
 }
 
@@ -619,5 +791,14 @@ rtRemoteMulticastResolver::unregisterObject(std::string const& name)
   {
     e = RT_ERROR_OBJECT_NOT_FOUND;
   }
+  lock.unlock();
+
+  if (e == RT_OK && m_env->Config->resolver_announce())
+  {
+    rtError err = sendAnnouncement(kMessageTypeWithdraw, name);
+    if (err != RT_OK)
+      rtLogWarn("failed to withdraw %s. %s", name.c_str(), rtStrError(err));
+  }
+
   return e;
 }
@@ -4,12 +4,14 @@
 #include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include <stdint.h>
 #include <netinet/in.h>
 #include <rtObject.h>
 
 #include "rtRemoteCorrelationKey.h"
+#include "rtRemoteResolverCache.h"
 #include "rtRemoteTypes.h"
 #include "rtRemoteSocketUtils.h"
 
@@ -29,18 +31,21 @@ public:
   virtual rtError locateObject(std::string const& name, sockaddr_storage& endpoint,
     uint32_t timeout) override;
   virtual rtError unregisterObject(std::string const& name);
+  virtual rtError locateObjects(std::vector<std::string> const& names,
+    std::map<std::string, sockaddr_storage>& endpoints, uint32_t timeout) override;
+  virtual void invalidateObject(std::string const& name) override;
 
 private:
   using CommandHandler = rtError (rtRemoteMulticastResolver::*)(rtRemoteMessagePtr const&, sockaddr_storage const&);
   using HostedObjectsMap = std::map< std::string, sockaddr_storage >;
   using CommandHandlerMap = std::map< std::string, CommandHandler >;
-  using RequestMap = std::map< rtRemoteCorrelationKey, rtRemoteMessagePtr >;
 
   void runListener();
   void doRead(int fd, rtRemoteSocketBuffer& buff);
   void doDispatch(char const* buff, int n, sockaddr_storage* peer);
 
-  rtError sendSearchAndWait(const std::string& name, const int timeout, rtRemoteMessagePtr& ret);
+  rtError sendSearch(std::vector<std::string> const& names);
+  rtError sendAnnouncement(char const* type, std::string const& name);
 
   rtError init();
   rtError openUnicastSocket();
@@ -49,6 +54,8 @@ private:
   // command handlers
   rtError onSearch(rtRemoteMessagePtr const& doc, sockaddr_storage const& soc);
   rtError onLocate(rtRemoteMessagePtr const& doc, sockaddr_storage const& soc);
+  rtError onAnnounce(rtRemoteMessagePtr const& doc, sockaddr_storage const& soc);
+  rtError onWithdraw(rtRemoteMessagePtr const& doc, sockaddr_storage const& soc);
 
 private:
   sockaddr_storage  m_mcast_dest;
@@ -68,7 +75,7 @@ private:
   std::string       m_rpc_addr;
   uint16_t          m_rpc_port;
   HostedObjectsMap  m_hosted_objects;
-  RequestMap	      m_pending_searches;
+  rtRemoteResolverCache m_cache;
   int		            m_shutdown_pipe[2];
   rtRemoteEnvironment* m_env;
 };
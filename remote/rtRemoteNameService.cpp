@@ -216,6 +216,30 @@ rtRemoteNameService::onUpdate(rtRemoteMessagePtr const& /*doc*/, sockaddr_storag
   return RT_OK;
 }
 
+void
+rtRemoteNameService::addEndpoint(rapidjson::Value& v, char const* objectId, sockaddr_storage const& endpoint,
+  rapidjson::MemoryPoolAllocator<>& alloc)
+{
+  // get IP and port
+  std::string       ep_addr;
+  uint16_t          ep_port;
+  char buff[128];
+
+  void* addr = nullptr;
+  rtGetInetAddr(endpoint, &addr);
+
+  socklen_t len;
+  rtSocketGetLength(endpoint, &len);
+  char const* p = inet_ntop(endpoint.ss_family, addr, buff, len);
+  if (p)
+    ep_addr = p;
+  rtGetPort(endpoint, &ep_port);
+
+  v.AddMember(kFieldNameObjectId, std::string(objectId), alloc);
+  v.AddMember(kFieldNameIp, ep_addr, alloc);
+  v.AddMember(kFieldNamePort, ep_port, alloc);
+}
+
 rtError
 rtRemoteNameService::onLookup(rtRemoteMessagePtr const& doc, sockaddr_storage const& soc)
 {
@@ -226,47 +250,59 @@ rtRemoteNameService::onLookup(rtRemoteMessagePtr const& doc, sockaddr_storage co
 
   rtRemoteCorrelationKey key = rtMessage_GetCorrelationKey(*doc);
 
-  auto itr = m_registered_objects.end();
-
   char const* objectId = rtMessage_GetObjectId(*doc);
+  auto objectIds = doc->FindMember(kFieldNameObjectIds);
+
+  // create and send response. names that aren't registered get an answer too,
+  // so the resolver doesn't sit out its timeout and can cache the miss
+  rtRemoteMessage res;
+  res.SetObject();
+  res.AddMember(kFieldNameMessageType, kNsMessageTypeLookupResponse, res.GetAllocator());
 
   std::unique_lock<std::mutex> lock(m_mutex);
-  itr = m_registered_objects.find(objectId);
-  lock.unlock();
+  if (objectId != nullptr)
+  {
+    auto itr = m_registered_objects.find(objectId);
+    if (itr != m_registered_objects.end())
+    { // object is registered
+      res.AddMember(kFieldNameStatusMessage, kNsStatusSuccess, res.GetAllocator());
+      addEndpoint(res, objectId, itr->second, res.GetAllocator());
+    }
+    else
+    {
+      res.AddMember(kFieldNameStatusMessage, kNsStatusFail, res.GetAllocator());
+      res.AddMember(kFieldNameObjectId, std::string(objectId), res.GetAllocator());
+    }
+  }
+  else if (objectIds != doc->MemberEnd() && objectIds->value.IsArray())
+  {
+    rapidjson::Value endpoints(rapidjson::kArrayType);
+    for (rapidjson::Value::ConstValueIterator id = objectIds->value.Begin(); id != objectIds->value.End(); ++id)
+    {
+      if (!id->IsString())
+        continue;
+
+      auto itr = m_registered_objects.find(id->GetString());
+      if (itr == m_registered_objects.end())
+        continue;
 
-  if (itr != m_registered_objects.end())
-  { // object is registered
-
-    // get IP and port
-    sockaddr_storage endpoint = itr->second;
-    std::string       ep_addr;
-    uint16_t          ep_port;
-    char buff[128];
-
-    void* addr = nullptr;
-    rtGetInetAddr(endpoint, &addr);
-
-    socklen_t len;
-    rtSocketGetLength(endpoint, &len);
-    char const* p = inet_ntop(endpoint.ss_family, addr, buff, len);
-    if (p)
-      ep_addr = p;
-    rtGetPort(endpoint, &ep_port);
-
-    // create and send response
-    rapidjson::Document doc;
-    doc.SetObject();
-    doc.AddMember(kFieldNameMessageType, kNsMessageTypeLookupResponse, doc.GetAllocator());
-    doc.AddMember(kFieldNameStatusMessage, kNsStatusSuccess, doc.GetAllocator());
-    doc.AddMember(kFieldNameObjectId, std::string(objectId), doc.GetAllocator());
-    doc.AddMember(kFieldNameIp, ep_addr, doc.GetAllocator());
-    doc.AddMember(kFieldNamePort, ep_port, doc.GetAllocator());
-    doc.AddMember(kFieldNameSenderId, senderId->value.GetInt(), doc.GetAllocator());
-    doc.AddMember(kFieldNameCorrelationKey, key.toString(), doc.GetAllocator());
-
-    return rtSendDocument(doc, m_ns_fd, &soc);
+      rapidjson::Value endpoint(rapidjson::kObjectType);
+      addEndpoint(endpoint, id->GetString(), itr->second, res.GetAllocator());
+      endpoints.PushBack(endpoint, res.GetAllocator());
+    }
+    res.AddMember(kFieldNameStatusMessage, kNsStatusSuccess, res.GetAllocator());
+    res.AddMember(kFieldNameEndpoints, endpoints, res.GetAllocator());
   }
-  return RT_OK;
+  else
+  {
+    return RT_ERROR_PROTOCOL_ERROR;
+  }
+  lock.unlock();
+
+  res.AddMember(kFieldNameSenderId, senderId->value.GetInt(), res.GetAllocator());
+  rtMessage_SetCorrelationKey(res, key);
+
+  return rtSendDocument(res, m_ns_fd, &soc);
 }
 
 void
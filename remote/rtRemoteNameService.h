@@ -36,6 +36,9 @@ private:
   rtError onUpdate(rtRemoteMessagePtr const& doc, sockaddr_storage const& soc);
   rtError onLookup(rtRemoteMessagePtr const& doc, sockaddr_storage const& soc);
 
+  static void addEndpoint(rapidjson::Value& v, char const* objectId, sockaddr_storage const& endpoint,
+    rapidjson::MemoryPoolAllocator<>& alloc);
+
   void runListener();
   void doRead(int fd, rtRemoteSocketBuffer& buff);
   void doDispatch(char const* buff, int n, sockaddr_storage* peer);
@@ -4,6 +4,7 @@
 #include "rtRemoteConfig.h"
 #include "rtRemoteEnvironment.h"
 
+#include <algorithm>
 #include <condition_variable>
 #include <thread>
 #include <mutex>
@@ -32,10 +33,17 @@
 #include <rapidjson/filewritestream.h>
 #include <rapidjson/pointer.h>
 
+namespace
+{
+  // keeps a batch lookup well inside a single datagram
+  size_t const kMaxNamesPerLookup = 64;
+}
+
 rtRemoteNsResolver::rtRemoteNsResolver(rtRemoteEnvironment* env)
   : m_static_fd(-1)
   , m_pid(getpid())
   , m_command_handlers()
+  , m_cache(env)
   , m_env(env)
 {
   memset(&m_static_endpoint, 0, sizeof(m_static_endpoint));
@@ -123,14 +131,14 @@ rtRemoteNsResolver::registerObject(std::string const& name, sockaddr_storage con
   rtError err = RT_OK;
   rtRemoteCorrelationKey seqId = rtMessage_GetNextCorrelationKey();
 
-  rapidjson::Document doc;
+  rtRemoteMessage doc;
   doc.SetObject();
   doc.AddMember(kFieldNameMessageType, kNsMessageTypeRegister, doc.GetAllocator());
   doc.AddMember(kFieldNameObjectId, name, doc.GetAllocator());
   doc.AddMember(kFieldNameIp, rpc_addr, doc.GetAllocator());
   doc.AddMember(kFieldNamePort, rpc_port, doc.GetAllocator());
   doc.AddMember(kFieldNameSenderId, m_pid, doc.GetAllocator());
-  doc.AddMember(kFieldNameCorrelationKey, seqId.toString(), doc.GetAllocator());
+  rtMessage_SetCorrelationKey(doc, seqId);
 
   err = rtSendDocument(doc, m_static_fd, &m_ns_dest);
   if (err != RT_OK)
@@ -187,87 +195,181 @@ rtRemoteNsResolver::registerObject(std::string const& name, sockaddr_storage con
 }
 
 rtError
-rtRemoteNsResolver::locateObject(std::string const& name, sockaddr_storage& endpoint,
-    uint32_t timeout)
+rtRemoteNsResolver::sendRequestAndWait(rtRemoteMessage& req, uint32_t timeout, rtRemoteMessagePtr& res)
 {
-  if (m_static_fd == -1)
-  {
-    rtLogError("unicast socket not opened");
-    return RT_FAIL;
-  }
-
-  rtError err = RT_OK;
   rtRemoteCorrelationKey seqId = rtMessage_GetNextCorrelationKey();
+  rtMessage_SetCorrelationKey(req, seqId);
 
-  rapidjson::Document doc;
-  doc.SetObject();
-  doc.AddMember(kFieldNameMessageType, kNsMessageTypeLookup, doc.GetAllocator());
-  doc.AddMember(kFieldNameObjectId, name, doc.GetAllocator());
-  doc.AddMember(kFieldNameSenderId, m_pid, doc.GetAllocator());
-  doc.AddMember(kFieldNameCorrelationKey, seqId.toString(), doc.GetAllocator());
-
-  err = rtSendDocument(doc, m_static_fd, &m_ns_dest);
+  rtError err = rtSendDocument(req, m_static_fd, &m_ns_dest);
   if (err != RT_OK)
     return err;
 
-  rtRemoteMessagePtr searchResponse;
-  RequestMap::const_iterator itr;
-
   auto delay = std::chrono::system_clock::now() + std::chrono::milliseconds(timeout);
 
   // wait here until timeout expires or we get a response that matches out pid/seqid
   std::unique_lock<std::mutex> lock(m_mutex);
-  itr = m_pending_searches.end();
-  
-  m_cond.wait_until(lock, delay, [this, seqId, &searchResponse]
+  m_cond.wait_until(lock, delay, [this, seqId, &res]
     {
       auto itr = this->m_pending_searches.find(seqId);
       if (itr != this->m_pending_searches.end())
       {
-        searchResponse = itr->second;
+        res = itr->second;
         this->m_pending_searches.erase(itr);
       }
-      return searchResponse != nullptr;
+      return res != nullptr;
     });
   lock.unlock();
 
-  if (!searchResponse)
+  if (!res)
   {
     rtLogInfo("no search response");
     return RT_FAIL;
   }
 
-  // response is in itr
-  if (searchResponse)
+  char const* message_type = rtMessage_GetMessageType(*res);
+  if (strcmp(message_type, kNsMessageTypeLookupResponse) != 0)
   {
-    char const* message_type = rtMessage_GetMessageType(*searchResponse);
-    
-    if (strcmp(message_type, kNsMessageTypeLookupResponse) == 0)
-    {    
-      if (strcmp(rtMessage_GetStatusMessage(*searchResponse), kNsStatusFail) == 0)
-      {
-        rtLogWarn("ns register failed");
-        return RT_FAIL;
-      }
-      else
+    rtLogWarn("unexpected response to lookup request. %s", message_type);
+    return RT_FAIL;
+  }
+
+  return RT_OK;
+}
+
+rtError
+rtRemoteNsResolver::locateObject(std::string const& name, sockaddr_storage& endpoint,
+    uint32_t timeout)
+{
+  std::vector<std::string> names(1, name);
+  std::map<std::string, sockaddr_storage> endpoints;
+
+  rtError err = locateObjects(names, endpoints, timeout);
+  if (err != RT_OK)
+    return err;
+
+  endpoint = endpoints[name];
+  return RT_OK;
+}
+
+rtError
+rtRemoteNsResolver::locateObjects(std::vector<std::string> const& names,
+  std::map<std::string, sockaddr_storage>& endpoints, uint32_t timeout)
+{
+  if (m_static_fd == -1)
+  {
+    rtLogError("unicast socket not opened");
+    return RT_FAIL;
+  }
+
+  // the name service knows everything that's registered, so a name it said
+  // it doesn't have is not asked for again until the negative entry expires
+  std::vector<std::string> unresolved;
+  bool notFound = false;
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  auto now = std::chrono::steady_clock::now();
+  for (std::string const& name : names)
+  {
+    sockaddr_storage endpoint;
+    switch (m_cache.find(name, now, endpoint))
+    {
+      case rtRemoteResolverCache::Status::Found:
+        endpoints[name] = endpoint;
+        break;
+      case rtRemoteResolverCache::Status::NotFound:
+        notFound = true;
+        break;
+      case rtRemoteResolverCache::Status::Unknown:
+        if (std::find(unresolved.begin(), unresolved.end(), name) == unresolved.end())
+          unresolved.push_back(name);
+        break;
+    }
+  }
+  lock.unlock();
+
+  for (size_t i = 0; i < unresolved.size(); i += kMaxNamesPerLookup)
+  {
+    size_t const n = std::min(unresolved.size() - i, kMaxNamesPerLookup);
+
+    rtRemoteMessage doc;
+    doc.SetObject();
+    doc.AddMember(kFieldNameMessageType, kNsMessageTypeLookup, doc.GetAllocator());
+    if (n == 1)
+    {
+      doc.AddMember(kFieldNameObjectId, unresolved[i], doc.GetAllocator());
+    }
+    else
+    {
+      rapidjson::Value ids(rapidjson::kArrayType);
+      for (size_t j = i; j < i + n; ++j)
+        ids.PushBack(rapidjson::Value(unresolved[j], doc.GetAllocator()), doc.GetAllocator());
+      doc.AddMember(kFieldNameObjectIds, ids, doc.GetAllocator());
+    }
+    doc.AddMember(kFieldNameSenderId, m_pid, doc.GetAllocator());
+
+    // no answer at all isn't cached, the name service may just be down
+    rtRemoteMessagePtr res;
+    rtError err = sendRequestAndWait(doc, timeout, res);
+    if (err != RT_OK)
+      return err;
+
+    char const* status = rtMessage_GetStatusMessage(*res);
+    if (status != nullptr && strcmp(status, kNsStatusFail) == 0)
+      continue;
+
+    char const* objectId = nullptr;
+    sockaddr_storage endpoint;
+    now = std::chrono::steady_clock::now();
+
+    lock.lock();
+    auto itr = res->FindMember(kFieldNameEndpoints);
+    if (itr != res->MemberEnd() && itr->value.IsArray())
+    {
+      for (rapidjson::Value::ConstValueIterator v = itr->value.Begin(); v != itr->value.End(); ++v)
       {
-        RT_ASSERT(searchResponse->HasMember(kFieldNameIp));
-        RT_ASSERT(searchResponse->HasMember(kFieldNamePort));
-        rtError err = rtParseAddress(endpoint, (*searchResponse)[kFieldNameIp].GetString(),
-          (*searchResponse)[kFieldNamePort].GetInt(), nullptr);
-        
+        err = rtMessage_GetEndpoint(*v, &objectId, endpoint);
         if (err != RT_OK)
-          return err;
+          break;
+        m_cache.insert(objectId, endpoint, now);
+        endpoints[objectId] = endpoint;
       }
     }
     else
     {
-      rtLogWarn("unexpected response to lookup request. %s", message_type);
-      return RT_FAIL;
+      err = rtMessage_GetEndpoint(*res, &objectId, endpoint);
+      if (err == RT_OK)
+      {
+        m_cache.insert(objectId, endpoint, now);
+        endpoints[objectId] = endpoint;
+      }
+    }
+    lock.unlock();
+
+    if (err != RT_OK)
+      return err;
+  }
+
+  now = std::chrono::steady_clock::now();
+
+  lock.lock();
+  for (std::string const& name : unresolved)
+  {
+    if (endpoints.find(name) == endpoints.end())
+    {
+      m_cache.insertNotFound(name, now);
+      notFound = true;
     }
   }
+  lock.unlock();
 
-  return RT_OK;
+  return notFound ? RT_RESOURCE_NOT_FOUND : RT_OK;
+}
+
+void
+rtRemoteNsResolver::invalidateObject(std::string const& name)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_cache.erase(name);
 }
 
 rtError
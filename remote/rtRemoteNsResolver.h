@@ -1,6 +1,7 @@
 #include "rtRemoteIResolver.h"
 #include "rtRemoteTypes.h"
 #include "rtRemoteCorrelationKey.h"
+#include "rtRemoteResolverCache.h"
 #include "rtRemoteSocketUtils.h"
 
 #include <condition_variable>
@@ -8,6 +9,7 @@
 #include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include <stdint.h>
 #include <netinet/in.h>
@@ -29,6 +31,9 @@ public:
     uint32_t timeout) override;
   rtError registerObject(std::string const& name, sockaddr_storage const& endpoint, uint32_t timeout);
   virtual rtError unregisterObject(std::string const& name);
+  virtual rtError locateObjects(std::vector<std::string> const& names,
+    std::map<std::string, sockaddr_storage>& endpoints, uint32_t timeout) override;
+  virtual void invalidateObject(std::string const& name) override;
 
 private:
   using CommandHandler = rtError (rtRemoteNsResolver::*)(rtRemoteMessagePtr const&, sockaddr_storage const&);
@@ -42,6 +47,7 @@ private:
 
   rtError init();
   rtError openSocket();
+  rtError sendRequestAndWait(rtRemoteMessage& req, uint32_t timeout, rtRemoteMessagePtr& res);
 
   // command handlers
   rtError onLocate(rtRemoteMessagePtr const& doc, sockaddr_storage const& soc);
@@ -61,6 +67,7 @@ private:
   uint16_t          m_rpc_port;
   HostedObjectsMap  m_hosted_objects;
   RequestMap	    m_pending_searches;
+  rtRemoteResolverCache m_cache;
   int		        m_shutdown_pipe[2];
 
   sockaddr_storage  m_ns_dest;
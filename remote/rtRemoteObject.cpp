@@ -1,5 +1,7 @@
 #include "rtRemoteObject.h"
 #include "rtRemoteClient.h"
+#include "rtRemoteConfig.h"
+#include "rtRemoteEnvironment.h"
 #include "rtError.h"
 
 rtRemoteObject::rtRemoteObject(std::string const& id, std::shared_ptr<rtRemoteClient> const& client)
@@ -13,8 +15,9 @@ rtRemoteObject::rtRemoteObject(std::string const& id, std::shared_ptr<rtRemoteCl
 rtRemoteObject::~rtRemoteObject()
 {
   m_client->removeKeepAliveForObject(m_id);
+  m_client->clearPropertyCache(m_id);
+  m_client->queueDeref(m_id);
   Release();
-  // TODO: send deref here
 }
 
 rtError
@@ -26,6 +29,9 @@ rtRemoteObject::Get(char const* name, rtValue* value) const
   if (name == nullptr)
     return RT_ERROR_INVALID_ARG;
 
+  if (m_client->getEnvironment()->Config->client_cache_properties())
+    return m_client->sendCachedGet(m_id, name, *value);
+
   return m_client->sendGet(m_id, name, *value);
 }
 
@@ -2,51 +2,166 @@
 #include "rtRemoteConfig.h"
 #include "rtRemoteEnvironment.h"
 
-#include <map>
+#include <algorithm>
 #include <mutex>
-#include <iostream>
+#include <unordered_map>
+#include <vector>
 #include <chrono>
 
 using std::chrono::steady_clock;
 
 namespace
 {
+  // one bucket per second. leases longer than the wheel get re-scheduled when
+  // their bucket comes around
+  static int const kWheelSize = 64;
+
   struct Entry
   {
+    std::string              Id;
     rtObjectRef              Object;
     rtFunctionRef            Function;
-    steady_clock::time_point LastUsed;
+    steady_clock::time_point Expires;
     std::chrono::seconds     MaxIdleTime;
+    uint32_t                 RemoteRefs;
+    uint32_t                 Generation;
     bool                     Unevictable;
+    bool                     InUse;
+  };
+
+  // slot index plus the generation of the slot when the handle was taken. A
+  // slot gets a new generation each time it's freed, so handles left behind in
+  // the wheel for a removed entry are recognized and dropped.
+  struct Handle
+  {
+    uint32_t Index;
+    uint32_t Generation;
+  };
+
+  using indexmap = std::unordered_map< std::string, uint32_t >;
+
+  std::mutex                sMutex;
+  std::vector<Entry>        sSlots;
+  std::vector<uint32_t>     sFreeSlots;
+  indexmap                  sIndex;
+  std::vector<Handle>       sWheel[kWheelSize];
+  int64_t                   sWheelTick = -1;
+  uint32_t                  sLiveObjects = 0;
+  uint32_t                  sLiveFunctions = 0;
+  uint64_t                  sRemovedByDeref = 0;
+  uint64_t                  sRemovedByLease = 0;
+  size_t                    sHighMark = 10000;
+
+  inline int64_t toTick(steady_clock::time_point t)
+  {
+    return std::chrono::duration_cast<std::chrono::seconds>(t.time_since_epoch()).count();
+  }
+
+  Entry* lookup(std::string const& id)
+  {
+    auto itr = sIndex.find(id);
+    return (itr != sIndex.end()) ? &sSlots[itr->second] : nullptr;
+  }
 
-    bool isActive(const steady_clock::time_point& now) const
+  void schedule(uint32_t index)
+  {
+    Entry const& entry = sSlots[index];
+
+    int64_t tick = toTick(entry.Expires);
+    if (sWheelTick < 0)
+      sWheelTick = toTick(steady_clock::now());
+    if (tick <= sWheelTick)
+      tick = sWheelTick + 1;
+    if (tick - sWheelTick >= kWheelSize)
+      tick = sWheelTick + kWheelSize - 1;
+
+    Handle h;
+    h.Index = index;
+    h.Generation = entry.Generation;
+    sWheel[tick % kWheelSize].push_back(h);
+  }
+
+  uint32_t allocate(std::string const& id)
+  {
+    uint32_t index = 0;
+    if (!sFreeSlots.empty())
     {
-      return (now - LastUsed) < MaxIdleTime;
+      index = sFreeSlots.back();
+      sFreeSlots.pop_back();
+    }
+    else
+    {
+      index = static_cast<uint32_t>(sSlots.size());
+      sSlots.push_back(Entry());
+      sSlots.back().Generation = 0;
     }
 
-  };
+    Entry& entry = sSlots[index];
+    entry.Id = id;
+    entry.RemoteRefs = 0;
+    entry.Unevictable = false;
+    entry.InUse = true;
+    sIndex.insert(indexmap::value_type(id, index));
+    return index;
+  }
 
-  using refmap = std::map< std::string, Entry >;
+  void freeSlot(uint32_t index)
+  {
+    Entry& entry = sSlots[index];
+    if (entry.Object)
+      sLiveObjects--;
+    if (entry.Function)
+      sLiveFunctions--;
+
+    sIndex.erase(entry.Id);
+    entry.Id.clear();
+    entry.Object = nullptr;
+    entry.Function = nullptr;
+    entry.InUse = false;
+    entry.Generation++;
+    sFreeSlots.push_back(index);
+  }
 
-  std::mutex    sMutex;
-  refmap        sRefMap;
-  size_t        sHighMark = 10000;
+  void expireBucket(std::vector<Handle>& bucket, steady_clock::time_point now)
+  {
+    std::vector<Handle> due;
+    due.swap(bucket);
+
+    for (Handle const& h : due)
+    {
+      Entry& entry = sSlots[h.Index];
+      if (!entry.InUse || entry.Generation != h.Generation)
+        continue;
+
+      // pinned entries are re-scheduled by markUnevictable(false)
+      if (entry.Unevictable)
+        continue;
+
+      if (entry.Expires > now)
+        schedule(h.Index);
+      else
+      {
+        freeSlot(h.Index);
+        sRemovedByLease++;
+      }
+    }
+  }
 }
 
 rtObjectRef
 rtRemoteObjectCache::findObject(std::string const& id)
 {
   std::unique_lock<std::mutex> lock(sMutex);
-  auto itr = sRefMap.find(id);
-  return (itr != sRefMap.end()) ? itr->second.Object : rtObjectRef();
+  Entry const* entry = lookup(id);
+  return (entry != nullptr) ? entry->Object : rtObjectRef();
 }
 
 rtFunctionRef
 rtRemoteObjectCache::findFunction(std::string const& id)
 {
   std::unique_lock<std::mutex> lock(sMutex);
-  auto itr = sRefMap.find(id);
-  return (itr != sRefMap.end()) ? itr->second.Function : rtFunctionRef();
+  Entry const* entry = lookup(id);
+  return (entry != nullptr) ? entry->Function : rtFunctionRef();
 }
 
 rtError
@@ -55,10 +170,16 @@ rtRemoteObjectCache::markUnevictable(std::string const& id, bool state)
   rtError e = RT_OK;
 
   std::unique_lock<std::mutex> lock(sMutex);
-  auto itr = sRefMap.find(id);
-  if (itr != sRefMap.end())
+  auto itr = sIndex.find(id);
+  if (itr != sIndex.end())
   {
-    itr->second.Unevictable = state;
+    Entry& entry = sSlots[itr->second];
+    if (entry.Unevictable && !state)
+    {
+      entry.Expires = steady_clock::now() + entry.MaxIdleTime;
+      schedule(itr->second);
+    }
+    entry.Unevictable = state;
     e = RT_OK;
   }
   else
@@ -69,43 +190,56 @@ rtRemoteObjectCache::markUnevictable(std::string const& id, bool state)
   return e;
 }
 
-
 rtError
 rtRemoteObjectCache::insert(std::string const& id, rtFunctionRef const& ref)
 {
-  rtError e = RT_OK;
+  std::unique_lock<std::mutex> lock(sMutex);
+  // every serialized copy becomes its own proxy on the other side, and each
+  // proxy sends its own deref, so a repeat insert takes another reference
+  Entry* existing = lookup(id);
+  if (existing != nullptr)
+  {
+    existing->RemoteRefs++;
+    existing->Expires = steady_clock::now() + existing->MaxIdleTime;
+    return RT_OK;
+  }
+
+  uint32_t index = allocate(id);
 
-  Entry entry;
-  entry.LastUsed = std::chrono::steady_clock::now();
+  Entry& entry = sSlots[index];
   entry.Function = ref;
   entry.MaxIdleTime = std::chrono::seconds(m_env->Config->cache_max_object_lifetime());
-  entry.Unevictable = false;
+  entry.Expires = steady_clock::now() + entry.MaxIdleTime;
+  entry.RemoteRefs = 1;
+  sLiveFunctions++;
+  schedule(index);
 
-  std::unique_lock<std::mutex> lock(sMutex);
-  auto res = sRefMap.insert(refmap::value_type(id, entry));
-  if (!res.second) // entry already exists
-    e = RT_ERROR_DUPLICATE_ENTRY;
-
-  return e;
+  return RT_OK;
 }
 
 rtError
 rtRemoteObjectCache::insert(std::string const& id, rtObjectRef const& ref)
 {
-  rtError e = RT_OK;
+  std::unique_lock<std::mutex> lock(sMutex);
+  Entry* existing = lookup(id);
+  if (existing != nullptr)
+  {
+    existing->RemoteRefs++;
+    existing->Expires = steady_clock::now() + existing->MaxIdleTime;
+    return RT_OK;
+  }
 
-  Entry entry;
-  entry.LastUsed = std::chrono::steady_clock::now();
+  uint32_t index = allocate(id);
+
+  Entry& entry = sSlots[index];
   entry.Object = ref;
   entry.MaxIdleTime = std::chrono::seconds(m_env->Config->cache_max_object_lifetime());
-  entry.Unevictable = false;
-
-  std::unique_lock<std::mutex> lock(sMutex);
-  auto res = sRefMap.insert(refmap::value_type(id, entry));
-  if (!res.second) // entry already exists
-    e = RT_ERROR_DUPLICATE_ENTRY;
+  entry.Expires = steady_clock::now() + entry.MaxIdleTime;
+  entry.RemoteRefs = 1;
+  sLiveObjects++;
+  schedule(index);
 
-  return e;
+  return RT_OK;
 }
 
 rtError
@@ -113,11 +247,12 @@ rtRemoteObjectCache::touch(std::string const& id, std::chrono::steady_clock::tim
 {
   rtError e = RT_OK;
 
+  // the wheel is lazy, the entry gets moved when its old bucket comes due
   std::unique_lock<std::mutex> lock(sMutex);
-  auto itr = sRefMap.find(id);
-  if (itr != sRefMap.end())
+  Entry* entry = lookup(id);
+  if (entry != nullptr)
   {
-    itr->second.LastUsed = now;
+    entry->Expires = now + entry->MaxIdleTime;
     e = RT_OK;
   }
   else
@@ -128,13 +263,56 @@ rtRemoteObjectCache::touch(std::string const& id, std::chrono::steady_clock::tim
   return e;
 }
 
+rtError
+rtRemoteObjectCache::addRef(std::string const& id)
+{
+  std::unique_lock<std::mutex> lock(sMutex);
+  Entry* entry = lookup(id);
+  if (entry == nullptr)
+    return RT_ERROR_OBJECT_NOT_FOUND;
+
+  entry->RemoteRefs++;
+  return RT_OK;
+}
+
+rtError
+rtRemoteObjectCache::release(std::string const& id)
+{
+  std::unique_lock<std::mutex> lock(sMutex);
+  auto itr = sIndex.find(id);
+  if (itr == sIndex.end())
+    return RT_ERROR_OBJECT_NOT_FOUND;
+
+  uint32_t const index = itr->second;
+  Entry& entry = sSlots[index];
+  if (entry.RemoteRefs > 0)
+    entry.RemoteRefs--;
+
+  if (entry.RemoteRefs == 0 && !entry.Unevictable)
+  {
+    freeSlot(index);
+    sRemovedByDeref++;
+  }
+
+  return RT_OK;
+}
+
 rtError
 rtRemoteObjectCache::clear()
 {
   rtLogInfo("clearing object cache");
 
   std::unique_lock<std::mutex> lock(sMutex);
-  sRefMap.clear();
+  sIndex.clear();
+  sSlots.clear();
+  sFreeSlots.clear();
+  for (std::vector<Handle>& bucket : sWheel)
+    bucket.clear();
+  sWheelTick = -1;
+  sLiveObjects = 0;
+  sLiveFunctions = 0;
+  sRemovedByDeref = 0;
+  sRemovedByLease = 0;
 
   return RT_OK;
 }
@@ -145,10 +323,10 @@ rtRemoteObjectCache::erase(std::string const& id)
   rtError e = RT_OK;
 
   std::unique_lock<std::mutex> lock(sMutex);
-  auto itr = sRefMap.find(id);
-  if (itr != sRefMap.end())
+  auto itr = sIndex.find(id);
+  if (itr != sIndex.end())
   {
-    sRefMap.erase(itr);
+    freeSlot(itr->second);
     e = RT_OK;
   }
   else
@@ -162,32 +340,46 @@ rtRemoteObjectCache::erase(std::string const& id)
 rtError
 rtRemoteObjectCache::removeUnused()
 {
-  auto now = std::chrono::steady_clock::now();
+  auto now = steady_clock::now();
+  int64_t const nowTick = toTick(now);
 
   std::unique_lock<std::mutex> lock(sMutex);
-  for (auto itr = sRefMap.begin(); itr != sRefMap.end();)
-  {
-    // rtLogInfo("IsActive:%s LifeTime:%lld MaxIdleTime:%lld Unevictable:%d", itr->first.c_str(),
-    //           std::chrono::duration_cast<std::chrono::seconds>(now - itr->second.LastUsed).count(),
-    //           itr->second.MaxIdleTime.count(), itr->second.Unevictable);
-    #if 0
-    if (!itr->second.Unevictable && itr->second.isActive(now))
-    {
-      rtLogInfo("not removing:%s, should remove, but it's active",
-        itr->first.c_str());
-    }
-    #endif
+  if (sWheelTick < 0)
+    sWheelTick = nowTick;
 
-    if (!itr->second.Unevictable && !itr->second.isActive(now))
-      itr = sRefMap.erase(itr);
-    else
-      ++itr;
+  // if we fell more than one full turn behind, every bucket is due once
+  int64_t const first = std::max(sWheelTick + 1, nowTick - kWheelSize + 1);
+  for (int64_t tick = first; tick <= nowTick; ++tick)
+  {
+    sWheelTick = tick;
+    expireBucket(sWheel[tick % kWheelSize], now);
   }
+  sWheelTick = nowTick;
 
-  if (sRefMap.size() > sHighMark)
+  if (sIndex.size() > sHighMark)
   {
-    rtLogWarn("Cache reached high mark, current size=%zu", sRefMap.size());
+    rtLogWarn("Cache reached high mark, current size=%zu", sIndex.size());
   }
 
   return RT_OK;
 }
+
+rtError
+rtRemoteObjectCache::getStats(rtRemoteObjectCacheStats& stats)
+{
+  std::unique_lock<std::mutex> lock(sMutex);
+  stats.LiveObjects = sLiveObjects;
+  stats.LiveFunctions = sLiveFunctions;
+  stats.Unevictable = 0;
+  stats.RemoteRefs = 0;
+  for (auto const& i : sIndex)
+  {
+    Entry const& entry = sSlots[i.second];
+    if (entry.Unevictable)
+      stats.Unevictable++;
+    stats.RemoteRefs += entry.RemoteRefs;
+  }
+  stats.RemovedByDeref = sRemovedByDeref;
+  stats.RemovedByLease = sRemovedByLease;
+  return RT_OK;
+}
@@ -10,6 +10,20 @@
 
 class rtRemoteEnvironment;
 
+struct rtRemoteObjectCacheStats
+{
+  uint32_t LiveObjects;
+  uint32_t LiveFunctions;
+  uint32_t Unevictable;
+  uint32_t RemoteRefs;
+  uint64_t RemovedByDeref;
+  uint64_t RemovedByLease;
+};
+
+// Objects and functions exported to remote peers. Every export holds one
+// remote reference that the peer gives back with a deref message once its
+// proxy is gone. Keep-alives extend a lease on the entry, expired leases are
+// collected from a timer wheel so only entries that are due get looked at.
 class rtRemoteObjectCache
 {
 public:
@@ -22,10 +36,13 @@ public:
   rtError insert(std::string const& id, rtObjectRef const& ref);
   rtError insert(std::string const& id, rtFunctionRef const& ref);
   rtError touch(std::string const& id, std::chrono::steady_clock::time_point now);
+  rtError addRef(std::string const& id);
+  rtError release(std::string const& id);
   rtError erase(std::string const& id);
   rtError markUnevictable(std::string const& id, bool state);
   rtError removeUnused();
   rtError clear();
+  rtError getStats(rtRemoteObjectCacheStats& stats);
 
 private:
   rtRemoteEnvironment* m_env;
@@ -0,0 +1,73 @@
+#include "rtRemoteResolverCache.h"
+#include "rtRemoteConfig.h"
+#include "rtRemoteEnvironment.h"
+
+#include <string.h>
+
+rtRemoteResolverCache::rtRemoteResolverCache(rtRemoteEnvironment* env)
+  : m_env(env)
+{
+}
+
+rtRemoteResolverCache::Status
+rtRemoteResolverCache::find(std::string const& name, time_point now, sockaddr_storage& endpoint) const
+{
+  auto itr = m_entries.find(name);
+  if (itr == m_entries.end() || itr->second.Expires <= now)
+    return Status::Unknown;
+
+  if (!itr->second.Found)
+    return Status::NotFound;
+
+  endpoint = itr->second.Endpoint;
+  return Status::Found;
+}
+
+bool
+rtRemoteResolverCache::foundSince(std::string const& name, time_point since, sockaddr_storage& endpoint) const
+{
+  auto itr = m_entries.find(name);
+  if (itr == m_entries.end() || !itr->second.Found || itr->second.Updated < since)
+    return false;
+
+  endpoint = itr->second.Endpoint;
+  return true;
+}
+
+void
+rtRemoteResolverCache::insert(std::string const& name, sockaddr_storage const& endpoint, time_point now)
+{
+  Entry& entry = m_entries[name];
+  entry.Endpoint = endpoint;
+  entry.Updated = now;
+  entry.Expires = now + std::chrono::milliseconds(m_env->Config->resolver_cache_ttl_ms());
+  entry.Found = true;
+}
+
+void
+rtRemoteResolverCache::insertNotFound(std::string const& name, time_point now)
+{
+  Entry& entry = m_entries[name];
+
+  // a live positive entry wins, it may have come from an announcement that
+  // raced with the search
+  if (entry.Found && entry.Expires > now)
+    return;
+
+  memset(&entry.Endpoint, 0, sizeof(entry.Endpoint));
+  entry.Updated = now;
+  entry.Expires = now + std::chrono::milliseconds(m_env->Config->resolver_negative_cache_ttl_ms());
+  entry.Found = false;
+}
+
+void
+rtRemoteResolverCache::erase(std::string const& name)
+{
+  m_entries.erase(name);
+}
+
+void
+rtRemoteResolverCache::clear()
+{
+  m_entries.clear();
+}
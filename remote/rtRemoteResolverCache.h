@@ -0,0 +1,54 @@
+#ifndef __RT_REMOTE_RESOLVER_CACHE_H__
+#define __RT_REMOTE_RESOLVER_CACHE_H__
+
+#include <chrono>
+#include <map>
+#include <string>
+
+#include <sys/socket.h>
+
+class rtRemoteEnvironment;
+
+// Endpoints the resolvers have learned about, from search replies and
+// announcements. Names that didn't answer a search are remembered too, for a
+// shorter time, so a missing service doesn't get searched for on every call.
+// Not thread safe, the owning resolver locks around it.
+class rtRemoteResolverCache
+{
+public:
+  using time_point = std::chrono::steady_clock::time_point;
+
+  enum class Status
+  {
+    Unknown,
+    Found,
+    NotFound
+  };
+
+  rtRemoteResolverCache(rtRemoteEnvironment* env);
+
+  Status find(std::string const& name, time_point now, sockaddr_storage& endpoint) const;
+
+  // true if name was resolved at or after since, regardless of the ttl. used
+  // by a search in progress to pick up the replies to it
+  bool foundSince(std::string const& name, time_point since, sockaddr_storage& endpoint) const;
+
+  void insert(std::string const& name, sockaddr_storage const& endpoint, time_point now);
+  void insertNotFound(std::string const& name, time_point now);
+  void erase(std::string const& name);
+  void clear();
+
+private:
+  struct Entry
+  {
+    sockaddr_storage  Endpoint;
+    time_point        Updated;
+    time_point        Expires;
+    bool              Found;
+  };
+
+  rtRemoteEnvironment*            m_env;
+  std::map<std::string, Entry>    m_entries;
+};
+
+#endif
@@ -177,6 +177,7 @@ namespace
 rtRemoteServer::rtRemoteServer(rtRemoteEnvironment* env)
   : m_listen_fd(-1)
   , m_resolver(nullptr)
+  , m_property_version(0)
   , m_keep_alive_interval(std::numeric_limits<uint32_t>::max())
   , m_env(env)
 {
@@ -212,6 +213,12 @@ rtRemoteServer::rtRemoteServer(rtRemoteEnvironment* env)
 
   m_command_handlers.insert(CommandHandlerMap::value_type(kMessageTypeKeepAliveRequest,
     rtRemoteCallback<rtRemoteMessageHandler>(&rtRemoteServer::onKeepAlive_Dispatch, this)));
+
+  m_command_handlers.insert(CommandHandlerMap::value_type(kMessageTypeDerefRequest,
+    rtRemoteCallback<rtRemoteMessageHandler>(&rtRemoteServer::onDeref_Dispatch, this)));
+
+  m_command_handlers.insert(CommandHandlerMap::value_type(kMessageTypePropertyChanged,
+    rtRemoteCallback<rtRemoteMessageHandler>(&rtRemoteServer::onPropertyChanged_Dispatch, this)));
 }
 
 rtRemoteServer::~rtRemoteServer()
@@ -446,6 +453,8 @@ rtRemoteServer::processMessage(std::shared_ptr<rtRemoteClient>& client, rtRemote
 {
   rtError e = RT_FAIL;
   char const* msgType = rtMessage_GetMessageType(*msg);
+  if (msgType == nullptr)
+    return RT_OK;
 
   auto itr = m_command_handlers.find(msgType);
   if (itr == m_command_handlers.end())
@@ -522,7 +531,7 @@ rtRemoteServer::findObject(std::string const& objectId, rtObjectRef& obj, uint32
           break;
         }
       }
-      m_mutex.unlock();
+      lock.unlock();
 
       if (!client)
       {
@@ -531,7 +540,9 @@ rtRemoteServer::findObject(std::string const& objectId, rtObjectRef& obj, uint32
         err = client->open();
         if (err != RT_OK)
         {
+          // the endpoint may be stale, look it up again next time
           rtLogWarn("failed to start new client. %s", rtStrError(err));
+          m_resolver->invalidateObject(objectId);
           return err;
         }
 
@@ -548,6 +559,8 @@ rtRemoteServer::findObject(std::string const& objectId, rtObjectRef& obj, uint32
         err = client->startSession(objectId);
         if (err == RT_OK)
           obj = remote;
+        else
+          m_resolver->invalidateObject(objectId);
 
         ClientDisconnectedCB CB = {cb, cbdata};
         auto ditr = m_disconnected_callback_map.find(client.get());
@@ -572,6 +585,48 @@ rtRemoteServer::findObject(std::string const& objectId, rtObjectRef& obj, uint32
   return (obj ? RT_OK : RT_FAIL);
 }
 
+rtError
+rtRemoteServer::findObjects(std::vector<std::string> const& objectIds, std::vector<rtObjectRef>& objs,
+  uint32_t timeout, clientDisconnectedCallback cb, void* cbdata)
+{
+  objs.clear();
+  objs.resize(objectIds.size());
+
+  // one search for everything that isn't local. the endpoints land in the
+  // resolver's cache so the findObject calls below don't search again
+  std::vector<std::string> remoteIds;
+  for (std::string const& id : objectIds)
+  {
+    if (!m_env->ObjectCache->findObject(id))
+      remoteIds.push_back(id);
+  }
+
+  if (!remoteIds.empty())
+  {
+    std::map<std::string, sockaddr_storage> endpoints;
+    rtError e = m_resolver->locateObjects(remoteIds, endpoints, timeout);
+    if (e != RT_OK)
+      rtLogInfo("found %d of %d objects. %s", static_cast<int>(endpoints.size()),
+        static_cast<int>(remoteIds.size()), rtStrError(e));
+  }
+
+  // anything the batch missed gets what's left of the caller's timeout
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+
+  rtError err = RT_OK;
+  for (size_t i = 0; i < objectIds.size(); ++i)
+  {
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+      deadline - std::chrono::steady_clock::now()).count();
+    rtError e = findObject(objectIds[i], objs[i], left > 0 ? static_cast<uint32_t>(left) : 0,
+      cb, cbdata);
+    if (e != RT_OK)
+      err = e;
+  }
+
+  return err;
+}
+
 rtError
 rtRemoteServer::openRpcListener()
 {
@@ -681,11 +736,15 @@ rtRemoteServer::onOpenSession(std::shared_ptr<rtRemoteClient>& client, rtRemoteM
 
   rtError err = RT_OK;
 
-  rtRemoteMessagePtr res(new rapidjson::Document());
+  // the proxy created for this session gives this back with a deref
+  if (objectId)
+    m_env->ObjectCache->addRef(objectId);
+
+  rtRemoteMessagePtr res = rtMessage_Create();
   res->SetObject();
   res->AddMember(kFieldNameMessageType, kMessageTypeOpenSessionResponse, res->GetAllocator());
   res->AddMember(kFieldNameObjectId, std::string(objectId), res->GetAllocator());
-  res->AddMember(kFieldNameCorrelationKey, key.toString(), res->GetAllocator());
+  rtMessage_SetCorrelationKey(*res, key);
   err = client->send(res);
 
   return err;
@@ -697,10 +756,10 @@ rtRemoteServer::onGet(std::shared_ptr<rtRemoteClient>& client, rtRemoteMessagePt
   rtRemoteCorrelationKey key = rtMessage_GetCorrelationKey(*doc);
   char const* objectId = rtMessage_GetObjectId(*doc);
 
-  rtRemoteMessagePtr res(new rapidjson::Document());
+  rtRemoteMessagePtr res = rtMessage_Create();
   res->SetObject();
   res->AddMember(kFieldNameMessageType, kMessageTypeGetByNameResponse, res->GetAllocator());
-  res->AddMember(kFieldNameCorrelationKey, key.toString(), res->GetAllocator());
+  rtMessage_SetCorrelationKey(*res, key);
   res->AddMember(kFieldNameObjectId, std::string(objectId), res->GetAllocator());
 
   rtObjectRef obj = m_env->ObjectCache->findObject(objectId);
@@ -715,10 +774,16 @@ rtRemoteServer::onGet(std::shared_ptr<rtRemoteClient>& client, rtRemoteMessagePt
     rtValue value;
 
     uint32_t    index;
+    uint64_t    version = 0;
     char const* name = rtMessage_GetPropertyName(*doc);
 
     if (name)
     {
+      // the version must be read before the value. see rtRemoteClient::sendCachedGet
+      auto subscribe = doc->FindMember(kFieldNamePropertySubscribe);
+      if (subscribe != doc->MemberEnd() && subscribe->value.IsBool() && subscribe->value.GetBool())
+        version = subscribeProperty(client, objectId, name);
+
       err = obj->Get(name, &value);
       if (err != RT_OK)
         rtLogWarn("failed to get property: %s", name);
@@ -750,6 +815,8 @@ rtRemoteServer::onGet(std::shared_ptr<rtRemoteClient>& client, rtRemoteMessagePt
       }
       res->AddMember(kFieldNameValue, val, res->GetAllocator());
       res->AddMember(kFieldNameStatusCode, 0, res->GetAllocator());
+      if (version != 0)
+        res->AddMember(kFieldNamePropertyVersion, version, res->GetAllocator());
     }
     else
     {
@@ -768,10 +835,10 @@ rtRemoteServer::onSet(std::shared_ptr<rtRemoteClient>& client, rtRemoteMessagePt
   rtRemoteCorrelationKey key = rtMessage_GetCorrelationKey(*doc);
   char const* objectId = rtMessage_GetObjectId(*doc);
 
-  rtRemoteMessagePtr res(new rapidjson::Document());
+  rtRemoteMessagePtr res = rtMessage_Create();
   res->SetObject();
   res->AddMember(kFieldNameMessageType, kMessageTypeSetByNameResponse, res->GetAllocator());
-  res->AddMember(kFieldNameCorrelationKey, key.toString(), res->GetAllocator());
+  rtMessage_SetCorrelationKey(*res, key);
   res->AddMember(kFieldNameObjectId, std::string(objectId), res->GetAllocator());
 
   rtObjectRef obj = m_env->ObjectCache->findObject(objectId);
@@ -799,6 +866,12 @@ rtRemoteServer::onSet(std::shared_ptr<rtRemoteClient>& client, rtRemoteMessagePt
       if (name)
       {
         err = obj->Set(name, &value);
+        if (err == RT_OK)
+        {
+          uint64_t version = publishPropertyChange(objectId, name, client.get());
+          if (version != 0)
+            res->AddMember(kFieldNamePropertyVersion, version, res->GetAllocator());
+        }
       }
       else
       {
@@ -821,10 +894,10 @@ rtRemoteServer::onMethodCall(std::shared_ptr<rtRemoteClient>& client, rtRemoteMe
   char const* objectId = rtMessage_GetObjectId(*doc);
   rtError err   = RT_OK;
 
-  rtRemoteMessagePtr res(new rapidjson::Document());
+  rtRemoteMessagePtr res = rtMessage_Create();
   res->SetObject();
   res->AddMember(kFieldNameMessageType, kMessageTypeMethodCallResponse, res->GetAllocator());
-  res->AddMember(kFieldNameCorrelationKey, key.toString(), res->GetAllocator());
+  rtMessage_SetCorrelationKey(*res, key);
 
   rtObjectRef obj = m_env->ObjectCache->findObject(objectId);
   if (!obj && (strcmp(objectId, "global") != 0))
@@ -918,16 +991,176 @@ rtRemoteServer::onKeepAlive(std::shared_ptr<rtRemoteClient>& client, rtRemoteMes
     rtLogWarn("got keep-alive without any interesting information");
   }
 
-  rtRemoteMessagePtr res(new rapidjson::Document());
+  rtRemoteMessagePtr res = rtMessage_Create();
   res->SetObject();
-  res->AddMember(kFieldNameCorrelationKey, key.toString(), res->GetAllocator());
+  rtMessage_SetCorrelationKey(*res, key);
   res->AddMember(kFieldNameMessageType, kMessageTypeKeepAliveResponse, res->GetAllocator());
   return client->send(res);
 }
 
+rtError
+rtRemoteServer::onDeref(std::shared_ptr<rtRemoteClient>& client, rtRemoteMessagePtr const& req)
+{
+  auto itr = req->FindMember(kFieldNameDerefIds);
+  if (itr == req->MemberEnd() || !itr->value.IsArray())
+    return RT_ERROR_PROTOCOL_ERROR;
+
+  for (rapidjson::Value::ConstValueIterator id = itr->value.Begin(); id != itr->value.End(); ++id)
+  {
+    if (!id->IsString())
+    {
+      rtLogWarn("ignoring non-string id in deref request");
+      continue;
+    }
+
+    rtError e = m_env->ObjectCache->release(id->GetString());
+    if (e != RT_OK)
+      rtLogDebug("failed to release %s. %s", id->GetString(), rtStrError(e));
+  }
+
+  itr = req->FindMember(kFieldNameUnsubscribeIds);
+  if (itr != req->MemberEnd() && itr->value.IsArray())
+  {
+    for (rapidjson::Value::ConstValueIterator id = itr->value.Begin(); id != itr->value.End(); ++id)
+    {
+      if (id->IsString())
+        unsubscribeProperties(client, id->GetString());
+    }
+  }
+
+  return RT_OK;
+}
+
+rtError
+rtRemoteServer::onPropertyChanged(std::shared_ptr<rtRemoteClient>& client, rtRemoteMessagePtr const& msg)
+{
+  return client->onPropertyChanged(msg);
+}
+
+uint64_t
+rtRemoteServer::subscribeProperty(std::shared_ptr<rtRemoteClient> const& client,
+  std::string const& objectId, char const* propertyName)
+{
+  std::unique_lock<std::mutex> lock(m_subscription_mutex);
+  PropertySubscription& sub = m_property_subscriptions[std::make_pair(objectId, std::string(propertyName))];
+  if (sub.Version == 0)
+    sub.Version = ++m_property_version;
+
+  auto itr = std::find_if(sub.Clients.begin(), sub.Clients.end(),
+    [&client](std::weak_ptr<rtRemoteClient> const& c) { return c.lock() == client; });
+  if (itr == sub.Clients.end())
+    sub.Clients.push_back(client);
+
+  return sub.Version;
+}
+
+void
+rtRemoteServer::unsubscribeProperties(std::shared_ptr<rtRemoteClient> const& client,
+  std::string const& objectId)
+{
+  std::unique_lock<std::mutex> lock(m_subscription_mutex);
+  auto itr = m_property_subscriptions.lower_bound(std::make_pair(objectId, std::string()));
+  while (itr != m_property_subscriptions.end() && itr->first.first == objectId)
+  {
+    std::vector< std::weak_ptr<rtRemoteClient> >& clients = itr->second.Clients;
+    clients.erase(std::remove_if(clients.begin(), clients.end(),
+      [&client](std::weak_ptr<rtRemoteClient> const& c)
+      {
+        std::shared_ptr<rtRemoteClient> subscriber = c.lock();
+        return !subscriber || subscriber == client;
+      }), clients.end());
+
+    if (clients.empty())
+      itr = m_property_subscriptions.erase(itr);
+    else
+      ++itr;
+  }
+}
+
+uint64_t
+rtRemoteServer::publishPropertyChange(std::string const& objectId, char const* propertyName,
+  rtRemoteClient const* origin)
+{
+  uint64_t version = 0;
+  std::vector< std::shared_ptr<rtRemoteClient> > subscribers;
+
+  {
+    std::unique_lock<std::mutex> lock(m_subscription_mutex);
+    auto itr = m_property_subscriptions.find(std::make_pair(objectId, std::string(propertyName)));
+    if (itr == m_property_subscriptions.end())
+      return 0;
+
+    version = itr->second.Version = ++m_property_version;
+    for (std::weak_ptr<rtRemoteClient> const& c : itr->second.Clients)
+    {
+      std::shared_ptr<rtRemoteClient> subscriber = c.lock();
+      if (subscriber && subscriber.get() != origin)
+        subscribers.push_back(subscriber);
+    }
+  }
+
+  if (subscribers.empty())
+    return version;
+
+  rtRemoteMessagePtr msg = rtMessage_Create();
+  msg->SetObject();
+  msg->AddMember(kFieldNameMessageType, kMessageTypePropertyChanged, msg->GetAllocator());
+  rtMessage_SetCorrelationKey(*msg, rtMessage_GetNextCorrelationKey());
+  msg->AddMember(kFieldNameObjectId, objectId, msg->GetAllocator());
+  msg->AddMember(kFieldNamePropertyName, std::string(propertyName), msg->GetAllocator());
+  msg->AddMember(kFieldNamePropertyVersion, version, msg->GetAllocator());
+
+  // push the new value along with the change when it can be copied. objects and
+  // functions are only invalidated, the subscriber will fetch them on next use.
+  rtValue value;
+  rtObjectRef obj = m_env->ObjectCache->findObject(objectId);
+  if (obj && obj->Get(propertyName, &value) == RT_OK &&
+      value.getType() != RT_objectType && value.getType() != RT_functionType)
+  {
+    rapidjson::Value val;
+    if (rtRemoteValueWriter::write(m_env, value, val, *msg) == RT_OK)
+      msg->AddMember(kFieldNameValue, val, msg->GetAllocator());
+  }
+
+  for (std::shared_ptr<rtRemoteClient> const& subscriber : subscribers)
+  {
+    rtError e = subscriber->send(msg);
+    if (e != RT_OK)
+      rtLogWarn("failed to send property change for %s.%s. %s", objectId.c_str(),
+        propertyName, rtStrError(e));
+  }
+
+  return version;
+}
+
+rtError
+rtRemoteServer::notifyPropertyChanged(std::string const& objectId, char const* propertyName)
+{
+  if (propertyName == nullptr)
+    return RT_ERROR_INVALID_ARG;
+
+  publishPropertyChange(objectId, propertyName, nullptr);
+  return RT_OK;
+}
+
 rtError
 rtRemoteServer::removeStaleObjects()
 {
+  {
+    std::unique_lock<std::mutex> lock(m_subscription_mutex);
+    for (auto itr = m_property_subscriptions.begin(); itr != m_property_subscriptions.end();)
+    {
+      std::vector< std::weak_ptr<rtRemoteClient> >& clients = itr->second.Clients;
+      clients.erase(std::remove_if(clients.begin(), clients.end(),
+        [](std::weak_ptr<rtRemoteClient> const& c) { return c.expired(); }), clients.end());
+
+      if (clients.empty())
+        itr = m_property_subscriptions.erase(itr);
+      else
+        ++itr;
+    }
+  }
+
   std::unique_lock<std::mutex> lock(m_mutex);
   for (auto itr = m_object_map.begin(); itr != m_object_map.end();)
   {
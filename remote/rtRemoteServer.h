@@ -10,8 +10,10 @@
 #include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include <stdint.h>
+#include <string.h>
 #include <netinet/in.h>
 #include <rtObject.h>
 
@@ -30,7 +32,10 @@ public:
   rtError registerObject(std::string const& objectId, rtObjectRef const& obj);
   rtError unregisterObject(std::string const& objectId);
   rtError findObject(std::string const& objectId, rtObjectRef& obj, uint32_t timeout, clientDisconnectedCallback cb, void *cbdata);
+  rtError findObjects(std::vector<std::string> const& objectIds, std::vector<rtObjectRef>& objs,
+    uint32_t timeout, clientDisconnectedCallback cb, void* cbdata);
   rtError removeStaleObjects();
+  rtError notifyPropertyChanged(std::string const& objectId, char const* propertyName);
   rtError processMessage(std::shared_ptr<rtRemoteClient>& client, rtRemoteMessagePtr const& msg);
 
 private:
@@ -60,6 +65,12 @@ private:
   static rtError onKeepAlive_Dispatch(std::shared_ptr<rtRemoteClient>& client, rtRemoteMessagePtr const& doc, void* argp)
     { return reinterpret_cast<rtRemoteServer *>(argp)->onKeepAlive(client, doc); }
 
+  static rtError onDeref_Dispatch(std::shared_ptr<rtRemoteClient>& client, rtRemoteMessagePtr const& doc, void* argp)
+    { return reinterpret_cast<rtRemoteServer *>(argp)->onDeref(client, doc); }
+
+  static rtError onPropertyChanged_Dispatch(std::shared_ptr<rtRemoteClient>& client, rtRemoteMessagePtr const& doc, void* argp)
+    { return reinterpret_cast<rtRemoteServer *>(argp)->onPropertyChanged(client, doc); }
+
   static rtError onIncomingMessage_Dispatch(std::shared_ptr<rtRemoteClient>& client, rtRemoteMessagePtr const& doc, void* argp)
     { return reinterpret_cast<rtRemoteServer *>(argp)->onIncomingMessage(client, doc); }
 
@@ -75,7 +86,14 @@ private:
   rtError onSet(std::shared_ptr<rtRemoteClient>& client, rtRemoteMessagePtr const& doc);
   rtError onMethodCall(std::shared_ptr<rtRemoteClient>& client, rtRemoteMessagePtr const& doc);
   rtError onKeepAlive(std::shared_ptr<rtRemoteClient>& client, rtRemoteMessagePtr const& doc);
+  rtError onPropertyChanged(std::shared_ptr<rtRemoteClient>& client, rtRemoteMessagePtr const& doc);
+  rtError onDeref(std::shared_ptr<rtRemoteClient>& client, rtRemoteMessagePtr const& doc);
   rtError openRpcListener();
+  uint64_t subscribeProperty(std::shared_ptr<rtRemoteClient> const& client, std::string const& objectId,
+    char const* propertyName);
+  void unsubscribeProperties(std::shared_ptr<rtRemoteClient> const& client, std::string const& objectId);
+  uint64_t publishPropertyChange(std::string const& objectId, char const* propertyName,
+    rtRemoteClient const* origin);
   rtError onClientStateChanged(std::shared_ptr<rtRemoteClient> const& client, rtRemoteClient::State state);
 
 private:
@@ -96,9 +114,24 @@ private:
   using ClientMap = std::map< std::string, std::shared_ptr<rtRemoteClient> >;
   using ClientDisconnectedCBMap = std::map< rtRemoteClient*, std::vector<ClientDisconnectedCB> >;
   using ClientList = std::vector< std::shared_ptr<rtRemoteClient > >;
-  using CommandHandlerMap = std::map< std::string, rtRemoteCallback<rtRemoteMessageHandler> >;
+  // keyed by the kMessageType literals, so dispatch doesn't build a string
+  // for every incoming message
+  struct CommandNameLess
+  {
+    bool operator()(char const* a, char const* b) const
+      { return strcmp(a, b) < 0; }
+  };
+  using CommandHandlerMap = std::map< char const*, rtRemoteCallback<rtRemoteMessageHandler>, CommandNameLess >;
   using ObjectRefeMap = std::map< std::string, ObjectReference >;
 
+  // clients that have a cached copy of an object property
+  struct PropertySubscription
+  {
+    uint64_t                                      Version;
+    std::vector< std::weak_ptr<rtRemoteClient> >  Clients;
+  };
+  using PropertySubscriptionMap = std::map< std::pair<std::string, std::string>, PropertySubscription >;
+
   sockaddr_storage              m_rpc_endpoint;
   int                           m_listen_fd;
 
@@ -110,6 +143,9 @@ private:
   ClientMap                     m_object_map;
   ClientList                    m_connected_clients;
   ClientDisconnectedCBMap       m_disconnected_callback_map;
+  PropertySubscriptionMap       m_property_subscriptions;
+  uint64_t                      m_property_version;
+  std::mutex                    m_subscription_mutex;
   int                           m_shutdown_pipe[2];
   uint32_t                      m_keep_alive_interval;
   rtRemoteEnvironment*          m_env;
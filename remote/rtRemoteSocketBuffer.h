@@ -3,6 +3,21 @@
 
 #include <vector>
 
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
 using rtRemoteSocketBuffer = std::vector<char>;
 
+// Serialized form of outgoing messages. The owner keeps it across sends so
+// the write path stops allocating once the buffer has grown to fit.
+struct rtRemoteWriteBuffer
+{
+  rtRemoteWriteBuffer()
+    : Writer(Buffer)
+  { }
+
+  rapidjson::StringBuffer                     Buffer;
+  rapidjson::Writer<rapidjson::StringBuffer>  Writer;
+};
+
 #endif
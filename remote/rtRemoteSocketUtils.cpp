@@ -314,11 +314,26 @@ rtSocketToString(sockaddr_storage const& ss)
 }
 
 rtError
-rtSendDocument(rapidjson::Document const& doc, int fd, sockaddr_storage const* dest)
+rtSendDocument(rtRemoteMessage const& doc, int fd, sockaddr_storage const* dest)
 {
-  rapidjson::StringBuffer buff;
-  rapidjson::Writer<rapidjson::StringBuffer> writer(buff);
-  doc.Accept(writer);
+  // resolvers and anyone else without a buffer of their own share one per thread
+  static thread_local rtRemoteWriteBuffer buff;
+  return rtSendDocument(doc, fd, dest, buff);
+}
+
+rtError
+rtSendDocument(rtRemoteMessage const& doc, int fd, sockaddr_storage const* dest,
+  rtRemoteWriteBuffer& writeBuffer)
+{
+  // don't hang on to the odd very large message
+  static size_t const kMaxRetainedSize = 64 * 1024;
+
+  rapidjson::StringBuffer& buff = writeBuffer.Buffer;
+  buff.Clear();
+  writeBuffer.Writer.Reset(buff);
+  doc.Accept(writeBuffer.Writer);
+
+  rtError e = RT_OK;
 
   #ifdef RT_RPC_DEBUG
   sockaddr_storage remoteEndpoint;
@@ -338,47 +353,67 @@ rtSendDocument(rapidjson::Document const& doc, int fd, sockaddr_storage const* d
     buff.GetString());
   #endif
 
+  int flags = 0;
+  #ifndef __APPLE__
+  flags = MSG_NOSIGNAL;
+  #endif
+
   if (dest)
   {
     socklen_t len;
     rtSocketGetLength(*dest, &len);
 
-    int flags = 0;
-    #ifndef __APPLE__
-    flags = MSG_NOSIGNAL;
-    #endif
-
     if (sendto(fd, buff.GetString(), buff.GetSize(), flags,
           reinterpret_cast<sockaddr const *>(dest), len) < 0)
     {
-      rtError e = rtErrorFromErrno(errno);
+      e = rtErrorFromErrno(errno);
       rtLogError("sendto failed. %s. dest:%s family:%d", rtStrError(e), rtSocketToString(*dest).c_str(),
         dest->ss_family);
-      return e;
     }
   }
   else
   {
-    // send length first
+    // length header and payload go out in one vectored send
     int n = buff.GetSize();
     n = htonl(n);
 
-    struct msghdr msg;
     struct iovec iov[2];
-    memset (&msg, '\0', sizeof (msg));
-    msg.msg_iov = iov;
-    msg.msg_iovlen = 2;
     iov[0].iov_base = &n;
     iov[0].iov_len = sizeof(n);
     iov[1].iov_base = const_cast<char*>(buff.GetString());
     iov[1].iov_len = buff.GetSize();
 
-    int flags = 0;
-    #ifndef __APPLE__
-    flags = MSG_NOSIGNAL;
-    #endif
+    e = rtSendAll(fd, iov, 2);
+  }
+
+  if (buff.GetSize() > kMaxRetainedSize)
+  {
+    buff.Clear();
+    buff.ShrinkToFit();
+  }
+
+  return e;
+}
 
-    while (sendmsg (fd, &msg, flags) < 0)
+rtError
+rtSendAll(int fd, struct iovec* iov, int iovcnt)
+{
+  int flags = 0;
+  #ifndef __APPLE__
+  flags = MSG_NOSIGNAL;
+  #endif
+
+  struct msghdr msg;
+  memset (&msg, '\0', sizeof (msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = iovcnt;
+
+  // a large message can be taken in pieces. advance past whatever the
+  // kernel accepted and send the rest
+  while (msg.msg_iovlen > 0)
+  {
+    ssize_t bytesSent = sendmsg(fd, &msg, flags);
+    if (bytesSent < 0)
     {
       if (errno == EINTR)
         continue;
@@ -386,6 +421,19 @@ rtSendDocument(rapidjson::Document const& doc, int fd, sockaddr_storage const* d
       rtLogError("failed to send message. %s", rtStrError(e));
       return e;
     }
+
+    size_t sent = static_cast<size_t>(bytesSent);
+    while (msg.msg_iovlen > 0 && sent >= msg.msg_iov->iov_len)
+    {
+      sent -= msg.msg_iov->iov_len;
+      msg.msg_iov++;
+      msg.msg_iovlen--;
+    }
+    if (msg.msg_iovlen > 0)
+    {
+      msg.msg_iov->iov_base = static_cast<char *>(msg.msg_iov->iov_base) + sent;
+      msg.msg_iov->iov_len -= sent;
+    }
   }
 
   return RT_OK;
@@ -394,16 +442,19 @@ rtSendDocument(rapidjson::Document const& doc, int fd, sockaddr_storage const* d
 rtError
 rtReadMessage(int fd, rtRemoteSocketBuffer& buff, rtRemoteMessagePtr& doc)
 {
-  rtError err = RT_OK;
-
   int n = 0;
-  int capacity = static_cast<int>(buff.capacity());
-
-  err = rtReadUntil(fd, reinterpret_cast<char *>(&n), 4);
+  rtError err = rtReadUntil(fd, reinterpret_cast<char *>(&n), 4);
   if (err != RT_OK)
     return err;
 
-  n = ntohl(n);
+  return rtReadMessageBody(fd, ntohl(n), buff, doc);
+}
+
+rtError
+rtReadMessageBody(int fd, int n, rtRemoteSocketBuffer& buff, rtRemoteMessagePtr& doc)
+{
+  rtError err = RT_OK;
+  int capacity = static_cast<int>(buff.capacity());
 
   if (n > capacity)
   {
@@ -439,7 +490,7 @@ rtParseMessage(char const* buff, int n, rtRemoteMessagePtr& doc)
   if (!buff)
     return RT_FAIL;
 
-  doc.reset(new rapidjson::Document());
+  doc = rtMessage_Create();
 
   rapidjson::MemoryStream stream(buff, n);
   if (doc->ParseStream<rapidjson::kParseDefaultFlags>(stream).HasParseError())
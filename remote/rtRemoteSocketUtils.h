@@ -3,6 +3,7 @@
 
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <rtError.h>
@@ -29,11 +30,15 @@ rtError rtGetPort(sockaddr_storage const& ss, uint16_t* port);
 rtError rtPushFd(fd_set* fds, int fd, int* maxFd);
 rtError rtReadUntil(int fd, char* buff, int n);
 rtError rtReadMessage(int fd, rtRemoteSocketBuffer& buff, rtRemoteMessagePtr& doc);
+rtError rtReadMessageBody(int fd, int n, rtRemoteSocketBuffer& buff, rtRemoteMessagePtr& doc);
 rtError rtParseMessage(char const* buff, int n, rtRemoteMessagePtr& doc);
 std::string rtSocketToString(sockaddr_storage const& ss);
 
 // this really doesn't belong here, but putting it here for now
 rtError rtSendDocument(rtRemoteMessage const& m, int fd, sockaddr_storage const* dest);
+rtError rtSendDocument(rtRemoteMessage const& m, int fd, sockaddr_storage const* dest,
+  rtRemoteWriteBuffer& buff);
+rtError rtSendAll(int fd, struct iovec* iov, int iovcnt);
 rtError rtGetPeerName(int fd, sockaddr_storage& endpoint);
 rtError rtGetSockName(int fd, sockaddr_storage& endpoint);
 rtError	rtCloseSocket(int& fd);
@@ -12,6 +12,8 @@
 #include <unistd.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <arpa/inet.h>
+#include <sys/uio.h>
 #include <rtLog.h>
 
 rtRemoteStream::rtRemoteStream(rtRemoteEnvironment* env, int fd, sockaddr_storage const& local_endpoint,
@@ -55,6 +57,7 @@ rtRemoteStream::close()
     rtCloseSocket(m_fd);
   }
 
+  failChannels(RT_ERROR_STREAM_CLOSED);
   return RT_OK;
 }
 
@@ -110,19 +113,104 @@ rtRemoteStream::connectTo(sockaddr_storage const& endpoint)
 rtError
 rtRemoteStream::send(rtRemoteMessagePtr const& msg)
 {
-  return rtSendDocument(*msg, m_fd, nullptr);
+  // also keeps frames from different threads from interleaving on the socket
+  std::unique_lock<std::mutex> lock(m_send_mutex);
+  return rtSendDocument(*msg, m_fd, nullptr, m_write_buffer);
 }
 
 rtRemoteAsyncHandle
 rtRemoteStream::sendWithWait(rtRemoteMessagePtr const& msg, rtRemoteCorrelationKey k)
 {
   rtRemoteAsyncHandle asyncHandle(m_env, k);
-  rtError e = rtSendDocument(*msg, m_fd, nullptr);
+  rtError e = send(msg);
   if (e != RT_OK)
     asyncHandle.complete(rtRemoteMessagePtr(), e);
   return asyncHandle;
 }
 
+rtError
+rtRemoteStream::sendChannelFrame(rtRemoteChannelFrame kind, uint32_t channelId, uint32_t arg,
+  char const* data, uint32_t n)
+{
+  rtRemoteChannelHeader header;
+  header.Kind = htonl(static_cast<uint32_t>(kind));
+  header.ChannelId = htonl(channelId);
+  header.Arg = htonl(arg);
+
+  uint32_t length = htonl((sizeof(header) + n) | kChannelFrameFlag);
+
+  struct iovec iov[3];
+  iov[0].iov_base = &length;
+  iov[0].iov_len = sizeof(length);
+  iov[1].iov_base = &header;
+  iov[1].iov_len = sizeof(header);
+  iov[2].iov_base = const_cast<char *>(data);
+  iov[2].iov_len = n;
+
+  // one chunk at a time, regular messages get in between
+  std::unique_lock<std::mutex> lock(m_send_mutex);
+  if (m_fd == kInvalidSocket)
+    return RT_ERROR_STREAM_CLOSED;
+  return rtSendAll(m_fd, iov, (n > 0) ? 3 : 2);
+}
+
+rtError
+rtRemoteStream::readChannel(uint32_t channelId, char* dest, uint32_t length, uint32_t timeout)
+{
+  std::unique_lock<std::mutex> lock(m_channel_mutex);
+  if (m_channels.find(channelId) != m_channels.end())
+    return RT_ERROR_DUPLICATE_ENTRY;
+
+  IncomingChannel& channel = m_channels[channelId];
+  channel.Dest = dest;
+  channel.Length = length;
+  channel.Received = 0;
+  channel.Granted = std::min(length, static_cast<uint32_t>(m_env->Config->channel_window()));
+  channel.Error = RT_ERROR_IN_PROGRESS;
+  lock.unlock();
+
+  rtError e = sendChannelFrame(rtRemoteChannelFrame::Credit, channelId, channel.Granted, nullptr, 0);
+
+  lock.lock();
+  if (e != RT_OK && channel.Error == RT_ERROR_IN_PROGRESS)
+    channel.Error = e;
+
+  bool cancel = false;
+  while (channel.Error == RT_ERROR_IN_PROGRESS)
+  {
+    uint32_t const received = channel.Received;
+    if (!m_channel_cond.wait_for(lock, std::chrono::milliseconds(timeout),
+          [&channel] { return channel.Error != RT_ERROR_IN_PROGRESS; }) && channel.Received == received)
+    {
+      rtLogWarn("timed out on channel %u after %u of %u bytes", channelId, channel.Received, length);
+      channel.Error = RT_ERROR_TIMEOUT;
+      cancel = true;
+    }
+  }
+
+  e = channel.Error;
+  m_channels.erase(channelId);
+  lock.unlock();
+
+  if (cancel)
+    sendChannelFrame(rtRemoteChannelFrame::Cancel, channelId, 0, nullptr, 0);
+
+  return e;
+}
+
+void
+rtRemoteStream::failChannels(rtError e)
+{
+  std::unique_lock<std::mutex> lock(m_channel_mutex);
+  for (auto& i : m_channels)
+  {
+    if (i.second.Error == RT_ERROR_IN_PROGRESS)
+      i.second.Error = e;
+  }
+  lock.unlock();
+  m_channel_cond.notify_all();
+}
+
 rtError
 rtRemoteStream::setStateChangedHandler(StateChangedHandler handler, void* argp)
 {
@@ -153,13 +241,119 @@ rtRemoteStream::onInactivity()
 }
 
 
+rtError
+rtRemoteStream::onChannelFrame(uint32_t n, rtRemoteSocketBuffer& buff)
+{
+  rtRemoteChannelHeader header;
+  if (n < sizeof(header))
+    return RT_ERROR_PROTOCOL_ERROR;
+
+  rtError e = rtReadUntil(m_fd, reinterpret_cast<char *>(&header), sizeof(header));
+  if (e != RT_OK)
+    return e;
+
+  rtRemoteChannelFrame const kind = static_cast<rtRemoteChannelFrame>(ntohl(header.Kind));
+  uint32_t const channelId = ntohl(header.ChannelId);
+  uint32_t const arg = ntohl(header.Arg);
+  uint32_t remaining = n - sizeof(header);
+
+  if (kind == rtRemoteChannelFrame::Data)
+  {
+    std::unique_lock<std::mutex> lock(m_channel_mutex);
+    auto itr = m_channels.find(channelId);
+    if (itr != m_channels.end() && itr->second.Error == RT_ERROR_IN_PROGRESS
+      && arg == itr->second.Received && remaining <= itr->second.Length - itr->second.Received)
+    {
+      // straight from the socket into the value, the reader holds on to its
+      // entry until we let go of the lock
+      IncomingChannel& channel = itr->second;
+      e = rtReadUntil(m_fd, channel.Dest + channel.Received, remaining);
+      if (e != RT_OK)
+        return e;
+
+      channel.Received += remaining;
+
+      uint32_t const window = static_cast<uint32_t>(m_env->Config->channel_window());
+      uint32_t const outstanding = channel.Granted - channel.Received;
+      uint32_t credit = 0;
+      if (channel.Granted < channel.Length && outstanding <= window / 2)
+      {
+        credit = std::min(window - outstanding, channel.Length - channel.Granted);
+        channel.Granted += credit;
+      }
+
+      bool const done = (channel.Received == channel.Length);
+      if (done)
+        channel.Error = RT_OK;
+      lock.unlock();
+
+      if (done)
+        m_channel_cond.notify_all();
+
+      if (credit > 0)
+        e = sendChannelFrame(rtRemoteChannelFrame::Credit, channelId, credit, nullptr, 0);
+      return e;
+    }
+    lock.unlock();
+
+    // cancelled or timed out on our end. the rest of what was in flight is
+    // thrown away
+    rtLogDebug("dropping %u bytes for channel %u", remaining, channelId);
+  }
+  else if (kind == rtRemoteChannelFrame::Credit)
+  {
+    m_env->ChannelSender->onCredit(shared_from_this(), channelId, arg);
+  }
+  else if (kind == rtRemoteChannelFrame::Cancel)
+  {
+    m_env->ChannelSender->onCancel(channelId);
+  }
+  else if (kind == rtRemoteChannelFrame::Reset)
+  {
+    std::unique_lock<std::mutex> lock(m_channel_mutex);
+    auto itr = m_channels.find(channelId);
+    if (itr != m_channels.end() && itr->second.Error == RT_ERROR_IN_PROGRESS)
+      itr->second.Error = RT_ERROR_OBJECT_NOT_FOUND;
+    lock.unlock();
+    m_channel_cond.notify_all();
+  }
+  else
+  {
+    rtLogWarn("unknown channel frame type %u", static_cast<uint32_t>(kind));
+  }
+
+  while (remaining > 0 && e == RT_OK)
+  {
+    uint32_t const n = std::min(remaining, static_cast<uint32_t>(buff.capacity()));
+    buff.resize(n);
+    e = rtReadUntil(m_fd, &buff[0], n);
+    remaining -= n;
+  }
+
+  return e;
+}
+
 rtError
 rtRemoteStream::onIncomingMessage(rtRemoteSocketBuffer& buff)
 {
   rtRemoteMessagePtr doc = nullptr;
-  rtError e = rtReadMessage(m_fd, buff, doc);
+
+  uint32_t n = 0;
+  rtError e = rtReadUntil(m_fd, reinterpret_cast<char *>(&n), 4);
+  if (e == RT_OK)
+  {
+    n = ntohl(n);
+    if (n & kChannelFrameFlag)
+      e = onChannelFrame(n & ~kChannelFrameFlag, buff);
+    else
+      e = rtReadMessageBody(m_fd, static_cast<int>(n), buff, doc);
+  }
+
   if (e != RT_OK)
   {
+    if (e == rtErrorFromErrno(ENOTCONN))
+      failChannels(RT_ERROR_STREAM_CLOSED);
+
     if (e == rtErrorFromErrno(ENOTCONN) && m_state_changed_handler.Func)
     { 
       auto self = shared_from_this();
@@ -173,7 +367,7 @@ rtRemoteStream::onIncomingMessage(rtRemoteSocketBuffer& buff)
     rtLogDebug("failed to read message. %s", rtStrError(e));
   }
 
-  if (e == RT_OK && m_message_handler.Func != nullptr)
+  if (e == RT_OK && doc && m_message_handler.Func != nullptr)
     e = m_message_handler.Func(doc, m_message_handler.Arg);
 
   return RT_OK;
@@ -5,7 +5,9 @@
 #include "rtRemoteSocketUtils.h"
 #include "rtRemoteAsyncHandle.h"
 #include "rtRemoteCallback.h"
+#include "rtRemoteChannel.h"
 
+#include <condition_variable>
 #include <deque>
 #include <map>
 #include <memory>
@@ -47,6 +49,13 @@ public:
   rtError send(rtRemoteMessagePtr const& msg);
   rtRemoteAsyncHandle sendWithWait(rtRemoteMessagePtr const& msg, rtRemoteCorrelationKey k);
   rtError setMessageHandler(MessageHandler handler, void* argp);
+
+  // pulls the value of a channel the peer announced in a message into dest,
+  // which must hold length bytes. timeout is how long to go without a chunk
+  // before giving up.
+  rtError readChannel(uint32_t channelId, char* dest, uint32_t length, uint32_t timeout);
+  rtError sendChannelFrame(rtRemoteChannelFrame kind, uint32_t channelId, uint32_t arg,
+    char const* data, uint32_t n);
   rtError setStateChangedHandler(StateChangedHandler handler, void* argp);
 
   inline bool isOpen() const
@@ -61,6 +70,17 @@ public:
 private:
   rtError onIncomingMessage(rtRemoteSocketBuffer& buff);
   rtError onInactivity();
+  rtError onChannelFrame(uint32_t n, rtRemoteSocketBuffer& buff);
+  void failChannels(rtError e);
+
+  struct IncomingChannel
+  {
+    char*     Dest;
+    uint32_t  Length;
+    uint32_t  Received;
+    uint32_t  Granted;
+    rtError   Error;
+  };
 
 private:
   int                                   m_fd;
@@ -70,6 +90,11 @@ private:
   sockaddr_storage                      m_local_endpoint;
   sockaddr_storage                      m_remote_endpoint;
   rtRemoteEnvironment*                  m_env;
+  std::mutex                            m_send_mutex;
+  rtRemoteWriteBuffer                   m_write_buffer;
+  std::map<uint32_t, IncomingChannel>   m_channels;
+  std::mutex                            m_channel_mutex;
+  std::condition_variable               m_channel_cond;
 };
 
 #endif
@@ -7,11 +7,13 @@
 
 #include <algorithm>
 #include <chrono>
+#include <errno.h>
 #include <unistd.h>
 #include <fcntl.h>
 
 rtRemoteStreamSelector::rtRemoteStreamSelector(rtRemoteEnvironment* env)
-  : m_env(env)
+  : m_shutdown(false)
+  , m_env(env)
 {
   int ret = pipe2(m_shutdown_pipe, O_CLOEXEC);
   if (ret == -1)
@@ -19,6 +21,13 @@ rtRemoteStreamSelector::rtRemoteStreamSelector(rtRemoteEnvironment* env)
     rtError e = rtErrorFromErrno(ret);
     rtLogError("failed to create pipe. %s", rtStrError(e));
   }
+
+  ret = pipe2(m_wakeup_pipe, O_CLOEXEC | O_NONBLOCK);
+  if (ret == -1)
+  {
+    rtError e = rtErrorFromErrno(errno);
+    rtLogError("failed to create pipe. %s", rtStrError(e));
+  }
 }
 
 void*
@@ -45,12 +54,33 @@ rtRemoteStreamSelector::registerStream(std::shared_ptr<rtRemoteStream> const& s)
   std::unique_lock<std::mutex> lock(m_mutex);
   m_streams.push_back(s);
   m_streams_cond.notify_all();
+
+  // the poll thread may be sitting in select without this fd. kick it so a
+  // new connection doesn't wait out the select interval for its first reply.
+  // shutdown closes the pipe once m_shutdown is set, so check it under the
+  // lock
+  if (!m_shutdown)
+  {
+    char c = 'w';
+    if (write(m_wakeup_pipe[1], &c, 1) == -1 && errno != EAGAIN)
+    {
+      rtError e = rtErrorFromErrno(errno);
+      rtLogWarn("failed to write. %s", rtStrError(e));
+    }
+  }
+
   return RT_OK;
 }
 
 rtError
 rtRemoteStreamSelector::shutdown()
 {
+  // the poll thread waits on the condition while it has no streams
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_shutdown = true;
+  m_streams_cond.notify_all();
+  lock.unlock();
+
   char buff[] = { "shudown" };
   rtLogInfo("sending shutdown signal");
   ssize_t n = write(m_shutdown_pipe[1], buff, sizeof(buff));
@@ -65,6 +95,8 @@ rtRemoteStreamSelector::shutdown()
 
   ::close(m_shutdown_pipe[0]);
   ::close(m_shutdown_pipe[1]);
+  ::close(m_wakeup_pipe[0]);
+  ::close(m_wakeup_pipe[1]);
 
   return RT_OK;
 }
@@ -92,9 +124,12 @@ rtRemoteStreamSelector::doPollFds()
     {
     std::unique_lock<std::mutex> lock(m_mutex);
     m_streams_cond.wait(lock, [&](){
-         return !m_streams.empty();
+         return !m_streams.empty() || m_shutdown;
     });
 
+    if (m_shutdown)
+      return RT_OK;
+
     // remove dead streams
     {
       auto itr = std::remove_if(m_streams.begin(), m_streams.end(),
@@ -103,8 +138,7 @@ rtRemoteStreamSelector::doPollFds()
             return !s->isOpen();
           });
 
-      if (itr != m_streams.end())
-        m_streams.erase(itr);
+      m_streams.erase(itr, m_streams.end());
     }
 
     for (auto const& s : m_streams)
@@ -114,6 +148,7 @@ rtRemoteStreamSelector::doPollFds()
     }
     }
     rtPushFd(&readFds, m_shutdown_pipe[0], &maxFd);
+    rtPushFd(&readFds, m_wakeup_pipe[0], &maxFd);
 
     timeval timeout;
     timeout.tv_sec = m_env->Config->stream_select_interval();
@@ -133,6 +168,13 @@ rtRemoteStreamSelector::doPollFds()
       return RT_OK;
     }
 
+    if (FD_ISSET(m_wakeup_pipe[0], &readFds))
+    {
+      char wakeup[64];
+      while (read(m_wakeup_pipe[0], wakeup, sizeof(wakeup)) > 0)
+        ;
+    }
+
     auto now = std::chrono::steady_clock::now();
     bool sentKeepAlive = false;
 
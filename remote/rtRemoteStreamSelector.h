@@ -31,6 +31,8 @@ private:
   std::mutex                                      m_mutex;
   std::condition_variable                         m_streams_cond;
   int                                             m_shutdown_pipe[2];
+  int                                             m_wakeup_pipe[2];
+  bool                                            m_shutdown;
   rtRemoteEnvironment*                            m_env;
 };
 
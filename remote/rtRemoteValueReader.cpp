@@ -25,6 +25,28 @@ static std::string toString(rapidjson::Value const& v)
 }
 #endif
 
+rtError
+rtRemoteValueReader::readChannel(rtValue& to, rapidjson::Value const& from,
+  std::shared_ptr<rtRemoteClient> const& client)
+{
+  auto id = from.FindMember(kFieldNameChannelId);
+  auto length = from.FindMember(kFieldNameChannelLength);
+  if (id == from.MemberEnd() || length == from.MemberEnd())
+  {
+    rtLogWarn("failed to find member: %s", kFieldNameValueValue);
+    return RT_ERROR_PROTOCOL_ERROR;
+  }
+
+  if (!client)
+    return RT_ERROR_PROTOCOL_ERROR;
+
+  rtString s;
+  rtError e = client->readChannel(id->value.GetUint(), length->value.GetUint(), s);
+  if (e == RT_OK)
+    to.setString(s);
+  return e;
+}
+
 rtError
 rtRemoteValueReader::read(rtValue& to, rapidjson::Value const& from, std::shared_ptr<rtRemoteClient> const& client)
 {
@@ -38,6 +60,9 @@ rtRemoteValueReader::read(rtValue& to, rapidjson::Value const& from, std::shared
   int const typeId = type->value.GetInt();
 
   auto val = from.FindMember(kFieldNameValueValue);
+  if (typeId == RT_stringType && val == from.MemberEnd())
+    return readChannel(to, from, client);
+
   if (((typeId != RT_functionType) && (typeId != RT_voidType)) && (val == from.MemberEnd()))
   {
     rtLogWarn("failed to find member: %s", kFieldNameValueValue);
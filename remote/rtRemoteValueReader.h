@@ -12,6 +12,10 @@ class rtRemoteValueReader
 {
 public:
   static rtError read(rtValue& val, rapidjson::Value const& from, std::shared_ptr<rtRemoteClient> const& client);
+
+private:
+  static rtError readChannel(rtValue& val, rapidjson::Value const& from,
+    std::shared_ptr<rtRemoteClient> const& client);
 };
 
 #endif
@@ -3,6 +3,7 @@
 #include "rtRemoteConfig.h"
 #include "rtRemoteMessage.h"
 #include "rtRemoteEnvironment.h"
+#include "rtRemoteChannel.h"
 #include "rtGuid.h"
 
 #include <rtObject.h>
@@ -36,7 +37,7 @@ namespace
 
 rtError
 rtRemoteValueWriter::write(rtRemoteEnvironment* env, rtValue const& from,
-  rapidjson::Value& to, rapidjson::Document& doc)
+  rapidjson::Value& to, rtRemoteMessage& doc)
 {
   to.SetObject();
 
@@ -90,7 +91,26 @@ rtRemoteValueWriter::write(rtRemoteEnvironment* env, rtValue const& from,
     case RT_uint32_tType: to.AddMember("value", from.toUInt32(), doc.GetAllocator()); break;
     case RT_int64_tType:  to.AddMember("value", from.toInt64(), doc.GetAllocator()); break;
     case RT_uint64_tType: to.AddMember("value", from.toUInt64(), doc.GetAllocator()); break;
-    case RT_stringType:   to.AddMember("value", std::string(from.toString().cString()), doc.GetAllocator()); break;
+    case RT_stringType:
+    {
+      // big strings are pulled by the receiver over a channel instead of
+      // being copied into the message.  Peers that don't know channels
+      // reject a string without a value, so it's off unless the threshold
+      // is set.
+      rtString s = from.toString();
+      uint32_t const length = static_cast<uint32_t>(s.byteLength());
+      int32_t const threshold = env->Config->channel_threshold();
+      if (threshold > 0 && length >= static_cast<uint32_t>(threshold))
+      {
+        to.AddMember(kFieldNameChannelId, env->ChannelSender->add(s), doc.GetAllocator());
+        to.AddMember(kFieldNameChannelLength, length, doc.GetAllocator());
+      }
+      else
+      {
+        to.AddMember("value", rapidjson::Value(s.cString(), length, doc.GetAllocator()), doc.GetAllocator());
+      }
+    }
+    break;
     case RT_voidPtrType:
 #if __x86_64
       to.AddMember("Value", (uint64_t)(from.toVoidPtr()), doc.GetAllocator());
@@ -99,6 +119,11 @@ rtRemoteValueWriter::write(rtRemoteEnvironment* env, rtValue const& from,
 #endif
       break;
 
+    case RT_bufferType:
+      // buffers share memory with the caller, they don't go over the wire
+      rtLogWarn("buffers can't be sent to remote objects");
+      return RT_ERROR_NOT_IMPLEMENTED;
+
     default:
       rtLogWarn("invalid type: %d", static_cast<int>(from.getType()));
       RT_ASSERT(false);
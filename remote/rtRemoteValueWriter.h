@@ -4,7 +4,7 @@
 #include <memory>
 #include <rtValue.h>
 #include <rtError.h>
-#include <rapidjson/document.h>
+#include "rtRemoteMessage.h"
 
 class rtRemoteEnvironment;
 
@@ -13,7 +13,7 @@ class rtRemoteValueWriter
 {
 public:
   static rtError write(rtRemoteEnvironment* env,
-    rtValue const& from, rapidjson::Value& to, rapidjson::Document& parent);
+    rtValue const& from, rapidjson::Value& to, rtRemoteMessage& parent);
 };
 
 #endif
@@ -0,0 +1,208 @@
+// Counts heap allocations per rpc in steady state. The client and server run
+// in two processes (fork), each counts its own calls into malloc/calloc/realloc
+// and the client prints both sides after a warm-up pass.
+//
+//  ./perf_alloc -n 10000 -w 1000
+//
+#include <rtRemote.h>
+#include <rtRemoteConfig.h>
+#include <rtRemoteEnvironment.h>
+#include <rtLog.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern "C"
+{
+  void* __libc_malloc(size_t size);
+  void* __libc_calloc(size_t n, size_t size);
+  void* __libc_realloc(void* p, size_t size);
+}
+
+static std::atomic<uint64_t> sAllocations(0);
+
+extern "C" void*
+malloc(size_t size)
+{
+  sAllocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_malloc(size);
+}
+
+extern "C" void*
+calloc(size_t n, size_t size)
+{
+  sAllocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_calloc(n, size);
+}
+
+extern "C" void*
+realloc(void* p, size_t size)
+{
+  sAllocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_realloc(p, size);
+}
+
+static char const* kObjectName = "perf.alloc";
+static std::mutex shutdownMutex;
+static bool testIsOver = false;
+
+struct option longOptions[] =
+{
+  { "num-iterations", required_argument, 0, 'n' },
+  { "warm-up", required_argument, 0, 'w' },
+  { 0, 0, 0, 0 }
+};
+
+class rtAllocTestObject : public rtObject
+{
+public:
+  rtDeclareObject(rtAllocTestObject, rtObject);
+  rtProperty(num, num, setNum, uint32_t);
+  rtReadOnlyProperty(allocations, allocations, double);
+  rtMethodNoArgAndNoReturn("shutdown", shutdown);
+
+  rtError num(uint32_t& n) const { n = m_num; return RT_OK; }
+  rtError setNum(uint32_t n) { m_num = n; return RT_OK; }
+  rtError allocations(double& n) const { n = static_cast<double>(sAllocations.load()); return RT_OK; }
+
+  rtError shutdown()
+  {
+    std::unique_lock<std::mutex> lock(shutdownMutex);
+    testIsOver = true;
+    return RT_OK;
+  }
+
+private:
+  uint32_t m_num = 0;
+};
+
+rtDefineObject(rtAllocTestObject, rtObject);
+rtDefineProperty(rtAllocTestObject, num);
+rtDefineProperty(rtAllocTestObject, allocations);
+rtDefineMethod(rtAllocTestObject, shutdown);
+
+static int
+runServer()
+{
+  rtRemoteEnvironment* env = rtEnvironmentGetGlobal();
+
+  rtError e = rtRemoteInit(env);
+  RT_ASSERT(e == RT_OK);
+
+  rtObjectRef obj(new rtAllocTestObject());
+  e = rtRemoteRegisterObject(env, kObjectName, obj);
+  RT_ASSERT(e == RT_OK);
+
+  bool running = true;
+  while (running)
+  {
+    {
+      std::unique_lock<std::mutex> lock(shutdownMutex);
+      running = !testIsOver;
+    }
+
+    if (running)
+      rtRemoteRun(env, 100);
+  }
+
+  rtRemoteShutdown(env);
+  return 0;
+}
+
+static void
+runPass(rtObjectRef& server, int count)
+{
+  for (int i = 0; i < count; ++i)
+  {
+    server.set("num", static_cast<uint32_t>(i));
+    server.get<uint32_t>("num");
+  }
+}
+
+static int
+runClient(int count, int warmup)
+{
+  rtRemoteEnvironment* env = rtEnvironmentGetGlobal();
+
+  rtError e = rtRemoteInit(env);
+  RT_ASSERT(e == RT_OK);
+
+  rtObjectRef server;
+  e = rtRemoteLocateObject(env, kObjectName, server, 5000);
+  if (e != RT_OK)
+  {
+    rtLogError("failed to locate %s. %s", kObjectName, rtStrError(e));
+    return 1;
+  }
+
+  runPass(server, warmup);
+
+  double serverBefore = server.get<double>("allocations");
+  uint64_t clientBefore = sAllocations.load();
+  auto start = std::chrono::steady_clock::now();
+
+  runPass(server, count);
+
+  auto end = std::chrono::steady_clock::now();
+  uint64_t clientAfter = sAllocations.load();
+  double serverAfter = server.get<double>("allocations");
+
+  // each pass is two round trips (set + get)
+  double rpcs = static_cast<double>(count) * 2;
+  double elapsed = std::chrono::duration<double, std::micro>(end - start).count();
+
+  printf("rpcs:%.0f usec/rpc:%.2f client allocs/rpc:%.3f server allocs/rpc:%.3f\n",
+    rpcs, elapsed / rpcs,
+    (clientAfter - clientBefore) / rpcs,
+    // the server side includes the trailing get of "allocations"
+    (serverAfter - serverBefore) / rpcs);
+
+  server.send("shutdown");
+  server = nullptr;
+  rtRemoteShutdown(env);
+  return 0;
+}
+
+int main(int argc, char* argv[])
+{
+  int count = 10000;
+  int warmup = 1000;
+
+  while (true)
+  {
+    int optionIndex = 0;
+    int c = getopt_long(argc, argv, "n:w:", longOptions, &optionIndex);
+    if (c == -1)
+      break;
+
+    switch (c)
+    {
+      case 'n':
+        count = atoi(optarg);
+        break;
+      case 'w':
+        warmup = atoi(optarg);
+        break;
+    }
+  }
+
+  rtLogSetLevel(RT_LOG_WARN);
+
+  pid_t pid = fork();
+  if (pid == 0)
+    return runServer();
+
+  int ret = runClient(count, warmup);
+
+  int status = 0;
+  waitpid(pid, &status, 0);
+  return ret;
+}
@@ -0,0 +1,261 @@
+// Moves a large string property back and forth while another thread keeps
+// making small calls on the same connection. Runs once with values sent
+// inline in the message and once over a channel, each in a fresh pair of
+// processes (fork), and prints the transfer rate, the worst small call
+// latency seen during the transfers and how much the client's peak rss grew.
+//
+//  ./perf_channel -m 8 -n 4
+//
+#include <rtRemote.h>
+#include <rtRemoteConfig.h>
+#include <rtRemoteEnvironment.h>
+#include <rtLog.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static char const* kObjectName = "perf.channel";
+static std::mutex shutdownMutex;
+static bool testIsOver = false;
+
+struct option longOptions[] =
+{
+  { "megabytes", required_argument, 0, 'm' },
+  { "num-iterations", required_argument, 0, 'n' },
+  { 0, 0, 0, 0 }
+};
+
+class rtChannelTestObject : public rtObject
+{
+public:
+  rtDeclareObject(rtChannelTestObject, rtObject);
+  rtProperty(blob, blob, setBlob, rtString);
+  rtProperty(num, num, setNum, uint32_t);
+  rtMethodNoArgAndNoReturn("shutdown", shutdown);
+
+  rtChannelTestObject(size_t size)
+  {
+    std::string s(size, ' ');
+    for (size_t i = 0; i < size; ++i)
+      s[i] = 'a' + (i % 26);
+    m_blob = s.c_str();
+  }
+
+  rtError blob(rtString& s) const { s = m_blob; return RT_OK; }
+  rtError setBlob(rtString s) { m_blob = s; return RT_OK; }
+  rtError num(uint32_t& n) const { n = m_num; return RT_OK; }
+  rtError setNum(uint32_t n) { m_num = n; return RT_OK; }
+
+  rtError shutdown()
+  {
+    std::unique_lock<std::mutex> lock(shutdownMutex);
+    testIsOver = true;
+    return RT_OK;
+  }
+
+private:
+  rtString m_blob;
+  uint32_t m_num = 0;
+};
+
+rtDefineObject(rtChannelTestObject, rtObject);
+rtDefineProperty(rtChannelTestObject, blob);
+rtDefineProperty(rtChannelTestObject, num);
+rtDefineMethod(rtChannelTestObject, shutdown);
+
+static long
+maxResidentKb()
+{
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+static int
+runServer(char const* configFile, size_t size)
+{
+  rtRemoteEnvironment* env = rtEnvironmentFromFile(configFile);
+
+  rtError e = rtRemoteInit(env);
+  RT_ASSERT(e == RT_OK);
+
+  rtObjectRef obj(new rtChannelTestObject(size));
+  e = rtRemoteRegisterObject(env, kObjectName, obj);
+  RT_ASSERT(e == RT_OK);
+
+  // requests are handled on the environment's dispatch threads
+  while (true)
+  {
+    {
+      std::unique_lock<std::mutex> lock(shutdownMutex);
+      if (testIsOver)
+        break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+
+  obj = nullptr;
+  rtRemoteShutdown(env);
+  return 0;
+}
+
+static int
+runClient(char const* mode, char const* configFile, size_t size, int count)
+{
+  rtRemoteEnvironment* env = rtEnvironmentFromFile(configFile);
+
+  rtError e = rtRemoteInit(env);
+  RT_ASSERT(e == RT_OK);
+
+  rtObjectRef server;
+  e = rtRemoteLocateObject(env, kObjectName, server, 5000);
+  if (e != RT_OK)
+  {
+    rtLogError("failed to locate %s. %s", kObjectName, rtStrError(e));
+    return 1;
+  }
+
+  server.set("num", 1u);
+  long const rssBefore = maxResidentKb();
+
+  // small calls on the same connection, timed while the transfers run
+  std::atomic<bool> transferring(true);
+  double worstPing = 0;
+  uint32_t pings = 0;
+  std::thread pinger([&]
+  {
+    while (transferring)
+    {
+      auto start = std::chrono::steady_clock::now();
+      server.get<uint32_t>("num");
+      double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+      if (elapsed > worstPing)
+        worstPing = elapsed;
+      pings++;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  });
+
+  int ret = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < count && ret == 0; ++i)
+  {
+    rtString blob;
+    e = server.get("blob", blob);
+    if (e != RT_OK || static_cast<size_t>(blob.byteLength()) != size || blob.cString()[size - 1] != static_cast<char>('a' + (size - 1) % 26))
+    {
+      rtLogError("get of blob failed. %s length:%d", rtStrError(e), blob.byteLength());
+      ret = 1;
+      break;
+    }
+
+    e = server.set("blob", blob);
+    if (e != RT_OK)
+    {
+      rtLogError("set of blob failed. %s", rtStrError(e));
+      ret = 1;
+    }
+  }
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  transferring = false;
+  pinger.join();
+
+  // each iteration moves the value twice
+  double const megabytes = static_cast<double>(size) * count * 2 / (1024 * 1024);
+  printf("%-8s %.1f MB/s  worst call during transfer:%.2f ms (%u calls)  client peak rss +%ld KB\n",
+    mode, megabytes / elapsed, worstPing, pings, maxResidentKb() - rssBefore);
+
+  server.send("shutdown");
+  server = nullptr;
+  rtRemoteShutdown(env);
+  return ret;
+}
+
+static int
+runMode(char const* mode, char const* config, size_t size, int count)
+{
+  char configFile[] = "/tmp/perf_channel.XXXXXX";
+  int fd = mkstemp(configFile);
+  if (fd == -1)
+    return 1;
+  if (write(fd, config, strlen(config)) != static_cast<ssize_t>(strlen(config)))
+    return 1;
+  close(fd);
+
+  pid_t pid = fork();
+  if (pid == 0)
+    exit(runServer(configFile, size));
+
+  int ret = 0;
+  pid_t client = fork();
+  if (client == 0)
+    exit(runClient(mode, configFile, size, count));
+
+  int status = 0;
+  waitpid(client, &status, 0);
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+  {
+    ret = 1;
+    kill(pid, SIGTERM);
+  }
+  waitpid(pid, nullptr, 0);
+
+  unlink(configFile);
+  return ret;
+}
+
+int main(int argc, char* argv[])
+{
+  int megabytes = 8;
+  int count = 4;
+
+  while (true)
+  {
+    int optionIndex = 0;
+    int c = getopt_long(argc, argv, "m:n:", longOptions, &optionIndex);
+    if (c == -1)
+      break;
+
+    switch (c)
+    {
+      case 'm':
+        megabytes = atoi(optarg);
+        break;
+      case 'n':
+        count = atoi(optarg);
+        break;
+    }
+  }
+
+  rtLogSetLevel(RT_LOG_WARN);
+
+  size_t const size = static_cast<size_t>(megabytes) * 1024 * 1024;
+
+  // inline messages have to fit the socket buffer whole
+  char inlineConfig[256];
+  snprintf(inlineConfig, sizeof(inlineConfig),
+    "rt.rpc.server.use_dispatch_thread=true\n"
+    "rt.rpc.channel.threshold=0\n"
+    "rt.rpc.stream.socket_buffer_size=%zu\n", size * 2);
+
+  char const* channelConfig =
+    "rt.rpc.server.use_dispatch_thread=true\n"
+    "rt.rpc.channel.threshold=65536\n";
+
+  int ret = runMode("inline", inlineConfig, size, count);
+  ret |= runMode("channel", channelConfig, size, count);
+  return ret;
+}
@@ -0,0 +1,261 @@
+// Times object discovery against a set of local server processes (fork), each
+// registering a number of objects. The client locates every object one at a
+// time, then all of them in one batch from a fresh environment, then again
+// from the resolver cache. It also checks that a miss is cached and that an
+// object registered later is pushed to the client by its announcement.
+//
+//  ./perf_locate -s 5 -o 10
+//
+#include <rtRemote.h>
+#include <rtRemoteConfig.h>
+#include <rtRemoteEnvironment.h>
+#include <rtLog.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <getopt.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static volatile sig_atomic_t testIsOver = 0;
+static std::mutex queueMutex;
+static std::condition_variable queueCond;
+static bool queueReady = false;
+
+struct option longOptions[] =
+{
+  { "servers", required_argument, 0, 's' },
+  { "objects", required_argument, 0, 'o' },
+  { 0, 0, 0, 0 }
+};
+
+class rtLocateTestObject : public rtObject
+{
+public:
+  rtDeclareObject(rtLocateTestObject, rtObject);
+};
+
+rtDefineObject(rtLocateTestObject, rtObject);
+
+static std::string
+objectName(int server, int object)
+{
+  char buff[64];
+  snprintf(buff, sizeof(buff), "perf.locate.%d.%d", server, object);
+  return buff;
+}
+
+static void
+onTerminate(int /*signo*/)
+{
+  testIsOver = 1;
+}
+
+// the servers sleep until there's work instead of polling rtRemoteRun, so a
+// handful of them don't starve the client of cpu
+static void
+onQueueReady(void* /*argp*/)
+{
+  std::unique_lock<std::mutex> lock(queueMutex);
+  queueReady = true;
+  lock.unlock();
+  queueCond.notify_one();
+}
+
+static int
+runServer(std::vector<std::string> const& names)
+{
+  signal(SIGTERM, onTerminate);
+
+  rtRemoteEnvironment* env = rtEnvironmentGetGlobal();
+
+  rtError e = rtRemoteInit(env);
+  RT_ASSERT(e == RT_OK);
+  rtRemoteRegisterQueueReadyHandler(env, &onQueueReady, nullptr);
+
+  std::vector<rtObjectRef> objs;
+  for (std::string const& name : names)
+  {
+    objs.push_back(new rtLocateTestObject());
+    e = rtRemoteRegisterObject(env, name.c_str(), objs.back());
+    RT_ASSERT(e == RT_OK);
+  }
+
+  while (!testIsOver)
+  {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    queueCond.wait_for(lock, std::chrono::milliseconds(100), [] { return queueReady; });
+    queueReady = false;
+    lock.unlock();
+
+    while (rtRemoteProcessSingleItem(env) == RT_OK)
+      ;
+  }
+
+  rtRemoteShutdown(env);
+  return 0;
+}
+
+// the server doesn't register anything until a byte shows up on fd. fork
+// before the client has any threads of its own
+static pid_t
+startServer(std::vector<std::string> const& names, int fd = -1)
+{
+  pid_t pid = fork();
+  if (pid == 0)
+  {
+    char c;
+    if (fd != -1 && read(fd, &c, 1) != 1)
+      exit(1);
+    exit(runServer(names));
+  }
+  return pid;
+}
+
+static double
+elapsedMillis(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static int
+runClient(std::vector<std::string> const& names, std::string const& late, int lateFd)
+{
+  std::vector<char const*> ids;
+  for (std::string const& name : names)
+    ids.push_back(name.c_str());
+
+  int const count = static_cast<int>(names.size());
+  int ret = 0;
+
+  // one at a time, each lookup is its own search
+  rtRemoteEnvironment* env = rtEnvironmentFromFile("/dev/null");
+  rtError e = rtRemoteInit(env);
+  RT_ASSERT(e == RT_OK);
+
+  auto start = std::chrono::steady_clock::now();
+  for (std::string const& name : names)
+  {
+    rtObjectRef obj;
+    e = rtRemoteLocateObject(env, name.c_str(), obj, 3000);
+    if (e != RT_OK)
+    {
+      rtLogError("failed to locate %s. %s", name.c_str(), rtStrError(e));
+      ret = 1;
+    }
+  }
+  printf("sequential: %d objects in %.2f ms\n", count, elapsedMillis(start));
+  rtRemoteShutdown(env);
+
+  // everything in one search, from an environment that hasn't seen any of it
+  env = rtEnvironmentFromFile("/dev/null");
+  e = rtRemoteInit(env);
+  RT_ASSERT(e == RT_OK);
+
+  std::vector<rtObjectRef> objs(count);
+  start = std::chrono::steady_clock::now();
+  e = rtRemoteLocateObjects(env, &ids[0], count, &objs[0], 3000);
+  printf("batch:      %d objects in %.2f ms (%s)\n", count, elapsedMillis(start), rtStrError(e));
+  if (e != RT_OK)
+    ret = 1;
+
+  objs.assign(count, rtObjectRef());
+  start = std::chrono::steady_clock::now();
+  e = rtRemoteLocateObjects(env, &ids[0], count, &objs[0], 3000);
+  printf("cached:     %d objects in %.2f ms (%s)\n", count, elapsedMillis(start), rtStrError(e));
+  if (e != RT_OK)
+    ret = 1;
+
+  // the first miss waits out the timeout, the second is answered from the cache
+  rtObjectRef missing;
+  start = std::chrono::steady_clock::now();
+  e = rtRemoteLocateObject(env, "perf.locate.missing", missing, 500);
+  printf("miss:       %.2f ms (%s)\n", elapsedMillis(start), rtStrError(e));
+  start = std::chrono::steady_clock::now();
+  e = rtRemoteLocateObject(env, "perf.locate.missing", missing, 500);
+  printf("miss again: %.2f ms (%s)\n", elapsedMillis(start), rtStrError(e));
+
+  // a server that comes up now announces its objects, the client shouldn't
+  // have to search for them
+  if (write(lateFd, "x", 1) != 1)
+    return 1;
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  rtObjectRef lateObj;
+  start = std::chrono::steady_clock::now();
+  e = rtRemoteLocateObject(env, late.c_str(), lateObj, 3000);
+  printf("announced:  %.2f ms (%s)\n", elapsedMillis(start), rtStrError(e));
+  if (e != RT_OK)
+    ret = 1;
+
+  lateObj = nullptr;
+  objs.clear();
+  rtRemoteShutdown(env);
+  return ret;
+}
+
+int main(int argc, char* argv[])
+{
+  int numServers = 5;
+  int numObjects = 10;
+
+  while (true)
+  {
+    int optionIndex = 0;
+    int c = getopt_long(argc, argv, "s:o:", longOptions, &optionIndex);
+    if (c == -1)
+      break;
+
+    switch (c)
+    {
+      case 's':
+        numServers = atoi(optarg);
+        break;
+      case 'o':
+        numObjects = atoi(optarg);
+        break;
+    }
+  }
+
+  rtLogSetLevel(RT_LOG_WARN);
+
+  std::vector<std::string> names;
+  std::vector<pid_t> servers;
+  for (int i = 0; i < numServers; ++i)
+  {
+    std::vector<std::string> hosted;
+    for (int j = 0; j < numObjects; ++j)
+      hosted.push_back(objectName(i, j));
+    names.insert(names.end(), hosted.begin(), hosted.end());
+    servers.push_back(startServer(hosted));
+  }
+
+  int lateFds[2];
+  if (pipe(lateFds) == -1)
+    return 1;
+
+  std::string const late = objectName(numServers, 0);
+  servers.push_back(startServer(std::vector<std::string>(1, late), lateFds[0]));
+
+  // let the servers register before the client's resolver is listening, so
+  // the first pass really has to search
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+
+  int ret = runClient(names, late, lateFds[1]);
+
+  for (pid_t pid : servers)
+    kill(pid, SIGTERM);
+  for (pid_t pid : servers)
+    waitpid(pid, nullptr, 0);
+
+  return ret;
+}
@@ -0,0 +1,279 @@
+// Heap allocations and time per operation for the string copies and name
+// lookups that happen on every property and event: copying short names and
+// long values, storing them in rtValues and reading them back, setting and
+// getting properties on a map object and on an object with a method map,
+// and sending an event to one of several names.  Counts its own calls into
+// malloc/calloc/realloc and prints the best of a few runs.
+//
+//  ./perf_string -n 1000000
+//
+#include <rtObject.h>
+#include <rtString.h>
+#include <rtValue.h>
+#include <rtLog.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+extern "C"
+{
+  void* __libc_malloc(size_t size);
+  void* __libc_calloc(size_t n, size_t size);
+  void* __libc_realloc(void* p, size_t size);
+}
+
+static std::atomic<uint64_t> sAllocations(0);
+
+extern "C" void*
+malloc(size_t size)
+{
+  sAllocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_malloc(size);
+}
+
+extern "C" void*
+calloc(size_t n, size_t size)
+{
+  sAllocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_calloc(n, size);
+}
+
+extern "C" void*
+realloc(void* p, size_t size)
+{
+  sAllocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_realloc(p, size);
+}
+
+struct option longOptions[] =
+{
+  { "num-iterations", required_argument, 0, 'n' },
+  { 0, 0, 0, 0 }
+};
+
+static char const* kShort = "onReady";
+static std::string const kLong(200, 'x');
+
+static uint64_t sink = 0;
+
+static void copyShort(int n)
+{
+  rtString s(kShort);
+  for (int i = 0; i < n; ++i)
+  {
+    rtString t(s);
+    sink += t.byteLength();
+  }
+}
+
+static void copyLong(int n)
+{
+  rtString s(kLong.c_str());
+  for (int i = 0; i < n; ++i)
+  {
+    rtString t(s);
+    sink += t.byteLength();
+  }
+}
+
+static void assignShort(int n)
+{
+  rtString s;
+  for (int i = 0; i < n; ++i)
+  {
+    s = (i & 1) ? "x" : "y";
+    sink += s.byteLength();
+  }
+}
+
+static void valueShort(int n)
+{
+  rtString s(kShort);
+  rtValue v;
+  for (int i = 0; i < n; ++i)
+  {
+    v.setString(s);
+    rtString t = v.toString();
+    sink += t.byteLength();
+  }
+}
+
+static void valueLong(int n)
+{
+  rtString s(kLong.c_str());
+  rtValue v;
+  for (int i = 0; i < n; ++i)
+  {
+    v.setString(s);
+    rtString t = v.toString();
+    sink += t.byteLength();
+  }
+}
+
+// properties declared like pxObject's, the one looked up is the last
+#define rtPerfProperty(name) \
+  rtProperty(name, name, name##Set, int32_t); \
+  rtError name(int32_t& n) const { n = m_v; return RT_OK; } \
+  rtError name##Set(int32_t n) { m_v = n; return RT_OK; }
+
+class rtPerfObject : public rtObject
+{
+public:
+  rtDeclareObject(rtPerfObject, rtObject);
+  rtPerfProperty(a);
+  rtPerfProperty(b);
+  rtPerfProperty(c);
+  rtPerfProperty(d);
+  rtPerfProperty(w);
+  rtPerfProperty(f);
+  rtPerfProperty(g);
+  rtPerfProperty(h);
+  rtPerfProperty(fillColor);
+  rtPerfProperty(lineColor);
+  rtPerfProperty(lineWidth);
+  rtPerfProperty(opacity);
+  rtPerfProperty(rotation);
+  rtPerfProperty(scaleX);
+  rtPerfProperty(scaleY);
+  rtPerfProperty(x);
+
+  rtPerfObject() : m_v(0) { }
+
+private:
+  int32_t m_v;
+};
+
+rtDefineObject(rtPerfObject, rtObject);
+rtDefineProperty(rtPerfObject, a);
+rtDefineProperty(rtPerfObject, b);
+rtDefineProperty(rtPerfObject, c);
+rtDefineProperty(rtPerfObject, d);
+rtDefineProperty(rtPerfObject, w);
+rtDefineProperty(rtPerfObject, f);
+rtDefineProperty(rtPerfObject, g);
+rtDefineProperty(rtPerfObject, h);
+rtDefineProperty(rtPerfObject, fillColor);
+rtDefineProperty(rtPerfObject, lineColor);
+rtDefineProperty(rtPerfObject, lineWidth);
+rtDefineProperty(rtPerfObject, opacity);
+rtDefineProperty(rtPerfObject, rotation);
+rtDefineProperty(rtPerfObject, scaleX);
+rtDefineProperty(rtPerfObject, scaleY);
+rtDefineProperty(rtPerfObject, x);
+
+static void objectProperty(int n)
+{
+  rtObjectRef o = new rtPerfObject;
+  // a name that isn't a literal, like the ones coming from script
+  std::string name("a");
+  for (int i = 0; i < n; ++i)
+  {
+    o.set(name.c_str(), i);
+    sink += o.get<int32_t>(name.c_str());
+  }
+}
+
+static rtError onEvent(int, rtValue const*, rtValue*, void*)
+{
+  sink++;
+  return RT_OK;
+}
+
+static void emitEvent(int n)
+{
+  char const* names[] = { "onReady", "onKeyDown", "onKeyUp", "onMouseDown", "onMouseUp",
+    "onMouseMove", "onFocus", "onBlur" };
+  rtEmitRef emit = new rtEmit;
+  rtFunctionRef f = new rtFunctionCallback(onEvent);
+  for (size_t i = 0; i < sizeof(names)/sizeof(names[0]); ++i)
+    emit->addListener(names[i], f.getPtr());
+  std::string name("onBlur");
+  for (int i = 0; i < n; ++i)
+    emit.send(name.c_str());
+}
+
+static void mapProperty(int n)
+{
+  rtObjectRef m = new rtMapObject;
+  rtString s(kShort);
+  m.set("name", s);
+  for (int i = 0; i < n; ++i)
+  {
+    m.set("name", s);
+    rtString t = m.get<rtString>("name");
+    sink += t.byteLength();
+  }
+}
+
+struct perfCase
+{
+  char const* name;
+  void (*run)(int n);
+  size_t bytes;
+};
+
+static perfCase const cases[] =
+{
+  { "copy short string",         copyShort,   7 },
+  { "copy long string",          copyLong,    200 },
+  { "assign short literal",      assignShort, 1 },
+  { "rtValue set/get short",     valueShort,  7 },
+  { "rtValue set/get long",      valueLong,   200 },
+  { "map object set/get short",  mapProperty, 7 },
+  { "method map set/get",        objectProperty, 1 },
+  { "emit to one of 8 names",    emitEvent,   6 },
+};
+
+int main(int argc, char* argv[])
+{
+  int count = 1000000;
+
+  while (true)
+  {
+    int optionIndex = 0;
+    int c = getopt_long(argc, argv, "n:", longOptions, &optionIndex);
+    if (c == -1)
+      break;
+
+    switch (c)
+    {
+      case 'n':
+        count = atoi(optarg);
+        break;
+    }
+  }
+
+  rtLogSetLevel(RT_LOG_WARN);
+
+  printf("%d operations, best of 5 runs\n\n", count);
+  printf("%-28s %12s %10s %12s\n", "", "allocs/op", "ns/op", "MB/s copied");
+
+  for (size_t i = 0; i < sizeof(cases)/sizeof(cases[0]); ++i)
+  {
+    perfCase const& pc = cases[i];
+
+    double best = 0;
+    uint64_t allocations = 0;
+    for (int r = 0; r < 5; ++r)
+    {
+      uint64_t before = sAllocations.load();
+      auto start = std::chrono::steady_clock::now();
+      pc.run(count);
+      double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+      if (r == 0 || ns < best)
+        best = ns;
+      allocations = sAllocations.load() - before;
+    }
+
+    double nsPerOp = best / count;
+    printf("%-28s %12.2f %10.1f %12.0f\n", pc.name, static_cast<double>(allocations) / count,
+      nsPerOp, (pc.bytes * 1e9) / (nsPerOp * 1024 * 1024));
+  }
+
+  return sink == 0 ? 1 : 0;
+}
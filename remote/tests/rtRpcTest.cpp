@@ -7,8 +7,17 @@
 #include<gtest/gtest.h>
 #include "../rtRemote.h"
 #include "rtTestCommon.h"
+#include "../rtRemoteEnvironment.h"
+#include "../rtRemoteObjectCache.h"
 #include <limits.h>
 #include <memory>
+#include <chrono>
+#include <thread>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 static char const* objectName = "com.xfinity.xsmart.SimpleServer/Comcast";
 class RemoteSettingsTest : public ::testing::Test {
@@ -20,6 +29,82 @@ class RemoteSettingsTest : public ::testing::Test {
     
 };
 
+// runs first so the server can be forked before this process starts any
+// rtRemote threads
+TEST(RemoteSettingsTest,DuplicateProxyDerefTest)
+{
+  char configFile[] = "/tmp/rtRpcTest.XXXXXX";
+  int fd = mkstemp(configFile);
+  ASSERT_NE(-1, fd);
+  // send each deref as soon as its proxy goes away
+  char const* config =
+    "rt.rpc.server.use_dispatch_thread=true\n"
+    "rt.rpc.client.deref_batch_size=1\n";
+  ASSERT_EQ(static_cast<ssize_t>(strlen(config)), write(fd, config, strlen(config)));
+  close(fd);
+
+  pid_t pid = fork();
+  ASSERT_NE(-1, pid);
+  if (pid == 0)
+  {
+    rtRemoteEnvironment* env = rtEnvironmentFromFile(configFile);
+    rtRemoteInit(env);
+    rtObjectRef serverObj(new rtThermostat());
+    rtObjectRef obj(new rtLcd());
+    obj.set("width",150);
+    serverObj.set("lcd",obj);
+    rtRemoteRegisterObject(env, objectName, serverObj);
+    while (true)
+      pause();
+  }
+
+  rtRemoteEnvironment* env = rtEnvironmentFromFile(configFile);
+  EXPECT_EQ(RT_OK,rtRemoteInit(env));
+
+  rtObjectRef objectRef;
+  EXPECT_EQ(RT_OK,rtRemoteLocateObject(env, objectName, objectRef, 5000));
+
+  // the same server object comes back as two proxies
+  rtObjectRef lcd1;
+  rtObjectRef lcd2;
+  EXPECT_EQ(RT_OK,objectRef.get("lcd",lcd1));
+  EXPECT_EQ(RT_OK,objectRef.get("lcd",lcd2));
+
+  // dropping one must not release the object out from under the other
+  lcd1 = nullptr;
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  uint32_t width = 0;
+  EXPECT_EQ(RT_OK,lcd2.get("width",width));
+  EXPECT_EQ(150u,width);
+  EXPECT_EQ(RT_OK,lcd2.set("width",123));
+  EXPECT_EQ(RT_OK,lcd2.get("width",width));
+  EXPECT_EQ(123u,width);
+
+  lcd2 = nullptr;
+  objectRef = nullptr;
+  rtRemoteShutdown(env);
+
+  kill(pid, SIGKILL);
+  waitpid(pid, nullptr, 0);
+  unlink(configFile);
+}
+
+TEST(RemoteSettingsTest,DuplicateInsertRefTest)
+{
+  rtRemoteEnvironment* env = rtEnvironmentGetGlobal();
+  rtObjectRef obj(new rtLcd());
+  std::string const id("obj://duplicate-insert-test");
+
+  // one reference per insert, the entry survives until both are released
+  EXPECT_EQ(RT_OK,env->ObjectCache->insert(id, obj));
+  EXPECT_EQ(RT_OK,env->ObjectCache->insert(id, obj));
+  EXPECT_EQ(RT_OK,env->ObjectCache->release(id));
+  EXPECT_TRUE(env->ObjectCache->findObject(id) == obj);
+  EXPECT_EQ(RT_OK,env->ObjectCache->release(id));
+  EXPECT_TRUE(env->ObjectCache->findObject(id) == nullptr);
+}
+
 TEST(RemoteSettingsTest,RTRemoteRegisterObjectTest) 
 {
   EXPECT_EQ(RT_OK,rtRemoteInit());
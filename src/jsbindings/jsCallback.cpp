@@ -1,16 +1,28 @@
 #include "jsCallback.h"
 #include "rtWrapperUtils.h"
 
+#include <rtMutex.h>
+
 using namespace v8;
 
+// Don't keep more idle callbacks than a busy frame uses
+static const size_t kMaxPooledCallbacks = 256;
+// Arguments past this many are converted into a heap array
+static const int kInlineArgs = 8;
+
+static rtMutex sQueueMutex;
+static std::vector<jsCallback*> sQueue;
+static std::vector<jsCallback*> sPool;
+// Wakes the loop for the queue when nothing pumps it
+static uv_work_t sWakeup;
+static bool sWakeupPending = false;
+
 jsCallback::jsCallback(v8::Local<v8::Context>& ctx)
   : mFunctionLookup(NULL)
   , mIsolate(ctx->GetIsolate())
   , mCompletionFunc(NULL)
   , mCompletionContext(NULL)
 {
-  mReq.data = this;
-
   mContext.Reset(mIsolate, ctx);
 }
 
@@ -20,9 +32,23 @@ jsCallback::~jsCallback()
   delete mFunctionLookup;
 }
 
+void jsCallback::init(v8::Local<v8::Context>& ctx)
+{
+  mIsolate = ctx->GetIsolate();
+  mContext.Reset(mIsolate, ctx);
+}
+
 void jsCallback::enqueue()
 {
-  uv_queue_work(uv_default_loop(), &mReq, &work, &doCallback);
+  bool wakeup;
+  {
+    rtMutexLockGuard lock(sQueueMutex);
+    sQueue.push_back(this);
+    wakeup = !sWakeupPending;
+    sWakeupPending = true;
+  }
+  if (wakeup)
+    uv_queue_work(uv_default_loop(), &sWakeup, &work, &doCallback);
 }
 
 void jsCallback::registerForCompletion(jsCallbackCompletionFunc callback, void* argp)
@@ -37,7 +63,43 @@ void jsCallback::work(uv_work_t* /* req */)
 
 jsCallback* jsCallback::create(v8::Local<v8::Context>& ctx)
 {
-  return new jsCallback(ctx);
+  jsCallback* callback = NULL;
+  {
+    rtMutexLockGuard lock(sQueueMutex);
+    if (!sPool.empty())
+    {
+      callback = sPool.back();
+      sPool.pop_back();
+    }
+  }
+  if (!callback)
+    return new jsCallback(ctx);
+  callback->init(ctx);
+  return callback;
+}
+
+void jsCallback::release(jsCallback* callback)
+{
+  if (!callback)
+    return;
+
+  // the args may hold the last references to rt objects, drop them now
+  callback->mArgs.clear();
+  delete callback->mFunctionLookup;
+  callback->mFunctionLookup = NULL;
+  callback->mCompletionFunc = NULL;
+  callback->mCompletionContext = NULL;
+  callback->mContext.Reset();
+
+  {
+    rtMutexLockGuard lock(sQueueMutex);
+    if (sPool.size() < kMaxPooledCallbacks)
+    {
+      sPool.push_back(callback);
+      return;
+    }
+  }
+  delete callback;
 }
 
 jsCallback* jsCallback::addArg(const rtValue& val)
@@ -46,16 +108,12 @@ jsCallback* jsCallback::addArg(const rtValue& val)
   return this;
 }
 
-Handle<Value>* jsCallback::makeArgs(Local<Context>& ctx)
+void jsCallback::makeArgs(Local<Context>& ctx, Handle<Value>* args)
 {
-  Handle<Value>* args = new Handle<Value>[mArgs.size()];
-
   for (size_t i = 0; i < mArgs.size(); ++i)
   {
     args[i] = rt2js(ctx, mArgs[i]);
   }
-
-  return args;
 }
 
 jsCallback* jsCallback::setFunctionLookup(jsIFunctionLookup* functionLookup)
@@ -64,21 +122,49 @@ jsCallback* jsCallback::setFunctionLookup(jsIFunctionLookup* functionLookup)
   return this;
 }
 
-void jsCallback::doCallback(uv_work_t* req, int /* status */)
+void jsCallback::complete()
 {
-  jsCallback* ctx = reinterpret_cast<jsCallback *>(req->data);
+  assert(mFunctionLookup != NULL);
+
+  rtValue ret = run();
+
+  if (mCompletionFunc)
+  {
+    mCompletionFunc(mCompletionContext, ret);
+  }
+}
 
-  assert(ctx != NULL);
-  assert(ctx->mFunctionLookup != NULL);
+void jsCallback::doCallback(uv_work_t* /* req */, int /* status */)
+{
+  {
+    rtMutexLockGuard lock(sQueueMutex);
+    sWakeupPending = false;
+  }
+  runQueued();
+}
 
-  rtValue ret  = ctx->run();
+void jsCallback::runQueued()
+{
+  std::vector<jsCallback*> batch;
+  {
+    rtMutexLockGuard lock(sQueueMutex);
+    if (sQueue.empty())
+      return;
+    batch.swap(sQueue);
+  }
 
-  if (ctx->mCompletionFunc)
+  // callbacks enqueued while these run wait for the next pass
+  for (size_t i = 0; i < batch.size(); ++i)
   {
-    ctx->mCompletionFunc(ctx->mCompletionContext, ret);
+    batch[i]->complete();
+    release(batch[i]);
   }
 
-  delete ctx;
+  // hand the storage back so the queue doesn't grow again every frame
+  batch.clear();
+  rtMutexLockGuard lock(sQueueMutex);
+  if (sQueue.empty())
+    sQueue.swap(batch);
 }
 
 rtValue jsCallback::run()
@@ -88,7 +174,10 @@ rtValue jsCallback::run()
   HandleScope handle_scope(mIsolate);
 
   Local<Context> ctx = PersistentToLocal(mIsolate, mContext);
-  Handle<Value>* args = this->makeArgs(ctx);
+  const int argc = static_cast<int>(this->mArgs.size());
+  Handle<Value> inlineArgs[kInlineArgs];
+  Handle<Value>* args = argc <= kInlineArgs ? inlineArgs : new Handle<Value>[argc];
+  this->makeArgs(ctx, args);
   Local<Function> func = this->mFunctionLookup->lookup(ctx);
 
   assert(!func.IsEmpty());
@@ -114,10 +203,11 @@ rtValue jsCallback::run()
   if (!func.IsEmpty())
   {
     // TODO: check that first arg. Is that 'this' why are we using context->Global()?
-    val = func->Call(context->Global(), static_cast<int>(this->mArgs.size()), args);
+    val = func->Call(context->Global(), argc, args);
   }
 
-  delete [] args;
+  if (args != inlineArgs)
+    delete [] args;
 
   rtValue returnValue;
   if (tryCatch.HasCaught())
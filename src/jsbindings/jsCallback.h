@@ -13,6 +13,10 @@ struct jsIFunctionLookup
   virtual v8::Local<v8::Function> lookup(v8::Local<v8::Context>& ctx) = 0;
 };
 
+// Callbacks from native code into javascript.  enqueue() adds the callback
+// to a queue that rtNode::pump() runs once a frame, a whole frame's worth of
+// events costs one pass through the loop.  Callbacks and their argument
+// storage are pooled, give them back with release() instead of delete.
 struct jsCallback
 {
   virtual void enqueue();
@@ -21,6 +25,10 @@ struct jsCallback
 
 
   static jsCallback* create(v8::Local<v8::Context>& ctx);
+  static void release(jsCallback* callback);
+
+  // Runs everything enqueued so far, on the javascript thread
+  static void runQueued();
 
   jsCallback* addArg(const rtValue& val);
 
@@ -29,16 +37,16 @@ struct jsCallback
   static void work(uv_work_t* req);
   static void doCallback(uv_work_t* req, int status);
 
-  // made this public for the direct call (rtIsMain) path
   virtual ~jsCallback();
 
 protected:
-  virtual v8::Handle<v8::Value>* makeArgs(v8::Local<v8::Context>& ctx);
+  virtual void makeArgs(v8::Local<v8::Context>& ctx, v8::Handle<v8::Value>* args);
 
 private:
+  void init(v8::Local<v8::Context>& ctx);
+  void complete();
 
   std::vector<rtValue> mArgs;
-  uv_work_t mReq;
   jsIFunctionLookup* mFunctionLookup;
 
   // TODO: Is it ok to hold this pointer here?
@@ -378,7 +378,7 @@ rtError jsFunctionWrapper::Send(int numArgs, const rtValue* args, rtValue* resul
     if (rtIsMainThread()) // main thread run now
     {
       *result = callback->run();
-      delete callback;
+      jsCallback::release(callback);
     }
     else // queue and wait
     {
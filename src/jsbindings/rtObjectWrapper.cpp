@@ -4,6 +4,10 @@
 
 #include <rtLog.h>
 
+#include <stdlib.h>
+#include <set>
+#include <string>
+
 using namespace v8;
 
 static const char* kClassName   = "rtObject";
@@ -30,6 +34,29 @@ static Handle<Value> makeIntegerFromKey(Isolate* isolate, rtObjectRef& , uint32_
 
 static Persistent<Function> ctor;
 
+// Templates for the classes that have their own rtMethodMap, keyed by map.
+// They have an accessor for every property and method in the map, so the
+// common case doesn't go through the named interceptor, convert the name to
+// utf8 and search the map for it.  Objects of other classes, and all objects
+// when RT_GENERIC_PROPERTIES is set, use the one rtObject template.
+typedef std::map<const rtMethodMap*, Persistent<FunctionTemplate>* > ClassTemplateMap;
+static ClassTemplateMap classTemplates;
+static bool useClassTemplates = true;
+
+// Returns the map to build the class template from, or NULL if the object
+// has to use the generic one.  Classes that don't declare their own map
+// (rtMapObject, rtArrayObject...) answer Get by name themselves.
+static rtMethodMap* templateMapFor(const rtObjectRef& ref)
+{
+  if (!useClassTemplates || !ref)
+    return NULL;
+  rtObject* obj = dynamic_cast<rtObject*>(ref.getPtr());
+  if (!obj)
+    return NULL;
+  rtMethodMap* map = obj->getMap();
+  return map != &rtObject::map ? map : NULL;
+}
+
 rtObjectWrapper::rtObjectWrapper(const rtObjectRef& ref)
   : rtWrapper(ref)
 {
@@ -48,6 +75,13 @@ void rtObjectWrapper::destroyPrototype()
     ctor.ClearWeak();
     ctor.Reset();
   }
+
+  for (ClassTemplateMap::iterator i = classTemplates.begin(); i != classTemplates.end(); ++i)
+  {
+    i->second->Reset();
+    delete i->second;
+  }
+  classTemplates.clear();
 }
 
 void rtObjectWrapper::exportPrototype(Isolate* isolate, Handle<Object> exports)
@@ -81,6 +115,75 @@ void rtObjectWrapper::exportPrototype(Isolate* isolate, Handle<Object> exports)
 #endif
   ctor.Reset(isolate, tmpl->GetFunction());
   exports->Set(String::NewFromUtf8(isolate, kClassName), tmpl->GetFunction());
+
+  useClassTemplates = getenv("RT_GENERIC_PROPERTIES") == NULL;
+}
+
+Local<Function> rtObjectWrapper::classConstructor(Isolate* isolate, rtMethodMap* map)
+{
+  EscapableHandleScope scope(isolate);
+
+  ClassTemplateMap::iterator i = classTemplates.find(map);
+  if (i != classTemplates.end())
+    return scope.Escape(PersistentToLocal(isolate, *i->second)->GetFunction());
+
+  Local<FunctionTemplate> tmpl = FunctionTemplate::New(isolate, create);
+  tmpl->SetClassName(String::NewFromUtf8(isolate, map->className));
+
+  Local<ObjectTemplate> inst = tmpl->InstanceTemplate();
+  inst->SetInternalFieldCount(1);
+
+  // Same lookup order as rtObject::Get, properties before methods and the
+  // class before its parents.  The accessors are not enumerable, allKeys
+  // still decides what for..in sees.
+  std::set<std::string> names;
+  for (rtMethodMap* m = map; m; m = m->parentsMap)
+  {
+    for (rtPropertyEntry* e = m->getFirstProperty(); e; e = e->mNext)
+    {
+      if (!names.insert(e->mPropertyName).second)
+        continue;
+      inst->SetAccessor(String::NewFromUtf8(isolate, e->mPropertyName, String::kInternalizedString),
+        &getClassProperty, &setClassProperty, External::New(isolate, e), DEFAULT, DontEnum);
+    }
+  }
+  for (rtMethodMap* m = map; m; m = m->parentsMap)
+  {
+    for (rtMethodEntry* e = m->getFirstMethod(); e; e = e->mNext)
+    {
+      if (!names.insert(e->mMethodName).second)
+        continue;
+      inst->SetAccessor(String::NewFromUtf8(isolate, e->mMethodName, String::kInternalizedString),
+        &getClassMethod, &setClassMethod, External::New(isolate, e), DEFAULT, DontEnum);
+    }
+  }
+
+  // Anything else still goes through rtObject::Get and Set.  kNonMasking
+  // keeps the interceptor from being asked first about the accessors.
+  inst->SetHandler(NamedPropertyHandlerConfiguration(
+      &getPropertyByGenericName,
+      &setPropertyByGenericName,
+#ifdef ENABLE_DEBUG_MODE
+      &queryPropertyByGenericName,
+#else
+      NULL,
+#endif
+      NULL,
+      &getEnumerablePropertyNames,
+      Local<Value>(),
+      PropertyHandlerFlags(static_cast<int>(PropertyHandlerFlags::kNonMasking) |
+                           static_cast<int>(PropertyHandlerFlags::kOnlyInterceptStrings))));
+#ifndef ENABLE_DEBUG_MODE
+  inst->SetIndexedPropertyHandler(
+      &getPropertyByIndex,
+      &setPropertyByIndex,
+      NULL,
+      NULL,
+      &getEnumerablePropertyIndecies);
+#endif
+
+  classTemplates[map] = new Persistent<FunctionTemplate>(isolate, tmpl);
+  return scope.Escape(tmpl->GetFunction());
 }
 
 Handle<Object> rtObjectWrapper::createFromObjectReference(v8::Local<v8::Context>& ctx, const rtObjectRef& ref)
@@ -151,7 +254,8 @@ Handle<Object> rtObjectWrapper::createFromObjectReference(v8::Local<v8::Context>
     External::New(isolate, ref.getPtr())
   };
 
-  Local<Function> func = PersistentToLocal(isolate, ctor);
+  rtMethodMap* map = templateMapFor(ref);
+  Local<Function> func = map ? classConstructor(isolate, map) : PersistentToLocal(isolate, ctor);
   obj = func->NewInstance(1, argv);
 
   // Local<Context> creationContext = obj->CreationContext();
@@ -264,6 +368,97 @@ void rtObjectWrapper::getPropertyByName(Local<String> prop, const PropertyCallba
   getProperty(name.cString(), info);
 }
 
+void rtObjectWrapper::getPropertyByGenericName(Local<Name> prop, const PropertyCallbackInfo<Value>& info)
+{
+  getPropertyByName(prop.As<String>(), info);
+}
+
+void rtObjectWrapper::setPropertyByGenericName(Local<Name> prop, Local<Value> val, const PropertyCallbackInfo<Value>& info)
+{
+  setPropertyByName(prop.As<String>(), val, info);
+}
+
+// The property thunks are called directly, no class with its own map
+// overrides Get by name.  Sets still go through Set, pxObject and the text
+// objects use it to mark themselves dirty.
+void rtObjectWrapper::getClassProperty(Local<String>, const PropertyCallbackInfo<Value>& info)
+{
+  rtObjectWrapper* wrapper = node::ObjectWrap::Unwrap<rtObjectWrapper>(info.Holder());
+  if (!wrapper || !wrapper->mWrappedObject)
+    return;
+
+  rtObject* obj = static_cast<rtObject*>(wrapper->mWrappedObject.getPtr());
+  rtPropertyEntry* e = static_cast<rtPropertyEntry*>(info.Data().As<External>()->Value());
+
+  rtValue value;
+  rtWrapperSceneUpdateEnter();
+  rtError err = (obj->*e->mGetThunk)(value);
+  rtWrapperSceneUpdateExit();
+
+  if (err != RT_OK)
+  {
+    if (err != RT_PROP_NOT_FOUND)
+      info.GetIsolate()->ThrowException(Exception::Error(String::NewFromUtf8(info.GetIsolate(),
+        rtStrError(err))));
+    return;
+  }
+
+  Local<Context> ctx = info.Holder()->CreationContext();
+  info.GetReturnValue().Set(rt2js(ctx, value));
+}
+
+void rtObjectWrapper::getClassMethod(Local<String>, const PropertyCallbackInfo<Value>& info)
+{
+  rtObjectWrapper* wrapper = node::ObjectWrap::Unwrap<rtObjectWrapper>(info.Holder());
+  if (!wrapper || !wrapper->mWrappedObject)
+    return;
+
+  rtObject* obj = static_cast<rtObject*>(wrapper->mWrappedObject.getPtr());
+  rtMethodEntry* e = static_cast<rtMethodEntry*>(info.Data().As<External>()->Value());
+
+  rtValue value;
+  value.setFunction(new rtObjectFunction(obj, e->mThunk));
+
+  Local<Context> ctx = info.Holder()->CreationContext();
+  info.GetReturnValue().Set(rt2js(ctx, value));
+}
+
+void rtObjectWrapper::setClassProperty(Local<String>, Local<Value> val, const PropertyCallbackInfo<void>& info)
+{
+  rtPropertyEntry* e = static_cast<rtPropertyEntry*>(info.Data().As<External>()->Value());
+  setClassValue(e->mPropertyName, val, info);
+}
+
+void rtObjectWrapper::setClassMethod(Local<String>, Local<Value> val, const PropertyCallbackInfo<void>& info)
+{
+  rtMethodEntry* e = static_cast<rtMethodEntry*>(info.Data().As<External>()->Value());
+  setClassValue(e->mMethodName, val, info);
+}
+
+void rtObjectWrapper::setClassValue(const char* name, Local<Value> val, const PropertyCallbackInfo<void>& info)
+{
+  rtObjectWrapper* wrapper = node::ObjectWrap::Unwrap<rtObjectWrapper>(info.Holder());
+  if (!wrapper || !wrapper->mWrappedObject)
+    return;
+
+  Local<Context> ctx = info.Holder()->CreationContext();
+  rtWrapperError error;
+  rtValue value = js2rt(ctx, val, &error);
+  if (error.hasError())
+  {
+    info.GetIsolate()->ThrowException(error.toTypeError(info.GetIsolate()));
+    return;
+  }
+
+  rtWrapperSceneUpdateEnter();
+  rtError err = wrapper->mWrappedObject->Set(name, &value);
+  rtWrapperSceneUpdateExit();
+
+  if (err != RT_OK && err != RT_PROP_NOT_FOUND)
+    info.GetIsolate()->ThrowException(Exception::Error(String::NewFromUtf8(info.GetIsolate(),
+      rtStrError(err))));
+}
+
 #ifdef ENABLE_DEBUG_MODE
 template<typename T>
 void rtObjectWrapper::queryProperty(const  T& prop, const PropertyCallbackInfo<Integer>& info)
@@ -305,6 +500,11 @@ void rtObjectWrapper::queryPropertyByName(Local<String> prop, const PropertyCall
   rtString name = toString(prop);
   queryProperty(name.cString(), info);
 }
+
+void rtObjectWrapper::queryPropertyByGenericName(Local<Name> prop, const PropertyCallbackInfo<Integer>& info)
+{
+  queryPropertyByName(prop.As<String>(), info);
+}
 #endif
 
 void rtObjectWrapper::getPropertyByIndex(uint32_t index, const PropertyCallbackInfo<Value>& info)
@@ -26,6 +26,21 @@ public:
 private:
   static void create(const FunctionCallbackInfo<Value>& args);
 
+  // Per class templates, built from the rtMethodMap the first time an
+  // object of that class is wrapped
+  static Local<Function> classConstructor(Isolate* isolate, rtMethodMap* map);
+  static void getClassProperty(Local<String> prop, const PropertyCallbackInfo<Value>& info);
+  static void getClassMethod(Local<String> prop, const PropertyCallbackInfo<Value>& info);
+  static void setClassProperty(Local<String> prop, Local<Value> val, const PropertyCallbackInfo<void>& info);
+  static void setClassMethod(Local<String> prop, Local<Value> val, const PropertyCallbackInfo<void>& info);
+  static void setClassValue(const char* name, Local<Value> val, const PropertyCallbackInfo<void>& info);
+
+  static void getPropertyByGenericName(Local<Name> prop, const PropertyCallbackInfo<Value>& info);
+  static void setPropertyByGenericName(Local<Name> prop, Local<Value> val, const PropertyCallbackInfo<Value>& info);
+#ifdef ENABLE_DEBUG_MODE
+  static void queryPropertyByGenericName(Local<Name> prop, const PropertyCallbackInfo<Integer>& info);
+#endif
+
   static void getPropertyByName(Local<String> prop, const PropertyCallbackInfo<Value>& info);
   static void setPropertyByName(Local<String> prop, Local<Value> val, const PropertyCallbackInfo<Value>& info);
   static void getEnumerablePropertyNames(const PropertyCallbackInfo<Array>& info);
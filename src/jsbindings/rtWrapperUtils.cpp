@@ -5,11 +5,16 @@
 extern uv_mutex_t threadMutex;
 #endif
 #include <rtMutex.h>
+#include <pxTimer.h>
 
+// One lock for every scene.  Without RUNINMAIN the node thread holds
+// threadMutex and the isolate's Locker for the whole of each uv_run, so a
+// lock per scene wouldn't let the render thread through any sooner, and
+// holding one while a callback into script waits for the Locker would
+// deadlock against a script waiting for the scene.
 #ifdef __APPLE__
 static pthread_mutex_t sSceneLock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER; //PTHREAD_MUTEX_INITIALIZER;
 static pthread_t sCurrentSceneThread;
-//static pthread_mutex_t sObjectMapMutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER; //PTHREAD_MUTEX_INITIALIZER;
 #elif defined(USE_STD_THREADS)
 #include <thread>
 #include <mutex>
@@ -18,24 +23,154 @@ static std::thread::id sCurrentSceneThread;
 #else
 static pthread_mutex_t sSceneLock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
 static pthread_t sCurrentSceneThread;
-static pthread_mutex_t sObjectMapMutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
 #endif
 
 using namespace std;
 
 static int sLockCount;
 
+static bool sLockStatsEnabled = getenv("RT_SCENE_LOCK_STATS") != NULL;
+static rtWrapperSceneLockStats sLockStats;
+static double sLockHoldStart;
+
 const int HandleMap::kContextIdIndex = 2;
 
+class HandleTable;
+
 struct ObjectReference
 {
   rtObjectRef        RTObject;
   Persistent<Object> PersistentObject;
   uint32_t           CreationContextId;
+  HandleTable*       Table;
+};
+
+// The wrappers made in one context, keyed by the rt object they wrap.  Open
+// addressing with linear probing; a removal shifts the entries after it
+// back, so there are no tombstones and lookups stay short.  Tables are only
+// used with the isolate locked, which already serializes every caller, so
+// they need no lock of their own.
+class HandleTable
+{
+public:
+  HandleTable(uint32_t contextId)
+    : mContextId(contextId), mSize(0), mSlots(16, (ObjectReference*)NULL)
+  {
+  }
+
+  uint32_t contextId() const { return mContextId; }
+  size_t size() const { return mSize; }
+
+  ObjectReference* find(rtIObject* key) const
+  {
+    size_t mask = mSlots.size() - 1;
+    for (size_t i = slot(key); mSlots[i]; i = (i + 1) & mask)
+    {
+      if (mSlots[i]->RTObject.getPtr() == key)
+        return mSlots[i];
+    }
+    return NULL;
+  }
+
+  void insert(ObjectReference* ref)
+  {
+    if ((mSize + 1)*4 > mSlots.size()*3)
+      resize(mSlots.size()*2);
+    place(ref);
+    mSize++;
+  }
+
+  ObjectReference* remove(rtIObject* key)
+  {
+    size_t mask = mSlots.size() - 1;
+    size_t i = slot(key);
+    while (mSlots[i] && mSlots[i]->RTObject.getPtr() != key)
+      i = (i + 1) & mask;
+    ObjectReference* ref = mSlots[i];
+    if (!ref)
+      return NULL;
+
+    // move back whatever the hole would hide from its home slot
+    size_t hole = i;
+    for (size_t j = (i + 1) & mask; mSlots[j]; j = (j + 1) & mask)
+    {
+      size_t home = slot(mSlots[j]->RTObject.getPtr());
+      if (((j - home) & mask) >= ((j - hole) & mask))
+      {
+        mSlots[hole] = mSlots[j];
+        hole = j;
+      }
+    }
+    mSlots[hole] = NULL;
+    mSize--;
+    return ref;
+  }
+
+  // Hands every entry to f and empties the table
+  template<typename F>
+  void clear(F f)
+  {
+    for (size_t i = 0; i < mSlots.size(); i++)
+    {
+      if (mSlots[i])
+        f(mSlots[i]);
+    }
+    mSlots.assign(16, (ObjectReference*)NULL);
+    mSize = 0;
+  }
+
+private:
+  size_t slot(const rtIObject* key) const
+  {
+    uint64_t h = ((uintptr_t)key >> 3) * 0x9e3779b97f4a7c15ULL;
+    return (size_t)(h >> 32) & (mSlots.size() - 1);
+  }
+
+  void place(ObjectReference* ref)
+  {
+    size_t mask = mSlots.size() - 1;
+    size_t i = slot(ref->RTObject.getPtr());
+    while (mSlots[i])
+      i = (i + 1) & mask;
+    mSlots[i] = ref;
+  }
+
+  void resize(size_t n)
+  {
+    vector<ObjectReference*> old(n, (ObjectReference*)NULL);
+    old.swap(mSlots);
+    for (size_t i = 0; i < old.size(); i++)
+    {
+      if (old[i])
+        place(old[i]);
+    }
+  }
+
+  uint32_t mContextId;
+  size_t mSize;
+  vector<ObjectReference*> mSlots;
 };
 
-typedef std::map< rtIObject*, ObjectReference*  > ObjectReferenceMap;
-static ObjectReferenceMap objectMap;
+// There are only ever a few contexts, and lookups mostly come from the one
+// used last
+typedef std::map<uint32_t, HandleTable*> HandleTableMap;
+static HandleTableMap handleTables;
+static HandleTable* sLastTable = NULL;
+
+static HandleTable* handleTableForContext(uint32_t contextId, bool create)
+{
+  if (sLastTable && sLastTable->contextId() == contextId)
+    return sLastTable;
+
+  HandleTableMap::iterator i = handleTables.find(contextId);
+  if (i != handleTables.end())
+    sLastTable = i->second;
+  else if (create)
+    sLastTable = handleTables[contextId] = new HandleTable(contextId);
+  else
+    return NULL;
+  return sLastTable;
+}
 
 uint32_t
 GetContextId(Local<Context>& ctx)
@@ -48,77 +183,29 @@ GetContextId(Local<Context>& ctx)
   return val->Uint32Value();
 }
 
-void weakCallback_rt2v8(const WeakCallbackData<Object, rtIObject>& data)
+void weakCallback_rt2v8(const WeakCallbackData<Object, ObjectReference>& data)
 {
   Locker locker(data.GetIsolate());
   Isolate::Scope isolateScope(data.GetIsolate());
   HandleScope handleScope(data.GetIsolate());
-#ifndef RUNINMAIN
-  rtObjectRef temp;
-#endif
-  // rtLogInfo("ptr: %p", data.GetParameter());
 
-  Local<Object> obj = data.GetValue();
-  assert(!obj.IsEmpty());
+  ObjectReference* ref = data.GetParameter();
+  // rtLogInfo("ptr: %p", ref->RTObject.getPtr());
 
-  Local<Context> ctx = obj->CreationContext();
-  assert(!ctx.IsEmpty());
+  ObjectReference* found = ref->Table->remove(ref->RTObject.getPtr());
+  if (found != ref)
+    rtLogWarn("failed to find:%p in map", ref->RTObject.getPtr());
 
-  #if 0
-  Local<String> s = obj->GetConstructorName();
-  String::Utf8Value v(s);
-  rtLogInfo("OBJ: %s", *v);
-
-  int index = 0;
-  rtIObject* rt = data.GetParameter();
-  rtValue value;
-  while (rt->Get(index++, &value) == RT_OK)
-  {
-    rtLogInfo("  type:%d", value.getType());
-  }
-  #endif
+  ref->PersistentObject.ClearWeak();
+  ref->PersistentObject.Reset();
 
-  // uint32_t contextId = GetContextId(ctx);
-  // rtLogInfo("contextId: %u addr:%p", contextId, data.GetParameter());
-rtWrapperSceneUpdateEnter();
 #ifndef RUNINMAIN
-  pthread_mutex_lock(&sObjectMapMutex);
-#endif
-  ObjectReferenceMap::iterator j = objectMap.find(data.GetParameter());
-  if (j != objectMap.end())
-  {
-    // TODO: Removing this temporarily until we understand how this callback works. I
-    // would have assumed that this is a weak persistent since we called SetWeak() on it
-    // before inserting it into the objectMap_rt2v8 map.
-    // assert(p->IsWeak());
-    //
-    j->second->PersistentObject.ClearWeak();
-    j->second->PersistentObject.Reset();
-#ifndef RUNINMAIN
-    temp = j->second->RTObject;
-#endif
-#if 0
-    if (!p->IsWeak())
-      rtLogWarn("TODO: Why isn't this handle weak?");
-    if (p)
-    {
-      // delete p;
-    }
-    else
-    {
-      rtLogError("null handle in map");
-    }
+  rtObjectRef temp = ref->RTObject;
 #endif
-    delete j->second;
-    objectMap.erase(j);
-  }
-  else
-  {
-    rtLogWarn("failed to find:%p in map", data.GetParameter());
-  }
+rtWrapperSceneUpdateEnter();
+  delete ref;
 rtWrapperSceneUpdateExit();
 #ifndef RUNINMAIN
-  pthread_mutex_unlock(&sObjectMapMutex);
   rtObjectRef parentRef;
   rtError err = temp.get<rtObjectRef>("parent",parentRef);
   if (err == RT_OK)
@@ -134,49 +221,30 @@ rtWrapperSceneUpdateExit();
 void
 HandleMap::clearAllForContext(uint32_t contextId)
 {
-  typedef ObjectReferenceMap::iterator iterator;
+  HandleTable* table = handleTableForContext(contextId, false);
+  if (!table)
+    return;
 
-  int n = 0;
-rtWrapperSceneUpdateEnter();
-#ifndef RUNINMAIN
-  pthread_mutex_lock(&sObjectMapMutex);
-#endif
   rtLogInfo("clearing all persistent handles for: %u size:%u", contextId,
-    static_cast<unsigned>(objectMap.size()));
-  vector<iterator> refs;
-  for (iterator begin = objectMap.begin(), end = objectMap.end(); begin != end;)
-  {
-      ObjectReference* ref = begin->second;
-      //rtLogInfo("looking at:%d == %d", ref->CreationContextId, contextId);
-
-      if (ref->CreationContextId == contextId)
-      {
-        refs.push_back(begin);
-        ref->PersistentObject.ClearWeak();
-        ref->PersistentObject.Reset();
-        delete ref;
-        ref = NULL;
-        begin++;
-        n++;
-      }
-      else
-      {
-        //rtLogInfo("looping :%d == %d", ref->CreationContextId, contextId);
-        ++begin;
-      }
-  }
+    static_cast<unsigned>(table->size()));
 
-  for(unsigned int i=0; i<refs.size();i++)
+  struct release
   {
-    objectMap.erase(refs[i]);
-  }
-  refs.clear();
-  //rtLogInfo("clear complete for id[%d] . removed:%d size:%u", contextId, n,
-      //static_cast<unsigned>(objectMap.size()));
+    void operator()(ObjectReference* ref)
+    {
+      ref->PersistentObject.ClearWeak();
+      ref->PersistentObject.Reset();
+      delete ref;
+    }
+  };
+rtWrapperSceneUpdateEnter();
+  table->clear(release());
 rtWrapperSceneUpdateExit();
-#ifndef RUNINMAIN
-  pthread_mutex_unlock(&sObjectMapMutex);
-#endif
+
+  handleTables.erase(contextId);
+  if (sLastTable == table)
+    sLastTable = NULL;
+  delete table;
 }
 
 void HandleMap::addWeakReference(v8::Isolate* isolate, const rtObjectRef& from, Local<Object>& to)
@@ -186,27 +254,21 @@ void HandleMap::addWeakReference(v8::Isolate* isolate, const rtObjectRef& from,
 
   uint32_t const contextIdCreation = GetContextId(creationContext);
   assert(contextIdCreation != 0);
-rtWrapperSceneUpdateEnter();
-#ifndef RUNINMAIN
-  pthread_mutex_lock(&sObjectMapMutex);
-#endif
-  ObjectReferenceMap::iterator i = objectMap.find(from.getPtr());
-  assert(i == objectMap.end());
 
-  if (i == objectMap.end())
+  HandleTable* table = handleTableForContext(contextIdCreation, true);
+  assert(table->find(from.getPtr()) == NULL);
+
+  if (!table->find(from.getPtr()))
   {
     // rtLogInfo("add id:%u addr:%p", contextIdCreation, from.getPtr());
     ObjectReference* entry(new ObjectReference());
     entry->PersistentObject.Reset(isolate, to);
-    entry->PersistentObject.SetWeak(from.getPtr(), &weakCallback_rt2v8);
+    entry->PersistentObject.SetWeak(entry, &weakCallback_rt2v8);
     entry->RTObject = from;
     entry->CreationContextId = contextIdCreation;
-    objectMap.insert(std::make_pair(from.getPtr(), entry));
+    entry->Table = table;
+    table->insert(entry);
   }
-rtWrapperSceneUpdateExit(); 
-#ifndef RUNINMAIN 
-  pthread_mutex_unlock(&sObjectMapMutex);
-#endif
 
   #if 0
   static FILE* f = NULL;
@@ -227,24 +289,12 @@ Local<Object> HandleMap::lookupSurrogate(v8::Local<v8::Context>& ctx, const rtOb
   Isolate* isolate = ctx->GetIsolate();
   EscapableHandleScope scope(isolate);
   Local<Object> obj;
-rtWrapperSceneUpdateEnter();
-#ifndef RUNINMAIN
-  pthread_mutex_lock(&sObjectMapMutex);
-#endif
-  ObjectReferenceMap::iterator i = objectMap.find(from.getPtr());
-  if (i == objectMap.end())
-  {
-    rtWrapperSceneUpdateExit();
-#ifndef RUNINMAIN
-    pthread_mutex_unlock(&sObjectMapMutex);
-#endif
+
+  HandleTable* table = handleTableForContext(GetContextId(ctx), false);
+  ObjectReference* ref = table ? table->find(from.getPtr()) : NULL;
+  if (!ref)
     return scope.Escape(obj);
-  }
-  obj = PersistentToLocal(isolate, i->second->PersistentObject);
-rtWrapperSceneUpdateExit();
-#ifndef RUNINMAIN
-  pthread_mutex_unlock(&sObjectMapMutex);
-#endif
+  obj = PersistentToLocal(isolate, ref->PersistentObject);
 
   #if 1
   if (!obj.IsEmpty())
@@ -291,6 +341,47 @@ bool rtWrapperSceneUpdateHasLock()
 #endif
 }
 
+bool rtWrapperSceneLockStatsEnabled()
+{
+  return sLockStatsEnabled;
+}
+
+void rtWrapperSetSceneLockStatsEnabled(bool enabled)
+{
+  sLockStatsEnabled = enabled;
+}
+
+void rtWrapperSceneLockStatsCollect(rtWrapperSceneLockStats& stats)
+{
+  stats = sLockStats;
+  memset(&sLockStats, 0, sizeof(sLockStats));
+}
+
+// start is when the outermost enter began waiting, 0 without stats
+static void sceneLockAcquired(double start, bool contended)
+{
+  if (!sLockStatsEnabled)
+    return;
+  sLockHoldStart = pxMilliseconds();
+  double wait = sLockHoldStart - start;
+  sLockStats.acquired++;
+  if (contended)
+    sLockStats.contended++;
+  sLockStats.waitMs += wait;
+  if (wait > sLockStats.maxWaitMs)
+    sLockStats.maxWaitMs = wait;
+}
+
+static void sceneLockReleased()
+{
+  if (!sLockStatsEnabled)
+    return;
+  double hold = pxMilliseconds() - sLockHoldStart;
+  sLockStats.holdMs += hold;
+  if (hold > sLockStats.maxHoldMs)
+    sLockStats.maxHoldMs = hold;
+}
+
 void rtWrapperSceneUpdateEnter()
 {
 #ifndef RUNINMAIN
@@ -314,9 +405,18 @@ void rtWrapperSceneUpdateEnter()
     else 
     {
       //printf("rtWrapperSceneUpdateEnter locking\n");
-      uv_mutex_lock(&threadMutex);
+      double start = 0;
+      bool contended = false;
+      if (sLockStatsEnabled)
+      {
+        start = pxMilliseconds();
+        contended = uv_mutex_trylock(&threadMutex) != 0;
+      }
+      if (!sLockStatsEnabled || contended)
+        uv_mutex_lock(&threadMutex);
       //printf("rtWrapperSceneUpdateEnter GOT LOCK!!!\n");
       sCurrentSceneThread = pthread_self();
+      sceneLockAcquired(start, contended);
       sLockCount++;
     }
   }
@@ -327,8 +427,21 @@ void rtWrapperSceneUpdateEnter()
   std::unique_lock<std::mutex> lock(sSceneLock);
   sCurrentSceneThread = std::this_thread::get_id();
 #else
-  assert(pthread_mutex_lock(&sSceneLock) == 0);
-  sCurrentSceneThread = pthread_self();
+  // nested enters only count, the mutex is taken once
+  if (!rtWrapperSceneUpdateHasLock())
+  {
+    double start = 0;
+    bool contended = false;
+    if (sLockStatsEnabled)
+    {
+      start = pxMilliseconds();
+      contended = pthread_mutex_trylock(&sSceneLock) != 0;
+    }
+    if (!sLockStatsEnabled || contended)
+      pthread_mutex_lock(&sSceneLock);
+    sCurrentSceneThread = pthread_self();
+    sceneLockAcquired(start, contended);
+  }
 #endif
   sLockCount++;
 #endif // RUNINMAIN
@@ -362,6 +475,7 @@ void rtWrapperSceneUpdateExit()
   // Main thread is now NOT the node thread
   if (sLockCount == 0) {
     //printf("rtWrapperSceneUpdateExit unlocking\n");
+    sceneLockReleased();
     uv_mutex_unlock(&threadMutex);
   }
 
@@ -379,19 +493,128 @@ void rtWrapperSceneUpdateExit()
     sCurrentSceneThread = std::thread::id()
 #else
   if (sLockCount == 0)
+  {
     sCurrentSceneThread = 0;
+    sceneLockReleased();
+    pthread_mutex_unlock(&sSceneLock);
+  }
 #endif
 
 #ifdef USE_STD_THREADS
   std::unique_lock<std::mutex> lock(sSceneLock);
-#else
-  assert(pthread_mutex_unlock(&sSceneLock) == 0);
 #endif
 #endif // RUNINMAIN
 }
 
 using namespace v8;
 
+// rtBuffers and the ArrayBuffers over their memory.  An entry holds a ref on
+// the buffer until the ArrayBuffer is collected, so the memory stays put
+// while either side can see it, and an ArrayBuffer coming back from script
+// finds its buffer by the memory it's over.  Only used with the isolate
+// locked.
+struct BufferReference
+{
+  rtBufferRef             Buffer;
+  Persistent<ArrayBuffer> PersistentObject;
+  // counted against the heap, for buffers made on the native side
+  int64_t                 ExternalBytes;
+};
+
+typedef std::map<std::pair<uint8_t*, uint32_t>, BufferReference*> BufferMap;
+static BufferMap sBufferMap;
+
+static void weakCallback_buffer(const WeakCallbackData<ArrayBuffer, BufferReference>& data)
+{
+  BufferReference* ref = data.GetParameter();
+
+  BufferMap::iterator it = sBufferMap.find(std::make_pair(ref->Buffer->data(), ref->Buffer->length()));
+  // another buffer over the same bytes may have taken the slot since
+  if (it != sBufferMap.end() && it->second == ref)
+    sBufferMap.erase(it);
+
+  if (ref->ExternalBytes)
+    data.GetIsolate()->AdjustAmountOfExternalAllocatedMemory(-ref->ExternalBytes);
+
+  ref->PersistentObject.ClearWeak();
+  ref->PersistentObject.Reset();
+  delete ref;
+}
+
+static void addBufferReference(Isolate* isolate, rtBuffer* buffer, Local<ArrayBuffer>& arrayBuffer,
+                               int64_t externalBytes)
+{
+  BufferReference* ref = new BufferReference();
+  ref->Buffer = buffer;
+  ref->PersistentObject.Reset(isolate, arrayBuffer);
+  ref->PersistentObject.SetWeak(ref, &weakCallback_buffer);
+  ref->ExternalBytes = externalBytes;
+  if (externalBytes)
+    isolate->AdjustAmountOfExternalAllocatedMemory(externalBytes);
+  sBufferMap[std::make_pair(buffer->data(), buffer->length())] = ref;
+}
+
+static Handle<Value> bufferToJs(Isolate* isolate, rtBuffer* buffer)
+{
+  if (!buffer)
+    return Null(isolate);
+
+  BufferMap::iterator it = sBufferMap.find(std::make_pair(buffer->data(), buffer->length()));
+  if (it != sBufferMap.end() && it->second->Buffer.getPtr() == buffer)
+    return Local<ArrayBuffer>::New(isolate, it->second->PersistentObject);
+
+  // externalized from the start, the memory is the buffer's
+  Local<ArrayBuffer> arrayBuffer = ArrayBuffer::New(isolate, buffer->data(), buffer->length());
+  addBufferReference(isolate, buffer, arrayBuffer, buffer->length());
+  return arrayBuffer;
+}
+
+static rtValue bufferFromJs(Isolate* isolate, const Handle<Value>& val)
+{
+  Local<ArrayBuffer> arrayBuffer;
+  size_t offset = 0;
+  size_t length = 0;
+  if (val->IsArrayBufferView())
+  {
+    Local<ArrayBufferView> view = Local<ArrayBufferView>::Cast(val);
+    arrayBuffer = view->Buffer();
+    offset = view->ByteOffset();
+    length = view->ByteLength();
+  }
+  else
+  {
+    arrayBuffer = Local<ArrayBuffer>::Cast(val);
+    length = arrayBuffer->ByteLength();
+  }
+
+  rtBufferRef buffer;
+  if (arrayBuffer->IsExternal())
+  {
+    ArrayBuffer::Contents contents = arrayBuffer->GetContents();
+    BufferMap::iterator it = sBufferMap.find(std::make_pair((uint8_t*)contents.Data(),
+                                                            (uint32_t)contents.ByteLength()));
+    if (it == sBufferMap.end())
+    {
+      // someone else's memory, there's no telling how long it lives
+      return rtValue(rtBufferRef(rtBuffer::create((uint8_t*)contents.Data() + offset, length)));
+    }
+    buffer = it->second->Buffer;
+  }
+  else
+  {
+    // Take the memory from v8.  It came from node's allocator, which is
+    // malloc, so the buffer frees it when the ArrayBuffer and every rtBuffer
+    // over it are gone.
+    ArrayBuffer::Contents contents = arrayBuffer->Externalize();
+    buffer = rtBuffer::wrap((uint8_t*)contents.Data(), (uint32_t)contents.ByteLength());
+    addBufferReference(isolate, buffer.getPtr(), arrayBuffer, 0);
+  }
+
+  if (offset == 0 && length == buffer->length())
+    return rtValue(buffer);
+  return rtValue(rtBufferRef(buffer->slice((uint32_t)offset, (uint32_t)length)));
+}
+
 Handle<Value> rt2js(Local<Context>& ctx, const rtValue& v)
 {
   Context::Scope contextScope(ctx);
@@ -453,6 +676,9 @@ Handle<Value> rt2js(Local<Context>& ctx, const rtValue& v)
         return String::NewFromUtf8(isolate, s.cString());
       }
       break;
+    case RT_bufferType:
+      return bufferToJs(isolate, v.toBuffer().getPtr());
+      break;
     case RT_voidPtrType:
       rtLogWarn("attempt to convert from void* to JS object");
       return Handle<Value>(); // TODO
@@ -477,6 +703,7 @@ rtValue js2rt(v8::Local<v8::Context>& ctx, const Handle<Value>& val, rtWrapperEr
   if (val->IsNull())      { return rtValue((char *)0); }
   if (val->IsString())    { return toString(val); }
   if (val->IsFunction())  { return rtValue(rtFunctionRef(new jsFunctionWrapper(ctx, val))); }
+  if (val->IsArrayBuffer() || val->IsArrayBufferView()) { return bufferFromJs(isolate, val); }
   if (val->IsArray() || val->IsObject())
   {
     // This is mostly a heuristic. We should probably set a second internal
@@ -196,6 +196,27 @@ bool rtWrapperSceneUpdateHasLock();
 void rtWrapperSceneUpdateEnter();
 void rtWrapperSceneUpdateExit();
 
+// How long the scene lock was waited for and held, collected when
+// RT_SCENE_LOCK_STATS is set.  Only the outermost enter on a thread counts,
+// nested ones don't touch the mutex.
+struct rtWrapperSceneLockStats
+{
+  uint32_t acquired;
+  uint32_t contended;
+  double   waitMs;
+  double   maxWaitMs;
+  double   holdMs;
+  double   maxHoldMs;
+};
+
+bool rtWrapperSceneLockStatsEnabled();
+// Turns the stats on or off whatever RT_SCENE_LOCK_STATS says.  Call it
+// with no thread holding the lock.
+void rtWrapperSetSceneLockStatsEnabled(bool enabled);
+// Copies the stats gathered since the last call and starts again.  Call it
+// with the lock held.
+void rtWrapperSceneLockStatsCollect(rtWrapperSceneLockStats& stats);
+
 class rtWrapperSceneUnlocker
 {
 public:
@@ -0,0 +1,573 @@
+/*
+
+ pxCore Copyright 2005-2017 John Robinson
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*/
+
+// pxPixelConvert.cpp
+//
+// (c*a)/255 is exact in 16 bits for 8 bit c and a as
+//
+//   x/255  ==  (x + 1 + (x >> 8)) >> 8      for x <= 255*255
+//
+// so the vector premultiplies widen each channel to 16 bits, multiply and
+// divide that way.  The alpha channel is multiplied by 255 to keep it as is.
+// Blending over needs a real divide, so the vector versions only take care
+// of whole groups of opaque or transparent pixels and leave the rest to the
+// scalar code.
+
+#include "pxPixelConvert.h"
+#include "pxCore.h"
+#include "pxBuffer.h"
+
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PX_CONVERT_SSSE3
+#define PX_CONVERT_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PX_CONVERT_NEON
+#include <arm_neon.h>
+#endif
+
+//
+// Scalar
+//
+
+static void rgbToRgbaScalar(uint32_t* d, const uint8_t* s, int n)
+{
+  uint8_t* p = (uint8_t*)d;
+  for (int i = 0; i < n; i++, p += 4, s += 3)
+  {
+    p[0] = s[0];
+    p[1] = s[1];
+    p[2] = s[2];
+    p[3] = 255;
+  }
+}
+
+static void rgbToBgraScalar(uint32_t* d, const uint8_t* s, int n)
+{
+  uint8_t* p = (uint8_t*)d;
+  for (int i = 0; i < n; i++, p += 4, s += 3)
+  {
+    p[0] = s[2];
+    p[1] = s[1];
+    p[2] = s[0];
+    p[3] = 255;
+  }
+}
+
+static void swapRBScalar(uint32_t* d, const uint32_t* s, int n)
+{
+  uint8_t* p = (uint8_t*)d;
+  const uint8_t* q = (const uint8_t*)s;
+  for (int i = 0; i < n; i++, p += 4, q += 4)
+  {
+    uint8_t r = q[0];
+    p[0] = q[2];
+    p[1] = q[1];
+    p[2] = r;
+    p[3] = q[3];
+  }
+}
+
+static void premultiplyScalar(uint32_t* d, const uint32_t* s, int n)
+{
+  uint8_t* p = (uint8_t*)d;
+  const uint8_t* q = (const uint8_t*)s;
+  for (int i = 0; i < n; i++, p += 4, q += 4)
+  {
+    uint32_t a = q[3];
+    p[0] = (q[0] * a)/255;
+    p[1] = (q[1] * a)/255;
+    p[2] = (q[2] * a)/255;
+    p[3] = a;
+  }
+}
+
+static void blendOverScalar(uint32_t* d, const uint32_t* s, int n)
+{
+  uint8_t* dp = (uint8_t*)d;
+  const uint8_t* sp = (const uint8_t*)s;
+  for (int i = 0; i < n; i++, sp += 4, dp += 4)
+  {
+    if (sp[3] == 255)
+      memcpy(dp, sp, 4);
+    else if (sp[3] != 0)
+    {
+      if (dp[3] != 0)
+      {
+        int u = sp[3] * 255;
+        int v = (255 - sp[3]) * dp[3];
+        int al = u + v;
+        dp[0] = (sp[0] * u + dp[0] * v) / al;
+        dp[1] = (sp[1] * u + dp[1] * v) / al;
+        dp[2] = (sp[2] * u + dp[2] * v) / al;
+        dp[3] = al / 255;
+      }
+      else
+        memcpy(dp, sp, 4);
+    }
+  }
+}
+
+static const pxConvertKernels gScalar =
+{
+  rgbToRgbaScalar, rgbToBgraScalar, swapRBScalar, premultiplyScalar, blendOverScalar
+};
+
+#ifdef PX_CONVERT_SSSE3
+
+//
+// SSSE3, 4 pixels at a time, 16 for the RGB expansions
+//
+
+#define PX_SSSE3 __attribute__((target("ssse3")))
+
+// RGB triples to the first three bytes of each pixel
+#define PX_RGBA_SHUFFLE 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1
+#define PX_BGRA_SHUFFLE 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1
+#define PX_SWAP_SHUFFLE 2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15
+// alpha to the color channels of the widened pixels, 0 for the alpha channel
+#define PX_ALPHA_LO_SHUFFLE 3, -1, 3, -1, 3, -1, -1, -1, 7, -1, 7, -1, 7, -1, -1, -1
+#define PX_ALPHA_HI_SHUFFLE 11, -1, 11, -1, 11, -1, -1, -1, 15, -1, 15, -1, 15, -1, -1, -1
+
+// Returns how many pixels were done
+PX_SSSE3 static inline int rgbExpandSSSE3(uint32_t* d, const uint8_t* s, int n, __m128i m)
+{
+  const __m128i alpha = _mm_set1_epi32((int)0xff000000);
+  int i = 0;
+  for (; i + 16 <= n; i += 16, s += 48)
+  {
+    __m128i a = _mm_loadu_si128((const __m128i*)s);
+    __m128i b = _mm_loadu_si128((const __m128i*)(s + 16));
+    __m128i c = _mm_loadu_si128((const __m128i*)(s + 32));
+    _mm_storeu_si128((__m128i*)(d + i), _mm_or_si128(_mm_shuffle_epi8(a, m), alpha));
+    _mm_storeu_si128((__m128i*)(d + i + 4),
+                     _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(b, a, 12), m), alpha));
+    _mm_storeu_si128((__m128i*)(d + i + 8),
+                     _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(c, b, 8), m), alpha));
+    _mm_storeu_si128((__m128i*)(d + i + 12),
+                     _mm_or_si128(_mm_shuffle_epi8(_mm_srli_si128(c, 4), m), alpha));
+  }
+  return i;
+}
+
+PX_SSSE3 static void rgbToRgbaSSSE3(uint32_t* d, const uint8_t* s, int n)
+{
+  int i = rgbExpandSSSE3(d, s, n, _mm_setr_epi8(PX_RGBA_SHUFFLE));
+  rgbToRgbaScalar(d + i, s + i*3, n - i);
+}
+
+PX_SSSE3 static void rgbToBgraSSSE3(uint32_t* d, const uint8_t* s, int n)
+{
+  int i = rgbExpandSSSE3(d, s, n, _mm_setr_epi8(PX_BGRA_SHUFFLE));
+  rgbToBgraScalar(d + i, s + i*3, n - i);
+}
+
+PX_SSSE3 static void swapRBSSSE3(uint32_t* d, const uint32_t* s, int n)
+{
+  const __m128i m = _mm_setr_epi8(PX_SWAP_SHUFFLE);
+  int i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    __m128i x = _mm_loadu_si128((const __m128i*)(s + i));
+    _mm_storeu_si128((__m128i*)(d + i), _mm_shuffle_epi8(x, m));
+  }
+  swapRBScalar(d + i, s + i, n - i);
+}
+
+PX_SSSE3 static inline __m128i div255x(__m128i x)
+{
+  __m128i t = _mm_add_epi16(_mm_add_epi16(x, _mm_set1_epi16(1)), _mm_srli_epi16(x, 8));
+  return _mm_srli_epi16(t, 8);
+}
+
+PX_SSSE3 static inline __m128i premultiply4(__m128i x)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i keepAlpha = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+  __m128i alo = _mm_or_si128(_mm_shuffle_epi8(x, _mm_setr_epi8(PX_ALPHA_LO_SHUFFLE)), keepAlpha);
+  __m128i ahi = _mm_or_si128(_mm_shuffle_epi8(x, _mm_setr_epi8(PX_ALPHA_HI_SHUFFLE)), keepAlpha);
+  __m128i lo = div255x(_mm_mullo_epi16(_mm_unpacklo_epi8(x, zero), alo));
+  __m128i hi = div255x(_mm_mullo_epi16(_mm_unpackhi_epi8(x, zero), ahi));
+  return _mm_packus_epi16(lo, hi);
+}
+
+PX_SSSE3 static void premultiplySSSE3(uint32_t* d, const uint32_t* s, int n)
+{
+  const __m128i alpha = _mm_set1_epi32((int)0xff000000);
+  int i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    __m128i x = _mm_loadu_si128((const __m128i*)(s + i));
+    // most images are mostly opaque
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(x, alpha), alpha)) != 0xffff)
+      x = premultiply4(x);
+    _mm_storeu_si128((__m128i*)(d + i), x);
+  }
+  premultiplyScalar(d + i, s + i, n - i);
+}
+
+PX_SSSE3 static void blendOverSSSE3(uint32_t* d, const uint32_t* s, int n)
+{
+  const __m128i alpha = _mm_set1_epi32((int)0xff000000);
+  const __m128i zero = _mm_setzero_si128();
+  int i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    __m128i x = _mm_loadu_si128((const __m128i*)(s + i));
+    __m128i a = _mm_and_si128(x, alpha);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(a, alpha)) == 0xffff)
+      _mm_storeu_si128((__m128i*)(d + i), x);
+    else if (_mm_movemask_epi8(_mm_cmpeq_epi32(a, zero)) != 0xffff)
+      blendOverScalar(d + i, s + i, 4);
+  }
+  blendOverScalar(d + i, s + i, n - i);
+}
+
+static const pxConvertKernels gSSSE3 =
+{
+  rgbToRgbaSSSE3, rgbToBgraSSSE3, swapRBSSSE3, premultiplySSSE3, blendOverSSSE3
+};
+
+#endif // PX_CONVERT_SSSE3
+
+#ifdef PX_CONVERT_AVX2
+
+//
+// AVX2, 8 pixels at a time.  The shuffles work within each 128 bit half
+// so the SSSE3 shuffle masks are used for both halves.
+//
+
+// The leftovers go to the SSSE3 versions, with the upper halves of the
+// registers cleared first to avoid the penalty for mixing the two.
+
+#define PX_AVX2 __attribute__((target("avx2")))
+
+PX_AVX2 static inline int rgbExpandAVX2(uint32_t* d, const uint8_t* s, int n, __m256i m)
+{
+  const __m256i alpha = _mm256_set1_epi32((int)0xff000000);
+  // each half loads 16 bytes for the 12 it uses, so stop while there are
+  // at least 4 bytes past the last pixel
+  int i = 0;
+  for (; i + 10 <= n; i += 8, s += 24)
+  {
+    __m128i lo = _mm_loadu_si128((const __m128i*)s);
+    __m128i hi = _mm_loadu_si128((const __m128i*)(s + 12));
+    __m256i x = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+    _mm256_storeu_si256((__m256i*)(d + i), _mm256_or_si256(_mm256_shuffle_epi8(x, m), alpha));
+  }
+  return i;
+}
+
+PX_AVX2 static void rgbToRgbaAVX2(uint32_t* d, const uint8_t* s, int n)
+{
+  int i = rgbExpandAVX2(d, s, n, _mm256_setr_epi8(PX_RGBA_SHUFFLE, PX_RGBA_SHUFFLE));
+  _mm256_zeroupper();
+  rgbToRgbaSSSE3(d + i, s + i*3, n - i);
+}
+
+PX_AVX2 static void rgbToBgraAVX2(uint32_t* d, const uint8_t* s, int n)
+{
+  int i = rgbExpandAVX2(d, s, n, _mm256_setr_epi8(PX_BGRA_SHUFFLE, PX_BGRA_SHUFFLE));
+  _mm256_zeroupper();
+  rgbToBgraSSSE3(d + i, s + i*3, n - i);
+}
+
+PX_AVX2 static void swapRBAVX2(uint32_t* d, const uint32_t* s, int n)
+{
+  const __m256i m = _mm256_setr_epi8(PX_SWAP_SHUFFLE, PX_SWAP_SHUFFLE);
+  int i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    __m256i x = _mm256_loadu_si256((const __m256i*)(s + i));
+    _mm256_storeu_si256((__m256i*)(d + i), _mm256_shuffle_epi8(x, m));
+  }
+  _mm256_zeroupper();
+  swapRBSSSE3(d + i, s + i, n - i);
+}
+
+PX_AVX2 static inline __m256i div255x8(__m256i x)
+{
+  __m256i t = _mm256_add_epi16(_mm256_add_epi16(x, _mm256_set1_epi16(1)), _mm256_srli_epi16(x, 8));
+  return _mm256_srli_epi16(t, 8);
+}
+
+PX_AVX2 static void premultiplyAVX2(uint32_t* d, const uint32_t* s, int n)
+{
+  const __m256i alpha = _mm256_set1_epi32((int)0xff000000);
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i keepAlpha = _mm256_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255,
+                                              0, 0, 0, 255, 0, 0, 0, 255);
+  const __m256i mlo = _mm256_setr_epi8(PX_ALPHA_LO_SHUFFLE, PX_ALPHA_LO_SHUFFLE);
+  const __m256i mhi = _mm256_setr_epi8(PX_ALPHA_HI_SHUFFLE, PX_ALPHA_HI_SHUFFLE);
+  int i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    __m256i x = _mm256_loadu_si256((const __m256i*)(s + i));
+    if ((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_and_si256(x, alpha), alpha)) != 0xffffffff)
+    {
+      __m256i alo = _mm256_or_si256(_mm256_shuffle_epi8(x, mlo), keepAlpha);
+      __m256i ahi = _mm256_or_si256(_mm256_shuffle_epi8(x, mhi), keepAlpha);
+      __m256i lo = div255x8(_mm256_mullo_epi16(_mm256_unpacklo_epi8(x, zero), alo));
+      __m256i hi = div255x8(_mm256_mullo_epi16(_mm256_unpackhi_epi8(x, zero), ahi));
+      x = _mm256_packus_epi16(lo, hi);
+    }
+    _mm256_storeu_si256((__m256i*)(d + i), x);
+  }
+  _mm256_zeroupper();
+  premultiplySSSE3(d + i, s + i, n - i);
+}
+
+PX_AVX2 static void blendOverAVX2(uint32_t* d, const uint32_t* s, int n)
+{
+  const __m256i alpha = _mm256_set1_epi32((int)0xff000000);
+  const __m256i zero = _mm256_setzero_si256();
+  int i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    __m256i x = _mm256_loadu_si256((const __m256i*)(s + i));
+    __m256i a = _mm256_and_si256(x, alpha);
+    if ((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi32(a, alpha)) == 0xffffffff)
+      _mm256_storeu_si256((__m256i*)(d + i), x);
+    else if ((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi32(a, zero)) != 0xffffffff)
+      blendOverScalar(d + i, s + i, 8);
+  }
+  _mm256_zeroupper();
+  blendOverSSSE3(d + i, s + i, n - i);
+}
+
+static const pxConvertKernels gAVX2 =
+{
+  rgbToRgbaAVX2, rgbToBgraAVX2, swapRBAVX2, premultiplyAVX2, blendOverAVX2
+};
+
+#endif // PX_CONVERT_AVX2
+
+#ifdef PX_CONVERT_NEON
+
+//
+// NEON, 16 pixels at a time with the channels split out by the
+// interleaved loads and stores
+//
+
+static void rgbToRgbaNEON(uint32_t* d, const uint8_t* s, int n)
+{
+  int i = 0;
+  for (; i + 16 <= n; i += 16, s += 48)
+  {
+    uint8x16x3_t v = vld3q_u8(s);
+    uint8x16x4_t o;
+    o.val[0] = v.val[0];
+    o.val[1] = v.val[1];
+    o.val[2] = v.val[2];
+    o.val[3] = vdupq_n_u8(255);
+    vst4q_u8((uint8_t*)(d + i), o);
+  }
+  rgbToRgbaScalar(d + i, s, n - i);
+}
+
+static void rgbToBgraNEON(uint32_t* d, const uint8_t* s, int n)
+{
+  int i = 0;
+  for (; i + 16 <= n; i += 16, s += 48)
+  {
+    uint8x16x3_t v = vld3q_u8(s);
+    uint8x16x4_t o;
+    o.val[0] = v.val[2];
+    o.val[1] = v.val[1];
+    o.val[2] = v.val[0];
+    o.val[3] = vdupq_n_u8(255);
+    vst4q_u8((uint8_t*)(d + i), o);
+  }
+  rgbToBgraScalar(d + i, s, n - i);
+}
+
+static void swapRBNEON(uint32_t* d, const uint32_t* s, int n)
+{
+  int i = 0;
+  for (; i + 16 <= n; i += 16)
+  {
+    uint8x16x4_t v = vld4q_u8((const uint8_t*)(s + i));
+    uint8x16_t r = v.val[0];
+    v.val[0] = v.val[2];
+    v.val[2] = r;
+    vst4q_u8((uint8_t*)(d + i), v);
+  }
+  swapRBScalar(d + i, s + i, n - i);
+}
+
+static inline uint8x8_t div255NEON(uint16x8_t x)
+{
+  uint16x8_t t = vaddq_u16(vaddq_u16(x, vdupq_n_u16(1)), vshrq_n_u16(x, 8));
+  return vshrn_n_u16(t, 8);
+}
+
+static inline uint8x16_t premultiplyNEON(uint8x16_t c, uint8x16_t a)
+{
+  uint8x8_t lo = div255NEON(vmull_u8(vget_low_u8(c), vget_low_u8(a)));
+  uint8x8_t hi = div255NEON(vmull_u8(vget_high_u8(c), vget_high_u8(a)));
+  return vcombine_u8(lo, hi);
+}
+
+static inline bool allEqual(uint8x16_t v, uint64_t b)
+{
+  uint64x2_t w = vreinterpretq_u64_u8(v);
+  return vgetq_lane_u64(w, 0) == b && vgetq_lane_u64(w, 1) == b;
+}
+
+static void premultiplyNEON(uint32_t* d, const uint32_t* s, int n)
+{
+  int i = 0;
+  for (; i + 16 <= n; i += 16)
+  {
+    uint8x16x4_t v = vld4q_u8((const uint8_t*)(s + i));
+    if (!allEqual(v.val[3], ~0ULL))
+    {
+      v.val[0] = premultiplyNEON(v.val[0], v.val[3]);
+      v.val[1] = premultiplyNEON(v.val[1], v.val[3]);
+      v.val[2] = premultiplyNEON(v.val[2], v.val[3]);
+    }
+    vst4q_u8((uint8_t*)(d + i), v);
+  }
+  premultiplyScalar(d + i, s + i, n - i);
+}
+
+static void blendOverNEON(uint32_t* d, const uint32_t* s, int n)
+{
+  int i = 0;
+  for (; i + 16 <= n; i += 16)
+  {
+    uint8x16x4_t v = vld4q_u8((const uint8_t*)(s + i));
+    if (allEqual(v.val[3], ~0ULL))
+      vst4q_u8((uint8_t*)(d + i), v);
+    else if (!allEqual(v.val[3], 0))
+      blendOverScalar(d + i, s + i, 16);
+  }
+  blendOverScalar(d + i, s + i, n - i);
+}
+
+static const pxConvertKernels gNEON =
+{
+  rgbToRgbaNEON, rgbToBgraNEON, swapRBNEON, premultiplyNEON, blendOverNEON
+};
+
+#endif // PX_CONVERT_NEON
+
+static const pxConvertKernels* kernels(pxConvertImpl impl)
+{
+  switch (impl)
+  {
+    case pxConvertImplScalar: return &gScalar;
+#ifdef PX_CONVERT_SSSE3
+    case pxConvertImplSSSE3:
+      return __builtin_cpu_supports("ssse3")?&gSSSE3:NULL;
+#endif
+#ifdef PX_CONVERT_AVX2
+    case pxConvertImplAVX2:
+      return __builtin_cpu_supports("avx2")?&gAVX2:NULL;
+#endif
+#ifdef PX_CONVERT_NEON
+    case pxConvertImplNEON: return &gNEON;
+#endif
+    default: return NULL;
+  }
+}
+
+static pxConvertImpl bestImpl()
+{
+#if defined(PX_CONVERT_SSSE3) || defined(PX_CONVERT_AVX2)
+  // this runs from a static initializer, possibly before libgcc's own
+  __builtin_cpu_init();
+#endif
+  for (int i = pxConvertImplCount-1; i > pxConvertImplScalar; i--)
+  {
+    if (kernels((pxConvertImpl)i))
+      return (pxConvertImpl)i;
+  }
+  return pxConvertImplScalar;
+}
+
+// scalar until the cpu has been checked, in case an image is loaded during
+// static initialization
+static pxConvertImpl gImpl = pxConvertImplScalar;
+static const pxConvertKernels* gKernels = &gScalar;
+
+const pxConvertKernels& pxConvert()
+{
+  return *gKernels;
+}
+
+bool pxConvertSetImpl(pxConvertImpl impl)
+{
+  const pxConvertKernels* k = kernels(impl);
+  if (!k)
+    return false;
+  gImpl = impl;
+  gKernels = k;
+  return true;
+}
+
+pxConvertImpl pxConvertGetImpl()
+{
+  return gImpl;
+}
+
+static bool gConvertInit = pxConvertSetImpl(bestImpl());
+
+const char* pxConvertImplName(pxConvertImpl impl)
+{
+  switch (impl)
+  {
+    case pxConvertImplScalar: return "scalar";
+    case pxConvertImplSSSE3: return "ssse3";
+    case pxConvertImplAVX2: return "avx2";
+    case pxConvertImplNEON: return "neon";
+    default: return "unknown";
+  }
+}
+
+void pxConvertRGBToPixels(uint32_t* d, const uint8_t* s, int n)
+{
+#if defined(PX_LITTLEENDIAN_PIXELS) && defined(PX_LITTLEENDIAN_RGBA_PIXELS)
+  pxConvert().rgbToRgba(d, s, n);
+#else
+  pxConvert().rgbToBgra(d, s, n);
+#endif
+}
+
+void pxPremultiply(pxBuffer& b)
+{
+  const pxConvertKernels& k = pxConvert();
+  for (int32_t y = 0; y < b.height(); y++)
+  {
+    uint32_t* p = b.scanlineInt32(y);
+    k.premultiply(p, p, b.width());
+  }
+}
+
+void pxPremultiply(pxBuffer& d, const pxBuffer& s)
+{
+  const pxConvertKernels& k = pxConvert();
+  int32_t w = pxMin<int32_t>(d.width(), s.width());
+  int32_t h = pxMin<int32_t>(d.height(), s.height());
+  for (int32_t y = 0; y < h; y++)
+    k.premultiply(d.scanlineInt32(y), s.scanlineInt32(y), w);
+}
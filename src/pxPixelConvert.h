@@ -0,0 +1,75 @@
+/*
+
+ pxCore Copyright 2005-2017 John Robinson
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*/
+
+// pxPixelConvert.h
+
+#ifndef PX_PIXELCONVERT_H
+#define PX_PIXELCONVERT_H
+
+#include <stdint.h>
+
+class pxBuffer;
+
+// Pixel format conversions used by the image loaders and texture uploads.
+// Pixels are 4 bytes with alpha in the last byte, in either RGBA or BGRA
+// byte order.  Every implementation gives exactly the same bytes as the
+// scalar one.  The best implementation for the cpu is picked the first time
+// the kernels are used.
+
+enum pxConvertImpl
+{
+  pxConvertImplScalar,
+  pxConvertImplSSSE3,
+  pxConvertImplAVX2,
+  pxConvertImplNEON,
+  pxConvertImplCount
+};
+
+struct pxConvertKernels
+{
+  // 3 byte RGB pixels to RGBA with alpha 255
+  void (*rgbToRgba)(uint32_t* d, const uint8_t* s, int n);
+  // 3 byte RGB pixels to BGRA with alpha 255
+  void (*rgbToBgra)(uint32_t* d, const uint8_t* s, int n);
+  // swaps the first and third bytes, RGBA to BGRA and back.  d may be s
+  void (*swapRB)(uint32_t* d, const uint32_t* s, int n);
+  // each color byte c becomes (c*a)/255, as the texture uploads have always
+  // done it.  d may be s
+  void (*premultiply)(uint32_t* d, const uint32_t* s, int n);
+  // the APNG over operation, s over d, neither premultiplied
+  void (*blendOver)(uint32_t* d, const uint32_t* s, int n);
+};
+
+const pxConvertKernels& pxConvert();
+
+// Returns false if impl isn't available on this cpu.  Not safe to call
+// while anything is being converted.
+bool pxConvertSetImpl(pxConvertImpl impl);
+pxConvertImpl pxConvertGetImpl();
+const char* pxConvertImplName(pxConvertImpl impl);
+
+// 3 byte RGB pixels to pxPixels, whichever byte order this platform uses
+void pxConvertRGBToPixels(uint32_t* d, const uint8_t* s, int n);
+
+// Premultiplies every pixel of b
+void pxPremultiply(pxBuffer& b);
+// Copies s into d premultiplying on the way, both the same size.  Either
+// may be upside down.
+void pxPremultiply(pxBuffer& d, const pxBuffer& s);
+
+#endif // PX_PIXELCONVERT_H
@@ -32,6 +32,7 @@
 #include "pxCore.h"
 #include "pxOffscreen.h"
 #include "pxUtil.h"
+#include "pxPixelConvert.h"
 
 #define SUPPORT_PNG
 #define SUPPORT_JPG
@@ -68,6 +69,125 @@ rtError pxLoadImage(const char *imageData, size_t imageDataSize,
   return retVal;
 }
 
+static bool isWholeImage(const pxImageDecodeParams &params)
+{
+  return params.crop.isEmpty() && params.scale == 1;
+}
+
+static bool isValidScale(int32_t scale)
+{
+  return scale == 1 || scale == 2 || scale == 4 || scale == 8;
+}
+
+// The part of a w x h image that params asks for, in the pixels of the image
+// scaled down to sw x sh.  False if none of the crop is in the image
+static bool decodeRegion(const pxImageDecodeParams &params, int w, int h,
+                         int sw, int sh, pxRect &r)
+{
+  pxRect crop = params.crop;
+  if (crop.isEmpty())
+    crop.setLTRB(0, 0, w, h);
+  crop.intersect(pxRect(0, 0, w, h));
+  if (crop.isEmpty())
+    return false;
+
+  int32_t s = params.scale;
+  r.setLTRB(crop.left() / s, crop.top() / s,
+            pxMin<int32_t>((crop.right() + s - 1) / s, sw),
+            pxMin<int32_t>((crop.bottom() + s - 1) / s, sh));
+  return !r.isEmpty();
+}
+
+// Hands o to preview in the default pixel format, then puts it back the way
+// the decoder left it, since it's still being decoded into
+static void sendPreview(pxOffscreen &o, pxImagePreviewFunc preview, void *context)
+{
+  rtPixelFmt format = o.mPixelFormat;
+  if (format != RT_DEFAULT_PIX)
+    o.swizzleTo(RT_DEFAULT_PIX);
+  preview(context, o);
+  if (format != RT_DEFAULT_PIX)
+    o.swizzleTo(format);
+}
+
+// Whether decoding the image can produce a preview: a progressive jpeg,
+// which is what jpeg_has_multiple_scans reports, or an interlaced png.
+// Reads the headers only, so it's cheap enough to ask before every decode.
+static bool hasPreview(const char *imageData, size_t imageDataSize)
+{
+  const unsigned char *d = (const unsigned char *)imageData;
+  static const unsigned char pngSignature[8] =
+    { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+  // the interlace method is the last byte of IHDR, the first chunk
+  if (imageDataSize > 28 && memcmp(d, pngSignature, 8) == 0)
+    return d[28] != 0;
+
+  if (imageDataSize < 4 || d[0] != 0xff || d[1] != 0xd8)
+    return false;
+
+  // walk the markers up to the frame header, SOF2, 6, 10 and 14 are the
+  // progressive ones
+  size_t i = 2;
+  while (i + 4 <= imageDataSize)
+  {
+    if (d[i] != 0xff)
+      return false;
+    unsigned char marker = d[i + 1];
+    if (marker == 0xff)
+    {
+      i++;
+      continue;
+    }
+    if (marker == 0x01 || (marker >= 0xd0 && marker <= 0xd7))
+    {
+      i += 2;
+      continue;
+    }
+    if (marker >= 0xc0 && marker <= 0xcf && marker != 0xc4 &&
+        marker != 0xc8 && marker != 0xcc)
+      return marker == 0xc2 || marker == 0xc6 || marker == 0xca ||
+             marker == 0xce;
+    if (marker == 0xda)
+      return false;
+    i += 2 + ((d[i + 2] << 8) | d[i + 3]);
+  }
+  return false;
+}
+
+rtError pxLoadImage(const char *imageData, size_t imageDataSize,
+                    pxOffscreen &o, const pxImageDecodeParams &params,
+                    pxImagePreviewFunc preview, void *context)
+{
+  if (!isValidScale(params.scale))
+  {
+    rtLogError("image decode scale must be 1, 2, 4 or 8, not %d", params.scale);
+    return RT_ERROR_INVALID_ARG;
+  }
+
+  // turbo can't crop or stop after the first scan, libjpeg can. An image
+  // without a first scan to show has nothing to preview
+  if (isWholeImage(params) &&
+      (!preview || !hasPreview(imageData, imageDataSize)))
+    return pxLoadImage(imageData, imageDataSize, o);
+
+  rtError retVal = pxLoadPNGImage(imageData, imageDataSize, o, params,
+                                  preview, context);
+  if (retVal != RT_OK && retVal != RT_ERROR_INVALID_ARG)
+    retVal = pxLoadJPGImage(imageData, imageDataSize, o, params, preview,
+                            context);
+
+  if (o.mPixelFormat != RT_DEFAULT_PIX)
+  {
+    o.swizzleTo(RT_DEFAULT_PIX);
+  }
+
+  if (retVal == RT_OK && isWholeImage(params))
+    o.setCompressedData(imageData, imageDataSize);
+
+  return retVal;
+}
+
 rtError pxLoadAImage(const char* imageData, size_t imageDataSize,
   pxTimedOffscreenSequence &s)
 {
@@ -700,51 +820,27 @@ rtError pxLoadJPGImageTurbo(const char *buf, size_t buflen, pxOffscreen &o)
 
   tjDecompressHeader3(jpegDecompressor, (unsigned char *)buf, buflen, &width, &height, &jpegSubsamp, &jpegColorspace);
 
-  int colorComponent = 3;
-
-  if (jpegColorspace == TJCS_GRAY)
-  {
-    colorComponent = 1;
-  }
-
-  unsigned char *imageBuffer = tjAlloc(width * height * colorComponent);
+  o.init(width, height);
 
-  int result = tjDecompress2(jpegDecompressor, (unsigned char *)buf, buflen, imageBuffer, width, 0, height, (colorComponent == 3) ? TJPF_RGB : jpegColorspace, TJFLAG_FASTDCT);
+  // straight into the offscreen in the pxPixel byte order, turbo does the
+  // color conversion (gray included) and adds the alpha
+#if defined(PX_LITTLEENDIAN_PIXELS) && defined(PX_LITTLEENDIAN_RGBA_PIXELS)
+  int pixelFormat = TJPF_RGBA;
+#else
+  int pixelFormat = TJPF_BGRA;
+#endif
+  int result = tjDecompress2(jpegDecompressor, (unsigned char *)buf, buflen, (unsigned char *)o.base(),
+                             width, o.stride(), height, pixelFormat, TJFLAG_FASTDCT);
 
   if (result != 0)
   {
     rtLogError("Error decompressing using libjpeg turbo");
-    tjFree(imageBuffer);
     tjDestroy(jpegDecompressor);
     return RT_FAIL;
   }
 
-  o.init(width, height);
-
-  int scanlinen = 0;
-  unsigned int bufferIndex = 0;
-  while (scanlinen < height)
-  {
-    pxPixel *p = o.scanline(scanlinen++);
-    {
-      char *b = (char *)&imageBuffer[bufferIndex];
-      char *bend = b + (width * colorComponent);
-      while (b < bend)
-      {
-        p->r = b[0];
-        p->g = b[1];
-        p->b = b[2];
-        p->a = 255;
-        b += 3; // next pixel
-        bufferIndex += colorComponent;
-        p++;
-      }
-    }
-  }
-
   o.mPixelFormat = RT_PIX_ARGB;
 
-  tjFree(imageBuffer);
   tjDestroy(jpegDecompressor);
 
   /* And we're done! */
@@ -753,6 +849,56 @@ rtError pxLoadJPGImageTurbo(const char *buf, size_t buflen, pxOffscreen &o)
 #endif //ENABLE_LIBJPEG_TURBO
 
 rtError pxLoadJPGImage(const char *buf, size_t buflen, pxOffscreen &o)
+{
+  return pxLoadJPGImage(buf, buflen, o, pxImageDecodeParams());
+}
+
+// libjpeg-turbo 1.5 and later can skip rows and columns without decoding them
+#if defined(LIBJPEG_TURBO_VERSION_NUMBER) && LIBJPEG_TURBO_VERSION_NUMBER >= 1005000
+#define PX_JPEG_SKIP_SCANLINES
+#endif
+
+// One row of libjpeg output, 3 byte rgb or gray, to pxPixels
+static void jpgRowToPixels(uint32_t *d, const JSAMPLE *s, int n, int components)
+{
+  if (components == 3)
+    pxConvertRGBToPixels(d, (const uint8_t *)s, n);
+  else
+  {
+    // grayscale
+    pxPixel *p = (pxPixel *)d;
+    for (int i = 0; i < n; i++, s += components)
+      p[i] = pxPixel(s[0], s[0], s[0]);
+  }
+}
+
+// Reads the rows of r from the current output pass into o.  Rows above r are
+// thrown away, rows below it are never read.  x is the output column of the
+// first sample in each row
+static void readJPGRegion(j_decompress_ptr cinfo, JSAMPARRAY buffer,
+                          const pxRect &r, int x, pxOffscreen &o, bool canSkip)
+{
+#ifdef PX_JPEG_SKIP_SCANLINES
+  if (canSkip && (int)cinfo->output_scanline < r.top())
+    jpeg_skip_scanlines(cinfo, r.top() - cinfo->output_scanline);
+#else
+  (void)canSkip;
+#endif
+  while ((int)cinfo->output_scanline < r.top())
+    (void)jpeg_read_scanlines(cinfo, buffer, 1);
+
+  for (int y = 0; y < o.height(); y++)
+  {
+    (void)jpeg_read_scanlines(cinfo, buffer, 1);
+    jpgRowToPixels((uint32_t *)o.scanline(y),
+                   buffer[0] + (r.left() - x) * cinfo->output_components,
+                   o.width(), cinfo->output_components);
+  }
+}
+
+rtError pxLoadJPGImage(const char *buf, size_t buflen, pxOffscreen &o,
+                       const pxImageDecodeParams &params,
+                       pxImagePreviewFunc preview, void *context)
 {
   if (!buf)
   {
@@ -760,6 +906,12 @@ rtError pxLoadJPGImage(const char *buf, size_t buflen, pxOffscreen &o)
     return RT_FAIL;
   }
 
+  if (!isValidScale(params.scale))
+  {
+    rtLogError("jpg decode scale must be 1, 2, 4 or 8, not %d", params.scale);
+    return RT_ERROR_INVALID_ARG;
+  }
+
   /* This struct contains the JPEG decompression parameters and pointers to
    * working space (which is allocated as needed by the JPEG library).
    */
@@ -813,9 +965,15 @@ rtError pxLoadJPGImage(const char *buf, size_t buflen, pxOffscreen &o)
 
   /* Step 4: set parameters for decompression */
 
-  /* In this example, we don't need to change any of the defaults set by
-   * jpeg_read_header(), so we do nothing here.
+  /* Scaling down happens in the IDCT, which is far cheaper than decoding at
+   * full size.  A progressive image can be shown after its first scan, which
+   * is usually just the DC coefficients, so with a preview the scans are
+   * buffered and output twice.
    */
+  cinfo.scale_num = 1;
+  cinfo.scale_denom = params.scale;
+  bool progressive = preview && jpeg_has_multiple_scans(&cinfo);
+  cinfo.buffered_image = progressive ? TRUE : FALSE;
 
   /* Step 5: Start decompressor */
 
@@ -824,6 +982,16 @@ rtError pxLoadJPGImage(const char *buf, size_t buflen, pxOffscreen &o)
    * with the stdio data source.
    */
 
+  pxRect region;
+  if (!decodeRegion(params, cinfo.image_width, cinfo.image_height,
+                    cinfo.output_width, cinfo.output_height, region))
+  {
+    rtLogError("jpg decode crop is outside the %dx%d image",
+               cinfo.image_width, cinfo.image_height);
+    jpeg_destroy_decompress(&cinfo);
+    return RT_ERROR_INVALID_ARG;
+  }
+
   /* We may need to do some setup of our own at this point before reading
    * the data.  After jpeg_start_decompress() we have the correct scaled
    * output image dimensions available, as well as the output colormap
@@ -835,45 +1003,63 @@ rtError pxLoadJPGImage(const char *buf, size_t buflen, pxOffscreen &o)
   /* Make a one-row-high sample array that will go away when done with image */
   buffer = (*cinfo.mem->alloc_sarray)((j_common_ptr)&cinfo, JPOOL_IMAGE, row_stride, 1);
 
-  o.init(cinfo.output_width, cinfo.output_height);
+  o.init(region.width(), region.height());
+  o.mPixelFormat = RT_PIX_ARGB;
 
   /* Step 6: while (scan lines remain to be read) */
   /*           jpeg_read_scanlines(...); */
 
-  /* Here we use the library's state variable cinfo.output_scanline as the
-   * loop counter, so that we don't have to keep track ourselves.
-   */
-  int scanlinen = 0;
-  while (cinfo.output_scanline < cinfo.output_height)
+  if (progressive)
   {
-    /* jpeg_read_scanlines expects an array of pointers to scanlines.
-     * Here the array is only one element long, but you could ask for
-     * more than one scanline at a time if that's more convenient.
-     */
-    (void)jpeg_read_scanlines(&cinfo, buffer, 1);
-    /* Assume put_scanline_someplace wants a pointer and sample count. */
+    /* All of the data is in memory, so jpeg_consume_input never suspends. */
+    int status;
+    do
+      status = jpeg_consume_input(&cinfo);
+    while (status != JPEG_SCAN_COMPLETED && status != JPEG_REACHED_EOI);
 
-    pxPixel *p = o.scanline(scanlinen++);
+    if (status == JPEG_SCAN_COMPLETED)
     {
-      char *b = (char *)buffer[0];
-      char *bend = b + (cinfo.output_width * 3);
-      while (b < bend)
-      {
-        p->r = b[0];
-        p->g = b[1];
-        p->b = b[2];
-        p->a = 255;
-        b += 3; // next pixel
-        p++;
-      }
+      /* The preview is soon replaced, so it gets the quickest IDCT. */
+      J_DCT_METHOD dctMethod = cinfo.dct_method;
+      cinfo.dct_method = JDCT_IFAST;
+      (void)jpeg_start_output(&cinfo, cinfo.input_scan_number);
+      readJPGRegion(&cinfo, buffer, region, 0, o, false);
+      (void)jpeg_finish_output(&cinfo);
+      cinfo.dct_method = dctMethod;
+      sendPreview(o, preview, context);
+
+      while (jpeg_consume_input(&cinfo) != JPEG_REACHED_EOI)
+        ;
     }
-  }
 
-  o.mPixelFormat = RT_PIX_ARGB;
+    (void)jpeg_start_output(&cinfo, cinfo.input_scan_number);
+    readJPGRegion(&cinfo, buffer, region, 0, o, false);
+    (void)jpeg_finish_output(&cinfo);
+  }
+  else
+  {
+    int x = 0;
+#ifdef PX_JPEG_SKIP_SCANLINES
+    /* Only decode the columns of the region, widened to whole iMCUs.  A
+     * pixel more on each side keeps the upsampling at the edges the same as
+     * in the whole image.
+     */
+    if (region.width() < (int)cinfo.output_width)
+    {
+      JDIMENSION xoffset = pxMax<int>(region.left() - 1, 0);
+      JDIMENSION width = pxMin<int>(region.right() + 1, cinfo.output_width) - xoffset;
+      jpeg_crop_scanline(&cinfo, &xoffset, &width);
+      x = xoffset;
+    }
+#endif
+    readJPGRegion(&cinfo, buffer, region, x, o, true);
+  }
 
   /* Step 7: Finish decompression */
 
-  (void)jpeg_finish_decompress(&cinfo);
+  /* Rows below the region were never read, so there's nothing to finish. */
+  if (progressive || cinfo.output_scanline == cinfo.output_height)
+    (void)jpeg_finish_decompress(&cinfo);
   /* We can ignore the return value since suspension is not possible
    * with the stdio data source.
    */
@@ -920,21 +1106,82 @@ void readPngData(png_structp pngPtr, png_bytep data, png_size_t length)
   png_voidp a = png_get_io_ptr(pngPtr);
   PngStruct *pngStruct = (PngStruct *)a;
 
+  if (pngStruct->readPosition + length > pngStruct->imageDataSize)
+    png_error(pngPtr, "read past end of image data");
+
   memcpy((char *)data, pngStruct->imageData + pngStruct->readPosition, length);
   pngStruct->readPosition += length;
 }
 
 rtError pxLoadPNGImage(const char *imageData, size_t imageDataSize,
                        pxOffscreen &o)
+{
+  return pxLoadPNGImage(imageData, imageDataSize, o, pxImageDecodeParams());
+}
+
+// Averages n rows of scale x scale boxes of rgba pixels into count pixels of
+// d, starting at column x of the rows.  Boxes are cut short at width.  Colors
+// are weighted by alpha so clear pixels don't darken their neighbours.
+static void shrinkPNGRow(uint8_t *d, png_bytep *rows, int n, int x, int width,
+                         int scale, int count)
+{
+  if (scale == 1)
+  {
+    memcpy(d, rows[0] + x * 4, count * 4);
+    return;
+  }
+
+  for (int i = 0; i < count; i++, x += scale, d += 4)
+  {
+    int end = pxMin<int>(x + scale, width);
+    uint32_t r = 0, g = 0, b = 0, a = 0;
+    for (int j = 0; j < n; j++)
+    {
+      const uint8_t *p = rows[j] + x * 4;
+      for (int k = x; k < end; k++, p += 4)
+      {
+        r += p[0] * p[3];
+        g += p[1] * p[3];
+        b += p[2] * p[3];
+        a += p[3];
+      }
+    }
+    uint32_t pixels = n * (end - x);
+    d[0] = a ? (r + a / 2) / a : 0;
+    d[1] = a ? (g + a / 2) / a : 0;
+    d[2] = a ? (b + a / 2) / a : 0;
+    d[3] = (a + pixels / 2) / pixels;
+  }
+}
+
+// Crops and shrinks a fully decoded image into o
+static void shrinkPNGImage(pxOffscreen &o, png_bytep *rows, int width,
+                           int height, const pxRect &region, int scale)
+{
+  for (int y = 0; y < o.height(); y++)
+  {
+    int top = (region.top() + y) * scale;
+    shrinkPNGRow((uint8_t *)o.scanline(y), rows + top,
+                 pxMin<int>(scale, height - top), region.left() * scale,
+                 width, scale, o.width());
+  }
+}
+
+rtError pxLoadPNGImage(const char *imageData, size_t imageDataSize,
+                       pxOffscreen &o, const pxImageDecodeParams &params,
+                       pxImagePreviewFunc preview, void *context)
 {
   rtError e = RT_FAIL;
 
   png_structp png_ptr;
   png_infop info_ptr;
-  //  int number_of_passes;
-  png_bytep *row_pointers;
   PngStruct pngStruct((char *)imageData, imageDataSize);
 
+  // outside of the setjmp so a png error doesn't leak them
+  pxOffscreen full;
+  std::vector<png_bytep> rows;
+  std::vector<png_byte> band;
+
   if (!imageData)
   {
     rtLogError("FATAL: Invalid arguments - imageData = NULL");
@@ -947,6 +1194,12 @@ rtError pxLoadPNGImage(const char *imageData, size_t imageDataSize,
     return e;
   }
 
+  if (!isValidScale(params.scale))
+  {
+    rtLogError("png decode scale must be 1, 2, 4 or 8, not %d", params.scale);
+    return RT_ERROR_INVALID_ARG;
+  }
+
   unsigned char header[8]; // 8 is the maximum size that can be checked
 
   // open file and test for it being a png
@@ -1009,38 +1262,92 @@ rtError pxLoadPNGImage(const char *imageData, size_t imageDataSize,
       png_set_tRNS_to_alpha(png_ptr);
     }
 
+    // rows are 4 bytes a pixel whatever the depth
+    png_set_strip_16(png_ptr);
+
     //png_set_bgr(png_ptr);
     png_set_add_alpha(png_ptr, 0xff, PNG_FILLER_AFTER);
 
-    o.init(width, height);
-
-    //	    number_of_passes = png_set_interlace_handling(png_ptr);
+    int passes = png_set_interlace_handling(png_ptr);
     png_read_update_info(png_ptr, info_ptr);
 
+    int scale = params.scale;
+    pxRect region;
+    if (!decodeRegion(params, width, height, (width + scale - 1) / scale,
+                      (height + scale - 1) / scale, region))
+    {
+      rtLogError("png decode crop is outside the %dx%d image", width, height);
+      png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+      return RT_ERROR_INVALID_ARG;
+    }
+
+    o.init(region.width(), region.height());
+    o.mPixelFormat = RT_PIX_RGBA;
+
     // read file
     if (!setjmp(png_jmpbuf(png_ptr)))
     {
-      row_pointers = (png_bytep *)malloc(sizeof(png_bytep) * height);
-
-      if (row_pointers)
+      bool whole = scale == 1 && region.width() == width &&
+                   region.height() == height;
+      if (passes > 1 || whole)
       {
+        // Every pass of an interlaced image covers all of it, so it's
+        // decoded whole and then cropped
+        pxOffscreen &image = whole ? o : full;
+        if (!whole)
+          full.init(width, height);
+
+        rows.resize(height);
         for (int y = 0; y < height; y++)
         {
-          row_pointers[y] = (png_byte *)o.scanline(y);
+          rows[y] = (png_byte *)image.scanline(y);
         }
 
-        png_read_image(png_ptr, row_pointers);
-        free(row_pointers);
+        if (passes > 1 && preview)
+        {
+          // the first pass is 1/64th of the pixels, blown up into blocks
+          // to fill the image
+          png_read_rows(png_ptr, NULL, &rows[0], height);
+          if (!whole)
+            shrinkPNGImage(o, &rows[0], width, height, region, scale);
+          sendPreview(o, preview, context);
+
+          for (int pass = 1; pass < passes; pass++)
+            png_read_rows(png_ptr, NULL, &rows[0], height);
+        }
+        else
+          png_read_image(png_ptr, &rows[0]);
+
+        if (!whole)
+          shrinkPNGImage(o, &rows[0], width, height, region, scale);
+      }
+      else
+      {
+        // one box of rows at a time, the rows above the region are decoded
+        // and thrown away and the ones below it aren't decoded at all
+        png_size_t rowBytes = png_get_rowbytes(png_ptr, info_ptr);
+        band.resize(rowBytes * scale);
+        rows.resize(scale);
+        for (int i = 0; i < scale; i++)
+          rows[i] = &band[i * rowBytes];
+
+        int y = 0;
+        for (int oy = 0; oy < o.height(); oy++)
+        {
+          int top = (region.top() + oy) * scale;
+          int n = pxMin<int>(scale, height - top);
+          for (; y < top; y++)
+            png_read_row(png_ptr, rows[0], NULL);
+          for (int i = 0; i < n; i++, y++)
+            png_read_row(png_ptr, rows[i], NULL);
+          shrinkPNGRow((uint8_t *)o.scanline(oy), &rows[0], n,
+                       region.left() * scale, width, scale, o.width());
+        }
       }
       e = RT_OK;
     }
   }
 
-  if (e == RT_OK)
-  {
-    o.mPixelFormat = RT_PIX_RGBA;
-  }
-
   png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
 
   return e;
@@ -1055,14 +1362,16 @@ void pxTimedOffscreenSequence::init()
 
 void pxTimedOffscreenSequence::addBuffer(pxBuffer &b, double d)
 {
-  entry e;
+  // blit straight into the entry, copying a filled one into the vector
+  // would copy every frame twice
+  mSequence.push_back(entry());
+  entry& e = mSequence.back();
   e.mOffscreen.init(b.width(), b.height());
 
   b.blit(e.mOffscreen);
 
   e.mDuration = d;
 
-  mSequence.push_back(e);
   mTotalTime += d;
 }
 
@@ -1076,44 +1385,26 @@ void pxTimedOffscreenSequence::addBuffer(pxBuffer &b, double d)
 #ifdef PNG_APNG_SUPPORTED
 void BlendOver(unsigned char **rows_dst, unsigned char **rows_src, unsigned int x, unsigned int y, unsigned int w, unsigned int h)
 {
-  unsigned int i, j;
-  int u, v, al;
-
-  for (j = 0; j < h; j++)
-  {
-    unsigned char *sp = rows_src[j];
-    unsigned char *dp = rows_dst[j + y] + x * 4;
-
-    for (i = 0; i < w; i++, sp += 4, dp += 4)
-    {
-      if (sp[3] == 255)
-        memcpy(dp, sp, 4);
-      else if (sp[3] != 0)
-      {
-        if (dp[3] != 0)
-        {
-          u = sp[3] * 255;
-          v = (255 - sp[3]) * dp[3];
-          al = u + v;
-          dp[0] = (sp[0] * u + dp[0] * v) / al;
-          dp[1] = (sp[1] * u + dp[1] * v) / al;
-          dp[2] = (sp[2] * u + dp[2] * v) / al;
-          dp[3] = al / 255;
-        }
-        else
-          memcpy(dp, sp, 4);
-      }
-    }
-  }
+  const pxConvertKernels& k = pxConvert();
+  for (unsigned int j = 0; j < h; j++)
+    k.blendOver((uint32_t *)(rows_dst[j + y] + x * 4), (const uint32_t *)rows_src[j], w);
 }
 #endif
 
-rtError pxLoadAPNGImage(const char *imageData, size_t imageDataSize,
-                        pxTimedOffscreenSequence &s)
+pxAPNGDecoder::pxAPNGDecoder()
+  : mPng(NULL), mInfo(NULL), mReader(NULL), mWidth(0), mHeight(0),
+    mRowBytes(0), mFrames(0), mFirst(0), mPlays(0), mNextFrame(0)
 {
-  s.init();
+}
 
-  PngStruct pngStruct((char *)imageData, imageDataSize);
+pxAPNGDecoder::~pxAPNGDecoder()
+{
+  term();
+}
+
+rtError pxAPNGDecoder::init(const char *imageData, size_t imageDataSize)
+{
+  term();
 
   if (!imageData)
   {
@@ -1127,143 +1418,248 @@ rtError pxLoadAPNGImage(const char *imageData, size_t imageDataSize,
     return RT_FAIL;
   }
 
-  unsigned char header[8]; // 8 is the maximum size that can be checked
-
-  // test for it being a png
-  memcpy(header, imageData, 8);
-  pngStruct.readPosition += 8;
-
   // test PNG header
-  if (png_sig_cmp(header, 0, 8) != 0)
+  if (png_sig_cmp((png_const_bytep)imageData, 0, 8) != 0)
   {
     // TODO Improve Detection of different image types
     //    rtLogError("FATAL: Invalid PNG header");
     return RT_FAIL;
   }
 
-  unsigned int width, height, channels, rowbytes, size, i, j;
-  png_bytepp rows_image;
-  png_bytepp rows_frame;
-  unsigned char *p_image;
-  unsigned char *p_frame;
-  unsigned char *p_temp;
+  rtError e = mData.init((uint8_t *)imageData, imageDataSize);
+  if (e == RT_OK)
+    e = open();
+  if (e != RT_OK)
+    term();
+  return e;
+}
+
+void pxAPNGDecoder::term()
+{
+  close();
+  mData.term();
+  mImage.clear();
+  mFrame.clear();
+  mTemp.clear();
+  mImageRows.clear();
+  mFrameRows.clear();
+  mWidth = mHeight = mRowBytes = 0;
+  mFrames = mFirst = mPlays = mNextFrame = 0;
+  mDisposed.setEmpty();
+}
+
+// reads the header and clears the canvas, the next frame read is the first
+rtError pxAPNGDecoder::open()
+{
+  mReader = new PngStruct((char *)mData.data(), mData.length());
+  mReader->readPosition = 8;
 
-  png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-  png_infop info_ptr = png_create_info_struct(png_ptr);
-  if (png_ptr && info_ptr)
+  mPng = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+  if (mPng)
+    mInfo = png_create_info_struct(mPng);
+  if (!mPng || !mInfo)
   {
-    if (setjmp(png_jmpbuf(png_ptr)))
-    {
-      png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
-      return RT_FAIL;
-    }
+    rtLogError("FATAL: png_create_read_struct() - failed !");
+    close();
+    return RT_FAIL;
+  }
 
-    png_set_read_fn(png_ptr, (png_voidp)&pngStruct, readPngData);
-    png_set_sig_bytes(png_ptr, 8);
-    png_read_info(png_ptr, info_ptr);
-    png_set_expand(png_ptr);
-    png_set_strip_16(png_ptr);
-    png_set_palette_to_rgb(png_ptr);
-    png_set_gray_to_rgb(png_ptr);
-    png_set_add_alpha(png_ptr, 0xff, PNG_FILLER_AFTER);
-    (void)png_set_interlace_handling(png_ptr);
-    png_read_update_info(png_ptr, info_ptr);
-    width = png_get_image_width(png_ptr, info_ptr);
-    height = png_get_image_height(png_ptr, info_ptr);
-    channels = png_get_channels(png_ptr, info_ptr);
-    rowbytes = png_get_rowbytes(png_ptr, info_ptr);
-    size = height * rowbytes;
-    p_image = (unsigned char *)malloc(size);
-    p_frame = (unsigned char *)malloc(size);
-    p_temp = (unsigned char *)malloc(size);
-    rows_image = (png_bytepp)malloc(height * sizeof(png_bytep));
-    rows_frame = (png_bytepp)malloc(height * sizeof(png_bytep));
-    if (p_image && p_frame && p_temp && rows_image && rows_frame)
-    {
-      png_uint_32 frames = 1;
-      png_uint_32 x0 = 0;
-      png_uint_32 y0 = 0;
-      png_uint_32 w0 = width;
-      png_uint_32 h0 = height;
-      unsigned int first = 0;
-      png_uint_32 plays = 0;
-      unsigned short delay_num = 1;
-      unsigned short delay_den = 10;
-      unsigned char dop = 0;
-      unsigned char bop = 0;
-#ifdef PNG_APNG_SUPPORTED
-      first = (png_get_first_frame_is_hidden(png_ptr, info_ptr) != 0) ? 1 : 0;
-      if (png_get_valid(png_ptr, info_ptr, PNG_INFO_acTL))
-        png_get_acTL(png_ptr, info_ptr, &frames, &plays);
+  if (setjmp(png_jmpbuf(mPng)))
+  {
+    close();
+    return RT_FAIL;
+  }
 
-      s.setNumPlays(plays);
+  png_set_read_fn(mPng, (png_voidp)mReader, readPngData);
+  png_set_sig_bytes(mPng, 8);
+  png_read_info(mPng, mInfo);
+  png_set_expand(mPng);
+  png_set_strip_16(mPng);
+  png_set_palette_to_rgb(mPng);
+  png_set_gray_to_rgb(mPng);
+  png_set_add_alpha(mPng, 0xff, PNG_FILLER_AFTER);
+  (void)png_set_interlace_handling(mPng);
+  png_read_update_info(mPng, mInfo);
+
+  mWidth = png_get_image_width(mPng, mInfo);
+  mHeight = png_get_image_height(mPng, mInfo);
+  mRowBytes = png_get_rowbytes(mPng, mInfo);
+
+  png_uint_32 frames = 1;
+  png_uint_32 plays = 0;
+  mFirst = 0;
+#ifdef PNG_APNG_SUPPORTED
+  mFirst = (png_get_first_frame_is_hidden(mPng, mInfo) != 0) ? 1 : 0;
+  if (png_get_valid(mPng, mInfo, PNG_INFO_acTL))
+    png_get_acTL(mPng, mInfo, &frames, &plays);
 #endif
-      for (j = 0; j < height; j++)
-        rows_image[j] = p_image + j * rowbytes;
+  mFrames = frames;
+  mPlays = plays;
+
+  size_t size = mHeight * mRowBytes;
+  mImage.assign(size, 0);
+  mFrame.resize(size);
+  mTemp.resize(size);
+  mImageRows.resize(mHeight);
+  mFrameRows.resize(mHeight);
+  for (uint32_t j = 0; j < mHeight; j++)
+  {
+    mImageRows[j] = &mImage[j * mRowBytes];
+    mFrameRows[j] = &mFrame[j * mRowBytes];
+  }
 
-      for (j = 0; j < height; j++)
-        rows_frame[j] = p_frame + j * rowbytes;
+  mNextFrame = 0;
+  mDisposed.setEmpty();
+  return RT_OK;
+}
 
-      for (i = 0; i < frames; i++)
-      {
-#ifdef PNG_APNG_SUPPORTED
-        if (png_get_valid(png_ptr, info_ptr, PNG_INFO_acTL))
-        {
-          png_read_frame_head(png_ptr, info_ptr);
-          png_get_next_frame_fcTL(png_ptr, info_ptr, &w0, &h0, &x0, &y0, &delay_num, &delay_den, &dop, &bop);
+void pxAPNGDecoder::close()
+{
+  if (mPng)
+    png_destroy_read_struct(&mPng, mInfo ? &mInfo : NULL, NULL);
+  mPng = NULL;
+  mInfo = NULL;
+  delete mReader;
+  mReader = NULL;
+}
 
-          if (!delay_den)
-            delay_den = 100;
-        }
-        if (i == first)
-        {
-          bop = PNG_BLEND_OP_SOURCE;
-          if (dop == PNG_DISPOSE_OP_PREVIOUS)
-            dop = PNG_DISPOSE_OP_BACKGROUND;
-        }
-#endif
-        png_read_image(png_ptr, rows_frame);
+rtError pxAPNGDecoder::readFrame(FrameInfo &f)
+{
+  if (setjmp(png_jmpbuf(mPng)))
+    return RT_FAIL;
 
+  png_uint_32 x0 = 0;
+  png_uint_32 y0 = 0;
+  png_uint_32 w0 = mWidth;
+  png_uint_32 h0 = mHeight;
+  unsigned short delay_num = 1;
+  unsigned short delay_den = 10;
+  unsigned char dop = 0;
+  unsigned char bop = 0;
 #ifdef PNG_APNG_SUPPORTED
-        if (dop == PNG_DISPOSE_OP_PREVIOUS)
-          memcpy(p_temp, p_image, size);
+  if (png_get_valid(mPng, mInfo, PNG_INFO_acTL))
+  {
+    png_read_frame_head(mPng, mInfo);
+    png_get_next_frame_fcTL(mPng, mInfo, &w0, &h0, &x0, &y0, &delay_num, &delay_den, &dop, &bop);
 
-        if (bop == PNG_BLEND_OP_OVER)
-          BlendOver(rows_image, rows_frame, x0, y0, w0, h0);
-        else
+    if (!delay_den)
+      delay_den = 100;
+  }
 #endif
-          for (j = 0; j < h0; j++)
-            memcpy(rows_image[j + y0] + x0 * 4, rows_frame[j], w0 * 4);
+  png_read_image(mPng, &mFrameRows[0]);
+
+  f.x = x0;
+  f.y = y0;
+  f.w = w0;
+  f.h = h0;
+  f.duration = (double)delay_num / (double)delay_den;
+  f.disposeOp = dop;
+  f.blendOp = bop;
+  return RT_OK;
+}
 
-        // TODO Extra copy of frame going on here
-        if (i >= first)
-        {
-          pxOffscreen o;
-          o.init(width, height);
-          for (uint32_t i = 0; i < height; i++)
-          {
-            memcpy(o.scanline(i), rows_image[i], width * 4);
-          }
-          s.addBuffer(o, (double)delay_num / (double)delay_den);
-        }
+rtError pxAPNGDecoder::decodeFrame(pxOffscreen &o, pxRect &dirty, double &duration)
+{
+  if (!mData.length())
+    return RT_FAIL;
+
+  if (!mPng || mNextFrame >= mFrames)
+  {
+    close();
+    if (open() != RT_OK)
+      return RT_FAIL;
+  }
+
+  size_t size = mHeight * mRowBytes;
 
+  while (true)
+  {
+    FrameInfo f;
+    if (readFrame(f) != RT_OK)
+    {
+      rtLogError("failed to decode frame %u of animated png", mNextFrame);
+      close();
+      return RT_FAIL;
+    }
+
+    uint32_t i = mNextFrame++;
 #ifdef PNG_APNG_SUPPORTED
-        if (dop == PNG_DISPOSE_OP_PREVIOUS)
-          memcpy(p_image, p_temp, size);
-        else if (dop == PNG_DISPOSE_OP_BACKGROUND)
-          for (j = 0; j < h0; j++)
-            memset(rows_image[j + y0] + x0 * 4, 0, w0 * 4);
+    if (i == mFirst)
+    {
+      f.blendOp = PNG_BLEND_OP_SOURCE;
+      if (f.disposeOp == PNG_DISPOSE_OP_PREVIOUS)
+        f.disposeOp = PNG_DISPOSE_OP_BACKGROUND;
+    }
+
+    if (f.disposeOp == PNG_DISPOSE_OP_PREVIOUS)
+      memcpy(&mTemp[0], &mImage[0], size);
+
+    if (f.blendOp == PNG_BLEND_OP_OVER)
+      BlendOver(&mImageRows[0], &mFrameRows[0], f.x, f.y, f.w, f.h);
+    else
 #endif
+      for (uint32_t j = 0; j < f.h; j++)
+        memcpy(mImageRows[j + f.y] + f.x * 4, mFrameRows[j], f.w * 4);
+
+    if (i >= mFirst)
+    {
+      if (o.width() != (int32_t)mWidth || o.height() != (int32_t)mHeight || !o.base())
+        o.init(mWidth, mHeight);
+      for (uint32_t j = 0; j < mHeight; j++)
+        memcpy(o.scanline(j), mImageRows[j], mWidth * 4);
+
+      if (i == mFirst)
+        dirty.setLTWH(0, 0, mWidth, mHeight);
+      else
+      {
+        dirty.setLTWH(f.x, f.y, f.w, f.h);
+        dirty.unionRect(mDisposed);
       }
-      png_read_end(png_ptr, info_ptr);
-      free(rows_frame);
-      free(rows_image);
-      free(p_temp);
-      free(p_frame);
-      free(p_image);
+      duration = f.duration;
+    }
+
+    mDisposed.setEmpty();
+#ifdef PNG_APNG_SUPPORTED
+    if (f.disposeOp == PNG_DISPOSE_OP_PREVIOUS)
+    {
+      memcpy(&mImage[0], &mTemp[0], size);
+      mDisposed.setLTWH(f.x, f.y, f.w, f.h);
+    }
+    else if (f.disposeOp == PNG_DISPOSE_OP_BACKGROUND)
+    {
+      for (uint32_t j = 0; j < f.h; j++)
+        memset(mImageRows[j + f.y] + f.x * 4, 0, f.w * 4);
+      mDisposed.setLTWH(f.x, f.y, f.w, f.h);
     }
+#endif
+
+    if (i >= mFirst)
+      return RT_OK;
   }
-  png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+}
 
-  return RT_OK;
+rtError pxLoadAPNGImage(const char *imageData, size_t imageDataSize,
+                        pxTimedOffscreenSequence &s)
+{
+  s.init();
+
+  pxAPNGDecoder decoder;
+  rtError e = decoder.init(imageData, imageDataSize);
+  if (e != RT_OK)
+    return e;
+
+  s.setNumPlays(decoder.numPlays());
+
+  pxOffscreen o;
+  pxRect dirty;
+  double duration = 0;
+  for (uint32_t i = 0; i < decoder.numFrames(); i++)
+  {
+    e = decoder.decodeFrame(o, dirty, duration);
+    if (e != RT_OK)
+      break;
+    s.addBuffer(o, duration);
+  }
+
+  return e;
 }
@@ -20,6 +20,7 @@
 #ifndef PX_UTIL_H
 #define PX_UTIL_H
 #include "rtFile.h"
+#include "pxOffscreen.h"
 
 #include <vector>
 
@@ -74,8 +75,104 @@ private:
   uint32_t mNumPlays;
 };
 
+struct png_struct_def;
+struct png_info_def;
+struct PngStruct;
+
+// Decodes an animated png one frame at a time from its compressed data, so
+// playback only needs the composited canvas and whatever frames the player
+// keeps around, rather than a full size offscreen for every frame.
+// Not thread safe.
+class pxAPNGDecoder
+{
+public:
+  pxAPNGDecoder();
+  ~pxAPNGDecoder();
+
+  // Keeps a copy of imageData. Fails quietly if it isn't a png
+  rtError init(const char* imageData, size_t imageDataSize);
+  void term();
+
+  uint32_t width() const { return mWidth; }
+  uint32_t height() const { return mHeight; }
+
+  // Visible frames, a hidden default image isn't counted
+  uint32_t numFrames() const { return mFrames - mFirst; }
+  uint32_t numPlays() const { return mPlays; }
+
+  // Composites the next frame and copies the canvas into o, which is only
+  // reallocated if it isn't already the size of the image. dirty is the part
+  // of the canvas that differs from the previous frame. After the last frame
+  // decoding starts over from the first.
+  rtError decodeFrame(pxOffscreen& o, pxRect& dirty, double& duration);
+
+private:
+  struct FrameInfo
+  {
+    uint32_t x, y, w, h;
+    double duration;
+    unsigned char disposeOp;
+    unsigned char blendOp;
+  };
+
+  pxAPNGDecoder(const pxAPNGDecoder&);
+  pxAPNGDecoder& operator=(const pxAPNGDecoder&);
+
+  rtError open();
+  void close();
+  rtError readFrame(FrameInfo& f);
+
+  rtData mData;
+  png_struct_def* mPng;
+  png_info_def* mInfo;
+  PngStruct* mReader;
+
+  uint32_t mWidth;
+  uint32_t mHeight;
+  uint32_t mRowBytes;
+  uint32_t mFrames;
+  uint32_t mFirst;
+  uint32_t mPlays;
+  uint32_t mNextFrame;
+
+  std::vector<unsigned char> mImage;
+  std::vector<unsigned char> mFrame;
+  std::vector<unsigned char> mTemp;
+  std::vector<unsigned char*> mImageRows;
+  std::vector<unsigned char*> mFrameRows;
+
+  // region the previous frame's dispose op changed
+  pxRect mDisposed;
+};
+
+// Which part of an image to decode and how small.  The defaults decode the
+// whole image at full size.
+struct pxImageDecodeParams
+{
+  pxImageDecodeParams(): scale(1) {}
+
+  // Part of the image in image pixels, clipped to the image.  Empty is the
+  // whole image
+  pxRect crop;
+  // 1, 2, 4 or 8.  The decoded size is the crop divided by this, rounded up
+  int32_t scale;
+};
+
+// Called from inside a decode with a coarse version of the whole output as
+// soon as the image data has one: after the first scan of a progressive jpeg
+// or the first pass of an interlaced png.  Other images never call it.
+// preview is the size of the output, only valid during the call and not to
+// be changed.
+typedef void (*pxImagePreviewFunc)(void* context, pxOffscreen& preview);
+
 rtError pxLoadImage(const char* imageData, size_t imageDataSize, 
                     pxOffscreen& o);
+// Decodes only the region params asks for, skipping as much of the rest of
+// the image as the format allows.  o only keeps the compressed data if the
+// whole image is decoded at full size, since that's all it can reload.
+rtError pxLoadImage(const char* imageData, size_t imageDataSize,
+                    pxOffscreen& o, const pxImageDecodeParams& params,
+                    pxImagePreviewFunc preview = NULL, void* context = NULL);
 rtError pxLoadImage(const char* filename, pxOffscreen& b);
 rtError pxStoreImage(const char* filename, pxOffscreen& b);
 
@@ -88,6 +185,9 @@ rtError pxLoadAPNGImage(const char *imageData, size_t imageDataSize,
 
 rtError pxLoadPNGImage(const char* imageData, size_t imageDataSize, 
                        pxOffscreen& o);
+rtError pxLoadPNGImage(const char* imageData, size_t imageDataSize,
+                       pxOffscreen& o, const pxImageDecodeParams& params,
+                       pxImagePreviewFunc preview = NULL, void* context = NULL);
 rtError pxLoadPNGImage(const char* filename, pxOffscreen& o);
 rtError pxStorePNGImage(const char* filename, pxOffscreen& b,
                         bool grayscale = false, bool alpha=true);
@@ -103,6 +203,9 @@ rtError pxLoadJPGImageTurbo(const char* buf, size_t buflen, pxOffscreen& o);
 #endif //ENABLE_LIBJPEG_TURBO
 rtError pxLoadJPGImage(const char* imageData, size_t imageDataSize, 
                        pxOffscreen& o);
+rtError pxLoadJPGImage(const char* imageData, size_t imageDataSize,
+                       pxOffscreen& o, const pxImageDecodeParams& params,
+                       pxImagePreviewFunc preview = NULL, void* context = NULL);
 rtError pxLoadJPGImage(const char* filename, pxOffscreen& o);
 
 #endif
\ No newline at end of file
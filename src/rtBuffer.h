@@ -0,0 +1,123 @@
+/*
+
+ pxCore Copyright 2005-2017 John Robinson
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*/
+
+// rtBuffer.h
+//
+// A refcounted block of bytes.  rtValues carry them and the script bindings
+// hand them to JavaScript as ArrayBuffers over the same memory, and take
+// ArrayBuffers and typed arrays back as rtBuffers, without copying.
+
+#ifndef RT_BUFFER_H
+#define RT_BUFFER_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "rtAtomic.h"
+#include "rtRef.h"
+
+// Called with the memory of a buffer made by rtBuffer::wrap once the last
+// ref to it, and to any slice of it, is gone
+typedef void (*rtBufferFreeFunc)(void* context, uint8_t* data);
+
+class rtBuffer
+{
+public:
+  // length new bytes, zeroed
+  static rtBuffer* create(uint32_t length)
+  {
+    uint8_t* data = (uint8_t*)calloc(length?length:1, 1);
+    return data?new rtBuffer(data, length, NULL, NULL, NULL):NULL;
+  }
+
+  // a copy of length bytes at data
+  static rtBuffer* create(const void* data, uint32_t length)
+  {
+    rtBuffer* b = create(length);
+    if (b && length)
+      memcpy(b->mData, data, length);
+    return b;
+  }
+
+  // memory that's already there.  freeFunc is called with it when the
+  // buffer goes; without one it's handed to free().
+  static rtBuffer* wrap(uint8_t* data, uint32_t length, rtBufferFreeFunc freeFunc = NULL,
+                        void* context = NULL)
+  {
+    return new rtBuffer(data, length, freeFunc, context, NULL);
+  }
+
+  // length bytes from offset, sharing this buffer's memory and keeping it
+  // alive
+  rtBuffer* slice(uint32_t offset, uint32_t length)
+  {
+    if (offset > mLength || length > mLength - offset)
+      return NULL;
+    AddRef();
+    return new rtBuffer(mData + offset, length, NULL, NULL, this);
+  }
+
+  uint8_t* data() const { return mData; }
+  uint32_t length() const { return mLength; }
+
+  unsigned long AddRef()
+  {
+    return rtAtomicInc(&mRefCount);
+  }
+
+  unsigned long Release()
+  {
+    long l = rtAtomicDec(&mRefCount);
+    if (l == 0)
+      delete this;
+    return l;
+  }
+
+private:
+  rtBuffer(uint8_t* data, uint32_t length, rtBufferFreeFunc freeFunc, void* context,
+           rtBuffer* parent)
+    : mData(data), mLength(length), mFreeFunc(freeFunc), mContext(context),
+      mParent(parent), mRefCount(0)
+  {
+  }
+
+  ~rtBuffer()
+  {
+    if (mParent)
+      mParent->Release();
+    else if (mFreeFunc)
+      mFreeFunc(mContext, mData);
+    else
+      free(mData);
+  }
+
+  rtBuffer(const rtBuffer&);
+  rtBuffer& operator=(const rtBuffer&);
+
+  uint8_t*         mData;
+  uint32_t         mLength;
+  rtBufferFreeFunc mFreeFunc;
+  void*            mContext;
+  rtBuffer*        mParent;
+  rtAtomic         mRefCount;
+};
+
+typedef rtRef<rtBuffer> rtBufferRef;
+
+#endif // RT_BUFFER_H
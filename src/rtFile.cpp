@@ -66,7 +66,7 @@ rtError rtData::init(uint8_t* data, uint32_t length) {
   return e;
 }
 
-rtError rtData::term() { delete [] mData; mLength = 0; return RT_OK; }
+rtError rtData::term() { delete [] mData; mData = NULL; mLength = 0; return RT_OK; }
 uint8_t* rtData::data() { return mData; }
 uint32_t rtData::length() { return mLength; }
 
@@ -20,10 +20,13 @@
 
 #include <unistd.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
 #include <errno.h>
 
 #include <string>
 #include <fstream>
+#include <algorithm>
 
 #include <iostream>
 #include <sstream>
@@ -41,12 +44,14 @@
 #include "env-inl.h"
 
 #include "jsbindings/rtWrapperUtils.h"
+#include "jsbindings/jsCallback.h"
 
 #ifndef WIN32
 #pragma GCC diagnostic pop
 #endif
 
 #include "rtNode.h"
+#include "pxTimer.h"
 #ifndef RUNINMAIN
 extern uv_loop_t *nodeLoop;
 #endif
@@ -138,6 +143,8 @@ static inline bool file_exists(const char *file)
 }
 #endif
 
+static void exportCodeCache(Isolate* isolate, Handle<Object> global);
+
 rtNodeContext::rtNodeContext(Isolate *isolate,Platform* platform) :
      mIsolate(isolate), mEnv(NULL), mRefCount(0),mPlatform(platform)
 {
@@ -237,6 +244,7 @@ void rtNodeContext::createEnvironment()
 #endif
     rtObjectWrapper::exportPrototype(mIsolate, global);
     rtFunctionWrapper::exportPrototype(mIsolate, global);
+    exportCodeCache(mIsolate, global);
 
     {
       SealHandleScope seal(mIsolate);
@@ -267,6 +275,7 @@ void rtNodeContext::createEnvironment()
   // Register wrappers.
   rtObjectWrapper::exportPrototype(mIsolate, global);
   rtFunctionWrapper::exportPrototype(mIsolate, global);
+  exportCodeCache(mIsolate, global);
 
   mRtWrappers.Reset(mIsolate, global);
 
@@ -559,6 +568,261 @@ bool rtNodeContext::find(const char *name)
   return false;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Code cache
+//
+// A cache file is a header followed by what V8 produced.  The V8 version
+// string and CachedDataVersionTag() pick out caches from another build (V8
+// would reject those too, but only after reading them), the length and hash
+// of the source the ones for an edited file.
+
+#define CODE_CACHE_MAGIC    0x63637472  // "rtcc"
+
+struct codeCacheHeader
+{
+  uint32_t magic;
+  uint32_t versionTag;
+  char     version[32];
+  uint32_t sourceLength;
+  uint32_t sourceHash;
+  uint32_t dataLength;
+};
+
+static rtNodeCodeCacheStats sCodeCacheStats;
+
+bool rtNodeCodeCacheEnabled()
+{
+  static int enabled = -1;
+  if (enabled < 0)
+  {
+    const char* s = ::getenv("RT_CODE_CACHE");
+    enabled = (s && strcmp(s, "0") == 0)?0:1;
+  }
+  return enabled == 1;
+}
+
+void rtNodeCodeCacheGetStats(rtNodeCodeCacheStats& stats)
+{
+  stats = sCodeCacheStats;
+}
+
+static uint32_t codeCacheHash(const char* s, size_t length)
+{
+  // FNV-1a
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < length; i++)
+  {
+    h ^= (uint8_t)s[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+static void codeCacheSetHeader(codeCacheHeader& header, const char* source, size_t length)
+{
+  memset(&header, 0, sizeof(header));
+  header.magic = CODE_CACHE_MAGIC;
+  header.versionTag = ScriptCompiler::CachedDataVersionTag();
+  strncpy(header.version, V8::GetVersion(), sizeof(header.version) - 1);
+  header.sourceLength = (uint32_t)length;
+  header.sourceHash = codeCacheHash(source, length);
+}
+
+// Scripts are often installed somewhere read only, or shared, so caches go
+// in a directory of the user's own unless $RT_CODE_CACHE_DIR says otherwise.
+// Empty when there's nowhere to put them.
+static std::string codeCacheDir()
+{
+  const char* dir = ::getenv("RT_CODE_CACHE_DIR");
+  if (dir && *dir)
+    return dir;
+
+  const char* base = ::getenv("XDG_CACHE_HOME");
+  if (base && *base)
+    return std::string(base) + "/pxscene/codecache";
+
+  const char* home = ::getenv("HOME");
+  if (home && *home)
+    return std::string(home) + "/.cache/pxscene/codecache";
+  return "";
+}
+
+static std::string codeCachePath(const char* file)
+{
+  std::string dir = codeCacheDir();
+  if (dir.empty())
+    return "";
+
+  // flatten the path so files with the same name don't share a cache
+  std::string name(file);
+  for (size_t i = 0; i < name.size(); i++)
+  {
+    if (name[i] == '/' || name[i] == '\\')
+      name[i] = '_';
+  }
+  return dir + "/" + name + ".cache";
+}
+
+// mkdir -p
+static bool codeCacheMakeDir(const std::string& dir)
+{
+  for (size_t i = 1; i <= dir.size(); i++)
+  {
+    if (i < dir.size() && dir[i] != '/')
+      continue;
+    std::string part = dir.substr(0, i);
+    if (mkdir(part.c_str(), 0700) != 0 && errno != EEXIST)
+      return false;
+  }
+  return true;
+}
+
+// The cache for file if it's there and was made from this source by this V8,
+// NULL otherwise.  The caller owns the result.
+static ScriptCompiler::CachedData* codeCacheLoad(const char* file, const char* source, size_t length)
+{
+  std::string path = codeCachePath(file);
+  if (path.empty())
+    return NULL;
+  FILE* f = fopen(path.c_str(), "rb");
+  if (!f)
+    return NULL;
+
+  codeCacheHeader expected, header;
+  codeCacheSetHeader(expected, source, length);
+
+  uint8_t* data = NULL;
+  if (fread(&header, sizeof(header), 1, f) == 1 &&
+      memcmp(&header, &expected, offsetof(codeCacheHeader, dataLength)) == 0 &&
+      header.dataLength > 0)
+  {
+    data = new uint8_t[header.dataLength];
+    if (fread(data, 1, header.dataLength, f) != header.dataLength)
+    {
+      delete [] data;
+      data = NULL;
+    }
+  }
+  else
+    rtLogInfo("code cache %s is stale, compiling %s from source", path.c_str(), file);
+  fclose(f);
+
+  if (!data)
+    return NULL;
+  return new ScriptCompiler::CachedData(data, header.dataLength,
+                                        ScriptCompiler::CachedData::BufferOwned);
+}
+
+static void codeCacheSave(const char* file, const char* source, size_t length,
+                          const ScriptCompiler::CachedData* cache)
+{
+  if (!cache || cache->length <= 0)
+    return;
+
+  std::string path = codeCachePath(file);
+  if (path.empty() || !codeCacheMakeDir(codeCacheDir()))
+    return;
+
+  // write to the side and rename so a reader never sees half a file.  The
+  // name is unique so processes saving the same cache don't write into
+  // each other's.
+  std::string tmp = path + ".XXXXXX";
+  int fd = mkstemp(&tmp[0]);
+  FILE* f = fd != -1 ? fdopen(fd, "wb") : NULL;
+  if (!f)
+  {
+    rtLogDebug("could not write code cache %s: %s", tmp.c_str(), strerror(errno));
+    if (fd != -1)
+    {
+      close(fd);
+      unlink(tmp.c_str());
+    }
+    return;
+  }
+
+  codeCacheHeader header;
+  codeCacheSetHeader(header, source, length);
+  header.dataLength = cache->length;
+
+  bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+            fwrite(cache->data, 1, cache->length, f) == (size_t)cache->length;
+  ok = (fclose(f) == 0) && ok;
+  if (ok && rename(tmp.c_str(), path.c_str()) == 0)
+    sCodeCacheStats.written++;
+  else
+    unlink(tmp.c_str());
+}
+
+// Compiles source from file in the current context, from its code cache when
+// there's a good one.  Without one the script is compiled from source and a
+// cache is written for the next time.
+static MaybeLocal<Script> compileCached(Local<Context> context, Local<String> source,
+                                        const char* utf8, size_t length, const char* file)
+{
+  Isolate* isolate = context->GetIsolate();
+  ScriptOrigin origin(String::NewFromUtf8(isolate, file));
+
+  ScriptCompiler::CachedData* cache = codeCacheLoad(file, utf8, length);
+  if (cache)
+  {
+    ScriptCompiler::Source cachedSource(source, origin, cache); // owns cache
+    MaybeLocal<Script> script = ScriptCompiler::Compile(context, &cachedSource,
+                                                        ScriptCompiler::kConsumeCodeCache);
+    if (!cachedSource.GetCachedData()->rejected)
+    {
+      sCodeCacheStats.hits++;
+      return script;
+    }
+    // compiled anyway, but from source.  Make a cache V8 will take.
+    rtLogWarn("code cache for %s was rejected", file);
+    sCodeCacheStats.rejected++;
+  }
+  sCodeCacheStats.misses++;
+
+  ScriptCompiler::Source plainSource(source, origin);
+  MaybeLocal<Script> script = ScriptCompiler::Compile(context, &plainSource,
+                                                      ScriptCompiler::kProduceCodeCache);
+  if (!script.IsEmpty())
+    codeCacheSave(file, utf8, length, plainSource.GetCachedData());
+  return script;
+}
+
+// _rtRunCached(code, filename) - vm.runInThisContext through the code cache,
+// see sandbox.js
+static void runCached(const FunctionCallbackInfo<Value>& args)
+{
+  Isolate* isolate = args.GetIsolate();
+  if (args.Length() < 2 || !args[0]->IsString() || !args[1]->IsString())
+  {
+    isolate->ThrowException(Exception::TypeError(
+      String::NewFromUtf8(isolate, "_rtRunCached(code, filename) expects two strings")));
+    return;
+  }
+
+  Local<Context> context = isolate->GetCurrentContext();
+  Local<String> source = args[0].As<String>();
+  String::Utf8Value utf8(source);
+  String::Utf8Value file(args[1]);
+
+  MaybeLocal<Script> script = compileCached(context, source, *utf8, utf8.length(), *file);
+  if (script.IsEmpty())
+    return; // the SyntaxError is thrown to the caller
+
+  Local<Value> result;
+  if (script.ToLocalChecked()->Run(context).ToLocal(&result))
+    args.GetReturnValue().Set(result);
+}
+
+static void exportCodeCache(Isolate* isolate, Handle<Object> global)
+{
+  if (rtNodeCodeCacheEnabled())
+    global->Set(String::NewFromUtf8(isolate, "_rtRunCached"),
+                FunctionTemplate::New(isolate, runCached)->GetFunction());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 rtObjectRef rtNodeContext::runScript(const char *script, const char *args /*= NULL*/)
 {
   if(script == NULL)
@@ -574,6 +838,11 @@ rtObjectRef rtNodeContext::runScript(const char *script, const char *args /*= NU
 }
 
 rtObjectRef rtNodeContext::runScript(const std::string &script, const char* /* args = NULL*/)
+{
+  return runScript(script, NULL, false);
+}
+
+rtObjectRef rtNodeContext::runScript(const std::string &script, const char *file, bool cached)
 {
   rtLogInfo(__FUNCTION__);
   if(script.empty())
@@ -602,10 +871,16 @@ rtObjectRef rtNodeContext::runScript(const std::string &script, const char* /* a
     Local<String> source = String::NewFromUtf8(mIsolate, script.c_str());
 
     // Compile the source code.
-    Local<Script> run_script = Script::Compile(source);
+    Local<Script> run_script;
+    if (cached && file)
+      compileCached(local_context, source, script.c_str(), script.size(), file).ToLocal(&run_script);
+    else
+      run_script = Script::Compile(source);
 
     // Run the script to get the result.
-    Local<Value> result = run_script->Run();
+    Local<Value> result;
+    if (!run_script.IsEmpty())
+      result = run_script->Run();
 // !CLF TODO: TEST FOR MT
 #ifdef RUNINMAIN
    if (tryCatch.HasCaught())
@@ -651,12 +926,150 @@ rtObjectRef rtNodeContext::runFile(const char *file, const char* /*args = NULL*/
   // Read the script file
   js_file   = file;
   js_script = readFile(file);
+  mFilesRun.push_back(file);
+
+  return runScript(js_script, file, rtNodeCodeCacheEnabled());
+}
+
+bool rtNodeContext::hasRunFile(const char *file) const
+{
+  for (size_t i = 0; i < mFilesRun.size(); i++)
+  {
+    if (mFilesRun[i] == file)
+      return true;
+  }
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// GC scheduling
+
+// left for drawing and input when V8 is given idle time
+#define GC_IDLE_MARGIN_SECONDS        0.002
+// moderate memory pressure starts a marking at most this often
+#define GC_PRESSURE_INTERVAL_SECONDS  2.0
+// growth since the last full collection that counts as heap pressure
+#define GC_HEAP_GROWTH_MIN_BYTES      (8*1024*1024)
+
+static rtNodeGcStats sGcStats;
+static double sGcStart = 0;
+static uint32_t sMarkSweeps = 0;
+static uint32_t sMarkSweepsAtPressure = 0;
+static size_t sHeapAfterMarkSweep = 0;
+
+void rtNodeGcStatsCollect(rtNodeGcStats& stats)
+{
+  stats = sGcStats;
+  memset(&sGcStats, 0, sizeof(sGcStats));
+}
+
+static void gcPrologue(Isolate*, GCType, GCCallbackFlags)
+{
+  sGcStart = pxMilliseconds();
+}
+
+static void gcEpilogue(Isolate* isolate, GCType type, GCCallbackFlags)
+{
+  double ms = pxMilliseconds() - sGcStart;
+  int bucket = 0;
+  while (bucket < RT_NODE_GC_PAUSE_BUCKETS - 1 && ms >= (double)(1 << bucket))
+    bucket++;
+  sGcStats.pauses[bucket]++;
+  sGcStats.collections++;
+  sGcStats.pauseMs += ms;
+  if (ms > sGcStats.maxPauseMs)
+    sGcStats.maxPauseMs = ms;
+
+  if (type == kGCTypeMarkSweepCompact)
+  {
+    HeapStatistics heap;
+    isolate->GetHeapStatistics(&heap);
+    sHeapAfterMarkSweep = heap.used_heap_size();
+    sMarkSweeps++;
+  }
+}
+
+void rtNode::memoryPressure(bool critical)
+{
+  if (!critical)
+  {
+    mMemoryPressure = true;
+    return;
+  }
+
+  Locker                locker(mIsolate);
+  Isolate::Scope isolate_scope(mIsolate);
+  HandleScope     handle_scope(mIsolate);
+  mIsolate->MemoryPressureNotification(MemoryPressureLevel::kCritical);
+  mIsolate->MemoryPressureNotification(MemoryPressureLevel::kNone);
+  mMemoryPressure = false;
+  mMemoryPressureReported = false;
+}
+
+void rtNode::idleGarbageCollect()
+{
+  double deadline = mFrameDeadline;
+  mFrameDeadline = 0;
+
+  double now = pxSeconds();
+  if (!mPlatform || deadline - now < GC_IDLE_MARGIN_SECONDS*2)
+    return;
+
+  Locker                locker(mIsolate);
+  Isolate::Scope isolate_scope(mIsolate);
+  HandleScope     handle_scope(mIsolate);
+
+  if (mMemoryPressureReported && sMarkSweeps != sMarkSweepsAtPressure)
+  {
+    // the marking it started is done
+    mIsolate->MemoryPressureNotification(MemoryPressureLevel::kNone);
+    mMemoryPressureReported = false;
+  }
+
+  if (!mMemoryPressure && sHeapAfterMarkSweep > 0)
+  {
+    HeapStatistics heap;
+    mIsolate->GetHeapStatistics(&heap);
+    size_t growth = std::max<size_t>(sHeapAfterMarkSweep/2, GC_HEAP_GROWTH_MIN_BYTES);
+    mMemoryPressure = heap.used_heap_size() > sHeapAfterMarkSweep + growth;
+  }
 
-  return runScript(js_script);
+  if (mMemoryPressure && !mMemoryPressureReported &&
+      now - mLastMemoryPressure >= GC_PRESSURE_INTERVAL_SECONDS)
+  {
+    // starts incremental marking, the idle notifications move it along
+    mIsolate->MemoryPressureNotification(MemoryPressureLevel::kModerate);
+    mMemoryPressureReported = true;
+    mLastMemoryPressure = now;
+    sMarkSweepsAtPressure = sMarkSweeps;
+  }
+  mMemoryPressure = false;
+
+  double idle = deadline - GC_IDLE_MARGIN_SECONDS - pxSeconds();
+  if (idle <= 0)
+    return;
+  mIsolate->IdleNotificationDeadline(mPlatform->MonotonicallyIncreasingTime() + idle);
+  sGcStats.idleNotifications++;
+  sGcStats.idleMs += idle*1000;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+static int defaultContextPoolSize()
+{
+#ifdef USE_CONTEXTIFY_CLONES
+  const char* s = ::getenv("RT_CONTEXT_POOL_SIZE");
+  if (s && *s)
+    return atoi(s) > 0?atoi(s):0;
+  return 1;
+#else
+  return 0;
+#endif
+}
+
 rtNode::rtNode() 
 #ifndef RUNINMAIN
 #ifdef USE_CONTEXTIFY_CLONES
@@ -667,6 +1080,14 @@ rtNode::rtNode()
 #endif
 {
   rtLogInfo(__FUNCTION__);
+  mContextPoolSize = defaultContextPoolSize();
+  memset(&mContextPoolStats, 0, sizeof(mContextPoolStats));
+  mFrameDeadline = 0;
+  mLastWarmMs = 0;
+  mWarmSkippedFrames = 0;
+  mMemoryPressure = false;
+  mMemoryPressureReported = false;
+  mLastMemoryPressure = 0;
   initializeNode();
 }
 
@@ -680,6 +1101,14 @@ rtNode::rtNode(bool initialize)
 #endif
 {
   rtLogInfo(__FUNCTION__);
+  mContextPoolSize = defaultContextPoolSize();
+  memset(&mContextPoolStats, 0, sizeof(mContextPoolStats));
+  mFrameDeadline = 0;
+  mLastWarmMs = 0;
+  mWarmSkippedFrames = 0;
+  mMemoryPressure = false;
+  mMemoryPressureReported = false;
+  mLastMemoryPressure = 0;
   if (true == initialize)
   {
     initializeNode();
@@ -772,6 +1201,8 @@ void rtNode::pump()
   Isolate::Scope isolate_scope(mIsolate);
   HandleScope     handle_scope(mIsolate);    // Create a stack-allocated handle scope.
   v8::platform::PumpMessageLoop(mPlatform, mIsolate);
+  // callbacks from native code since the last pump, all in one go
+  jsCallback::runQueued();
   uv_run(uv_default_loop(), UV_RUN_NOWAIT);//UV_RUN_ONCE);
 
   // Enable this to expedite garbage collection for testing... warning perf hit
@@ -899,6 +1330,9 @@ void rtNode::init(int argc, char** argv)
     Isolate::Scope isolate_scope(mIsolate);
     HandleScope     handle_scope(mIsolate);    // Create a stack-allocated handle scope.
 
+    mIsolate->AddGCPrologueCallback(gcPrologue);
+    mIsolate->AddGCEpilogueCallback(gcEpilogue);
+
     Local<Context> ctx = Context::New(mIsolate);
     ctx->SetEmbedderData(HandleMap::kContextIdIndex, Integer::New(mIsolate, 99));
     mContext.Reset(mIsolate, ctx);
@@ -910,6 +1344,7 @@ void rtNode::term()
 {
   rtLogInfo(__FUNCTION__);
   nodeTerminated = true;
+  mContextPool.clear();
 #ifdef USE_CONTEXTIFY_CLONES
   if( mRefContext.getPtr() )
   {
@@ -966,11 +1401,35 @@ rtNodeContextRef rtNode::createContext(bool ownThread)
 {
   UNUSED_PARAM(ownThread);    // not implemented yet.
 
+  if (!mContextPool.empty())
+  {
+    // oldest first
+    rtNodeContextRef ctxref = mContextPool.front().ctx;
+    mContextPoolStats.hits++;
+    mContextPoolStats.savedMs += mContextPool.front().warmMs;
+    mContextPool.erase(mContextPool.begin());
+
+    rtLogInfo("createContext() from the pool, %.2f ms saved so far, %u of %u from the pool",
+              mContextPoolStats.savedMs, mContextPoolStats.hits,
+              mContextPoolStats.hits + mContextPoolStats.misses);
+    return ctxref;
+  }
+
+  if (mContextPoolSize > 0)
+    mContextPoolStats.misses++;
+
+  return newContext();
+}
+
+rtNodeContextRef rtNode::newContext()
+{
   rtNodeContextRef ctxref;
 
 #ifdef USE_CONTEXTIFY_CLONES
   if(mRefContext.getPtr() == NULL)
   {
+    double start = pxMilliseconds();
+
     mRefContext = new rtNodeContext(mIsolate,mPlatform);
     ctxref = mRefContext;
     
@@ -992,6 +1451,12 @@ rtNodeContextRef rtNode::createContext(bool ownThread)
     {
       rtLogError("## ERROR:   Could not find \"%s\" ...", sandbox_path.c_str());
     }
+
+    rtNodeCodeCacheStats stats;
+    rtNodeCodeCacheGetStats(stats);
+    rtLogInfo("reference context created in %.2f ms, code cache %s: %u hits, %u misses, %u rejected",
+              pxMilliseconds() - start, rtNodeCodeCacheEnabled()?"on":"off",
+              stats.hits, stats.misses, stats.rejected);
     // !CLF: TODO Why is ctxref being reassigned from the mRefContext already assigned?
     //ctxref = new rtNodeContext(mIsolate, mRefContext);
   }
@@ -1011,6 +1476,57 @@ rtNodeContextRef rtNode::createContext(bool ownThread)
   return ctxref;
 }
 
+void rtNode::setContextPool(int size, const char *prepareFile)
+{
+  mContextPoolSize = size > 0?size:0;
+  mContextPoolFile = prepareFile?prepareFile:"";
+
+  // contexts prepared some other way, or too many of them, go
+  mContextPool.clear();
+}
+
+// frames a warm-up that doesn't fit waits before it goes ahead anyway
+#define CONTEXT_POOL_MAX_SKIPPED_FRAMES  60
+
+bool rtNode::warmContextPool()
+{
+  if ((int)mContextPool.size() >= mContextPoolSize)
+    return false;
+
+  // one that runs past the deadline holds up the next frame.  A context
+  // usually takes longer than a frame to make, and the first one's cost
+  // isn't known, so rather than never refilling the pool it costs one frame
+  // every so often.
+  if (mFrameDeadline > 0)
+  {
+    bool fits = mLastWarmMs > 0 &&
+        pxSeconds() + mLastWarmMs/1000 + GC_IDLE_MARGIN_SECONDS <= mFrameDeadline;
+    if (!fits && ++mWarmSkippedFrames < CONTEXT_POOL_MAX_SKIPPED_FRAMES)
+      return false;
+  }
+  mWarmSkippedFrames = 0;
+
+  double start = pxMilliseconds();
+#ifdef USE_CONTEXTIFY_CLONES
+  // the reference context only seeds the clones, it's not handed out
+  if (mRefContext.getPtr() == NULL)
+    newContext();
+#endif
+
+  pooledContext pooled;
+  pooled.ctx = newContext();
+  if (!mContextPoolFile.empty())
+    pooled.ctx->runFile(mContextPoolFile.c_str());
+  pooled.warmMs = pxMilliseconds() - start;
+  mLastWarmMs = pooled.warmMs;
+
+  mContextPoolStats.warmMs += pooled.warmMs;
+  mContextPool.push_back(pooled);
+
+  rtLogDebug("context pool warmed to %d in %.2f ms", (int)mContextPool.size(), pooled.warmMs);
+  return true;
+}
+
 unsigned long rtNodeContext::Release()
 {
     long l = rtAtomicDec(&mRefCount);
@@ -29,6 +29,7 @@
 // TODO eliminate std::string
 #include <string>
 #include <map>
+#include <vector>
 
 #if !defined(WIN32) && !defined(ENABLE_DFB)
 #pragma GCC diagnostic push
@@ -75,6 +76,24 @@ typedef struct args_
 }
 args_t;
 
+// Scripts run from files (sandbox.js, init.js) and the modules required from
+// under NODE_PATH are compiled with a V8 code cache.  The caches go in
+// $RT_CODE_CACHE_DIR when that is set, in pxscene/codecache under
+// $XDG_CACHE_HOME or ~/.cache otherwise, and a file's is written the first
+// time it is compiled.  A cache from another
+// V8 version, or for different source, is ignored and replaced.
+// RT_CODE_CACHE=0 compiles everything from source.
+struct rtNodeCodeCacheStats
+{
+  uint32_t hits;      // compiled from a cache
+  uint32_t misses;    // no cache, or not a usable one
+  uint32_t rejected;  // a cache V8 itself turned down
+  uint32_t written;
+};
+
+bool rtNodeCodeCacheEnabled();
+void rtNodeCodeCacheGetStats(rtNodeCodeCacheStats& stats);
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 class rtNodeContext  // V8
@@ -100,6 +119,10 @@ public:
   rtObjectRef runScript(const std::string &script,  const char *args = NULL); // BLOCKS
   rtObjectRef runFile  (const char *file,           const char *args = NULL); // BLOCKS
 
+  // True when file was run in this context already, e.g. while it sat in
+  // rtNode's context pool
+  bool hasRunFile(const char *file) const;
+
   unsigned long AddRef()
   {
     return rtAtomicInc(&mRefCount);
@@ -125,10 +148,14 @@ private:
 
   void createEnvironment();
 
+  rtObjectRef runScript(const std::string &script, const char *file, bool cached); // BLOCKS
+
 #ifdef USE_CONTEXTIFY_CLONES
   void clonedEnvironment(rtNodeContextRef clone_me);
 #endif
 
+  std::vector<std::string>       mFilesRun;
+
   int mRefCount;
   rtAtomic mId;
   v8::Platform                  *mPlatform;
@@ -136,6 +163,33 @@ private:
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// Garbage collection pauses since the last rtNodeGcStatsCollect().
+// pauses[i] counts the ones under 2^i ms, the last bucket the rest.
+#define RT_NODE_GC_PAUSE_BUCKETS 8
+
+struct rtNodeGcStats
+{
+  uint32_t collections;
+  uint32_t pauses[RT_NODE_GC_PAUSE_BUCKETS];
+  double   pauseMs;
+  double   maxPauseMs;
+  uint32_t idleNotifications;
+  double   idleMs;            // time given to V8 in idle notifications
+};
+
+// Copies the stats gathered since the last call and starts again
+void rtNodeGcStatsCollect(rtNodeGcStats& stats);
+
+// How the context pool is doing.  savedMs is what creating and preparing
+// the contexts handed out from the pool took, off the caller's path.
+struct rtNodeContextPoolStats
+{
+  uint32_t hits;
+  uint32_t misses;
+  double   warmMs;
+  double   savedMs;
+};
+
 typedef std::map<uint32_t, rtNodeContextRef> rtNodeContexts;
 typedef std::map<uint32_t, rtNodeContextRef>::const_iterator rtNodeContexts_iterator;
 
@@ -151,6 +205,20 @@ public:
 
   rtNodeContextRef getGlobalContext() const;
   rtNodeContextRef createContext(bool ownThread = false);
+
+  // Contexts are created ahead of time, up to size of them, by
+  // warmContextPool() and handed out by createContext().  Each has run
+  // prepareFile, if one is given.  The size starts at $RT_CONTEXT_POOL_SIZE,
+  // or 1; 0 turns the pool off.
+  void setContextPool(int size, const char *prepareFile = NULL);
+  int  contextPoolSize() const { return mContextPoolSize; }
+  // Adds one context to the pool if it's short.  Call it when there is time
+  // to spare on the script thread, after a frame say.  With a frame deadline
+  // set it waits for a frame where the last one made would fit before it,
+  // or for enough frames to go by that it goes ahead anyway.  Returns true
+  // if it made one.
+  bool warmContextPool();
+  void contextPoolStats(rtNodeContextPoolStats& stats) const { stats = mContextPoolStats; }
 #ifndef RUNINMAIN
   bool isInitialized();
   bool needsToEnd() { /*rtLogDebug("needsToEnd returning %d\n",mNeedsToEnd);*/ return mNeedsToEnd;};
@@ -160,6 +228,16 @@ public:
   v8::Isolate   *getIsolate() { return mIsolate; };
   v8::Platform   *getPlatform() { return mPlatform; };
   void garbageCollect();
+
+  // GC scheduling.  setFrameDeadline says when, in pxSeconds(), the next
+  // frame needs the script thread and idleGarbageCollect gives V8 the time
+  // until then for incremental marking and scavenges.  A moderate
+  // memoryPressure starts incremental marking for idle time to finish, as
+  // does the heap growing a lot since the last full collection.  A critical
+  // one collects everything now.
+  void setFrameDeadline(double deadline) { mFrameDeadline = deadline; }
+  void idleGarbageCollect();
+  void memoryPressure(bool critical);
 private:
 #ifdef ENABLE_DEBUG_MODE
   void init();
@@ -179,6 +257,25 @@ private:
   rtNodeContextRef mRefContext;
 #endif
 
+  rtNodeContextRef newContext();
+
+  struct pooledContext
+  {
+    rtNodeContextRef ctx;
+    double           warmMs;
+  };
+  double                     mFrameDeadline;
+  double                     mLastWarmMs;
+  int                        mWarmSkippedFrames;
+  bool                       mMemoryPressure;
+  bool                       mMemoryPressureReported;
+  double                     mLastMemoryPressure;
+
+  std::vector<pooledContext> mContextPool;
+  int                        mContextPoolSize;
+  std::string                mContextPoolFile;
+  rtNodeContextPoolStats     mContextPoolStats;
+
   bool mTestGc;
 #ifndef RUNINMAIN
   bool mNeedsToEnd;
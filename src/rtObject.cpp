@@ -37,11 +37,12 @@ unsigned long rtEmit::Release() {
 
 rtError rtEmit::setListener(const char* eventName, rtIFunction* f)
 {
+  rtAtom name(eventName);
   for (vector<_rtEmitEntry>::iterator it = mEntries.begin();
        it != mEntries.end(); it++)
   {
     _rtEmitEntry& e = (*it);
-    if (e.n == eventName && e.isProp)
+    if (e.n == name && e.isProp)
     {
       mEntries.erase(it);
       // There can only be one
@@ -51,7 +52,7 @@ rtError rtEmit::setListener(const char* eventName, rtIFunction* f)
   if (f)
   {
     _rtEmitEntry e;
-    e.n = eventName;
+    e.n = name;
     e.f = f;
     e.isProp = true;
     mEntries.push_back(e);      
@@ -64,13 +65,14 @@ rtError rtEmit::addListener(const char* eventName, rtIFunction* f)
 {
   if (!f) 
     return RT_ERROR;
+  rtAtom name(eventName);
   // Only allow unique entries
   bool found = false;
   for (vector<_rtEmitEntry>::iterator it = mEntries.begin(); 
        it != mEntries.end(); it++)
   {
     _rtEmitEntry& e = (*it);
-    if (e.n == eventName && e.f.getPtr() == f && !e.isProp)
+    if (e.n == name && e.f.getPtr() == f && !e.isProp)
     {
       found = true;
       break;
@@ -79,7 +81,7 @@ rtError rtEmit::addListener(const char* eventName, rtIFunction* f)
   if (!found)
   {
     _rtEmitEntry e;
-    e.n = eventName;
+    e.n = name;
     e.f = f;
     e.isProp = false;
     mEntries.push_back(e);
@@ -90,11 +92,15 @@ rtError rtEmit::addListener(const char* eventName, rtIFunction* f)
 
 rtError rtEmit::delListener(const char* eventName, rtIFunction* f)
 {
+  // nothing listens for a name that was never interned
+  rtAtom name = rtAtom::find(eventName);
+  if (name.isNull())
+    return RT_OK;
   for (vector<_rtEmitEntry>::iterator it = mEntries.begin(); 
        it != mEntries.end(); it++)
   {
     _rtEmitEntry& e = (*it);
-    if (e.n == eventName && e.f.getPtr() == f && !e.isProp)
+    if (e.n == name && e.f.getPtr() == f && !e.isProp)
     {
       mEntries.erase(it);
       // There can only be one
@@ -112,12 +118,15 @@ rtError rtEmit::Send(int numArgs, const rtValue* args, rtValue* result)
   {
     rtString eventName = args[0].toString();
     rtLogDebug("rtEmit::Send %s", eventName.cString());
+    rtAtom name = rtAtom::find(eventName.cString());
+    if (name.isNull())
+      return RT_OK;
 
     vector<_rtEmitEntry>::iterator it = mEntries.begin();
     while (it != mEntries.end())
     {
       _rtEmitEntry& e = (*it);
-      if (e.n == eventName)
+      if (e.n == name)
       {
         // Do this here to make interop synchronous
         rtError err;
@@ -221,10 +230,13 @@ rtError rtArrayObject::Set(uint32_t i, const rtValue* value)
 // rtMapObject
 vector<rtNamedValue>::iterator rtMapObject::find(const char* name)
 {
+  // a key with an atom is only equal to the same atom, one without is
+  // compared by its characters, it may have been interned since
+  rtAtom a = rtAtom::find(name);
   vector<rtNamedValue>::iterator it = mProps.begin(); 
   while(it != mProps.end())
   {
-    if (it->n == name)
+    if (it->a.isNull() ? strcmp(it->n.cString(), name) == 0 : it->a == a)
       return it;
     it++;
   }
@@ -251,8 +263,8 @@ rtError rtMapObject::Get(const char* name, rtValue* value) const
     while(it != mProps.end())
     {
       // exclude allKeys
-      if (it->n != "allKeys")
-        keys->pushBack(it->n);
+      if (strcmp(it->n.cString(), "allKeys"))
+        keys->pushBack(it->n.cString());
       it++;
     }
     *value = keys;
@@ -276,6 +288,7 @@ rtError rtMapObject::Set(const char* name, const rtValue* value)
   {
     rtNamedValue v;
     v.n = name;
+    v.a = rtAtom::find(name);
     v.v = *value;
     mProps.push_back(v);
     return RT_OK;
@@ -324,6 +337,17 @@ rtError rtObject::Get(uint32_t /*i*/, rtValue* /*value*/) const
 rtError rtObject::Get(const char* name, rtValue* value) const
 {
   rtError hr = RT_PROP_NOT_FOUND;
+
+  // The names in the maps are interned, so a name that never was can't be
+  // one of them, and one that was is found by pointer
+  rtAtom a = rtAtom::find(name);
+  if (a.isNull())
+  {
+    rtLogDebug("key: %s not found", name);
+    return hr;
+  }
+  const char* atom = a.cString();
+
   rtMethodMap* m = getMap();
   
   while(m) 
@@ -331,7 +355,7 @@ rtError rtObject::Get(const char* name, rtValue* value) const
     rtPropertyEntry* e = m->getFirstProperty();
     while(e) 
     {
-      if (strcmp(name, e->mPropertyName) == 0) 
+      if (e->mPropertyName == atom) 
       {
         rtGetPropertyThunk t = e->mGetThunk;
         hr = (*this.*t)(*value);
@@ -354,7 +378,7 @@ rtError rtObject::Get(const char* name, rtValue* value) const
       rtMethodEntry* e = m->getFirstMethod();
       while(e)
       {
-        if (strcmp(name, e->mMethodName) == 0)
+        if (e->mMethodName == atom)
         {
           rtLogDebug("found method: %s", name);
           value->setFunction(new rtObjectFunction(this, e->mThunk));
@@ -378,6 +402,11 @@ rtError rtObject::Set(uint32_t /*i*/, const rtValue* /*value*/)
 rtError rtObject::Set(const char* name, const rtValue* value) 
 {
   rtError hr = RT_PROP_NOT_FOUND;
+
+  rtAtom a = rtAtom::find(name);
+  if (a.isNull())
+    return RT_OK;
+  const char* atom = a.cString();
   
   rtMethodMap* m;
   m = getMap();
@@ -387,7 +416,7 @@ rtError rtObject::Set(const char* name, const rtValue* value)
     rtPropertyEntry* e = m->getFirstProperty();
     while(e) 
     {
-      if (strcmp(name, e->mPropertyName) == 0) 
+      if (e->mPropertyName == atom) 
       {
         if (e->mSetThunk) 
         {
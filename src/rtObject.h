@@ -637,7 +637,7 @@ public:
 protected:
   struct _rtEmitEntry 
   {
-    rtString n;
+    rtAtom n;
     rtFunctionRef f;
     bool isProp;
   };
@@ -676,9 +676,13 @@ private:
   std::vector<rtValue> mElements;
 };
 
+// Map keys often come from data, so they're kept as strings and only
+// matched by atom when the name was interned anyway, as property, method
+// and event names are.  Interning them would keep every key ever set.
 struct rtNamedValue
 {
   rtString n;
+  rtAtom a;
   rtValue v;
 };
 
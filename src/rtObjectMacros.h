@@ -21,6 +21,8 @@
 #ifndef RT_OBJECT_MACROS_H
 #define RT_OBJECT_MACROS_H
 
+#include "rtString.h"
+
 #define __UNUSED(x)  ((x)=(x))
 
 class rtObject;
@@ -35,7 +37,7 @@ struct rtMethodEntry
 	      rtMethodThunk thunk, rtMethodEntry* next)
     {
         mArgTypes = argTypes;
-        mMethodName = methodName;
+        mMethodName = rtAtom(methodName).cString();
         mNext = next;
         mReturnType = returnType;
         mThunk = thunk;
@@ -231,7 +233,7 @@ int class::rtPropertyCount = sizeof(class::rtPropertyEntries)/sizeof(rtPropertyE
         name##PropEntry() \
         {\
             rtPropertyEntry* tail = headProperty(&entry); \
-            entry.mPropertyName = "" #name ""; \
+            entry.mPropertyName = rtAtom("" #name "").cString(); \
             entry.mPropType = RT_##propType##Type; \
             entry.mSetThunk = (rtSetPropertyThunk)&PARENTTYPE__::setMethod##_PropSetterThunk; \
             entry.mGetThunk = (rtGetPropertyThunk)&PARENTTYPE__::getMethod##_PropGetterThunk; \
@@ -249,7 +251,7 @@ int class::rtPropertyCount = sizeof(class::rtPropertyEntries)/sizeof(rtPropertyE
         name##PropEntry() \
         {\
             rtPropertyEntry* tail = headProperty(&entry); \
-            entry.mPropertyName = "" #name ""; \
+            entry.mPropertyName = rtAtom("" #name "").cString(); \
             entry.mPropType = RT_##propType##Type; \
             entry.mSetThunk = (rtSetPropertyThunk)NULL; \
             entry.mGetThunk = (rtGetPropertyThunk)&PARENTTYPE__::getMethod##_PropGetterThunk; \
@@ -267,7 +269,7 @@ int class::rtPropertyCount = sizeof(class::rtPropertyEntries)/sizeof(rtPropertyE
         name##PropEntry() \
         {\
             rtPropertyEntry* tail = headProperty(&entry); \
-            entry.mPropertyName = "" #name ""; \
+            entry.mPropertyName = rtAtom("" #name "").cString(); \
             entry.mPropType = RT_##propType##Type; \
             entry.mSetThunk = (rtSetPropertyThunk)NULL; \
             entry.mGetThunk = (rtGetPropertyThunk)&PARENTTYPE__::name##_PropGetterThunk; \
@@ -286,7 +288,7 @@ int class::rtPropertyCount = sizeof(class::rtPropertyEntries)/sizeof(rtPropertyE
         {\
             rtMethodEntry* tail = head(&entry); \
             entry.mArgTypes = ""; \
-            entry.mMethodName = name; \
+            entry.mMethodName = rtAtom(name).cString(); \
             entry.mNext = tail; \
             entry.mReturnType = RT_voidType; \
             entry.mThunk = (rtMethodThunk)&PARENTTYPE__::method##_thunk;	\
@@ -304,7 +306,7 @@ int class::rtPropertyCount = sizeof(class::rtPropertyEntries)/sizeof(rtPropertyE
         {\
             rtMethodEntry* tail = head(&entry); \
             entry.mArgTypes = RT_##arg1type##Type2; \
-            entry.mMethodName = name; \
+            entry.mMethodName = rtAtom(name).cString(); \
             entry.mNext = tail; \
             entry.mReturnType = RT_voidType; \
             entry.mThunk = (rtMethodThunk)&PARENTTYPE__::method##_thunk;	\
@@ -323,7 +325,7 @@ int class::rtPropertyCount = sizeof(class::rtPropertyEntries)/sizeof(rtPropertyE
         {\
             rtMethodEntry* tail = head(&entry); \
             entry.mArgTypes = RT_##arg1type##Type2 RT_##arg2type##Type2; \
-            entry.mMethodName = name; \
+            entry.mMethodName = rtAtom(name).cString(); \
             entry.mNext = tail; \
             entry.mReturnType = RT_voidType; \
             entry.mThunk = (rtMethodThunk)&PARENTTYPE__::method##_thunk;	\
@@ -342,7 +344,7 @@ int class::rtPropertyCount = sizeof(class::rtPropertyEntries)/sizeof(rtPropertyE
         {\
             rtMethodEntry* tail = head(&entry); \
             entry.mArgTypes = RT_##arg1type##Type2 RT_##arg2type##Type2 RT_##arg3type##Type2; \
-            entry.mMethodName = name; \
+            entry.mMethodName = rtAtom(name).cString(); \
             entry.mNext = tail; \
             entry.mReturnType = RT_voidType; \
             entry.mThunk = (rtMethodThunk)&PARENTTYPE__::method##_thunk; \
@@ -361,7 +363,7 @@ int class::rtPropertyCount = sizeof(class::rtPropertyEntries)/sizeof(rtPropertyE
         {\
             rtMethodEntry* tail = head(&entry); \
             entry.mArgTypes = RT_##arg1type##Type2 RT_##arg2type##Type2 RT_##arg3type##Type2 RT_##arg4type##Type2; \
-            entry.mMethodName = name; \
+            entry.mMethodName = rtAtom(name).cString(); \
             entry.mNext = tail; \
             entry.mReturnType = RT_voidType; \
             entry.mThunk = (rtMethodThunk)&PARENTTYPE__::method##_thunk; \
@@ -380,7 +382,7 @@ int class::rtPropertyCount = sizeof(class::rtPropertyEntries)/sizeof(rtPropertyE
         {\
             rtMethodEntry* tail = head(&entry); \
             entry.mArgTypes = RT_##arg1type##Type2 RT_##arg2type##Type2 RT_##arg3type##Type2 RT_##arg4type##Type2 RT_##arg5type##Type2; \
-            entry.mMethodName = name; \
+            entry.mMethodName = rtAtom(name).cString(); \
             entry.mNext = tail; \
             entry.mReturnType = RT_voidType; \
             entry.mThunk = (rtMethodThunk)&PARENTTYPE__::method##_thunk; \
@@ -399,7 +401,7 @@ int class::rtPropertyCount = sizeof(class::rtPropertyEntries)/sizeof(rtPropertyE
         {\
             rtMethodEntry* tail = head(&entry); \
             entry.mArgTypes = RT_##arg1type##Type2 RT_##arg2type##Type2 RT_##arg3type##Type2 RT_##arg4type##Type2 RT_##arg5type##Type2 RT_##arg6type##Type2; \
-            entry.mMethodName = name; \
+            entry.mMethodName = rtAtom(name).cString(); \
             entry.mNext = tail; \
             entry.mReturnType = RT_voidType; \
             entry.mThunk = (rtMethodThunk)&PARENTTYPE__::method##_thunk; \
@@ -418,7 +420,7 @@ int class::rtPropertyCount = sizeof(class::rtPropertyEntries)/sizeof(rtPropertyE
         {\
             rtMethodEntry* tail = head(&entry); \
             entry.mArgTypes = RT_##arg1type##Type2 RT_##arg2type##Type2 RT_##arg3type##Type2 RT_##arg4type##Type2 RT_##arg5type##Type2 RT_##arg6type##Type2 RT_##arg7type##Type2; \
-            entry.mMethodName = name; \
+            entry.mMethodName = rtAtom(name).cString(); \
             entry.mNext = tail; \
             entry.mReturnType = RT_voidType; \
             entry.mThunk = (rtMethodThunk)&PARENTTYPE__::method##_thunk; \
@@ -437,7 +439,7 @@ int class::rtPropertyCount = sizeof(class::rtPropertyEntries)/sizeof(rtPropertyE
         {\
             rtMethodEntry* tail = head(&entry); \
             entry.mArgTypes = RT_##arg1type##Type2 RT_##arg2type##Type2 RT_##arg3type##Type2 RT_##arg4type##Type2 RT_##arg5type##Type2 RT_##arg6type##Type2 RT_##arg7type##Type2 RT_##arg8type##Type2; \
-            entry.mMethodName = name; \
+            entry.mMethodName = rtAtom(name).cString(); \
             entry.mNext = tail; \
             entry.mReturnType = RT_voidType; \
             entry.mThunk = (rtMethodThunk)&PARENTTYPE__::method##_thunk; \
@@ -456,7 +458,7 @@ int class::rtPropertyCount = sizeof(class::rtPropertyEntries)/sizeof(rtPropertyE
         {\
             rtMethodEntry* tail = head(&entry); \
             entry.mArgTypes = RT_##arg1type##Type2 RT_##arg2type##Type2 RT_##arg3type##Type2 RT_##arg4type##Type2 RT_##arg5type##Type2 RT_##arg6type##Type2 RT_##arg7type##Type2 RT_##arg8type##Type2 RT_##arg9type##Type2; \
-            entry.mMethodName = name; \
+            entry.mMethodName = rtAtom(name).cString(); \
             entry.mNext = tail; \
             entry.mReturnType = RT_voidType; \
             entry.mThunk = (rtMethodThunk)&PARENTTYPE__::method##_thunk; \
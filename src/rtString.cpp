@@ -21,60 +21,160 @@
 #include "rtString.h"
 #include <string.h>
 #include <stdlib.h>
+#include <stddef.h>
 
 #include <stdio.h>
 #include "rtLog.h"
+#include "rtAtomic.h"
+#ifdef WIN32
+#include <Windows.h>
+#else
+#include <pthread.h>
+#endif
 extern "C"
 {
 #include "utf8.h"
 }
 
-rtString::rtString(): mData(0) {}
+// The heap storage of a long string, shared by its copies
+struct rtStringBlock
+{
+  rtAtomic refCount;
+  uint32_t capacity;
+  char     data[1];
+};
+
+static rtStringBlock* blockOf(const char* data)
+{
+  return (rtStringBlock*)(data - offsetof(rtStringBlock, data));
+}
+
+// room for capacity bytes and the terminator
+static char* newBlock(uint32_t capacity)
+{
+  rtStringBlock* b = (rtStringBlock*)malloc(offsetof(rtStringBlock, data) + capacity + 1);
+  b->refCount = 1;
+  b->capacity = capacity;
+  return b->data;
+}
+
+static void releaseBlock(char* data)
+{
+  rtStringBlock* b = blockOf(data);
+  if (rtAtomicDec(&b->refCount) == 0)
+    free(b);
+}
+
+rtString::rtString(): mData(0), mLength(0) {}
 
-rtString::rtString(const char* s): mData(0) 
+rtString::rtString(const char* s): mData(0), mLength(0)
 {
   if (s)
-    mData = strdup(s);
+    assign(s, (uint32_t)strlen(s));
 }
 
-rtString::rtString(const char* s, uint32_t byteLen): mData(0)
+rtString::rtString(const char* s, uint32_t byteLen): mData(0), mLength(0)
 {
   if (s)
-  {
-    mData = (char*)malloc(byteLen+1);
-    memcpy(mData, s, byteLen);
-    mData[byteLen] = 0; // null terminate
-  }
+    assign(s, byteLen);
+}
+
+rtString::rtString(const rtString& s): mData(0), mLength(0)
+{
+  share(s);
 }
 
-rtString::rtString(const rtString& s): mData(0) 
+#if __cplusplus >= 201103L
+rtString::rtString(rtString&& s): mData(0), mLength(0)
 {
-  if (s.mData)
-    mData = strdup(s.mData);
+  take(s);
 }
+#endif
 
 rtString& rtString::operator=(const rtString& s) 
+{
+  if (this != &s && (mData != s.mData || !mData))
+  {
+    term();
+    share(s);
+  }
+  return *this;
+}
+
+#if __cplusplus >= 201103L
+rtString& rtString::operator=(rtString&& s)
 {
   if (this != &s)
   {
     term();
-    if (s.mData)
-      mData = strdup(s.mData);
+    take(s);
   }
   return *this;
 }
+#endif
 
 rtString& rtString::operator=(const char* s) 
 {
   if (s != mData)
   {
-    term();
-    if (s)
-      mData = strdup(s);
+    if (s && mData && s > mData && s <= mData + mLength)
+    {
+      // s is part of this string, copy it before letting go
+      rtString t(s);
+      term();
+      take(t);
+    }
+    else
+    {
+      term();
+      if (s)
+        assign(s, (uint32_t)strlen(s));
+    }
   }
   return *this;
 }
 
+void rtString::assign(const char* s, uint32_t byteLen)
+{
+  if (byteLen < RT_STRING_SMALL)
+    mData = mSmall;
+  else
+    mData = newBlock(byteLen);
+  memcpy(mData, s, byteLen);
+  mData[byteLen] = 0; // null terminate
+  mLength = byteLen;
+}
+
+void rtString::share(const rtString& s)
+{
+  if (s.mData == s.mSmall)
+  {
+    memcpy(mSmall, s.mSmall, s.mLength + 1);
+    mData = mSmall;
+  }
+  else
+  {
+    mData = s.mData;
+    if (mData)
+      rtAtomicInc(&blockOf(mData)->refCount);
+  }
+  mLength = s.mLength;
+}
+
+void rtString::take(rtString& s)
+{
+  if (s.mData == s.mSmall)
+  {
+    memcpy(mSmall, s.mSmall, s.mLength + 1);
+    mData = mSmall;
+  }
+  else
+    mData = s.mData;
+  mLength = s.mLength;
+  s.mData = 0;
+  s.mLength = 0;
+}
+
 bool rtString::isEmpty() const
 {
   return (!mData || !(*mData));
@@ -84,17 +184,52 @@ rtString::~rtString() { term(); }
 
 void rtString::term() 
 {
-  if (mData)
-    free(mData);
+  if (mData && mData != mSmall)
+    releaseBlock(mData);
   mData = 0;
+  mLength = 0;
+}
+
+char* rtString::setLength(uint32_t byteLen)
+{
+  term();
+  if (byteLen < RT_STRING_SMALL)
+    mData = mSmall;
+  else
+    mData = newBlock(byteLen);
+  mData[byteLen] = 0;
+  mLength = byteLen;
+  return mData;
 }
 
 void rtString::append(const char* s) 
 {
-  size_t sl = strlen(s);
-  size_t dl = strlen(mData);
-  mData = (char*)realloc((void*)mData, dl+sl+1);
-  strcpy(mData+dl, s);
+  uint32_t sl = (uint32_t)strlen(s);
+  uint32_t l = mLength + sl;
+  if (l < RT_STRING_SMALL)
+  {
+    // still short, so this is already in mSmall if it's anything
+    memmove(mSmall + mLength, s, sl + 1);
+    mData = mSmall;
+  }
+  else if (mData && mData != mSmall && blockOf(mData)->refCount == 1 &&
+           blockOf(mData)->capacity >= l)
+  {
+    memmove(mData + mLength, s, sl + 1);
+  }
+  else
+  {
+    // copy on write, with room to grow for the next append
+    uint32_t capacity = l < mLength*2?mLength*2:l;
+    char* d = newBlock(capacity);
+    if (mLength)
+      memcpy(d, mData, mLength);
+    memcpy(d + mLength, s, sl + 1);
+    if (mData && mData != mSmall)
+      releaseBlock(mData);
+    mData = d;
+  }
+  mLength = l;
 }
 
 int rtString::compare(const char* s) const 
@@ -127,7 +262,7 @@ int32_t rtString::length() const
 
 int32_t rtString::byteLength() const 
 {
-  return (int32_t)(mData?strlen(mData):0);
+  return (int32_t)mLength;
 }
 
 bool rtString::beginsWith(const char* s) const
@@ -210,3 +345,123 @@ rtString rtString::substring(size_t pos, size_t len) const
     return rtString(s,byteEnd);
   }
 }
+
+// rtAtom
+//
+// Open addressing with linear probing over the interned names.  Lookups
+// don't lock: slots are only ever filled, never cleared, a name is written
+// before the slot pointing at it and a grown table is filled before it's
+// published, with the old one left for readers still in it.  Interning
+// locks.  Everything here is constant initialized, so atoms can be made
+// from static constructors.
+
+struct rtAtomTable
+{
+  // the table this one replaced, kept for lookups still going on in it
+  rtAtomTable* previous;
+  uint32_t     mask;
+  uint32_t     size;
+  const char* volatile slots[1];
+};
+
+static rtAtomTable* volatile sAtomTable = NULL;
+#ifdef WIN32
+static SRWLOCK sAtomLock = SRWLOCK_INIT;
+#define rtAtomLock()   AcquireSRWLockExclusive(&sAtomLock)
+#define rtAtomUnlock() ReleaseSRWLockExclusive(&sAtomLock)
+// volatile reads and writes are acquire and release here
+#define rtAtomLoad(p)     (p)
+#define rtAtomStore(p, v) ((p) = (v))
+#else
+static pthread_mutex_t sAtomLock = PTHREAD_MUTEX_INITIALIZER;
+#define rtAtomLock()   pthread_mutex_lock(&sAtomLock)
+#define rtAtomUnlock() pthread_mutex_unlock(&sAtomLock)
+#define rtAtomLoad(p)     __atomic_load_n(&(p), __ATOMIC_ACQUIRE)
+#define rtAtomStore(p, v) __atomic_store_n(&(p), (v), __ATOMIC_RELEASE)
+#endif
+
+static uint32_t atomHash(const char* s)
+{
+  // FNV-1a
+  uint32_t h = 2166136261u;
+  for (; *s; s++)
+    h = (h ^ (uint8_t)*s) * 16777619u;
+  return h;
+}
+
+static const char* atomFind(const rtAtomTable* t, const char* s, uint32_t h)
+{
+  if (!t)
+    return NULL;
+  for (uint32_t i = h & t->mask;; i = (i + 1) & t->mask)
+  {
+    const char* a = rtAtomLoad(t->slots[i]);
+    if (!a)
+      return NULL;
+    if (strcmp(a, s) == 0)
+      return a;
+  }
+}
+
+static rtAtomTable* newAtomTable(uint32_t capacity)
+{
+  rtAtomTable* t = (rtAtomTable*)calloc(1, offsetof(rtAtomTable, slots) + capacity*sizeof(const char*));
+  t->mask = capacity - 1;
+  t->size = 0;
+  return t;
+}
+
+static void atomInsert(rtAtomTable* t, const char* a, uint32_t h)
+{
+  uint32_t i = h & t->mask;
+  while (t->slots[i])
+    i = (i + 1) & t->mask;
+  rtAtomStore(t->slots[i], a);
+  t->size++;
+}
+
+rtAtom::rtAtom(const char* s): mName(0)
+{
+  if (!s)
+    return;
+
+  uint32_t h = atomHash(s);
+  mName = atomFind(rtAtomLoad(sAtomTable), s, h);
+  if (mName)
+    return;
+
+  rtAtomLock();
+  rtAtomTable* t = sAtomTable;
+  mName = atomFind(t, s, h);
+  if (!mName)
+  {
+    // at most half full
+    if (!t || (t->size + 1)*2 > t->mask + 1)
+    {
+      rtAtomTable* grown = newAtomTable(t?(t->mask + 1)*2:256);
+      grown->previous = t;
+      if (t)
+      {
+        for (uint32_t i = 0; i <= t->mask; i++)
+        {
+          if (t->slots[i])
+            atomInsert(grown, t->slots[i], atomHash(t->slots[i]));
+        }
+      }
+      rtAtomStore(sAtomTable, grown);
+      t = grown;
+    }
+    const char* a = strdup(s);
+    atomInsert(t, a, h);
+    mName = a;
+  }
+  rtAtomUnlock();
+}
+
+rtAtom rtAtom::find(const char* s)
+{
+  rtAtom a;
+  if (s)
+    a.mName = atomFind(rtAtomLoad(sAtomTable), s, atomHash(s));
+  return a;
+}
@@ -32,7 +32,14 @@
 
 /**
   A lightweight utf-8 string class.
+
+  Strings shorter than RT_STRING_SMALL bytes live inside the rtString, so
+  names like "x" or "onReady" never touch the heap.  Longer ones are kept in
+  a refcounted block that copies share until one of them is appended to.
+  The byte length is kept alongside.
 */
+#define RT_STRING_SMALL 16
+
 class rtString 
 {
 public:
@@ -47,11 +54,17 @@ public:
   rtString(const char* s, uint32_t byteLen);
 
   rtString(const rtString& s);
+#if __cplusplus >= 201103L
+  rtString(rtString&& s);
+#endif
   
   ~rtString();
   
   rtString& operator=(const rtString& s);
   rtString& operator=(const char* s);
+#if __cplusplus >= 201103L
+  rtString& operator=(rtString&& s);
+#endif
 
   /**
    * Determines if the string is empty.
@@ -63,6 +76,13 @@ public:
 
   void append(const char* s);
 
+  /**
+   * Makes this a string of byteLen bytes for the caller to fill in, so
+   * readers can write straight into it instead of copying from a buffer.
+   * @returns The byteLen writable bytes, null-terminated.
+   */
+  char* setLength(uint32_t byteLen);
+
   int compare(const char* s) const;
 
   /**
@@ -107,7 +127,42 @@ public:
   int32_t find(size_t pos, uint32_t codePoint) const;
 
 private:
-  char* mData;
+  void assign(const char* s, uint32_t byteLen);
+  void share(const rtString& s);
+  void take(rtString& s);
+
+  // mData is NULL, mSmall or the characters of a shared block
+  char*    mData;
+  uint32_t mLength;
+  char     mSmall[RT_STRING_SMALL];
+};
+
+/**
+  An interned string.  Every rtAtom made from the same characters holds the
+  same pointer, so names that are looked up often (properties, methods,
+  events) compare with a pointer compare instead of strcmp.  Interned
+  characters are never freed, so intern names, not arbitrary data.
+*/
+class rtAtom
+{
+public:
+  rtAtom(): mName(0) {}
+  explicit rtAtom(const char* s);
+
+  /**
+   * Looks s up without interning it.
+   * @returns The atom for s, or a null atom if s was never interned.
+   */
+  static rtAtom find(const char* s);
+
+  bool isNull() const { return !mName; }
+  const char* cString() const { return mName?mName:""; }
+
+  finline bool operator== (const rtAtom& a) const { return mName == a.mName; }
+  finline bool operator!= (const rtAtom& a) const { return mName != a.mName; }
+
+private:
+  const char* mName;
 };
 
 #endif
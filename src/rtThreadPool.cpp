@@ -34,8 +34,9 @@ rtThreadPool::rtThreadPool(int numberOfThreads) : rtThreadPoolNative(numberOfThr
 
 rtThreadPool::~rtThreadPool()
 {
-  delete mGlobalInstance;
-  mGlobalInstance = NULL;
+  // pools other than the global one can come and go
+  if (mGlobalInstance == this)
+    mGlobalInstance = NULL;
 }
 
 rtThreadPool* rtThreadPool::globalInstance()
@@ -40,6 +40,7 @@ rtValue::rtValue(const rtIObject* v)    :mType(0) { setObject(v); }
 rtValue::rtValue(const rtObjectRef& v)  :mType(0) { setObject(v); }
 rtValue::rtValue(const rtIFunction* v)  :mType(0) { setFunction(v); }
 rtValue::rtValue(const rtFunctionRef& v):mType(0) { setFunction(v); }
+rtValue::rtValue(const rtBufferRef& v)  :mType(0) { setBuffer(v); }
 rtValue::rtValue(const rtValue& v)      :mType(0) { setValue(v);  }
 rtValue::rtValue(voidPtr v)             :mType(0) { setVoidPtr(v); }
 
@@ -80,6 +81,7 @@ bool rtValue::compare(const rtValue& lhs, const rtValue& rhs)
     break;
     case RT_objectType:   result = (lhs.mValue.objectValue == rhs.mValue.objectValue); break;
     case RT_functionType: result = (lhs.mValue.functionValue == rhs.mValue.functionValue); break;
+    case RT_bufferType:   result = (lhs.mValue.bufferValue == rhs.mValue.bufferValue); break;
     }
   }
   return result;
@@ -127,6 +129,14 @@ void rtValue::setEmpty()
       mValue.stringValue = NULL;
     }
   }
+  else if (mType == RT_bufferType)
+  {
+    if (mValue.bufferValue)
+    {
+      mValue.bufferValue->Release();
+      mValue.bufferValue = NULL;
+    }
+  }
 
   // TODO setting this to '0' makes node wrappers unhappy
   mType = 0;
@@ -139,6 +149,14 @@ void rtValue::setValue(const rtValue& v)
 {
   if (this != &v)
   {
+    // a string over a string keeps the rtString, see setString
+    if (mType == RT_stringType && mValue.stringValue &&
+        v.mType == RT_stringType && v.mValue.stringValue)
+    {
+      *mValue.stringValue = *v.mValue.stringValue;
+      mIsEmpty = v.mIsEmpty;
+      return;
+    }
     setEmpty();
     mType = v.mType;
     if (mType == RT_objectType && v.mValue.objectValue != NULL)
@@ -151,6 +169,11 @@ void rtValue::setValue(const rtValue& v)
       mValue.functionValue = v.mValue.functionValue;
       mValue.functionValue->AddRef();
     }
+    else if (mType == RT_bufferType && v.mValue.bufferValue != NULL)
+    {
+      mValue.bufferValue = v.mValue.bufferValue;
+      mValue.bufferValue->AddRef();
+    }
 #if 1
     else if (mType == RT_stringType && v.mValue.stringValue != NULL)
     {
@@ -227,6 +250,13 @@ void rtValue::setDouble(double v)
 
 void rtValue::setString(const rtString& v)
 {
+  // a string over a string keeps the rtString, copying v is cheap
+  if (mType == RT_stringType && mValue.stringValue)
+  {
+    *mValue.stringValue = v;
+    mIsEmpty = false;
+    return;
+  }
   setEmpty();
   mType    = RT_stringType; mValue.stringValue = new rtString(v);
   mIsEmpty = false;
@@ -270,6 +300,16 @@ void rtValue::setFunction(const rtFunctionRef& v)
   setFunction(v.getPtr());
 }
 
+void rtValue::setBuffer(const rtBufferRef& v)
+{
+  setEmpty();
+  mType    = RT_bufferType;
+  mIsEmpty = false;
+  mValue.bufferValue = v.getPtr();
+  if (mValue.bufferValue)
+    mValue.bufferValue->AddRef();
+}
+
 void rtValue::setVoidPtr(voidPtr v)
 {
   setEmpty();
@@ -305,6 +345,7 @@ rtError rtValue::getBool(bool& v) const
     break;
     case RT_objectType: v = mValue.objectValue?     true:false; break;
     case RT_functionType: v = mValue.functionValue? true:false; break;
+    case RT_bufferType:   v = mValue.bufferValue?   true:false; break;
     case RT_voidPtrType:  /* Leave as default */ break;
     default:
       rtLogError("No conversion from %s to bool.", rtStrType(mType));
@@ -342,6 +383,7 @@ rtError rtValue::getInt8(int8_t& v)  const
     break;
     case RT_objectType: /* Leave as default */ break;
     case RT_functionType: /* Leave as default */ break;
+    case RT_bufferType:   /* Leave as default */ break;
     case RT_voidPtrType:  /* Leave as default */ break;
     default:
       rtLogError("No conversion from %s to int8_t.", rtStrType(mType));
@@ -379,6 +421,7 @@ rtError rtValue::getUInt8(uint8_t& v) const
     break;
     case RT_objectType:   /* Leave as default */ break;
     case RT_functionType: /* Leave as default */ break;
+    case RT_bufferType:   /* Leave as default */ break;
     case RT_voidPtrType:  /* Leave as default */ break;
     default:
       rtLogError("No conversion from %s to uint8_t.", rtStrType(mType));
@@ -416,6 +459,7 @@ rtError rtValue::getInt32(int32_t& v) const
     break;
     case RT_objectType:   /* Leave as default */ break;
     case RT_functionType: /* Leave as default */ break;
+    case RT_bufferType:   /* Leave as default */ break;
     case RT_voidPtrType:  /* Leave as default */ break;
     default:
       rtLogError("No conversion from %s to int32_t.", rtStrType(mType));
@@ -453,6 +497,7 @@ rtError rtValue::getUInt32(uint32_t& v) const
     break;
     case RT_objectType:   /* Leave as default */ break;
     case RT_functionType: /* Leave as default */ break;
+    case RT_bufferType:   /* Leave as default */ break;
     case RT_voidPtrType:  /* Leave as default */ break;
     default:
       rtLogError("No conversion from %s to uint32_t.", rtStrType(mType));
@@ -490,6 +535,7 @@ rtError rtValue::getInt64(int64_t& v) const
     break;
     case RT_objectType:   /* Leave as default */ break;
     case RT_functionType: /* Leave as default */ break;
+    case RT_bufferType:   /* Leave as default */ break;
     case RT_voidPtrType:  /* Leave as default */ break;
     default:
       rtLogError("No conversion from %s to int64.", rtStrType(mType));
@@ -527,6 +573,7 @@ rtError rtValue::getUInt64(uint64_t& v) const
     break;
     case RT_objectType:   /* Leave as default */ break;
     case RT_functionType: /* Leave as default */ break;
+    case RT_bufferType:   /* Leave as default */ break;
     case RT_voidPtrType:  /* Leave as default */ break;
     default:
       rtLogError("No conversion from %s to uint64_t.", rtStrType(mType));
@@ -563,6 +610,7 @@ rtError rtValue::getFloat(float& v) const
     break;
     case RT_objectType:   /* Leave as default */ break;
     case RT_functionType: /* Leave as default */ break;
+    case RT_bufferType:   /* Leave as default */ break;
     case RT_voidPtrType:  /* Leave as default */ break;
     default:
       rtLogError("No conversion from %s to float.", rtStrType(mType));
@@ -599,6 +647,7 @@ rtError rtValue::getDouble(double& v) const
     break;
     case RT_objectType:   /* Leave as default */ break;
     case RT_functionType: /* Leave as default */ break;
+    case RT_bufferType:   /* Leave as default */ break;
     case RT_voidPtrType:  /* Leave as default */ break;
     default:
       rtLogError("No conversion from %s to double.", rtStrType(mType));
@@ -631,6 +680,14 @@ rtError rtValue::getString(rtString& v) const
       // TODO call toString or description on object
     case RT_objectType: break;
     case RT_functionType: break;
+    case RT_bufferType:
+      // the bytes, for callers that still want strings
+      if (mValue.bufferValue)
+      {
+        v = rtString((const char*)mValue.bufferValue->data(), mValue.bufferValue->length());
+        return RT_OK;
+      }
+      break;
     case RT_voidPtrType:  /* Leave as default */ break;
     default:
       rtLogError("No conversion from %s to string.", rtStrType(mType));
@@ -667,6 +724,19 @@ rtError rtValue::getFunction(rtFunctionRef& v) const
   return RT_OK;
 }
 
+rtError rtValue::getBuffer(rtBufferRef& v) const
+{
+  if (mType == RT_bufferType)
+    v = mValue.bufferValue;
+  else
+  {
+    // No other types are convertable to buffer
+    v = NULL;
+    return RT_ERROR_TYPE_MISMATCH;
+  }
+  return RT_OK;
+}
+
 rtError rtValue::getVoidPtr(voidPtr& v) const
 {
   if (mType == RT_voidPtrType)
@@ -705,6 +775,7 @@ const char* rtStrType(char t)
     RT_TYPE_CASE(RT_objectType);
     RT_TYPE_CASE(RT_functionType);
     RT_TYPE_CASE(RT_voidPtrType);
+    RT_TYPE_CASE(RT_bufferType);
     default:
     break;
   }
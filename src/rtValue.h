@@ -26,6 +26,7 @@
 
 #include "rtCore.h"
 #include "rtString.h"
+#include "rtBuffer.h"
 
 #define RT_voidType               '\0'
 #define RT_valueType              'v'
@@ -47,6 +48,8 @@
 #define RT_functionType           'f'
 #define RT_rtFunctionRefType      'f'
 #define RT_voidPtrType            'z'
+#define RT_bufferType             'a'
+#define RT_rtBufferRefType        'a'
 
 // TODO JR Hack Only needed for reflection... method signature
 //Try #define CHARIZE(x) #x[0]
@@ -69,6 +72,7 @@
 #define RT_rtObjectRefType2        "o"
 #define RT_rtFunctionRefType2      "f"
 #define RT_voidPtrType2            "z"
+#define RT_rtBufferRefType2        "a"
 
 class rtIObject;
 class rtIFunction;
@@ -94,6 +98,7 @@ union rtValue_
   rtString    *stringValue;
   rtIObject   *objectValue;
   rtIFunction *functionValue;
+  rtBuffer    *bufferValue;
   voidPtr     voidPtrValue;  // For creating mischief
 };
 
@@ -118,6 +123,7 @@ class rtValue
   rtValue(const rtObjectRef& v);
   rtValue(const rtIFunction* v);
   rtValue(const rtFunctionRef& v);
+  rtValue(const rtBufferRef& v);
   rtValue(const rtValue& v);
   rtValue(voidPtr v);
   ~rtValue();
@@ -139,6 +145,7 @@ class rtValue
   finline rtValue& operator=(const rtObjectRef& v)  { setObject(v);   return *this; }
   finline rtValue& operator=(const rtIFunction* v)  { setFunction(v); return *this; }
   finline rtValue& operator=(const rtFunctionRef& v){ setFunction(v); return *this; }
+  finline rtValue& operator=(const rtBufferRef& v)  { setBuffer(v);   return *this; }
   finline rtValue& operator=(const rtValue& v)      { setValue(v);    return *this; }
   finline rtValue& operator=(voidPtr v)             { setVoidPtr(v);  return *this; }
 
@@ -158,6 +165,7 @@ class rtValue
   finline rtString   toString()   const { rtString v;    getString(v); return v; }
   rtObjectRef        toObject()   const;
   rtFunctionRef      toFunction() const;
+  rtBufferRef        toBuffer()   const { rtBufferRef v; getBuffer(v);  return v; }
   voidPtr            toVoidPtr()  const { voidPtr v;     getVoidPtr(v);return v; }
 
   rtType getType() const { return mType; }
@@ -182,6 +190,7 @@ class rtValue
   void setObject(const rtObjectRef& v);
   void setFunction(const rtIFunction* v);
   void setFunction(const rtFunctionRef& v);
+  void setBuffer(const rtBufferRef& v);
   void setVoidPtr(voidPtr v);
 
   rtError getValue(rtValue& v)          const;
@@ -197,6 +206,7 @@ class rtValue
   rtError getString(rtString& v)        const;
   rtError getObject(rtObjectRef& v)     const;
   rtError getFunction(rtFunctionRef& v) const;
+  rtError getBuffer(rtBufferRef& v)     const;
   rtError getVoidPtr(voidPtr& v)        const;
 
   // TODO rework this so we avoid a copy if the type matches
@@ -227,6 +237,7 @@ class rtValue
    rtError cvt(rtString& v)               const { return getString(v);   }
    rtError cvt(rtObjectRef& v)            const { return getObject(v);   }
    rtError cvt(rtFunctionRef& v)          const { return getFunction(v); }
+   rtError cvt(rtBufferRef& v)            const { return getBuffer(v);   }
    rtError cvt(voidPtr& v)                const { return getVoidPtr(v);  }
 
   void asn(const rtValue& v)                { setValue(v);    }
@@ -245,6 +256,7 @@ class rtValue
   void asn(const rtObjectRef& v)            { setObject(v);   }
   void asn(const rtIFunction* v)            { setFunction(v); }
   void asn(const rtFunctionRef& v)          { setFunction(v); }
+  void asn(const rtBufferRef& v)            { setBuffer(v);   }
   void asn(voidPtr v)                       { setVoidPtr(v);  }
 
   rtError coerceType(rtType newType);
@@ -104,37 +104,60 @@ rtError rtZip::getFilePathAtIndex(uint32_t i,rtString& filePath) const
   return e;
 }
 
-rtError rtZip::getFileData(const char* filePath, rtData& d) const
+rtError rtZip::locateFile(const char* filePath, uint32_t& size) const
 {
-  rtError e = RT_FAIL;
-  int err = UNZ_OK;
   if (unzLocateFile(mUnzFile, filePath, 0)==UNZ_OK)
   {
     unz_file_info64 fileInfo;
     char filename[256];
-    err = unzGetCurrentFileInfo64(mUnzFile, &fileInfo, filename, 
-                                  sizeof(filename),NULL,0,NULL,0);
+    int err = unzGetCurrentFileInfo64(mUnzFile, &fileInfo, filename, 
+                                      sizeof(filename),NULL,0,NULL,0);
     if (err == UNZ_OK)
     {
       // TODO warning truncating size
-      if (d.init((uint32_t)fileInfo.uncompressed_size) == RT_OK)
-      {
-        err = unzOpenCurrentFilePassword(mUnzFile, NULL);
-        if (err == UNZ_OK)
-        {
-          int amount = unzReadCurrentFile(mUnzFile,d.data(),d.length());
-          if ((uint32_t)amount == d.length())
-          {
-            e = RT_OK;
-          }
-          err = unzCloseCurrentFile(mUnzFile);
-        }
-      }
+      size = (uint32_t)fileInfo.uncompressed_size;
+      return RT_OK;
+    }
+  }
+  return RT_FAIL;
+}
+
+rtError rtZip::readCurrentFile(uint8_t* data, uint32_t size) const
+{
+  rtError e = RT_FAIL;
+  int err = unzOpenCurrentFilePassword(mUnzFile, NULL);
+  if (err == UNZ_OK)
+  {
+    int amount = unzReadCurrentFile(mUnzFile,data,size);
+    if ((uint32_t)amount == size)
+    {
+      e = RT_OK;
     }
+    err = unzCloseCurrentFile(mUnzFile);
   }
   return e;
 }
 
+rtError rtZip::getFileData(const char* filePath, rtData& d) const
+{
+  uint32_t size;
+  if (locateFile(filePath, size) == RT_OK && d.init(size) == RT_OK)
+    return readCurrentFile(d.data(), d.length());
+  return RT_FAIL;
+}
+
+rtError rtZip::getFileData(const char* filePath, rtBufferRef& b) const
+{
+  uint32_t size;
+  if (locateFile(filePath, size) != RT_OK)
+    return RT_FAIL;
+  rtBufferRef buffer = rtBuffer::create(size);
+  if (!buffer || readCurrentFile(buffer->data(), size) != RT_OK)
+    return RT_FAIL;
+  b = buffer;
+  return RT_OK;
+}
+
 bool rtZip::isZip(const void* buffer, size_t bufferSize)
 {
   const char zipMagic[] = "\x50\x4b\x03\x04";
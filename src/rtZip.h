@@ -24,6 +24,7 @@
 #include "rtError.h"
 #include "rtFile.h"
 #include "rtString.h"
+#include "rtBuffer.h"
 
 extern "C"
 {
@@ -47,10 +48,16 @@ public:
   rtError getFilePathAtIndex(uint32_t i,rtString& filePath) const;
 
   rtError getFileData(const char* filePath,rtData& d) const;
+  // inflated straight into a new buffer, ready to be handed to script
+  rtError getFileData(const char* filePath,rtBufferRef& b) const;
 
   static bool isZip(const void* buffer, size_t bufferSize);
 
 private:
+  // size of the file at filePath, which becomes the current one
+  rtError locateFile(const char* filePath, uint32_t& size) const;
+  rtError readCurrentFile(uint8_t* data, uint32_t size) const;
+
   unzFile mUnzFile;
   rtData mData;
 
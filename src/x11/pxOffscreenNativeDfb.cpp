@@ -8,6 +8,7 @@
 #include <stdlib.h>
 
 #include "pxBuffer.h"
+#include "../pxPixelConvert.h"
 
 pxError pxOffscreen::init(int width, int height)
 {
@@ -49,6 +50,25 @@ void pxOffscreenNative::swizzleTo(rtPixelFmt fmt)
 {
   // printf("\nDEBUG:   pxOffscreenNative::swizzleTo(rtPixelFmt fmt) - Format = %s (%d) ",
   //        rtPixelFmt2str(mPixelFormat), mPixelFormat); fflush(stdout); // JUNK
+
+  // RGBA and ARGB only differ in where red and blue are
+  if (mPixelFormat == fmt ||
+      (mPixelFormat == RT_PIX_RGBA && fmt == RT_PIX_ARGB) ||
+      (mPixelFormat == RT_PIX_ARGB && fmt == RT_PIX_RGBA))
+  {
+    if (mPixelFormat != fmt)
+    {
+      const pxConvertKernels& k = pxConvert();
+      for (int y = 0; y < height(); y++)
+      {
+        uint32_t* p = scanlineInt32(y);
+        k.swapRB(p, p, width());
+      }
+    }
+    mPixelFormat = RT_DEFAULT_PIX;
+    return;
+  }
+
 #if 1
   // Setup SRC indexes
   switch(mPixelFormat)
@@ -0,0 +1,69 @@
+"use strict";
+
+// Property get and set rates through the rtObject wrappers.  Objects with
+// their own method map (rects, text...) use accessors generated from it,
+// map objects like the one textureMemory() returns always use the generic
+// interceptors.  Run once as is and once with RT_GENERIC_PROPERTIES=1 set
+// to compare against the interceptors for everything.
+//
+//  ./pxscene property_bench.js
+
+px.import("px:scene.1.js").then( function ready(scene) {
+
+  var root = scene.root;
+  var rect = scene.create({t:"rect", parent:root, w:100, h:100, fillColor:0xff0000ff});
+  var text = scene.create({t:"text", parent:root, y:200, text:"property bench"});
+  var map = scene.textureMemory();
+
+  var iterations = 200000;
+  var sink = 0;
+
+  // best of a few runs, the machine may be busy
+  function rate(name, f) {
+    var best = 0;
+    for (var r = 0; r < 5; r++) {
+      var start = Date.now();
+      f();
+      var ms = Math.max(Date.now() - start, 1);
+      if (r == 0 || ms < best)
+        best = ms;
+    }
+    console.log("  " + name + ": " + Math.round(iterations/best) + "k ops/s (" + best + " ms)");
+  }
+
+  console.log("property_bench: " + iterations + " ops per run");
+
+  rate("rect.x get", function() {
+    for (var i = 0; i < iterations; i++)
+      sink += rect.x;
+  });
+  rate("rect.x set", function() {
+    for (var i = 0; i < iterations; i++)
+      rect.x = i & 255;
+  });
+  rate("rect.fillColor get", function() {
+    for (var i = 0; i < iterations; i++)
+      sink += rect.fillColor;
+  });
+  rate("rect.a set", function() {
+    for (var i = 0; i < iterations; i++)
+      rect.a = (i & 255)/255;
+  });
+  rate("text.text get", function() {
+    for (var i = 0; i < iterations; i++)
+      sink += text.text.length;
+  });
+  rate("rect.animateTo get", function() {
+    for (var i = 0; i < iterations; i++)
+      sink += rect.animateTo ? 1 : 0;
+  });
+  rate("map.used get (interceptor)", function() {
+    for (var i = 0; i < iterations; i++)
+      sink += map.used;
+  });
+
+  console.log("property_bench done " + (sink ? "" : "-"));
+
+  }).catch( function importFailed(err){
+  console.error("Import for property_bench.js failed: " + err)
+});
@@ -1,5 +1,59 @@
 #include "gtest/gtest.h"
 #include "pxContext.h"
+#include "pxOffscreen.h"
+#include "pxTimer.h"
+#include "pxUtil.h"
+#include "pxWindow.h"
+#include "rtThreadQueue.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+extern pxContext context;
+extern rtThreadQueue gUIThreadQueue;
+
+// The texture tests draw, so they need a current gl context, which nothing
+// else in the tests makes.  A small window makes one where there's a
+// display, without one those tests pass without checking anything.
+static bool glContextReady()
+{
+  static int ready = -1;
+  if (ready < 0)
+  {
+    ready = 0;
+#ifdef PX_PLATFORM_GLUT
+    pxWindow* window = new pxWindow;
+    if (getenv("DISPLAY") && window->init(0, 0, 64, 64) == PX_OK)
+    {
+      context.init();
+      context.setSize(64, 64);
+      ready = 1;
+    }
+#endif
+    if (!ready)
+      rtLogWarn("no gl context, texture tests skipped");
+  }
+  return ready == 1;
+}
+
+// A w x h texture with a png of itself for its image data, so it can be
+// evicted and decoded again
+static pxTextureRef createImageTexture(int w, int h)
+{
+  pxOffscreen o;
+  o.init(w, h);
+  o.fill(pxRed);
+  rtData png;
+  pxStorePNGImage(o, png);
+  pxOffscreen decoded;
+  pxLoadImage((const char*)png.data(), png.length(), decoded);
+  return context.createTexture(decoded);
+}
+
+static void drawTexture(pxTextureRef t)
+{
+  context.drawImage(0, 0, t->width(), t->height(), t, pxTextureRef());
+}
 
 bool outlinesTest(bool value)
 {
@@ -14,3 +68,188 @@ TEST(pxScene2dTests, pxContextOutlinesTest)
     EXPECT_TRUE (outlinesTest(false) == false);
 }
 
+
+TEST(pxScene2dTests, pxContextTextureResidencyTest)
+{
+    pxContext a;
+    pxTextureResidencyStats stats;
+    a.textureResidencyStats(stats);
+    EXPECT_TRUE (stats.evictedTextures == 0);
+
+    // nothing to evict, under the limit only while the bytes fit
+    a.setTextureMemoryLimit(1024);
+    EXPECT_TRUE (a.evictTextures(1024, 0) == true);
+    EXPECT_TRUE (a.evictTextures(1025, 0) == false);
+    EXPECT_TRUE (a.texturesReady() == false);
+}
+
+TEST(pxScene2dTests, pxContextTextureUploadBudgetTest)
+{
+    pxContext a;
+    a.setTextureUploadBudget(1024*1024);
+    pxTextureUploadStats stats;
+    a.textureUploadStats(stats);
+    EXPECT_TRUE (stats.budget == 1024*1024);
+    EXPECT_TRUE (stats.frameDeferred == 0);
+    a.setTextureUploadBudget(PXSCENE_DEFAULT_TEXTURE_UPLOAD_BUDGET_IN_BYTES);
+}
+
+TEST(pxScene2dTests, pxContextTextureEvictionTest)
+{
+    if (!glContextReady())
+      return;
+
+    int64_t limit = context.textureMemoryLimitInBytes();
+    context.setTextureUploadBudget(0);
+    context.setTextureEvictionAge(1);
+
+    pxTextureResidencyStats before;
+    context.textureResidencyStats(before);
+
+    // drawn a frame apart, least recently drawn first
+    const int count = 4;
+    const int64_t bytes = 32*32*4;
+    pxTextureRef t[count];
+    for (int i = 0; i < count; i++)
+    {
+      t[i] = createImageTexture(32, 32);
+      drawTexture(t[i]);
+      context.endFrame();
+    }
+    pxTextureResidencyStats stats;
+    context.textureResidencyStats(stats);
+    EXPECT_TRUE (stats.residentTextures == before.residentTextures + count);
+    EXPECT_TRUE (stats.residentBytes == before.residentBytes + count*bytes);
+
+    // over the limit by two textures, the first two drawn go at the end of
+    // the frame
+    context.setTextureMemoryLimit(context.currentTextureMemoryUsageInBytes() - 2*bytes);
+    context.endFrame();
+    context.textureResidencyStats(stats);
+    EXPECT_TRUE (stats.evictions == before.evictions + 2);
+    EXPECT_TRUE (stats.evictedTextures == before.evictedTextures + 2);
+    EXPECT_TRUE (stats.residentTextures == before.residentTextures + count - 2);
+    EXPECT_TRUE (t[0]->loading() && t[1]->loading());
+    EXPECT_TRUE (!t[2]->loading() && !t[3]->loading());
+
+    // drawing an evicted one decodes it again in the background, it's
+    // uploaded on a draw after that
+    context.setTextureMemoryLimit(limit);
+    double start = pxSeconds();
+    while (t[0]->loading() && pxSeconds() - start < 5)
+    {
+      drawTexture(t[0]);
+      context.endFrame();
+      gUIThreadQueue.process(0.01);
+      usleep(1000);
+    }
+    EXPECT_TRUE (!t[0]->loading());
+    EXPECT_TRUE (context.texturesReady() == true);
+    context.textureResidencyStats(stats);
+    EXPECT_TRUE (stats.reloads == before.reloads + 1);
+    EXPECT_TRUE (stats.evictedTextures == before.evictedTextures + 1);
+
+    for (int i = 0; i < count; i++)
+      t[i] = NULL;
+    context.textureResidencyStats(stats);
+    EXPECT_TRUE (stats.residentTextures == before.residentTextures);
+    EXPECT_TRUE (stats.evictedTextures == before.evictedTextures);
+
+    context.setTextureUploadBudget(PXSCENE_DEFAULT_TEXTURE_UPLOAD_BUDGET_IN_BYTES);
+    context.setTextureEvictionAge(PXSCENE_DEFAULT_TEXTURE_EVICTION_AGE_IN_FRAMES);
+}
+
+TEST(pxScene2dTests, pxContextTextureUploadTest)
+{
+    if (!glContextReady())
+      return;
+
+    // 64 rows of 256 bytes, a quarter of them a frame
+    context.setTextureUploadBudget(64*64);
+    pxTextureRef t = createImageTexture(64, 64);
+    pxTextureUploadStats stats;
+    int frames = 0;
+    while (t->loading() && frames < 10)
+    {
+      drawTexture(t);
+      context.endFrame();
+      context.textureUploadStats(stats);
+      EXPECT_TRUE (stats.frameBytes == 64*64);
+      frames++;
+    }
+    EXPECT_TRUE (!t->loading());
+    EXPECT_TRUE (frames == 4);
+
+    // nothing draws a render target again, so it all goes up at once
+    pxTextureRef t2 = createImageTexture(64, 64);
+    pxContextFramebufferRef fbo = context.createFramebuffer(64, 64);
+    pxContextFramebufferRef previous = context.getCurrentFramebuffer();
+    context.setFramebuffer(fbo);
+    drawTexture(t2);
+    context.setFramebuffer(previous);
+    EXPECT_TRUE (!t2->loading());
+    context.endFrame();
+
+    context.setTextureUploadBudget(PXSCENE_DEFAULT_TEXTURE_UPLOAD_BUDGET_IN_BYTES);
+}
+
+TEST(pxScene2dTests, pxContextFramebufferPoolTest)
+{
+    if (!glContextReady())
+      return;
+
+    pxFramebufferPoolStats before, stats;
+    context.framebufferPoolStats(before);
+    pxContextFramebufferRef previous = context.getCurrentFramebuffer();
+
+    // fills all of its 112x64 bucket
+    float green[4] = {0, 1, 0, 1};
+    pxContextFramebufferRef fbo = context.createFramebuffer(112, 64);
+    context.setFramebuffer(fbo);
+    context.clear(112, 64, green);
+    context.setFramebuffer(previous);
+    fbo = NULL;
+    context.framebufferPoolStats(stats);
+    EXPECT_TRUE (stats.allocated == before.allocated+1);
+    EXPECT_TRUE (stats.pooled == before.pooled+1);
+    EXPECT_TRUE (stats.pooledBytes == before.pooledBytes+112*64*4);
+
+    // same bucket, then a resize that still fits it
+    fbo = context.createFramebuffer(100, 50);
+    context.updateFramebuffer(fbo, 100, 60);
+    context.framebufferPoolStats(stats);
+    EXPECT_TRUE (stats.allocated == before.allocated+1);
+    EXPECT_TRUE (stats.reused == before.reused+2);
+    EXPECT_TRUE (stats.pooled == before.pooled);
+
+    // scaled up, the edges mustn't pick up the green left past 100x60
+    float red[4] = {1, 0, 0, 1};
+    context.setFramebuffer(fbo);
+    context.drawRect(100, 60, 0, red, red);
+    pxContextFramebufferRef scaled = context.createFramebuffer(200, 120);
+    context.setFramebuffer(scaled);
+    context.drawImage(0, 0, 200, 120, fbo->getTexture(), pxTextureRef(), false);
+    pxOffscreen o;
+    context.snapshot(o);
+    context.setFramebuffer(previous);
+    EXPECT_TRUE (o.pixel(199, 60)->g == 0);
+    EXPECT_TRUE (o.pixel(100, 0)->g == 0);
+    EXPECT_TRUE (o.pixel(100, 119)->g == 0);
+    EXPECT_TRUE (o.pixel(100, 60)->r == 255);
+
+    // pooled ones go once they're older than the pool age
+    fbo = NULL;
+    scaled = NULL;
+    context.setFramebufferPoolAge(2);
+    context.endFrame();
+    context.framebufferPoolStats(stats);
+    EXPECT_TRUE (stats.released == before.released);
+    context.endFrame();
+    context.endFrame();
+    context.framebufferPoolStats(stats);
+    EXPECT_TRUE (stats.pooled == 0);
+    EXPECT_TRUE (stats.pooledBytes == 0);
+    EXPECT_TRUE (stats.released >= before.released+2);
+
+    context.setFramebufferPoolAge(PXSCENE_DEFAULT_FRAMEBUFFER_POOL_AGE_IN_FRAMES);
+}
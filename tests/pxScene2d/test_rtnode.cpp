@@ -1,9 +1,15 @@
 #include "gtest/gtest.h"
 
 #include "rtNode.h"
+#include "rtObjectMacros.h"
 
 #include "pxTimer.h"
 
+#include <atomic>
+#include <fstream>
+#include <thread>
+#include <unistd.h>
+
 
 bool rtNodeInit()
 {
@@ -81,3 +87,456 @@ TEST(pxScene2dTests, rtNodeTests)
     // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 }
 
+
+TEST(pxScene2dTests, rtNodeCallbackTests)
+{
+    extern rtNode script;
+
+    rtNodeContextRef ctx = script.createContext();
+    ctx->runScript("var count = 0; function onEvent(x, y) { count += x + y; }");
+
+    rtFunctionRef onEvent = ctx->get("onEvent").toFunction();
+    EXPECT_TRUE( onEvent.getPtr() != NULL );
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // A frame's worth of events is queued and runs on the next pump
+
+    const int count = 10000;
+
+    double s = pxMilliseconds();
+
+    for (int i = 0; i < count; i++)
+      onEvent.send(rtValue(1), rtValue(0));
+
+    double queued = pxMilliseconds();
+
+    script.pump();
+
+    double e = pxMilliseconds();
+
+    EXPECT_TRUE( ctx->get("count").toInt32() == count );
+
+    // printf("\n %d callbacks: queued in %.2f ms, ran in %.2f ms, %.0f callbacks/s\n\n",
+    //        count, queued - s, e - queued, count/((e - s)/1000));
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+}
+
+
+TEST(pxScene2dTests, rtNodeCodeCacheTests)
+{
+    extern rtNode script;
+
+    if (!rtNodeCodeCacheEnabled())
+      return;
+
+    char dir[] = "/tmp/rtcodecacheXXXXXX";
+    ASSERT_TRUE( mkdtemp(dir) != NULL );
+    setenv("RT_CODE_CACHE_DIR", dir, 1);
+
+    std::string file = std::string(dir) + "/cached.js";
+    std::string source;
+    for (int i = 0; i < 500; i++)
+    {
+      char line[128];
+      sprintf(line, "function f%d(x) { return x*%d + (x >> 1); }\n", i, i);
+      source += line;
+    }
+    source += "var cached = f499(2);\n";
+    {
+      std::ofstream out(file.c_str());
+      out << source;
+    }
+
+    rtNodeContextRef ctx = script.createContext();
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // The first run compiles from source and writes the cache, the second
+    // compiles from it
+
+    rtNodeCodeCacheStats before, after;
+    rtNodeCodeCacheGetStats(before);
+
+    double s = pxMilliseconds();
+    ctx->runFile(file.c_str());
+    double cold = pxMilliseconds() - s;
+
+    rtNodeCodeCacheGetStats(after);
+    EXPECT_TRUE( after.misses  == before.misses + 1 );
+    EXPECT_TRUE( after.written == before.written + 1 );
+    EXPECT_TRUE( ctx->get("cached").toInt32() == 499*2 + 1 );
+
+    s = pxMilliseconds();
+    ctx->runFile(file.c_str());
+    double warm = pxMilliseconds() - s;
+
+    before = after;
+    rtNodeCodeCacheGetStats(after);
+    EXPECT_TRUE( after.hits == before.hits + 1 );
+    EXPECT_TRUE( ctx->get("cached").toInt32() == 499*2 + 1 );
+
+    // printf("\n runFile() - from source = %f ms, from code cache = %f ms\n\n", cold, warm);
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // An edited file doesn't use the old cache
+
+    {
+      std::ofstream out(file.c_str(), std::ios::app);
+      out << "cached = 7;\n";
+    }
+
+    before = after;
+    ctx->runFile(file.c_str());
+    rtNodeCodeCacheGetStats(after);
+    EXPECT_TRUE( after.hits   == before.hits );
+    EXPECT_TRUE( after.misses == before.misses + 1 );
+    EXPECT_TRUE( ctx->get("cached").toInt32() == 7 );
+
+    std::string cache = std::string(dir) + "/" + file + ".cache";
+    for (size_t i = strlen(dir) + 1; i < cache.size(); i++)
+    {
+      if (cache[i] == '/')
+        cache[i] = '_';
+    }
+    unlink(cache.c_str());
+    unsetenv("RT_CODE_CACHE_DIR");
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // Without a directory given the cache goes under the user's, not next to
+    // the script
+
+    const char* xdg = getenv("XDG_CACHE_HOME");
+    std::string oldXdg = xdg ? xdg : "";
+    setenv("XDG_CACHE_HOME", dir, 1);
+
+    before = after;
+    ctx->runFile(file.c_str());
+    rtNodeCodeCacheGetStats(after);
+    EXPECT_TRUE( after.written == before.written + 1 );
+
+    std::string userDir = std::string(dir) + "/pxscene/codecache";
+    cache = userDir + "/" + file + ".cache";
+    for (size_t i = userDir.size() + 1; i < cache.size(); i++)
+    {
+      if (cache[i] == '/')
+        cache[i] = '_';
+    }
+    EXPECT_TRUE( access(cache.c_str(), R_OK) == 0 );
+    EXPECT_TRUE( access((file + ".cache").c_str(), F_OK) != 0 );
+
+    if (xdg)
+      setenv("XDG_CACHE_HOME", oldXdg.c_str(), 1);
+    else
+      unsetenv("XDG_CACHE_HOME");
+    unlink(cache.c_str());
+    rmdir(userDir.c_str());
+    rmdir((std::string(dir) + "/pxscene").c_str());
+    unlink(file.c_str());
+    rmdir(dir);
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+}
+
+
+TEST(pxScene2dTests, rtNodeContextPoolTests)
+{
+    extern rtNode script;
+
+    int size = script.contextPoolSize();
+    script.setContextPool(2);
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // Warming stops at the pool size
+
+    EXPECT_TRUE( script.warmContextPool() == true );
+    EXPECT_TRUE( script.warmContextPool() == true );
+    EXPECT_TRUE( script.warmContextPool() == false );
+
+    rtNodeContextPoolStats before, after;
+    script.contextPoolStats(before);
+
+    double s = pxMilliseconds();
+    rtNodeContextRef ctx1 = script.createContext();
+    rtNodeContextRef ctx2 = script.createContext();
+    double pooled = (pxMilliseconds() - s)/2;
+
+    s = pxMilliseconds();
+    rtNodeContextRef ctx3 = script.createContext();
+    double fresh = pxMilliseconds() - s;
+
+    script.contextPoolStats(after);
+
+    EXPECT_TRUE( ctx1.getPtr() != NULL && ctx2.getPtr() != NULL && ctx3.getPtr() != NULL );
+    EXPECT_TRUE( ctx1.getPtr() != ctx2.getPtr() );
+    EXPECT_TRUE( after.hits   == before.hits + 2 );
+    EXPECT_TRUE( after.misses == before.misses + 1 );
+
+    // a pooled context works like any other
+    ctx1->add("Foo", rtString("Foo"));
+    EXPECT_TRUE( ctx1->has("Foo") == true );
+    EXPECT_TRUE( ctx2->has("Foo") == false );
+
+    // printf("\n createContext() - from pool = %f ms, new = %f ms, %.2f ms saved\n\n",
+    //        pooled, fresh, after.savedMs - before.savedMs);
+    (void)pooled; (void)fresh;
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // Not when the frame deadline has no room for it
+
+    script.setFrameDeadline(pxSeconds());
+    EXPECT_TRUE( script.warmContextPool() == false );
+    script.setFrameDeadline(pxSeconds() + 10);
+    EXPECT_TRUE( script.warmContextPool() == true );
+
+    // but a pool drawn from while no frame has room still refills
+
+    rtNodeContextRef ctx4 = script.createContext();
+    int frames = 0;
+    bool warmed = false;
+    while (!warmed && frames < 1000)
+    {
+      script.setFrameDeadline(pxSeconds());
+      warmed = script.warmContextPool();
+      frames++;
+    }
+    EXPECT_TRUE( warmed == true );
+    EXPECT_TRUE( frames > 1 );
+    script.setFrameDeadline(0);
+
+    script.setContextPool(size);
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+}
+
+
+TEST(pxScene2dTests, rtNodeGcSchedulerTests)
+{
+    extern rtNode script;
+
+    rtNodeContextRef ctx = script.createContext();
+    ctx->runScript("var garbage = []; for (var i = 0; i < 100000; i++) garbage.push({ i: i }); garbage = null;");
+
+    rtNodeGcStats stats;
+    rtNodeGcStatsCollect(stats);
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // Idle time goes to V8 only when there's enough of it before the deadline
+
+    script.setFrameDeadline(pxSeconds());
+    script.idleGarbageCollect();
+    rtNodeGcStatsCollect(stats);
+    EXPECT_TRUE( stats.idleNotifications == 0 );
+
+    script.setFrameDeadline(pxSeconds() + 0.010);
+    script.idleGarbageCollect();
+    rtNodeGcStatsCollect(stats);
+    EXPECT_TRUE( stats.idleNotifications == 1 );
+    EXPECT_TRUE( stats.idleMs > 0 && stats.idleMs <= 10 );
+
+    // the deadline is used once
+    script.idleGarbageCollect();
+    rtNodeGcStatsCollect(stats);
+    EXPECT_TRUE( stats.idleNotifications == 0 );
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // Critical pressure collects now, and every pause lands in the histogram
+
+    script.memoryPressure(true);
+    rtNodeGcStatsCollect(stats);
+    EXPECT_TRUE( stats.collections > 0 );
+
+    uint32_t pauses = 0;
+    for (int i = 0; i < RT_NODE_GC_PAUSE_BUCKETS; i++)
+      pauses += stats.pauses[i];
+    EXPECT_TRUE( pauses == stats.collections );
+    EXPECT_TRUE( stats.maxPauseMs <= stats.pauseMs );
+
+    // printf("\n memoryPressure(critical) - %u collections, %f ms, max pause %f ms\n\n",
+    //        stats.collections, stats.pauseMs, stats.maxPauseMs);
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+}
+
+
+TEST(pxScene2dTests, rtNodeBufferTests)
+{
+    extern rtNode script;
+
+    rtNodeContextRef ctx = script.createContext();
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // Native to script and back, over the same memory
+
+    rtBufferRef b = rtBuffer::create(16);
+    ctx->add("buf", b);
+    ctx->runScript("var bytes = new Uint8Array(buf); bytes[3] = 42; var tail = bytes.subarray(8);");
+
+    EXPECT_TRUE( b->data()[3] == 42 );
+
+    rtBufferRef same = ctx->get("buf").toBuffer();
+    EXPECT_TRUE( same.getPtr() == b.getPtr() );
+
+    // a view is a slice of the buffer it's over
+    rtBufferRef tail = ctx->get("tail").toBuffer();
+    EXPECT_TRUE( tail.getPtr() != NULL );
+    EXPECT_TRUE( tail->data() == b->data() + 8 );
+    EXPECT_TRUE( tail->length() == 8 );
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // Script to native, the memory stays where v8 put it
+
+    ctx->runScript("var made = new Uint8Array(4096); made[0] = 7;");
+    rtBufferRef made = ctx->get("made").toBuffer();
+    EXPECT_TRUE( made.getPtr() != NULL );
+    EXPECT_TRUE( made->length() == 4096 && made->data()[0] == 7 );
+
+    ctx->runScript("made[1] = 9;");
+    EXPECT_TRUE( made->data()[1] == 9 );
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+}
+
+
+// Has its own map, so it's wrapped with the accessors made from it, and
+// answers one name that isn't in the map
+class rtNodeTestObject : public rtObject
+{
+public:
+  rtDeclareObject(rtNodeTestObject, rtObject);
+  rtProperty(x, x, setX, int32_t);
+  rtMethod1ArgAndReturn("twice", twice, int32_t, int32_t);
+
+  rtNodeTestObject() : mX(0), mExtra(0) {}
+
+  rtError x(int32_t& v) const { v = mX; return RT_OK; }
+  rtError setX(int32_t v)
+  {
+    if (v < 0)
+      return RT_ERROR_INVALID_ARG;
+    mX = v;
+    return RT_OK;
+  }
+  rtError twice(int32_t v, int32_t& r) { r = v*2; return RT_OK; }
+
+  using rtObject::Get;
+  using rtObject::Set;
+
+  virtual rtError Get(const char* name, rtValue* value) const
+  {
+    if (strcmp(name, "extra") == 0)
+    {
+      *value = mExtra;
+      return RT_OK;
+    }
+    return rtObject::Get(name, value);
+  }
+
+  virtual rtError Set(const char* name, const rtValue* value)
+  {
+    if (strcmp(name, "extra") == 0)
+    {
+      mExtra = value->toInt32();
+      return RT_OK;
+    }
+    return rtObject::Set(name, value);
+  }
+
+  int32_t mX;
+  int32_t mExtra;
+};
+
+rtDefineObject(rtNodeTestObject, rtObject);
+rtDefineProperty(rtNodeTestObject, x);
+rtDefineMethod(rtNodeTestObject, twice);
+
+TEST(pxScene2dTests, rtNodeClassTemplateTests)
+{
+    extern rtNode script;
+
+    rtNodeContextRef ctx = script.createContext();
+
+    rtNodeTestObject* o = new rtNodeTestObject;
+    rtObjectRef ref = o;
+    ctx->add("obj", ref);
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // Mapped properties and methods go through the accessors
+
+    o->mX = 5;
+    ctx->runScript("var x = obj.x; obj.x = 12; var twice = obj.twice(21);");
+    EXPECT_TRUE( ctx->get("x").toInt32() == 5 );
+    EXPECT_TRUE( o->mX == 12 );
+    EXPECT_TRUE( ctx->get("twice").toInt32() == 42 );
+
+    // a setter's error is thrown, and the value left alone
+    ctx->runScript("var threw = false; try { obj.x = -1; } catch (e) { threw = true; }");
+    EXPECT_TRUE( ctx->get("threw").toBool() == true );
+    EXPECT_TRUE( o->mX == 12 );
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // Anything else falls back to Get and Set by name
+
+    o->mExtra = 3;
+    ctx->runScript("var extra = obj.extra; obj.extra = 9;");
+    EXPECT_TRUE( ctx->get("extra").toInt32() == 3 );
+    EXPECT_TRUE( o->mExtra == 9 );
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+}
+
+
+TEST(pxScene2dTests, rtNodeSceneLockTests)
+{
+    rtWrapperSceneLockStats stats;
+    rtWrapperSetSceneLockStatsEnabled(true);
+    rtWrapperSceneLockStatsCollect(stats);
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // Nested enters only count, the lock goes with the last exit
+
+    EXPECT_TRUE( !rtWrapperSceneUpdateHasLock() );
+    rtWrapperSceneUpdateEnter();
+    rtWrapperSceneUpdateEnter();
+    rtWrapperSceneUpdateEnter();
+    EXPECT_TRUE( rtWrapperSceneUpdateHasLock() );
+    rtWrapperSceneUpdateExit();
+    rtWrapperSceneUpdateExit();
+    EXPECT_TRUE( rtWrapperSceneUpdateHasLock() );
+    rtWrapperSceneUpdateExit();
+    EXPECT_TRUE( !rtWrapperSceneUpdateHasLock() );
+
+    rtWrapperSceneLockStatsCollect(stats);
+    EXPECT_TRUE( stats.acquired == 1 );
+    EXPECT_TRUE( stats.contended == 0 );
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // Another thread can take it once it's gone.  Without RUNINMAIN only
+    // the main thread takes it.  Whether the other thread got as far as
+    // waiting before it was let go is up to the scheduler, so contention
+    // isn't checked.
+
+#ifdef RUNINMAIN
+    rtWrapperSceneUpdateEnter();
+    std::atomic<bool> started(false);
+    bool hadLock = false;
+    std::thread other([&started, &hadLock]() {
+      started = true;
+      rtWrapperSceneUpdateEnter();
+      hadLock = rtWrapperSceneUpdateHasLock();
+      rtWrapperSceneUpdateExit();
+    });
+    while (!started)
+      std::this_thread::yield();
+    rtWrapperSceneUpdateExit();
+    other.join();
+    EXPECT_TRUE( hadLock );
+    EXPECT_TRUE( !rtWrapperSceneUpdateHasLock() );
+
+    rtWrapperSceneLockStatsCollect(stats);
+    EXPECT_TRUE( stats.acquired == 2 );
+#endif
+
+    rtWrapperSetSceneLockStatsEnabled(getenv("RT_SCENE_LOCK_STATS") != NULL);
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+}